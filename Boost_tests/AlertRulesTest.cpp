@@ -0,0 +1,91 @@
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+#include "../include/AlertRules.h"
+#include "TestScript.h"
+
+namespace {
+    std::vector<std::string> feed(AlertRules& rules, const std::string& series, double value, int64_t timestamp) {
+        return rules.evaluate({{series, value}}, timestamp);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ALERT_RULES_ARE_PARSED)
+{
+    AlertRules rules;
+    BOOST_CHECK(rules.empty());
+    for(auto rule : {"a > 1", "a >= 1", "a < 1", "a <= 1", "a == 1", "a != 1", "a > 1.5 for 30", "a > -2 for 0.5"}) {
+        BOOST_CHECK_NO_THROW(rules.add(rule));
+    }
+    BOOST_CHECK(!rules.empty());
+    for(auto rule : {"", "a", "a >", "a > x", "a => 1", "a > 1 during 5", "a > 1 for", "a > 1 for -1",
+                     "a > 1 for 5 more"}) {
+        BOOST_CHECK_THROW(rules.add(rule), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ALERT_WITHOUT_DURATION_FIRES_AND_RESOLVES_ONCE)
+{
+    AlertRules rules;
+    rules.add("load1 > 2");
+    BOOST_CHECK(feed(rules, "load1", 1, 0).empty());
+    auto messages = feed(rules, "load1", 3, 1000);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK_EQUAL(messages[0], "Alert load1 > 2 is firing, value is 3.\n");
+    // only transitions are reported
+    BOOST_CHECK(feed(rules, "load1", 4, 2000).empty());
+    messages = feed(rules, "load1", 2, 3000);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK_EQUAL(messages[0], "Alert load1 > 2 resolved, value is 2.\n");
+    BOOST_CHECK(feed(rules, "load1", 1, 4000).empty());
+    BOOST_CHECK(feed(rules, "other", 10, 5000).empty());
+}
+
+BOOST_AUTO_TEST_CASE(ALERT_WITH_DURATION_FIRES_WHEN_CONDITION_HOLDS_LONG_ENOUGH)
+{
+    AlertRules rules;
+    rules.add("fds >= 100 for 10");
+    BOOST_CHECK(feed(rules, "fds", 100, 0).empty());
+    BOOST_CHECK(feed(rules, "fds", 150, 9999).empty());
+    // condition broken meanwhile, pending time starts again
+    BOOST_CHECK(feed(rules, "fds", 99, 10000).empty());
+    BOOST_CHECK(feed(rules, "fds", 120, 11000).empty());
+    BOOST_CHECK(feed(rules, "fds", 120, 20999).empty());
+    auto messages = feed(rules, "fds", 120, 21000);
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK_EQUAL(messages[0], "Alert fds >= 100 for 10s is firing, value is 120.\n");
+    BOOST_CHECK_EQUAL(feed(rules, "fds", 3, 22000).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(ALERT_RULES_OF_ONE_SAMPLE_ARE_EVALUATED_TOGETHER)
+{
+    AlertRules rules;
+    rules.add("memory_available < 1000");
+    rules.add("memory_available != 5000");
+    rules.add("swap_free == 0");
+    auto messages = rules.evaluate({{"memory_available", 10}, {"swap_free", 0}, {"load1", 7}}, 0);
+    BOOST_REQUIRE_EQUAL(messages.size(), 3u);
+    BOOST_CHECK_EQUAL(messages[0], "Alert memory_available < 1000 is firing, value is 10.\n");
+    BOOST_CHECK_EQUAL(messages[1], "Alert memory_available != 5000 is firing, value is 10.\n");
+    BOOST_CHECK_EQUAL(messages[2], "Alert swap_free == 0 is firing, value is 0.\n");
+    messages = rules.evaluate({{"memory_available", 5000}}, 1000);
+    BOOST_REQUIRE_EQUAL(messages.size(), 2u);
+    BOOST_CHECK_EQUAL(messages[1], "Alert memory_available != 5000 resolved, value is 5000.\n");
+}
+
+// without alert_mail transitions are printed by the polling handler
+BOOST_AUTO_TEST_CASE(CHECK_SYSTEM_PRINTS_FIRING_ALERT)
+{
+    BOOST_CHECK_THROW(runScript("system_handler h\nh.register = \"check_system\"\nh.alert = \"fds >\"\n$"),
+                      std::runtime_error);
+    auto output = runScript(
+            "system_handler h\nh.register = \"check_system\"\nh.raport_type = \"fds\"\nh.freq = \"0.05\"\n"
+            "h.alert = \"fds > 0\"\nh.alert = \"fds < 0\"\nh.start\n"
+            "system_handler t\nt.register = \"run\"\nt.path = \"sleep 0.3\"\nt.start\nint s\ns = t.wait\n"
+            "h.stop\ns = h.wait\nput s\n$");
+    std::string firing = "Alert fds > 0 is firing, value is ";
+    BOOST_CHECK_EQUAL(output.rfind(firing, 0), 0u);
+    // fires once over several ticks, the other rule never does
+    BOOST_CHECK_EQUAL(output.find("Alert", firing.size()), std::string::npos);
+    BOOST_CHECK(output.size() > 17 && output.substr(output.size() - 17) == "137 of int type.\n");
+}
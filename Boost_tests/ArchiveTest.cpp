@@ -0,0 +1,156 @@
+#include <boost/test/unit_test.hpp>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "../include/Archive.h"
+
+namespace {
+    struct RawEntry {
+        std::string name;
+        char type;
+        std::string content;
+        std::string linkTarget;
+    };
+
+    void setOctal(char* field, size_t size, uint64_t value) {
+        snprintf(field, size, "%0*llo", (int)size - 1, (unsigned long long)value);
+    }
+
+    // hand made ustar stream, gzip compressed, for entries no well behaved writer produces
+    void writeTarGz(const std::string& path, const std::vector<RawEntry>& entries) {
+        std::string tar;
+        for(auto& entry : entries) {
+            char header[512] = {};
+            strncpy(header, entry.name.c_str(), 100);
+            setOctal(header + 100, 8, 0644);
+            setOctal(header + 108, 8, 0);
+            setOctal(header + 116, 8, 0);
+            setOctal(header + 124, 12, entry.content.size());
+            setOctal(header + 136, 12, 1000000000);
+            header[156] = entry.type;
+            strncpy(header + 157, entry.linkTarget.c_str(), 100);
+            memcpy(header + 257, "ustar", 6);
+            memcpy(header + 263, "00", 2);
+            memset(header + 148, ' ', 8);
+            unsigned checksum = 0;
+            for(unsigned char byte : header) {
+                checksum += byte;
+            }
+            setOctal(header + 148, 7, checksum);
+            tar.append(header, sizeof(header));
+            tar += entry.content;
+            tar.append((512 - entry.content.size() % 512) % 512, '\0');
+        }
+        tar.append(1024, '\0');
+        z_stream stream {};
+        deflateInit2(&stream, 6, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        std::string output(deflateBound(&stream, tar.size()), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(tar.data());
+        stream.avail_in = tar.size();
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = output.size();
+        deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        std::ofstream(path, std::ios::binary) << output;
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    }
+
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    void makeSource() {
+        system("rm -rf arc_src arc_out arc_tar arc_outside arc_test.tar.gz* && mkdir -p arc_src/sub arc_outside");
+        writeFile("arc_src/small", "small\n");
+        std::string big;
+        for(int i = 0; i < 200000; i++) {
+            big += std::to_string(i * 7919) + "\n";
+        }
+        writeFile("arc_src/sub/big", big);
+        writeFile("arc_src/sub/" + std::string(150, 'n'), "long name\n");
+        symlink("small", "arc_src/link");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ARCHIVE_ROUND_TRIP_KEEPS_TREE)
+{
+    makeSource();
+    WorkStealingPool pool(4);
+    auto written = ArchiveWriter("arc_test.tar.gz", 6, nullptr, pool).write("arc_src");
+    BOOST_CHECK(written.errors.empty());
+    BOOST_CHECK_EQUAL(written.files, 3u);
+    BOOST_CHECK(written.compressedBytes < written.bytes);
+
+    auto read = ArchiveReader("arc_test.tar.gz").extractAll("arc_out");
+    BOOST_CHECK(read.errors.empty());
+    BOOST_CHECK_EQUAL(read.files, 3u);
+    BOOST_CHECK_EQUAL(read.links, 1u);
+    for(auto name : {"small", "sub/big"}) {
+        BOOST_CHECK(readFile(std::string("arc_out/arc_src/") + name) == readFile(std::string("arc_src/") + name));
+    }
+    BOOST_CHECK_EQUAL(readFile("arc_out/arc_src/sub/" + std::string(150, 'n')), "long name\n");
+    char linkTarget[16] = {};
+    BOOST_CHECK(readlink("arc_out/arc_src/link", linkTarget, sizeof(linkTarget) - 1) > 0);
+    BOOST_CHECK_EQUAL(std::string(linkTarget), "small");
+}
+
+// output is a standard gzip stream, tar reads it
+BOOST_AUTO_TEST_CASE(ARCHIVE_IS_READ_BY_TAR)
+{
+    makeSource();
+    ArchiveWriter("arc_test.tar.gz", 1).write("arc_src");
+    BOOST_REQUIRE_EQUAL(system("mkdir -p arc_tar && tar xzf arc_test.tar.gz -C arc_tar"), 0);
+    BOOST_CHECK(readFile("arc_tar/arc_src/sub/big") == readFile("arc_src/sub/big"));
+}
+
+BOOST_AUTO_TEST_CASE(ARCHIVE_EXTRACTS_SINGLE_FILE_FROM_INDEX)
+{
+    makeSource();
+    ArchiveWriter("arc_test.tar.gz", 6).write("arc_src");
+    auto report = ArchiveReader("arc_test.tar.gz").extractFile("arc_src/sub/big", "arc_out");
+    BOOST_CHECK_EQUAL(report.files, 1u);
+    BOOST_CHECK(readFile("arc_out/arc_src/sub/big") == readFile("arc_src/sub/big"));
+    BOOST_CHECK(access("arc_out/arc_src/small", F_OK) == -1);
+    BOOST_CHECK_THROW(ArchiveReader("arc_test.tar.gz").extractFile("arc_src/missing", "arc_out"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ARCHIVE_REJECTS_PATH_TRAVERSAL)
+{
+    system("rm -rf arc_out arc_escaped && mkdir -p arc_out");
+    writeTarGz("arc_evil.tar.gz", {{"../arc_escaped", '0', "x", ""}, {"/tmp/arc_absolute", '0', "x", ""},
+                                   {"a/../../arc_escaped", '0', "x", ""}, {"fine", '0', "ok", ""}});
+    auto report = ArchiveReader("arc_evil.tar.gz").extractAll("arc_out/target");
+    BOOST_CHECK_EQUAL(report.errors.size(), 3u);
+    BOOST_CHECK_EQUAL(report.files, 1u);
+    BOOST_CHECK(access("arc_escaped", F_OK) == -1);
+    BOOST_CHECK(access("arc_out/arc_escaped", F_OK) == -1);
+    BOOST_CHECK(access("/tmp/arc_absolute", F_OK) == -1);
+    BOOST_CHECK_EQUAL(readFile("arc_out/target/fine"), "ok");
+}
+
+// a symlink extracted first must not carry later entries out of target
+BOOST_AUTO_TEST_CASE(ARCHIVE_DOES_NOT_WRITE_THROUGH_EXTRACTED_SYMLINKS)
+{
+    system("rm -rf arc_out arc_outside && mkdir -p arc_out arc_outside");
+    writeFile("arc_outside/victim", "original");
+    char directory[PATH_MAX];
+    auto outside = std::string(getcwd(directory, sizeof(directory))) + "/arc_outside";
+    writeTarGz("arc_evil.tar.gz", {{"dir", '2', "", outside}, {"dir/planted", '0', "x", ""},
+                                   {"file", '2', "", outside + "/victim"}, {"file", '0', "overwritten", ""},
+                                   {"dir/sub/deeper", '0', "x", ""}});
+    auto report = ArchiveReader("arc_evil.tar.gz").extractAll("arc_out");
+    BOOST_CHECK_EQUAL(report.errors.size(), 3u);
+    BOOST_CHECK_EQUAL(report.files, 0u);
+    BOOST_CHECK(access("arc_outside/planted", F_OK) == -1);
+    BOOST_CHECK(access("arc_outside/sub", F_OK) == -1);
+    BOOST_CHECK_EQUAL(readFile("arc_outside/victim"), "original");
+}
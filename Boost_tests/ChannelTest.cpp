@@ -0,0 +1,140 @@
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../include/Channel.h"
+#include "../include/WorkStealingPool.h"
+
+BOOST_AUTO_TEST_CASE(RING_CAPACITY_IS_ROUNDED_UP_TO_POWER_OF_TWO)
+{
+    MpmcRing<int> ring(5);
+    int value = 0;
+    for(int i = 0; i < 8; i++) {
+        value = i;
+        BOOST_CHECK(ring.tryPush(value));
+    }
+    value = 8;
+    BOOST_CHECK(!ring.tryPush(value));
+    BOOST_CHECK(ring.full());
+    for(int i = 0; i < 8; i++) {
+        BOOST_CHECK(ring.tryPop(value));
+        BOOST_CHECK_EQUAL(value, i);
+    }
+    BOOST_CHECK(!ring.tryPop(value));
+    BOOST_CHECK(ring.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SPSC_CHANNEL_KEEPS_ORDER_ACROSS_THREADS)
+{
+    Channel channel(16, true);
+    std::thread producer([&] {
+        for(int i = 0; i < 100000; i++) {
+            channel.send(i);
+        }
+        channel.close();
+    });
+    Channel::Value value;
+    int expected = 0;
+    while(channel.receive(value)) {
+        BOOST_REQUIRE_EQUAL(std::get<int>(value), expected);
+        expected++;
+    }
+    producer.join();
+    BOOST_CHECK_EQUAL(expected, 100000);
+    BOOST_CHECK(channel.isDrained());
+}
+
+BOOST_AUTO_TEST_CASE(MPMC_CHANNEL_DELIVERS_EVERY_VALUE_ONCE)
+{
+    Channel channel(8, false);
+    const int producers = 4;
+    const int perProducer = 20000;
+    std::vector<std::thread> threads;
+    for(int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for(int i = 0; i < perProducer; i++) {
+                channel.send(p * perProducer + i);
+            }
+        });
+    }
+    std::vector<std::vector<int>> received(3);
+    std::vector<std::thread> consumers;
+    for(auto& values : received) {
+        consumers.emplace_back([&channel, &values] {
+            Channel::Value value;
+            while(channel.receive(value)) {
+                values.push_back(std::get<int>(value));
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    channel.close();
+    for(auto& consumer : consumers) {
+        consumer.join();
+    }
+    std::set<int> unique;
+    size_t total = 0;
+    for(auto& values : received) {
+        total += values.size();
+        unique.insert(values.begin(), values.end());
+    }
+    BOOST_CHECK_EQUAL(total, (size_t)producers * perProducer);
+    BOOST_CHECK_EQUAL(unique.size(), (size_t)producers * perProducer);
+}
+
+BOOST_AUTO_TEST_CASE(CLOSED_CHANNEL_REFUSES_SENDS_AND_DRAINS)
+{
+    Channel channel(4, false);
+    BOOST_CHECK_EQUAL(channel.sendBatch({1, 2.5, std::string("\"x\"")}), 3u);
+    channel.close();
+    BOOST_CHECK(!channel.send(4));
+    BOOST_CHECK(!channel.isDrained());
+    std::vector<Channel::Value> values;
+    BOOST_CHECK_EQUAL(channel.receiveBatch(values, 10), 3u);
+    BOOST_CHECK_EQUAL(std::get<int>(values[0]), 1);
+    BOOST_CHECK_EQUAL(std::get<double>(values[1]), 2.5);
+    Channel::Value value;
+    BOOST_CHECK(!channel.receive(value));
+    BOOST_CHECK(channel.isDrained());
+}
+
+// consumers block every pool worker, producers queued behind them still have to run
+BOOST_AUTO_TEST_CASE(CHANNEL_TASKS_BLOCKING_EVERY_WORKER_DO_NOT_DEADLOCK)
+{
+    auto& pool = WorkStealingPool::instance();
+    size_t pairs = pool.size() + 2;
+    std::vector<std::shared_ptr<Channel>> channels;
+    for(size_t i = 0; i < pairs; i++) {
+        channels.push_back(std::make_shared<Channel>(1, true));
+    }
+    std::atomic<size_t> done {0};
+    for(auto& channel : channels) {
+        pool.submit([channel, &done] {
+            Channel::Value value;
+            int sum = 0;
+            while(channel->receive(value)) {
+                sum += std::get<int>(value);
+            }
+            if(sum == 45) {
+                done++;
+            }
+        });
+    }
+    for(auto& channel : channels) {
+        pool.submit([channel] {
+            for(int i = 0; i < 10; i++) {
+                channel->send(i);
+            }
+            channel->close();
+        });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(done < pairs && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    BOOST_REQUIRE_EQUAL(done.load(), pairs);
+}
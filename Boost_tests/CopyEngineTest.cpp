@@ -0,0 +1,118 @@
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/CopyEngine.h"
+
+namespace {
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    // src/{a, empty, big, sub/b, sub/deeper/c, link -> a}
+    void makeTree() {
+        system("rm -rf copy_src copy_dst && mkdir -p copy_src/sub/deeper copy_dst");
+        writeFile("copy_src/a", "alpha\n");
+        writeFile("copy_src/empty", "");
+        std::string big;
+        for(int i = 0; i < 300000; i++) {
+            big += std::to_string(i) + "\n";
+        }
+        writeFile("copy_src/big", big);
+        writeFile("copy_src/sub/b", "beta\n");
+        writeFile("copy_src/sub/deeper/c", "gamma\n");
+        symlink("a", "copy_src/link");
+        chmod("copy_src/sub/b", 0750);
+        timespec times[2] = {{1000000000, 0}, {1000000000, 500}};
+        utimensat(AT_FDCWD, "copy_src/sub/b", times, 0);
+        utimensat(AT_FDCWD, "copy_src/sub", times, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(COPY_ENGINE_COPIES_TREE_INTO_EXISTING_DIRECTORY)
+{
+    makeTree();
+    WorkStealingPool pool(4);
+    CopyEngine engine(pool);
+    auto report = engine.copy("copy_src/", "copy_dst");
+    BOOST_CHECK(report.errors.empty());
+    BOOST_CHECK_EQUAL(report.files, 5u);
+    BOOST_CHECK_EQUAL(report.links, 1u);
+    BOOST_CHECK_EQUAL(report.bytes, readFile("copy_src/big").size() + 6 + 5 + 6);
+    for(auto name : {"a", "empty", "big", "sub/b", "sub/deeper/c"}) {
+        BOOST_CHECK(readFile(std::string("copy_dst/copy_src/") + name) == readFile(std::string("copy_src/") + name));
+    }
+    char linkTarget[16] = {};
+    BOOST_CHECK(readlink("copy_dst/copy_src/link", linkTarget, sizeof(linkTarget) - 1) == 1);
+    BOOST_CHECK_EQUAL(std::string(linkTarget), "a");
+}
+
+BOOST_AUTO_TEST_CASE(COPY_ENGINE_KEEPS_MODES_AND_TIMESTAMPS)
+{
+    makeTree();
+    CopyEngine engine;
+    engine.mirror("copy_src", "copy_dst/mirror");
+    struct stat file {}, directory {};
+    BOOST_REQUIRE(stat("copy_dst/mirror/sub/b", &file) == 0);
+    BOOST_CHECK_EQUAL(file.st_mode & 07777, 0750u);
+    BOOST_CHECK_EQUAL(file.st_mtim.tv_sec, 1000000000);
+    BOOST_CHECK_EQUAL(file.st_mtim.tv_nsec, 500);
+    // set after its children were copied in
+    BOOST_REQUIRE(stat("copy_dst/mirror/sub", &directory) == 0);
+    BOOST_CHECK_EQUAL(directory.st_mtim.tv_sec, 1000000000);
+}
+
+BOOST_AUTO_TEST_CASE(COPY_ENGINE_HOOKS_FILTER_AND_SEE_FILES)
+{
+    makeTree();
+    CopyEngine engine;
+    std::mutex mutex;
+    std::vector<std::string> copied;
+    uint64_t hashes = 0;
+    engine.shouldCopy = [](const std::string& path, const struct stat&) { return path != "big"; };
+    engine.onCopied = [&](const std::string& path, const struct stat&, uint64_t hash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        copied.push_back(path);
+        hashes |= hash;
+    };
+    auto report = engine.mirror("copy_src", "copy_dst/filtered");
+    BOOST_CHECK_EQUAL(report.files, 4u);
+    BOOST_CHECK_EQUAL(report.skipped, 1u);
+    BOOST_CHECK(access("copy_dst/filtered/big", F_OK) == -1);
+    std::sort(copied.begin(), copied.end());
+    BOOST_CHECK(copied == (std::vector<std::string>{"a", "empty", "sub/b", "sub/deeper/c"}));
+    // not hashed unless asked for
+    BOOST_CHECK_EQUAL(hashes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(COPY_ENGINE_DOES_NOT_DESCEND_INTO_OWN_TARGET)
+{
+    makeTree();
+    CopyEngine engine;
+    auto report = engine.mirror("copy_src", "copy_src/sub/inner");
+    BOOST_CHECK(report.errors.empty());
+    BOOST_CHECK_EQUAL(readFile("copy_src/sub/inner/a"), "alpha\n");
+    BOOST_CHECK(access("copy_src/sub/inner/sub/inner", F_OK) == -1);
+}
+
+BOOST_AUTO_TEST_CASE(COPY_ENGINE_COPIES_SINGLE_FILE_THROTTLED)
+{
+    makeTree();
+    Throttle throttle(4 * 1024 * 1024, 0);
+    auto bytes = CopyEngine::copyFile("copy_src/big", "copy_dst/big", &throttle);
+    BOOST_CHECK_EQUAL(bytes, readFile("copy_src/big").size());
+    BOOST_CHECK(readFile("copy_dst/big") == readFile("copy_src/big"));
+    BOOST_CHECK_THROW(CopyEngine().copy("copy_missing", "copy_dst"), std::runtime_error);
+}
@@ -0,0 +1,203 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <csignal>
+#include <random>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/Chunker.h"
+#include "../include/DedupStore.h"
+#include "../include/Hash.h"
+
+namespace {
+    std::vector<unsigned char> randomBytes(size_t size, unsigned seed) {
+        std::mt19937_64 generator(seed);
+        std::vector<unsigned char> data(size);
+        for(size_t i = 0; i < size; i += sizeof(uint64_t)) {
+            auto value = generator();
+            memcpy(data.data() + i, &value, std::min(sizeof(value), size - i));
+        }
+        return data;
+    }
+
+    void writeFile(const std::string& path, const std::vector<unsigned char>& data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    std::vector<unsigned char> readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), {});
+    }
+
+    std::vector<std::pair<size_t, size_t>> chunksOf(const std::vector<unsigned char>& data) {
+        std::vector<std::pair<size_t, size_t>> chunks;
+        Chunker::split(data.data(), data.size(), [&](size_t offset, size_t length) {
+            chunks.emplace_back(offset, length);
+        });
+        return chunks;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(XXH64_MATCHES_REFERENCE_VALUES)
+{
+    BOOST_CHECK_EQUAL(Hasher::hash("", 0), 0xEF46DB3751D8E999ULL);
+    BOOST_CHECK_EQUAL(Hasher::hash("a", 1), 0xD24EC4F1A98C6E5BULL);
+    BOOST_CHECK_EQUAL(Hasher::hash("abc", 3), 0x44BC2CF5AD770999ULL);
+}
+
+// stripes are 32 bytes, pieces of every size have to give the same digest
+BOOST_AUTO_TEST_CASE(XXH64_STREAMING_MATCHES_ONE_SHOT)
+{
+    auto data = randomBytes(1000, 1);
+    for(size_t size : {0, 1, 31, 32, 33, 63, 64, 65, 1000}) {
+        auto expected = Hasher::hash(data.data(), size, 7);
+        for(size_t piece : {1, 3, 17, 32, 100}) {
+            Hasher hasher(7);
+            for(size_t offset = 0; offset < size; offset += piece) {
+                hasher.update(data.data() + offset, std::min(piece, size - offset));
+            }
+            BOOST_CHECK_EQUAL(hasher.digest(), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CHUNKER_RESPECTS_SIZE_BOUNDARIES)
+{
+    auto data = randomBytes(4 * 1024 * 1024, 2);
+    BOOST_CHECK_EQUAL(Chunker::cut(data.data(), Chunker::MIN_SIZE), Chunker::MIN_SIZE);
+    BOOST_CHECK_EQUAL(Chunker::cut(data.data(), 10), 10u);
+    // no cut point at all in constant data, chunks end at MAX_SIZE
+    std::vector<unsigned char> zeros(3 * Chunker::MAX_SIZE + 5, 0);
+    auto zeroChunks = chunksOf(zeros);
+    BOOST_REQUIRE_EQUAL(zeroChunks.size(), 4u);
+    BOOST_CHECK_EQUAL(zeroChunks[0].second, Chunker::MAX_SIZE);
+    BOOST_CHECK_EQUAL(zeroChunks[3].second, 5u);
+
+    size_t expectedOffset = 0;
+    auto chunks = chunksOf(data);
+    for(size_t i = 0; i < chunks.size(); i++) {
+        BOOST_REQUIRE_EQUAL(chunks[i].first, expectedOffset);
+        BOOST_CHECK(chunks[i].second <= Chunker::MAX_SIZE);
+        if(i + 1 < chunks.size()) {
+            BOOST_CHECK(chunks[i].second > Chunker::MIN_SIZE);
+        }
+        expectedOffset += chunks[i].second;
+    }
+    BOOST_CHECK_EQUAL(expectedOffset, data.size());
+    auto average = data.size() / chunks.size();
+    BOOST_CHECK(average > Chunker::AVERAGE_SIZE / 2 && average < Chunker::AVERAGE_SIZE * 2);
+}
+
+// content defined cut points resynchronize shortly after an insertion
+BOOST_AUTO_TEST_CASE(CHUNKER_INSERTION_CHANGES_ONLY_NEARBY_CHUNKS)
+{
+    auto data = randomBytes(2 * 1024 * 1024, 3);
+    auto shifted = data;
+    shifted.insert(shifted.begin() + 1024 * 1024, {1, 2, 3, 4, 5, 6, 7});
+    std::vector<uint64_t> before;
+    for(auto& [offset, length] : chunksOf(data)) {
+        before.push_back(Hasher::hash(data.data() + offset, length));
+    }
+    std::sort(before.begin(), before.end());
+    size_t shared = 0;
+    auto after = chunksOf(shifted);
+    for(auto& [offset, length] : after) {
+        shared += std::binary_search(before.begin(), before.end(), Hasher::hash(shifted.data() + offset, length));
+    }
+    BOOST_CHECK(shared + 3 >= after.size());
+}
+
+BOOST_AUTO_TEST_CASE(DEDUP_STORE_RESTORES_WHAT_IT_STORED)
+{
+    system("rm -rf dedup_src dedup_store dedup_out && mkdir -p dedup_src/sub");
+    // larger than a read window and than a segment, cut points must match chunking it whole
+    auto big = randomBytes(70 * 1024 * 1024, 4);
+    auto small = randomBytes(5000, 5);
+    writeFile("dedup_src/big", big);
+    writeFile("dedup_src/sub/small", small);
+    writeFile("dedup_src/empty", {});
+    symlink("sub/small", "dedup_src/link");
+
+    WorkStealingPool pool(4);
+    auto report = DedupStore("dedup_store", nullptr, pool).backup("dedup_src", "first");
+    BOOST_CHECK(report.errors.empty());
+    BOOST_CHECK_EQUAL(report.files, 3u);
+    BOOST_CHECK_EQUAL(report.links, 1u);
+    auto expectedChunks = chunksOf(std::vector<unsigned char>(big.begin(), big.begin() + 64 * 1024 * 1024)).size()
+            + chunksOf(std::vector<unsigned char>(big.begin() + 64 * 1024 * 1024, big.end())).size() + 1;
+    BOOST_CHECK_EQUAL(report.chunks, expectedChunks);
+
+    auto again = DedupStore("dedup_store", nullptr, pool).backup("dedup_src", "second");
+    BOOST_CHECK_EQUAL(again.newChunks, 0u);
+    BOOST_CHECK_EQUAL(again.storedBytes, 0u);
+
+    DedupStore("dedup_store", nullptr, pool).restore("dedup_out", "first");
+    BOOST_CHECK(readFile("dedup_out/big") == big);
+    BOOST_CHECK(readFile("dedup_out/sub/small") == small);
+    BOOST_CHECK(readFile("dedup_out/empty").empty());
+    char linkTarget[32] = {};
+    BOOST_CHECK(readlink("dedup_out/link", linkTarget, sizeof(linkTarget) - 1) > 0);
+    BOOST_CHECK_EQUAL(std::string(linkTarget), "sub/small");
+}
+
+// names are free form, the run that came last is the latest whatever it is called
+BOOST_AUTO_TEST_CASE(DEDUP_STORE_RESTORES_LATEST_RUN_NOT_LARGEST_NAME)
+{
+    system("rm -rf dedup_src dedup_store dedup_out && mkdir -p dedup_src");
+    writeFile("dedup_src/file", {'o', 'l', 'd'});
+    DedupStore("dedup_store").backup("dedup_src", "zz-nightly");
+    writeFile("dedup_src/file", {'n', 'e', 'w'});
+    DedupStore("dedup_store").backup("dedup_src", "aa-manual");
+    // older snapshot touched later does not become the latest either
+    system("touch dedup_store/snapshots/zz-nightly");
+    auto report = DedupStore("dedup_store").restore("dedup_out");
+    BOOST_CHECK_EQUAL(report.snapshot, "aa-manual");
+    BOOST_CHECK(readFile("dedup_out/file") == (std::vector<unsigned char>{'n', 'e', 'w'}));
+}
+
+// chunks past the file size limit are never written, snapshot referring to them is not recorded
+BOOST_AUTO_TEST_CASE(DEDUP_STORE_DOES_NOT_RECORD_SNAPSHOT_WITH_LOST_CHUNKS)
+{
+    system("rm -rf dedup_src dedup_store dedup_out && mkdir -p dedup_src");
+    auto data = randomBytes(1024 * 1024, 6);
+    writeFile("dedup_src/a", data);
+    writeFile("dedup_src/b", data);
+    auto previousHandler = signal(SIGXFSZ, SIG_IGN);
+    rlimit previousLimit {};
+    getrlimit(RLIMIT_FSIZE, &previousLimit);
+    rlimit limit = previousLimit;
+    limit.rlim_cur = 64 * 1024;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    WorkStealingPool pool(4);
+    BOOST_CHECK_THROW(DedupStore("dedup_store", nullptr, pool).backup("dedup_src", "cut"), std::runtime_error);
+    setrlimit(RLIMIT_FSIZE, &previousLimit);
+    signal(SIGXFSZ, previousHandler);
+    BOOST_CHECK_EQUAL(access("dedup_store/snapshots/cut", F_OK), -1);
+
+    // next run writes what was lost and restores completely
+    auto report = DedupStore("dedup_store", nullptr, pool).backup("dedup_src", "whole");
+    BOOST_CHECK(report.errors.empty());
+    BOOST_CHECK_GT(report.newChunks, 0u);
+    DedupStore("dedup_store", nullptr, pool).restore("dedup_out", "whole");
+    BOOST_CHECK(readFile("dedup_out/a") == data);
+    BOOST_CHECK(readFile("dedup_out/b") == data);
+}
+
+// symlinks already in target are not followed, nothing is written outside of it
+BOOST_AUTO_TEST_CASE(DEDUP_RESTORE_DOES_NOT_FOLLOW_SYMLINKS_IN_TARGET)
+{
+    system("rm -rf dedup_src dedup_store dedup_out dedup_outside && mkdir -p dedup_src/sub dedup_outside dedup_out");
+    writeFile("dedup_src/sub/file", {'i', 'n'});
+    writeFile("dedup_src/top", {'t', 'o', 'p'});
+    DedupStore("dedup_store").backup("dedup_src", "first");
+    symlink("../dedup_outside", "dedup_out/sub");
+    symlink("../dedup_outside/top", "dedup_out/top");
+    auto report = DedupStore("dedup_store").restore("dedup_out", "first");
+    // file below the linked directory and the linked file
+    BOOST_CHECK_EQUAL(report.errors.size(), 2u);
+    BOOST_CHECK_EQUAL(access("dedup_outside/file", F_OK), -1);
+    BOOST_CHECK_EQUAL(access("dedup_outside/top", F_OK), -1);
+}
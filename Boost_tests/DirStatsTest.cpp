@@ -0,0 +1,170 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fstream>
+#include <unistd.h>
+#include "../include/DirStats.h"
+#include "../include/DirWatcher.h"
+
+namespace {
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    // stats_tree/{a, b, sub/c, sub/deep/d, link -> a, fifo, outside -> stats_other}
+    void makeTree() {
+        system("rm -rf stats_tree stats_other stats_root_link && mkdir -p stats_tree/sub/deep stats_other/x/y"
+               " && mkfifo stats_tree/fifo");
+        writeFile("stats_tree/a", "12345");
+        writeFile("stats_tree/b", "");
+        writeFile("stats_tree/sub/c", "123");
+        writeFile("stats_tree/sub/deep/d", "1234567");
+        writeFile("stats_other/x/y/z", "not counted");
+        symlink("a", "stats_tree/link");
+        symlink("../stats_other", "stats_tree/outside");
+        symlink("stats_tree", "stats_root_link");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DIR_STATS_COUNTS_TREE_WITHOUT_FOLLOWING_LINKS)
+{
+    makeTree();
+    WorkStealingPool pool(4);
+    auto stats = DirStats::collect("stats_tree", true, true, nullptr, pool);
+    BOOST_CHECK(stats.errors.empty());
+    BOOST_CHECK_EQUAL(stats.files, 4u);
+    BOOST_CHECK_EQUAL(stats.directories, 2u);
+    BOOST_CHECK_EQUAL(stats.links, 2u);
+    BOOST_CHECK_EQUAL(stats.others, 1u);
+    BOOST_CHECK_EQUAL(stats.bytes, 15u);
+    BOOST_CHECK_EQUAL(stats.depth, 2u);
+
+    auto flat = DirStats::collect("stats_tree", false, false, nullptr, pool);
+    BOOST_CHECK_EQUAL(flat.files, 2u);
+    BOOST_CHECK_EQUAL(flat.bytes, 0u);
+    BOOST_CHECK_EQUAL(flat.depth, 0u);
+    BOOST_CHECK_THROW(DirStats::collect("stats_missing", true, false, nullptr, pool), std::runtime_error);
+}
+
+// root given as a symlink is followed, as opendir did, with and without cache
+BOOST_AUTO_TEST_CASE(DIR_STATS_FOLLOWS_SYMLINKED_ROOT)
+{
+    makeTree();
+    auto stats = DirStats::collect("stats_root_link", true, true);
+    BOOST_CHECK(stats.errors.empty());
+    BOOST_CHECK_EQUAL(stats.files, 4u);
+    BOOST_CHECK_EQUAL(stats.bytes, 15u);
+    DirStatsCache cache;
+    auto cached = DirStats::collect("stats_root_link", true, true, &cache);
+    BOOST_CHECK(cached.errors.empty());
+    BOOST_CHECK_EQUAL(cached.files, 4u);
+
+    DirCounts counts;
+    std::vector<std::string> errors;
+    BOOST_CHECK(!DirStats::list("stats_root_link", false, counts, errors));
+    BOOST_CHECK(DirStats::list("stats_root_link", false, counts, errors, true));
+    BOOST_CHECK_EQUAL(counts.files, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(DIR_WATCHER_FOLLOWS_SYMLINKED_ROOT_AND_SEES_CHANGES)
+{
+    makeTree();
+    DirWatcher watcher("stats_root_link", true, false);
+    BOOST_CHECK_EQUAL(watcher.stats().files, 4u);
+    BOOST_CHECK_EQUAL(watcher.stats().directories, 2u);
+    writeFile("stats_tree/sub/deep/e", "new");
+    watcher.waitForChange(std::chrono::milliseconds(20), std::chrono::milliseconds(500));
+    BOOST_CHECK_EQUAL(watcher.stats().files, 5u);
+    BOOST_CHECK_EQUAL(watcher.rescans(), 1u);
+}
+
+namespace {
+    // cache entry for directory as it is now, counts are made up so a cache hit shows in results
+    std::pair<DirStatsCache::Key, DirStatsCache::Entry> entryFor(const std::string& path, uint64_t files,
+                                                                 std::vector<std::string> fileNames) {
+        struct statx info {};
+        statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, STATX_INO | STATX_MTIME | STATX_CTIME, &info);
+        DirStatsCache::Key key {makedev(info.stx_dev_major, info.stx_dev_minor), info.stx_ino};
+        DirStatsCache::Entry entry;
+        entry.mtimeSeconds = info.stx_mtime.tv_sec;
+        entry.mtimeNanoseconds = info.stx_mtime.tv_nsec;
+        entry.ctimeSeconds = info.stx_ctime.tv_sec;
+        entry.ctimeNanoseconds = info.stx_ctime.tv_nsec;
+        entry.files = files;
+        entry.hasBytes = !fileNames.empty();
+        entry.fileNames = std::move(fileNames);
+        return {key, entry};
+    }
+
+    void makeCachedDirectory() {
+        system("rm -rf stats_cached && mkdir -p stats_cached");
+        writeFile("stats_cached/f", "12345");
+    }
+}
+
+// file growing in place leaves directory times alone, its size must not come from the cache
+BOOST_AUTO_TEST_CASE(DIR_STATS_CACHE_HIT_STATS_FILES_AGAIN_FOR_BYTES)
+{
+    makeCachedDirectory();
+    DirStatsCache cache;
+    auto [key, entry] = entryFor("stats_cached", 7, {"f"});
+    cache.store(key, entry);
+    auto stats = DirStats::collect("stats_cached", false, true, &cache);
+    BOOST_CHECK_EQUAL(stats.files, 7u);
+    BOOST_CHECK_EQUAL(stats.bytes, 5u);
+    {
+        std::ofstream file("stats_cached/f", std::ios::app);
+        file << "67890";
+    }
+    stats = DirStats::collect("stats_cached", false, true, &cache);
+    BOOST_CHECK_EQUAL(stats.files, 7u);
+    BOOST_CHECK_EQUAL(stats.bytes, 10u);
+}
+
+BOOST_AUTO_TEST_CASE(DIR_STATS_CACHE_WITHOUT_FILE_NAMES_IS_LISTED_FOR_BYTES)
+{
+    makeCachedDirectory();
+    DirStatsCache cache;
+    auto [key, entry] = entryFor("stats_cached", 7, {});
+    cache.store(key, entry);
+    // counts alone come from cache
+    BOOST_CHECK_EQUAL(DirStats::collect("stats_cached", false, false, &cache).files, 7u);
+    auto stats = DirStats::collect("stats_cached", false, true, &cache);
+    BOOST_CHECK_EQUAL(stats.files, 1u);
+    BOOST_CHECK_EQUAL(stats.bytes, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(DIR_STATS_CACHE_WITH_VANISHED_FILE_IS_LISTED)
+{
+    makeCachedDirectory();
+    DirStatsCache cache;
+    auto [key, entry] = entryFor("stats_cached", 7, {"f", "gone"});
+    cache.store(key, entry);
+    auto stats = DirStats::collect("stats_cached", false, true, &cache);
+    BOOST_CHECK_EQUAL(stats.files, 1u);
+    BOOST_CHECK_EQUAL(stats.bytes, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(DIR_STATS_CACHE_SURVIVES_SAVE_AND_LOAD)
+{
+    makeCachedDirectory();
+    unlink("stats_cache_file");
+    auto [key, entry] = entryFor("stats_cached", 7, {"f"});
+    entry.subdirectories = {"one", "two"};
+    {
+        DirStatsCache cache("stats_cache_file");
+        cache.store(key, entry);
+        cache.save();
+    }
+    DirStatsCache loaded("stats_cache_file");
+    DirStatsCache::Entry found;
+    BOOST_REQUIRE(loaded.find(key, entry, true, found));
+    BOOST_CHECK_EQUAL(found.files, 7u);
+    BOOST_CHECK(found.subdirectories == entry.subdirectories);
+    BOOST_CHECK(found.fileNames == entry.fileNames);
+    auto changed = entry;
+    changed.mtimeNanoseconds++;
+    BOOST_CHECK(!loaded.find(key, changed, false, found));
+}
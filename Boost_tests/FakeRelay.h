@@ -0,0 +1,169 @@
+#ifndef TKOM_FAKERELAY_H
+#define TKOM_FAKERELAY_H
+
+#include <arpa/inet.h>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Relay on loopback, one thread per session. Replies come from a table of rejected recipients,
+ * messages and sessions are counted, and the session can be cut at a given MAIL FROM or right
+ * after content of a message, both counted over all sessions.
+ */
+class FakeRelay {
+public:
+    explicit FakeRelay(bool pipelining) : pipelining(pipelining) {
+        listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+        listen(listener, 16);
+        acceptor = std::thread([this] { acceptSessions(); });
+    }
+
+    ~FakeRelay() {
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        acceptor.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for(auto fd : sessionFds) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for(auto& session : sessions) {
+            session.join();
+        }
+    }
+
+    std::string relay() const {
+        return "127.0.0.1:" + std::to_string(port);
+    }
+
+    std::vector<std::string> messages() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received;
+    }
+
+    size_t sessionCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return sessionFds.size();
+    }
+
+    std::map<std::string, std::string> rejected;
+    // 1 for the first MAIL FROM or message, 0 never
+    size_t cutAtMail {0};
+    size_t cutAfterContent {0};
+
+private:
+    bool pipelining;
+    int listener;
+    int port;
+    std::thread acceptor;
+    std::mutex mutex;
+    std::vector<std::thread> sessions;
+    std::vector<int> sessionFds;
+    std::vector<std::string> received;
+    size_t mails {0};
+    size_t contents {0};
+
+    void acceptSessions() {
+        while(true) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if(fd == -1) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            sessionFds.push_back(fd);
+            sessions.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    static void reply(int fd, const std::string& text) {
+        ::send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+    }
+
+    void serve(int fd) {
+        reply(fd, "220 fake relay\r\n");
+        std::string pending, content;
+        bool isData = false;
+        size_t accepted = 0;
+        char buffer[4096];
+        while(true) {
+            auto end = pending.find("\r\n");
+            if(end == std::string::npos) {
+                auto got = recv(fd, buffer, sizeof(buffer), 0);
+                if(got <= 0) {
+                    break;
+                }
+                pending.append(buffer, got);
+                continue;
+            }
+            auto line = pending.substr(0, end);
+            pending.erase(0, end + 2);
+            if(isData) {
+                if(line != ".") {
+                    content += line + "\r\n";
+                    continue;
+                }
+                isData = false;
+                std::unique_lock<std::mutex> lock(mutex);
+                received.push_back(content);
+                if(++contents == cutAfterContent) {
+                    break;
+                }
+                lock.unlock();
+                reply(fd, "250 queued\r\n");
+                continue;
+            }
+            if(line.rfind("EHLO", 0) == 0) {
+                reply(fd, pipelining ? "250-fake relay\r\n250-PIPELINING\r\n250 8BITMIME\r\n" : "250 fake relay\r\n");
+            } else if(line.rfind("MAIL FROM:", 0) == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(++mails == cutAtMail) {
+                    break;
+                }
+                accepted = 0;
+                reply(fd, "250 sender ok\r\n");
+            } else if(line.rfind("RCPT TO:<", 0) == 0) {
+                auto recipient = line.substr(9, line.size() - 10);
+                auto rejection = rejected.find(recipient);
+                if(rejection != rejected.end()) {
+                    reply(fd, rejection->second + "\r\n");
+                } else {
+                    accepted++;
+                    reply(fd, "250 recipient ok\r\n");
+                }
+            } else if(line == "DATA") {
+                if(accepted == 0) {
+                    reply(fd, "554 no valid recipients\r\n");
+                } else {
+                    isData = true;
+                    content.clear();
+                    reply(fd, "354 go ahead\r\n");
+                }
+            } else if(line == "RSET") {
+                accepted = 0;
+                reply(fd, "250 reset\r\n");
+            } else if(line == "QUIT") {
+                reply(fd, "221 bye\r\n");
+                break;
+            } else {
+                reply(fd, "502 unknown command\r\n");
+            }
+        }
+        shutdown(fd, SHUT_RDWR);
+    }
+};
+
+#endif //TKOM_FAKERELAY_H
@@ -0,0 +1,67 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../include/HandlerSupervisor.h"
+#include "../include/ProcessLauncher.h"
+
+namespace {
+    pid_t spawnWatched(std::vector<std::string> argv) {
+        SpawnOptions options;
+        options.argv = std::move(argv);
+        auto pid = ProcessLauncher::spawn(options);
+        HandlerSupervisor::instance().watch(pid);
+        return pid;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SUPERVISOR_REPORTS_STATUS_ONCE_AND_FORGETS_CHILD)
+{
+    auto& supervisor = HandlerSupervisor::instance();
+    auto pid = spawnWatched({"/bin/sh", "-c", "exit 7"});
+    BOOST_CHECK_EQUAL(*supervisor.waitFor(pid, -1), 7);
+    BOOST_CHECK_THROW(supervisor.poll(pid), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SUPERVISOR_WAIT_TIMES_OUT_ON_RUNNING_CHILD)
+{
+    auto& supervisor = HandlerSupervisor::instance();
+    auto pid = spawnWatched({"sleep", "0.3"});
+    BOOST_CHECK(!supervisor.poll(pid));
+    BOOST_CHECK(!supervisor.waitFor(pid, 0.05));
+    BOOST_CHECK_EQUAL(*supervisor.waitFor(pid, -1), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SUPERVISOR_FORGETS_RELEASED_CHILD_WHEN_IT_IS_REAPED)
+{
+    auto& supervisor = HandlerSupervisor::instance();
+    auto running = supervisor.runningCount();
+    auto pid = spawnWatched({"sleep", "0.1"});
+    supervisor.release(pid);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    bool isForgotten = false;
+    while(!isForgotten && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        try {
+            supervisor.poll(pid);
+        } catch(std::runtime_error&) {
+            isForgotten = true;
+        }
+    }
+    BOOST_CHECK(isForgotten);
+    BOOST_CHECK_EQUAL(supervisor.runningCount(), running);
+}
+
+BOOST_AUTO_TEST_CASE(SUPERVISOR_KEEPS_NO_ENTRY_AFTER_MANY_CHILDREN)
+{
+    auto& supervisor = HandlerSupervisor::instance();
+    std::vector<pid_t> pids;
+    for(int i = 0; i < 200; i++) {
+        pids.push_back(spawnWatched({"true"}));
+    }
+    for(auto pid : pids) {
+        BOOST_CHECK_EQUAL(*supervisor.waitFor(pid, -1), 0);
+        BOOST_CHECK_THROW(supervisor.poll(pid), std::runtime_error);
+    }
+    BOOST_CHECK_EQUAL(supervisor.runningCount(), 0u);
+}
@@ -0,0 +1,87 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include "../include/ProcessLauncher.h"
+#include "TestScript.h"
+
+BOOST_AUTO_TEST_CASE(HANDLER_START_DOES_NOT_WAIT_FOR_PROCESS)
+{
+    auto started = std::chrono::steady_clock::now();
+    auto output = runScript(
+            "system_handler h\nh.register = \"run\"\nh.path = \"sleep 0.5; exit 3\"\nh.start\n"
+            "int p\np = h.poll\nput p\n"
+            "h.timeout = \"0.05\"\nint s\ns = h.wait\nput s\n"
+            "h.timeout = \"-1\"\ns = h.wait\nput s\np = h.poll\nput p\n$");
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    // not running yet, timed out wait, exit status, finished
+    BOOST_CHECK_EQUAL(output, "0 of int type.\n-1 of int type.\n3 of int type.\n1 of int type.\n");
+    BOOST_CHECK(elapsed >= std::chrono::milliseconds(450));
+    BOOST_CHECK(elapsed < std::chrono::seconds(3));
+}
+
+BOOST_AUTO_TEST_CASE(HANDLER_STOP_KILLS_PROCESS)
+{
+    auto started = std::chrono::steady_clock::now();
+    auto output = runScript(
+            "system_handler h\nh.register = \"run\"\nh.path = \"sleep 30\"\nh.start\nh.stop\n"
+            "int s\ns = h.wait\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "137 of int type.\n");
+    BOOST_CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_CASE(HANDLER_WAIT_BEFORE_START_IS_AN_ERROR)
+{
+    BOOST_CHECK_THROW(runScript("system_handler h\nh.register = \"run\"\nh.path = \"true\"\nint s\ns = h.wait\n$"),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(HANDLER_CAN_BE_STARTED_AGAIN_AFTER_IT_FINISHED)
+{
+    auto output = runScript(
+            "system_handler h\nh.register = \"run\"\nh.path = \"true; exit 4\"\nh.start\nint s\ns = h.wait\nput s\n"
+            "h.path = \"exit 5\"\nh.start\ns = h.wait\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "4 of int type.\n5 of int type.\n");
+}
+
+// handlers other than run are started as the interpreter binary in handler mode
+BOOST_AUTO_TEST_CASE(BACKUP_HANDLER_RUNS_IN_SPAWNED_INTERPRETER)
+{
+    ProcessLauncher::setInterpreter(TKOM_BINARY);
+    system("rm -rf handler_src handler_dst && mkdir -p handler_src/sub handler_dst"
+           " && echo a > handler_src/a && echo b > handler_src/sub/b");
+    auto output = runScript(
+            "system_handler b\nb.register = \"backup\"\nb.dest = \"handler_src\"\nb.dir = \"handler_dst\"\n"
+            "b.start\nint z\nz = b.wait\nput z\n"
+            "system_handler x\nx.register = \"backup\"\nx.dir = \"handler_dst\"\nx.start\nz = x.wait\nput z\n$");
+    BOOST_CHECK_EQUAL(output, "0 of int type.\n1 of int type.\n");
+    std::ifstream copied("handler_dst/handler_src/sub/b");
+    std::string line;
+    BOOST_CHECK(std::getline(copied, line) && line == "b");
+}
+
+BOOST_AUTO_TEST_CASE(CHECK_SYSTEM_FREQUENCY_IS_VALIDATED)
+{
+    for(auto freq : {"abc", "0", "-1", "2s", "nan"}) {
+        BOOST_CHECK_THROW(runScript(std::string("system_handler h\nh.register = \"check_system\"\nh.freq = \"")
+                                    + freq + "\"\n$"), std::runtime_error);
+    }
+    BOOST_CHECK_EQUAL(runScript("system_handler h\nh.register = \"check_system\"\nh.freq = \"0.25\"\n$"), "");
+}
+
+// fractional freq bounds report delay of watch mode as it does polling period
+BOOST_AUTO_TEST_CASE(CHECK_SYSTEM_WATCH_MODE_ACCEPTS_FRACTIONAL_FREQUENCY)
+{
+    ProcessLauncher::setInterpreter(TKOM_BINARY);
+    system("rm -rf watch_dir watch_report && mkdir -p watch_dir && touch watch_dir/a");
+    auto output = runScript(
+            "system_handler h\nh.register = \"check_system\"\nh.raport_type = \"file_number\"\n"
+            "h.dir = \"watch_dir\"\nh.path = \"watch_report\"\nh.watch = \"1\"\nh.freq = \"0.3\"\n"
+            "h.debounce = \"20\"\nh.start\n"
+            "system_handler t\nh.timeout = \"1.5\"\nt.register = \"run\"\nt.path = \"sleep 0.5; touch watch_dir/b\"\n"
+            "t.start\nint s\ns = h.wait\nput s\nh.stop\nh.timeout = \"-1\"\ns = h.wait\nput s\n$");
+    // still running after timeout, killed by stop
+    BOOST_CHECK_EQUAL(output, "-1 of int type.\n137 of int type.\n");
+    std::ifstream report("watch_report");
+    BOOST_CHECK_EQUAL(std::string(std::istreambuf_iterator<char>(report), {}), "In dir watch_dir there are 2 files.\n");
+}
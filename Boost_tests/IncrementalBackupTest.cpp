@@ -0,0 +1,145 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/Hash.h"
+#include "../include/IncrementalBackup.h"
+
+namespace {
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    }
+
+    void setMtime(const std::string& path, time_t seconds) {
+        timespec times[2] = {{seconds, 0}, {seconds, 0}};
+        utimensat(AT_FDCWD, path.c_str(), times, 0);
+    }
+
+    void makeSource() {
+        system("rm -rf inc_src inc_dst && mkdir -p inc_src/sub");
+        writeFile("inc_src/a", "alpha");
+        writeFile("inc_src/b", "beta");
+        writeFile("inc_src/sub/c", "gamma");
+    }
+
+    ManifestEntry entryOf(std::string path, uint64_t size, bool isDeleted = false) {
+        ManifestEntry entry;
+        entry.path = std::move(path);
+        entry.size = size;
+        entry.mtimeSeconds = -5;
+        entry.mtimeNanoseconds = 7;
+        entry.inode = 11;
+        entry.hash = size * 3;
+        entry.isDeleted = isDeleted;
+        return entry;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MANIFEST_ROUND_TRIP_KEEPS_ENTRIES_SORTED)
+{
+    Manifest::write("test_manifest", {entryOf("z/last", 3), entryOf("a", 1, true), entryOf("m/middle", 2)});
+    Manifest manifest("test_manifest");
+    BOOST_REQUIRE_EQUAL(manifest.size(), 3u);
+    BOOST_CHECK_EQUAL(manifest.entry(0).path, "a");
+    BOOST_CHECK_EQUAL(manifest.entry(2).path, "z/last");
+    auto middle = manifest.entry(manifest.find("m/middle"));
+    BOOST_CHECK_EQUAL(middle.size, 2u);
+    BOOST_CHECK_EQUAL(middle.mtimeSeconds, -5);
+    BOOST_CHECK_EQUAL(middle.mtimeNanoseconds, 7u);
+    BOOST_CHECK_EQUAL(middle.inode, 11u);
+    BOOST_CHECK_EQUAL(middle.hash, 6u);
+    BOOST_CHECK(!middle.isDeleted);
+    BOOST_CHECK(manifest.entry(manifest.find("a")).isDeleted);
+    BOOST_CHECK_EQUAL(manifest.find("m"), manifest.size());
+    BOOST_CHECK_EQUAL(manifest.find("zz"), manifest.size());
+}
+
+BOOST_AUTO_TEST_CASE(DAMAGED_MANIFEST_IS_EMPTY)
+{
+    Manifest::write("test_manifest", {entryOf("a", 1), entryOf("b", 2)});
+    auto content = readFile("test_manifest");
+    // strings table cut off
+    writeFile("test_manifest_cut", content.substr(0, content.size() - 1));
+    BOOST_CHECK_EQUAL(Manifest("test_manifest_cut").size(), 0u);
+    writeFile("test_manifest_cut", "junk" + content.substr(4));
+    BOOST_CHECK_EQUAL(Manifest("test_manifest_cut").size(), 0u);
+    BOOST_CHECK_EQUAL(Manifest("test_manifest_missing").size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(INCREMENTAL_BACKUP_COPIES_ONLY_CHANGES)
+{
+    makeSource();
+    auto first = IncrementalBackup("inc_src", "inc_dst", false).run();
+    BOOST_CHECK_EQUAL(first.files, 3u);
+    BOOST_CHECK_EQUAL(readFile("inc_dst/sub/c"), "gamma");
+
+    auto unchanged = IncrementalBackup("inc_src", "inc_dst", false).run();
+    BOOST_CHECK_EQUAL(unchanged.files, 0u);
+    BOOST_CHECK_EQUAL(unchanged.skipped, 3u);
+
+    writeFile("inc_src/b", "beta changed");
+    unlink("inc_src/a");
+    auto changed = IncrementalBackup("inc_src", "inc_dst", false).run();
+    BOOST_CHECK_EQUAL(changed.files, 1u);
+    BOOST_CHECK_EQUAL(changed.deleted, 1u);
+    BOOST_CHECK_EQUAL(readFile("inc_dst/b"), "beta changed");
+    // deleted file keeps its last copy and is reported only once
+    BOOST_CHECK_EQUAL(readFile("inc_dst/a"), "alpha");
+    Manifest manifest(std::string("inc_dst/") + IncrementalBackup::MANIFEST_NAME);
+    BOOST_CHECK(manifest.entry(manifest.find("a")).isDeleted);
+    BOOST_CHECK_EQUAL(IncrementalBackup("inc_src", "inc_dst", false).run().deleted, 0u);
+
+    writeFile("inc_src/a", "alpha again");
+    auto restored = IncrementalBackup("inc_src", "inc_dst", false).run();
+    BOOST_CHECK_EQUAL(restored.files, 1u);
+    BOOST_CHECK_EQUAL(readFile("inc_dst/a"), "alpha again");
+}
+
+BOOST_AUTO_TEST_CASE(INCREMENTAL_BACKUP_WITH_HASH_SKIPS_TOUCHED_FILES)
+{
+    makeSource();
+    IncrementalBackup("inc_src", "inc_dst", true).run();
+    setMtime("inc_src/a", 1500000000);
+    // same size, different content
+    writeFile("inc_src/b", "BETA");
+    auto report = IncrementalBackup("inc_src", "inc_dst", true).run();
+    BOOST_CHECK_EQUAL(report.files, 1u);
+    BOOST_CHECK_EQUAL(readFile("inc_dst/b"), "BETA");
+    struct stat info {};
+    BOOST_REQUIRE(stat("inc_dst/a", &info) == 0);
+    BOOST_CHECK_EQUAL(info.st_mtim.tv_sec, 1500000000);
+    // touched file is unchanged in manifest now
+    BOOST_CHECK_EQUAL(IncrementalBackup("inc_src", "inc_dst", true).run().skipped, 3u);
+    BOOST_CHECK_THROW(IncrementalBackup("inc_missing", "inc_dst", true).run(), std::runtime_error);
+}
+
+// hash of a copied file is taken from the bytes written, also when they take many reads
+BOOST_AUTO_TEST_CASE(INCREMENTAL_BACKUP_HASHES_COPIED_DATA)
+{
+    makeSource();
+    std::string big;
+    for(int i = 0; i < 300 * 1024; i++) {
+        big += (char)('a' + i % 23);
+    }
+    writeFile("inc_src/sub/big", big);
+    IncrementalBackup("inc_src", "inc_dst", true).run();
+    Manifest manifest(std::string("inc_dst/") + IncrementalBackup::MANIFEST_NAME);
+    for(auto path : {"a", "sub/big", "sub/c"}) {
+        auto index = manifest.find(path);
+        BOOST_REQUIRE(index != manifest.size());
+        BOOST_CHECK_EQUAL(manifest.entry(index).hash, Hasher::hashFile(std::string("inc_dst/") + path));
+    }
+    BOOST_CHECK_EQUAL(manifest.entry(manifest.find("sub/big")).hash, Hasher::hash(big.data(), big.size()));
+    setMtime("inc_src/sub/big", 1500000000);
+    auto report = IncrementalBackup("inc_src", "inc_dst", true).run();
+    BOOST_CHECK_EQUAL(report.files, 0u);
+    BOOST_CHECK_EQUAL(readFile("inc_dst/sub/big"), big);
+}
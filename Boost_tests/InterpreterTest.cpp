@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include "../include/Channel.h"
+#include "../include/Scheduler.h"
+#include "../include/TaskRegistry.h"
+#include "TestScript.h"
+
+BOOST_AUTO_TEST_CASE(RET_SKIPS_REST_OF_FUNCTION)
+{
+    auto output = runScript(
+            "int f(int x)\ndo\nif(x > 2)\ndo\nret 1\ndone\nret 2\ndone\n"
+            "int r\nr = f(5)\nput r\nr = f(1)\nput r\n$");
+    BOOST_CHECK_EQUAL(output, "1 of int type.\n2 of int type.\n");
+}
+
+BOOST_AUTO_TEST_CASE(RET_LEAVES_FOR_AND_WHILE_LOOPS)
+{
+    auto output = runScript(
+            "int g(int n)\ndo\nfor(i, 0, n)\ndo\nif(i == 3)\ndo\nret i\ndone\ndone\nret 100\ndone\n"
+            "int h(int n)\ndo\nint k\nk = 0\nwhile(k < n)\ndo\nk = k + 1\nif(k == 4)\ndo\nret k * 10\ndone\ndone\nret 0\ndone\n"
+            "int r\nr = g(10)\nput r\nr = g(2)\nput r\nr = h(10)\nput r\n$");
+    BOOST_CHECK_EQUAL(output, "3 of int type.\n100 of int type.\n40 of int type.\n");
+}
+
+BOOST_AUTO_TEST_CASE(RET_IN_CALLED_FUNCTION_DOES_NOT_END_CALLER)
+{
+    auto output = runScript(
+            "int one()\ndo\nret 1\ndone\n"
+            "int two()\ndo\nint a\na = one()\nret a + 1\ndone\n"
+            "int r\nr = two()\nput r\n$");
+    BOOST_CHECK_EQUAL(output, "2 of int type.\n");
+}
+
+BOOST_AUTO_TEST_CASE(AWAIT_RELEASES_TASK_HANDLE)
+{
+    auto tasksBefore = TaskRegistry::instance().size();
+    auto output = runScript(
+            "int sq(int x)\ndo\nret x * x\ndone\n"
+            "int s\ns = 0\nint t\nt = 0\nfor(i, 0, 50)\ndo\nt = spawn sq(i)\ns = await t\ndone\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "2401 of int type.\n");
+    BOOST_CHECK_EQUAL(TaskRegistry::instance().size(), tasksBefore);
+}
+
+BOOST_AUTO_TEST_CASE(DRAINED_CHANNEL_RELEASES_HANDLE)
+{
+    auto channelsBefore = ChannelRegistry::instance().size();
+    auto output = runScript(
+            "int c\nc = chan(4)\nsend(c, 7)\nclose(c)\nint v\nv = recv(c)\nput v\n"
+            "int d\nd = drained(c)\nput d\nv = recv(c)\nput v\n$");
+    BOOST_CHECK_EQUAL(output, "7 of int type.\n1 of int type.\n0 of int type.\n");
+    BOOST_CHECK_EQUAL(ChannelRegistry::instance().size(), channelsBefore);
+}
+
+// block of every sees outer channel, ret ends its schedule, finished schedules are not remembered
+BOOST_AUTO_TEST_CASE(EVERY_BLOCK_RUNS_GIVEN_TIMES_AND_ENDS_ON_RET)
+{
+    auto schedulesBefore = Scheduler::instance().size();
+    auto output = runScript(
+            "int c\nc = chan(8)\nevery(0.05, 3)\ndo\nsend(c, 1)\ndone\n"
+            "every(0.02)\ndo\nsend(c, 7)\nret 0\ndone\n"
+            "int v\nint s\ns = 0\nfor(i, 0, 4)\ndo\nv = recv(c)\ns = s + v\ndone\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "10 of int type.\n");
+    Scheduler::instance().waitForActive();
+    BOOST_CHECK_EQUAL(Scheduler::instance().size(), schedulesBefore);
+}
+
+// handler state has no lock, only handlers declared inside iteration or tick are used there
+BOOST_AUTO_TEST_CASE(OUTER_HANDLER_IS_NOT_CONTROLLED_FROM_WORKERS)
+{
+    std::string outer = "system_handler h\nh.register = \"run\"\nh.path = \"touch worker_started\"\n";
+    remove("worker_started");
+    BOOST_CHECK_THROW(runScript(outer + "parallel_for(i, 0, 4)\ndo\nh.start\ndone\n$"), std::runtime_error);
+    BOOST_CHECK_THROW(runScript(outer + "parallel_for(i, 0, 1)\ndo\nint s\ns = h.poll\ndone\n$"), std::runtime_error);
+    // failing tick ends its schedule
+    runScript(outer + "every(0.02, 3)\ndo\nh.start\ndone\n$");
+    Scheduler::instance().waitForActive();
+    BOOST_CHECK_EQUAL(access("worker_started", F_OK), -1);
+
+    auto output = runScript(
+            "parallel_for(i, 0, 1)\ndo\nsystem_handler t\nt.register = \"run\"\nt.path = \"exit 3\"\n"
+            "t.start\nint s\ns = t.wait\nput s\ndone\n$");
+    BOOST_CHECK_EQUAL(output, "3 of int type.\n");
+}
@@ -0,0 +1,71 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <sys/wait.h>
+#include "../include/OutputCollector.h"
+#include "../include/ProcessLauncher.h"
+#include "TestScript.h"
+
+namespace {
+    // runs shell command with stdout and stderr captured, returns after it exited
+    void runCaptured(const std::shared_ptr<CapturedOutput>& output, const std::string& command) {
+        SpawnOptions options;
+        options.argv = {"/bin/sh", "-c", command};
+        options.stdoutFd = options.stderrFd = output->writeEnd();
+        auto pid = ProcessLauncher::spawn(options);
+        output->closeWriteEnd();
+        OutputCollector::instance().collect(output);
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CAPTURED_OUTPUT_KEEPS_STDOUT_AND_STDERR)
+{
+    auto output = std::make_shared<CapturedOutput>(1024, "");
+    runCaptured(output, "echo out; echo err >&2");
+    BOOST_CHECK_EQUAL(output->text(), "out\nerr\n");
+    BOOST_CHECK_EQUAL(output->lines(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(CAPTURED_OUTPUT_KEEPS_ONLY_LAST_BYTES)
+{
+    auto output = std::make_shared<CapturedOutput>(10, "");
+    runCaptured(output, "i=0; while [ $i -lt 1000 ]; do echo line$i; i=$((i+1)); done");
+    BOOST_CHECK_EQUAL(output->text(), "8\nline999\n");
+    // every line is counted even though only tail is kept
+    BOOST_CHECK_EQUAL(output->lines(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(CAPTURED_OUTPUT_WRITES_WHOLE_OUTPUT_TO_FILE)
+{
+    auto output = std::make_shared<CapturedOutput>(6, "captured.txt");
+    runCaptured(output, "printf 'a\\nb\\nc\\nd\\n'");
+    BOOST_CHECK_EQUAL(output->text(), "b\nc\nd\n");
+    BOOST_CHECK_EQUAL(output->lines(), 4u);
+    std::ifstream file("captured.txt");
+    std::stringstream content;
+    content << file.rdbuf();
+    BOOST_CHECK_EQUAL(content.str(), "a\nb\nc\nd\n");
+}
+
+// pipe is drained by collector while child writes, far more than pipe capacity must not block it
+BOOST_AUTO_TEST_CASE(CHATTY_COMMAND_DOES_NOT_BLOCK_ON_FULL_PIPE)
+{
+    auto output = std::make_shared<CapturedOutput>(4096, "");
+    auto started = std::chrono::steady_clock::now();
+    runCaptured(output, "head -c 8000000 /dev/zero | tr '\\0' x");
+    BOOST_CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(10));
+    BOOST_CHECK_EQUAL(output->text(), std::string(4096, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(RUN_HANDLER_EXPOSES_CAPTURED_OUTPUT)
+{
+    auto output = runScript(
+            "system_handler h\nh.register = \"run\"\nh.path = \"seq 2\"\nh.capture = \"1\"\n"
+            "h.start\nint s\ns = h.wait\nput s\nint n\nn = h.lines\nput n\n$");
+    BOOST_CHECK_EQUAL(output, "0 of int type.\n2 of int type.\n");
+    BOOST_CHECK_THROW(runScript("system_handler h\nh.register = \"run\"\nh.path = \"true\"\nh.start\n"
+                                "int s\ns = h.wait\nint n\nn = h.lines\n$"), std::runtime_error);
+}
@@ -0,0 +1,89 @@
+#include <boost/test/unit_test.hpp>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../include/ProcessLauncher.h"
+
+namespace {
+    using Args = std::vector<std::string>;
+
+    int waitStatus(pid_t pid) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SPLIT_COMMAND_LINE_HONOURS_QUOTES_AND_ESCAPES)
+{
+    BOOST_CHECK(ProcessLauncher::splitCommandLine("  ls   -la  /tmp ") == (Args{"ls", "-la", "/tmp"}));
+    BOOST_CHECK(ProcessLauncher::splitCommandLine("echo 'a b' \"c \\\"d\\\"\" e\\ f") ==
+                (Args{"echo", "a b", "c \"d\"", "e f"}));
+    BOOST_CHECK(ProcessLauncher::splitCommandLine("printf '' x") == (Args{"printf", "", "x"}));
+    BOOST_CHECK(ProcessLauncher::splitCommandLine("   ").empty());
+    BOOST_CHECK_THROW(ProcessLauncher::splitCommandLine("echo 'open"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(NEEDS_SHELL_DETECTS_SHELL_SYNTAX)
+{
+    BOOST_CHECK(!ProcessLauncher::needsShell("ls -la /tmp"));
+    BOOST_CHECK(!ProcessLauncher::needsShell("sleep 1"));
+    BOOST_CHECK(!ProcessLauncher::needsShell("grep exit log.txt"));
+    BOOST_CHECK(ProcessLauncher::needsShell("ls | wc -l"));
+    BOOST_CHECK(ProcessLauncher::needsShell("echo $HOME"));
+    BOOST_CHECK(ProcessLauncher::needsShell("ls *.txt"));
+    BOOST_CHECK(ProcessLauncher::needsShell("true; false"));
+    BOOST_CHECK(ProcessLauncher::needsShell("echo x > out"));
+}
+
+BOOST_AUTO_TEST_CASE(NEEDS_SHELL_DETECTS_BUILTINS_AND_ASSIGNMENTS)
+{
+    BOOST_CHECK(ProcessLauncher::needsShell("exit 4"));
+    BOOST_CHECK(ProcessLauncher::needsShell("  cd /tmp"));
+    BOOST_CHECK(ProcessLauncher::needsShell("export A=1"));
+    BOOST_CHECK(ProcessLauncher::needsShell(". ./env.sh"));
+    BOOST_CHECK(ProcessLauncher::needsShell("A=1 env"));
+}
+
+BOOST_AUTO_TEST_CASE(BUILD_ENVIRONMENT_OVERRIDES_INHERITED_VARIABLES)
+{
+    setenv("TKOM_TEST_VARIABLE", "old", 1);
+    auto environment = ProcessLauncher::buildEnvironment("TKOM_TEST_VARIABLE=new;TKOM_OTHER=x=y");
+    size_t found = 0;
+    for(auto& entry : environment) {
+        found += entry == "TKOM_TEST_VARIABLE=new" || entry == "TKOM_OTHER=x=y";
+        BOOST_CHECK(entry != "TKOM_TEST_VARIABLE=old");
+    }
+    BOOST_CHECK_EQUAL(found, 2u);
+    BOOST_CHECK_THROW(ProcessLauncher::buildEnvironment("=x"), std::runtime_error);
+    BOOST_CHECK_THROW(ProcessLauncher::buildEnvironment("novalue"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SPAWN_RETURNS_CHILD_WITH_EXIT_STATUS)
+{
+    SpawnOptions options;
+    options.argv = {"/bin/sh", "-c", "exit 6"};
+    BOOST_CHECK_EQUAL(waitStatus(ProcessLauncher::spawn(options)), 6);
+    options.argv = {"true"};
+    BOOST_CHECK_EQUAL(waitStatus(ProcessLauncher::spawn(options)), 0);
+    options.argv.clear();
+    BOOST_CHECK_THROW(ProcessLauncher::spawn(options), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SPAWN_APPLIES_DIRECTORY_ENVIRONMENT_AND_OUTPUT)
+{
+    int fd = open("spawn_output.txt", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    BOOST_REQUIRE(fd >= 0);
+    SpawnOptions options;
+    options.argv = {"/bin/sh", "-c", "echo \"$TKOM_SPAWNED\"; pwd"};
+    options.environment = {"TKOM_SPAWNED=yes", "PATH=/usr/bin:/bin"};
+    options.workingDir = "/";
+    options.stdoutFd = fd;
+    BOOST_CHECK_EQUAL(waitStatus(ProcessLauncher::spawn(options)), 0);
+    close(fd);
+    std::ifstream output("spawn_output.txt");
+    std::string line;
+    BOOST_CHECK(std::getline(output, line) && line == "yes");
+    BOOST_CHECK(std::getline(output, line) && line == "/");
+}
@@ -0,0 +1,160 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../include/EvaluationVisitor.h"
+#include "../include/ReportBatcher.h"
+#include "FakeRelay.h"
+#include "TestScript.h"
+
+namespace {
+    SmtpMessage report(const std::string& recipient, const std::string& subject, const std::string& body) {
+        return SmtpMessage {"tkom@test", {recipient}, subject, body};
+    }
+
+    // polls until outcome is no longer pending or timeout passes
+    ReportBatcher::Delivery waitFor(const ReportBatcher::Outcome& outcome, std::chrono::milliseconds timeout) {
+        auto until = std::chrono::steady_clock::now() + timeout;
+        while(*outcome == ReportBatcher::Delivery::PENDING && std::chrono::steady_clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return *outcome;
+    }
+
+    // address nobody listens on anymore
+    std::string closedRelay() {
+        FakeRelay relay(true);
+        return relay.relay();
+    }
+}
+
+// equal reports in a row count repeats, window of the first one sends all of them
+BOOST_AUTO_TEST_CASE(BATCHED_REPORTS_ARE_SENT_AS_ONE_DIGEST)
+{
+    FakeRelay relay(true);
+    auto& batcher = ReportBatcher::instance();
+    std::chrono::milliseconds window(200);
+    auto first = batcher.submit(relay.relay(), "", report("a@test", "Raport 1", "one"), window, 100);
+    batcher.submit(relay.relay(), "", report("a@test", "Raport 1", "one"), window, 100);
+    auto last = batcher.submit(relay.relay(), "", report("a@test", "Raport 2", "two"), window, 100);
+    BOOST_CHECK(*first == ReportBatcher::Delivery::PENDING);
+    BOOST_CHECK(waitFor(last, std::chrono::seconds(5)) == ReportBatcher::Delivery::SENT);
+    BOOST_CHECK(*first == ReportBatcher::Delivery::SENT);
+    auto messages = relay.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK(messages[0].find("Subject: Digest of 2 raports\r\n") != std::string::npos);
+    auto body = messages[0].substr(messages[0].find("\r\n\r\n") + 4);
+    BOOST_CHECK_EQUAL(body, "== Raport 1 ==\r\none\r\nRepeated 2 times.\r\n== Raport 2 ==\r\ntwo\r\n");
+
+    // full batch does not wait for its window, flush does not wait for any
+    auto full = batcher.submit(relay.relay(), "", report("a@test", "Raport 3", "three"), std::chrono::seconds(30), 1);
+    BOOST_CHECK(*full == ReportBatcher::Delivery::SENT);
+    auto flushed = batcher.submit(relay.relay(), "", report("a@test", "Raport 4", "four"), std::chrono::seconds(30), 100);
+    batcher.flush();
+    BOOST_CHECK(*flushed == ReportBatcher::Delivery::SENT);
+    BOOST_CHECK_EQUAL(relay.messages().size(), 3u);
+}
+
+// digest is not dropped when relay fails, it goes again together with a report which came meanwhile
+BOOST_AUTO_TEST_CASE(FAILED_DIGEST_IS_RETRIED_WITH_LATER_REPORTS)
+{
+    FakeRelay relay(true);
+    relay.cutAtMail = 1;
+    auto& batcher = ReportBatcher::instance();
+    auto first = batcher.submit(relay.relay(), "", report("b@test", "Raport 1", "one"), std::chrono::milliseconds(50), 100);
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(relay.sessionCount() == 0 && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto later = batcher.submit(relay.relay(), "", report("b@test", "Raport 2", "two"), std::chrono::seconds(30), 100);
+    BOOST_CHECK(waitFor(first, std::chrono::seconds(5)) == ReportBatcher::Delivery::SENT);
+    BOOST_CHECK(*later == ReportBatcher::Delivery::SENT);
+    auto messages = relay.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK(messages[0].find("== Raport 1 ==\r\none\r\n== Raport 2 ==\r\ntwo\r\n") != std::string::npos);
+    BOOST_CHECK_EQUAL(relay.sessionCount(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(UNDELIVERABLE_DIGEST_FAILS_ITS_REPORTS)
+{
+    auto& batcher = ReportBatcher::instance();
+    // every attempt fails, the delays between them pass first
+    auto start = std::chrono::steady_clock::now();
+    auto unreachable = batcher.submit(closedRelay(), "", report("c@test", "Raport", "lost"),
+                                      std::chrono::milliseconds(10), 100);
+    BOOST_CHECK(waitFor(unreachable, std::chrono::seconds(10)) == ReportBatcher::Delivery::FAILED);
+    BOOST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(1750));
+
+    // refusal is not tried again
+    FakeRelay relay(true);
+    relay.rejected["gone@test"] = "550 no such user";
+    start = std::chrono::steady_clock::now();
+    auto refused = batcher.submit(relay.relay(), "", report("gone@test", "Raport", "refused"),
+                                  std::chrono::milliseconds(10), 100);
+    BOOST_CHECK(waitFor(refused, std::chrono::seconds(5)) == ReportBatcher::Delivery::FAILED);
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(250));
+    BOOST_CHECK_EQUAL(relay.sessionCount(), 1u);
+}
+
+// schedule of a report is finished with error status once its batch is given up
+BOOST_AUTO_TEST_CASE(SEND_RAPORT_STATUS_FOLLOWS_ITS_BATCH)
+{
+    system("rm -rf batch_dir && mkdir -p batch_dir && touch batch_dir/a");
+    FakeRelay relay(true);
+    std::string handler = "system_handler h\nh.register = \"send_raport\"\nh.raport_type = \"file_number\"\n"
+                          "h.mail = \"d@test\"\nh.dir = \"batch_dir\"\nh.batch = \"0.1\"\n";
+    auto output = runScript(handler + "h.relay = \"" + relay.relay() + "\"\nh.start\nint s\ns = h.wait\nput s\n"
+                            "h.relay = \"" + closedRelay() + "\"\nh.start\ns = h.wait\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "0 of int type.\n1 of int type.\n");
+    BOOST_CHECK_EQUAL(relay.messages().size(), 1u);
+}
+
+// interpreter killed while report waits for its window still sends it, then ends as killed
+BOOST_AUTO_TEST_CASE(BATCHES_ARE_FLUSHED_ON_TERMINATION)
+{
+    system("rm -rf batch_dir && mkdir -p batch_dir && touch batch_dir/a");
+    FakeRelay relay(true);
+    for(int signalNumber : {SIGTERM, SIGINT}) {
+        std::ofstream("batch_script.txt")
+                << "system_handler h\nh.register = \"send_raport\"\nh.raport_type = \"file_number\"\n"
+                   "h.mail = \"e@test\"\nh.dir = \"batch_dir\"\nh.batch = \"30\"\nh.relay = \""
+                << relay.relay() << "\"\nh.start\n$";
+        auto messages = relay.messages().size();
+        pid_t pid = fork();
+        if(pid == 0) {
+            freopen("/dev/null", "w", stdout);
+            execl(TKOM_BINARY, TKOM_BINARY, "-f", "batch_script.txt", (char*)nullptr);
+            _exit(127);
+        }
+        // report is batched well before that
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        BOOST_CHECK_EQUAL(relay.messages().size(), messages);
+        kill(pid, signalNumber);
+        int status;
+        waitpid(pid, &status, 0);
+        BOOST_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == signalNumber);
+        BOOST_CHECK_EQUAL(relay.messages().size(), messages + 1);
+    }
+}
+
+// recipient able to end the envelope line is refused, line breaks of dir do not leave the subject
+BOOST_AUTO_TEST_CASE(REPORT_HEADERS_CAN_NOT_BE_INJECTED)
+{
+    system("rm -rf batch_dir && mkdir -p batch_dir && touch batch_dir/a");
+    FakeRelay relay(true);
+    auto output = runScript("system_handler h\nh.register = \"send_raport\"\nh.raport_type = \"file_number\"\n"
+                            "h.mail = \"f@test>, g@test\"\nh.dir = \"batch_dir\"\nh.relay = \""
+                            + relay.relay() + "\"\nh.start\nint s\ns = h.wait\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "1 of int type.\n");
+    BOOST_CHECK(relay.messages().empty());
+
+    BOOST_CHECK_THROW(reportMessage("", "f@test\r\nRCPT TO:<g@test", "Raport", "text"), std::runtime_error);
+    BOOST_CHECK_THROW(reportMessage("tkom@test>", "f@test", "Raport", "text"), std::runtime_error);
+    auto message = reportMessage("", "f@test, g@test", "Raport file_number of dir\r\nBcc: g@test", "text");
+    BOOST_CHECK_EQUAL(message.subject, "Raport file_number of dir  Bcc: g@test");
+    BOOST_CHECK_EQUAL(message.recipients.size(), 2u);
+}
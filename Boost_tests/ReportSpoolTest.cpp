@@ -0,0 +1,136 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../include/ReportSpool.h"
+#include "FakeRelay.h"
+
+namespace {
+    SmtpMessage report(const std::string& recipient, const std::string& body) {
+        return SmtpMessage {"tkom@test", {recipient}, "Raport", body};
+    }
+
+    off_t sizeOf(const std::string& path) {
+        struct stat info {};
+        return stat(path.c_str(), &info) == 0 ? info.st_size : -1;
+    }
+
+    // spooled reports stay in file while relay keeps rejecting their recipient for now
+    void spoolRejected(FakeRelay& relay, const std::string& path, const std::vector<std::string>& bodies) {
+        relay.rejected["later@test"] = "452 try later";
+        ReportSpool spool(path);
+        for(auto& body : bodies) {
+            spool.enqueue(relay.relay(), report("later@test", body));
+        }
+        spool.drain();
+    }
+
+    // opened again with relay taking everything, what waited in file is sent
+    void sendSpooled(FakeRelay& relay, const std::string& path) {
+        relay.rejected.clear();
+        ReportSpool spool(path);
+        spool.drain();
+    }
+}
+
+// record cut by a crash was never acknowledged, the ones before it are sent and file is emptied
+BOOST_AUTO_TEST_CASE(SPOOL_RECOVERS_FROM_TORN_RECORD)
+{
+    unlink("spool_torn");
+    FakeRelay relay(true);
+    spoolRejected(relay, "spool_torn", {"first", "second"});
+    BOOST_CHECK(relay.messages().empty());
+    truncate("spool_torn", sizeOf("spool_torn") - 5);
+    sendSpooled(relay, "spool_torn");
+    auto messages = relay.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK(messages[0].find("\r\n\r\nfirst\r\n") != std::string::npos);
+    BOOST_CHECK_EQUAL(sizeOf("spool_torn"), 0);
+
+    // garbage behind the last whole record is cut as well
+    spoolRejected(relay, "spool_torn", {"third"});
+    auto size = sizeOf("spool_torn");
+    {
+        std::ofstream garbage("spool_torn", std::ios::app | std::ios::binary);
+        garbage << "TKSP and the rest of a header";
+    }
+    relay.rejected["later@test"] = "452 try later";
+    {
+        ReportSpool spool("spool_torn");
+        spool.drain();
+    }
+    BOOST_CHECK_EQUAL(sizeOf("spool_torn"), size);
+    sendSpooled(relay, "spool_torn");
+    BOOST_REQUIRE_EQUAL(relay.messages().size(), 2u);
+    BOOST_CHECK(relay.messages()[1].find("\r\n\r\nthird\r\n") != std::string::npos);
+}
+
+// records of sent reports do not pile up behind one which waits, file keeps only that one
+BOOST_AUTO_TEST_CASE(SPOOL_IS_COMPACTED_WHEN_DEAD_RECORDS_PASS_LIMIT)
+{
+    unlink("spool_compact");
+    FakeRelay waiting(true), taking(true);
+    waiting.rejected["later@test"] = "452 try later";
+    {
+        ReportSpool spool("spool_compact", 0);
+        spool.enqueue(waiting.relay(), report("later@test", "waiting"));
+        spool.drain();
+        auto waitingSize = sizeOf("spool_compact");
+        for(int i = 0; i < 20; i++) {
+            spool.enqueue(taking.relay(), report("a@test", std::string(200, 'a' + i)));
+            spool.drain();
+        }
+        BOOST_CHECK_EQUAL(taking.messages().size(), 20u);
+        BOOST_CHECK_EQUAL(sizeOf("spool_compact"), waitingSize);
+        BOOST_CHECK_EQUAL(sizeOf("spool_compact.tmp"), -1);
+    }
+    // with default limit the same records stay appended
+    unlink("spool_compact");
+    {
+        ReportSpool spool("spool_compact");
+        spool.enqueue(waiting.relay(), report("later@test", "waiting"));
+        spool.drain();
+        auto waitingSize = sizeOf("spool_compact");
+        spool.enqueue(taking.relay(), report("a@test", "sent"));
+        spool.drain();
+        BOOST_CHECK_GT(sizeOf("spool_compact"), waitingSize);
+    }
+    // compacted file is recovered with the waiting report
+    sendSpooled(waiting, "spool_compact");
+    auto messages = waiting.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK(messages[0].find("\r\n\r\nwaiting\r\n") != std::string::npos);
+}
+
+// write cut by file size limit leaves part of record, it is cut off and the group written again
+BOOST_AUTO_TEST_CASE(SPOOL_WRITES_GROUP_AGAIN_AFTER_FAILED_WRITE)
+{
+    unlink("spool_write");
+    FakeRelay relay(true);
+    relay.rejected["later@test"] = "452 try later";
+    auto previousHandler = signal(SIGXFSZ, SIG_IGN);
+    rlimit previousLimit {};
+    getrlimit(RLIMIT_FSIZE, &previousLimit);
+    {
+        ReportSpool spool("spool_write");
+        rlimit limit = previousLimit;
+        limit.rlim_cur = 10;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        spool.enqueue(relay.relay(), report("later@test", "delayed"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        setrlimit(RLIMIT_FSIZE, &previousLimit);
+        spool.drain();
+    }
+    signal(SIGXFSZ, previousHandler);
+    BOOST_CHECK_GT(sizeOf("spool_write"), 10);
+    sendSpooled(relay, "spool_write");
+    auto messages = relay.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+    BOOST_CHECK(messages[0].find("\r\n\r\ndelayed\r\n") != std::string::npos);
+}
@@ -2149,6 +2149,81 @@ BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_142)
     auto receivedToken = scanner.getTokenValue(); 
     BOOST_CHECK_EQUAL(expectedToken, receivedToken);
 }
+BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_143)
+{
+    std::ofstream outfile;
+    outfile.open("tmp.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << "for(" << "$";
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "tmp.txt";
+    Scanner scanner(configuration);
+    Token expectedToken("for", T_FOR);
+    scanner.getNextToken();
+    auto receivedToken = scanner.getTokenValue(); 
+    BOOST_CHECK_EQUAL(expectedToken, receivedToken);
+}
+BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_144)
+{
+    std::ofstream outfile;
+    outfile.open("tmp.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << "parallel_for(" << "$";
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "tmp.txt";
+    Scanner scanner(configuration);
+    Token expectedToken("parallel_for", T_PARALLEL_FOR);
+    scanner.getNextToken();
+    auto receivedToken = scanner.getTokenValue(); 
+    BOOST_CHECK_EQUAL(expectedToken, receivedToken);
+}
+BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_145)
+{
+    std::ofstream outfile;
+    outfile.open("tmp.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << "spawn" << "$";
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "tmp.txt";
+    Scanner scanner(configuration);
+    Token expectedToken("spawn", T_SPAWN);
+    scanner.getNextToken();
+    auto receivedToken = scanner.getTokenValue(); 
+    BOOST_CHECK_EQUAL(expectedToken, receivedToken);
+}
+BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_146)
+{
+    std::ofstream outfile;
+    outfile.open("tmp.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << "await" << "$";
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "tmp.txt";
+    Scanner scanner(configuration);
+    Token expectedToken("await", T_AWAIT);
+    scanner.getNextToken();
+    auto receivedToken = scanner.getTokenValue(); 
+    BOOST_CHECK_EQUAL(expectedToken, receivedToken);
+}
+BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_147)
+{
+    std::ofstream outfile;
+    outfile.open("tmp.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << "every(" << "$";
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "tmp.txt";
+    Scanner scanner(configuration);
+    Token expectedToken("every", T_EVERY);
+    scanner.getNextToken();
+    auto receivedToken = scanner.getTokenValue(); 
+    BOOST_CHECK_EQUAL(expectedToken, receivedToken);
+}
 BOOST_AUTO_TEST_CASE(AUTO_GENERATED_TEST_MULTI_NON_UNIT_0)
 {
     // not a typical unit test, two things are chcked
@@ -0,0 +1,134 @@
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/Scheduler.h"
+
+namespace {
+    // task ticking given number of times, recording its period when it is done
+    PeriodicTask countedTask(int periodMs, int ticks, std::mutex& mutex, std::vector<int>& order) {
+        auto left = std::make_shared<int>(ticks);
+        PeriodicTask task;
+        task.period = std::chrono::milliseconds(periodMs);
+        task.run = [left, periodMs, &mutex, &order] {
+            if(--*left > 0) {
+                return true;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(periodMs);
+            return false;
+        };
+        return task;
+    }
+}
+
+// 2.6 s and 2.7 s are past the first level of the wheel and reach their slots by cascading
+BOOST_AUTO_TEST_CASE(TIMERS_FIRE_IN_ORDER_OF_DUE_TIME)
+{
+    auto& scheduler = Scheduler::instance();
+    std::mutex mutex;
+    std::vector<int> order;
+    auto started = std::chrono::steady_clock::now();
+    std::vector<Scheduler::Id> ids;
+    for(auto period : {2700, 100, 2600, 300, 200}) {
+        ids.push_back(scheduler.add(countedTask(period, 2, mutex, order)));
+    }
+    for(auto id : ids) {
+        BOOST_CHECK_EQUAL(scheduler.waitFor(id, 10).value_or(-1), 0);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    std::vector<int> expected {100, 200, 300, 2600, 2700};
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+    BOOST_CHECK(elapsed >= std::chrono::milliseconds(2690));
+    BOOST_CHECK(elapsed < std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_CASE(FINISHED_SCHEDULE_IS_FORGOTTEN_ONCE_REPORTED)
+{
+    auto& scheduler = Scheduler::instance();
+    auto before = scheduler.size();
+    std::mutex mutex;
+    std::vector<int> order;
+    auto id = scheduler.add(countedTask(10, 3, mutex, order));
+    BOOST_REQUIRE_EQUAL(scheduler.waitFor(id, 5).value_or(-1), 0);
+    BOOST_CHECK_EQUAL(scheduler.size(), before);
+    BOOST_CHECK_THROW(scheduler.poll(id), std::runtime_error);
+
+    id = scheduler.add(countedTask(10, 1, mutex, order));
+    std::optional<int> status;
+    for(int i = 0; i < 500 && !status; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        status = scheduler.poll(id);
+    }
+    BOOST_CHECK_EQUAL(status.value_or(-1), 0);
+    BOOST_CHECK_EQUAL(scheduler.size(), before);
+}
+
+BOOST_AUTO_TEST_CASE(CANCELLED_SCHEDULE_IS_FORGOTTEN_ONCE_REPORTED)
+{
+    auto& scheduler = Scheduler::instance();
+    auto before = scheduler.size();
+    PeriodicTask task;
+    task.period = std::chrono::milliseconds(20);
+    task.run = [] { return true; };
+    auto id = scheduler.add(task);
+    BOOST_CHECK(!scheduler.poll(id));
+    scheduler.cancel(id, 137);
+    BOOST_CHECK_EQUAL(scheduler.size(), before + 1);
+    BOOST_CHECK_EQUAL(scheduler.poll(id).value_or(-1), 137);
+    BOOST_CHECK_EQUAL(scheduler.size(), before);
+    BOOST_CHECK_THROW(scheduler.cancel(id, 137), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(RELEASED_SCHEDULE_IS_FORGOTTEN_WHEN_IT_FINISHES)
+{
+    auto& scheduler = Scheduler::instance();
+    auto before = scheduler.size();
+    std::atomic<int> ticks {0};
+    PeriodicTask task;
+    task.period = std::chrono::milliseconds(10);
+    task.run = [&ticks] { return ++ticks < 5; };
+    scheduler.release(scheduler.add(task));
+    for(int i = 0; i < 500 && scheduler.size() != before; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(scheduler.size(), before);
+    BOOST_CHECK_EQUAL(ticks.load(), 5);
+
+    // released after it finished, nothing left to wait for
+    task.run = [] { return false; };
+    auto id = scheduler.add(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    scheduler.release(id);
+    BOOST_CHECK_EQUAL(scheduler.size(), before);
+}
+
+// slow tick covers several periods, SKIP drops ticks due meanwhile, CATCHUP runs them afterwards
+BOOST_AUTO_TEST_CASE(TICKS_DUE_WHILE_RUNNING_ARE_SKIPPED_OR_CAUGHT_UP)
+{
+    auto& scheduler = Scheduler::instance();
+    for(auto missed : {PeriodicTask::Missed::SKIP, PeriodicTask::Missed::CATCHUP}) {
+        // tick running while schedule is cancelled outlives this iteration
+        auto ticks = std::make_shared<std::atomic<int>>(0);
+        PeriodicTask task;
+        task.period = std::chrono::milliseconds(50);
+        task.missed = missed;
+        task.run = [ticks] {
+            if(++*ticks == 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(420));
+            }
+            return true;
+        };
+        auto id = scheduler.add(task);
+        std::this_thread::sleep_for(std::chrono::milliseconds(440));
+        scheduler.cancel(id, 0);
+        scheduler.poll(id);
+        if(missed == PeriodicTask::Missed::SKIP) {
+            BOOST_CHECK_LE(ticks->load(), 2);
+        } else {
+            BOOST_CHECK_GE(ticks->load(), 8);
+        }
+    }
+}
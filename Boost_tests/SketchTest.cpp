@@ -0,0 +1,197 @@
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../include/Sketch.h"
+#include "TestScript.h"
+
+namespace {
+    const double QUANTILES[] = {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999};
+
+    // same rank as the sketch asks its buckets for
+    double exactQuantile(std::vector<double> values, double q) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(q * (values.size() - 1))];
+    }
+
+    // largest relative error over quantiles at least minimumQ
+    double worstError(Sketch& sketch, const std::vector<double>& values, double minimumQ = 0) {
+        double worst = 0;
+        for(auto q : QUANTILES) {
+            if(q < minimumQ) {
+                continue;
+            }
+            auto exact = exactQuantile(values, q);
+            worst = std::max(worst, std::abs(sketch.quantile(q) - exact) / std::abs(exact));
+        }
+        return worst;
+    }
+
+    std::vector<double> lognormal(size_t count, unsigned seed) {
+        std::mt19937_64 random(seed);
+        std::lognormal_distribution<double> distribution(3, 2);
+        std::vector<double> values;
+        for(size_t i = 0; i < count; i++) {
+            values.push_back(distribution(random));
+        }
+        return values;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QUANTILE_SKETCH_RELATIVE_ERROR_IS_BOUNDED)
+{
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> uniform(1, 1e6);
+    std::vector<std::vector<double>> inputs {lognormal(100000, 2), {}, {}};
+    for(int i = 0; i < 100000; i++) {
+        inputs[1].push_back(uniform(random));
+        // both signs, negative values are kept in their own buckets
+        inputs[2].push_back((i % 3 ? 1 : -1) * uniform(random) / 1000);
+    }
+    for(auto accuracy : {0.01, 0.05}) {
+        for(auto& values : inputs) {
+            QuantileSketch sketch(accuracy);
+            for(auto value : values) {
+                sketch.add(value);
+            }
+            BOOST_CHECK_EQUAL(sketch.count(), values.size());
+            BOOST_CHECK_LE(worstError(sketch, values), accuracy + 1e-12);
+        }
+    }
+}
+
+// 60 decades do not fit into bucket limit, lowest buckets are folded and high quantiles stay accurate
+BOOST_AUTO_TEST_CASE(QUANTILE_SKETCH_COLLAPSES_LOWEST_BUCKETS)
+{
+    std::mt19937_64 random(3);
+    std::uniform_real_distribution<double> exponent(-30, 30);
+    std::vector<double> values;
+    QuantileSketch sketch(0.01);
+    for(int i = 0; i < 50000; i++) {
+        values.push_back(std::pow(10, exponent(random)));
+        sketch.add(values.back());
+    }
+    BOOST_CHECK_LE(worstError(sketch, values, 0.75), 0.01 + 1e-12);
+    BOOST_CHECK_EQUAL(sketch.quantile(0), *std::min_element(values.begin(), values.end()));
+    BOOST_CHECK_EQUAL(sketch.quantile(1), *std::max_element(values.begin(), values.end()));
+}
+
+BOOST_AUTO_TEST_CASE(LOG_HISTOGRAM_RELATIVE_ERROR_IS_BOUNDED)
+{
+    std::mt19937_64 random(4);
+    for(int bits : {4, 7, 10}) {
+        LogHistogram histogram(bits);
+        std::vector<double> values;
+        for(int i = 0; i < 100000; i++) {
+            values.push_back((double)(random() % 10000000));
+            histogram.add(values.back());
+        }
+        BOOST_CHECK_LE(worstError(histogram, values), std::pow(2, 1 - bits));
+    }
+    // small values are counted exactly
+    LogHistogram exact(7);
+    std::vector<double> small;
+    for(int i = 0; i < 1000; i++) {
+        small.push_back(i % 128);
+        exact.add(small.back());
+    }
+    for(auto q : QUANTILES) {
+        BOOST_CHECK_EQUAL(exact.quantile(q), exactQuantile(small, q));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MERGED_SKETCH_MATCHES_ONE_FED_WITH_ALL)
+{
+    auto values = lognormal(20000, 5);
+    QuantileSketch all, first, second;
+    LogHistogram allHistogram, firstHistogram, secondHistogram;
+    for(size_t i = 0; i < values.size(); i++) {
+        all.add(values[i]);
+        allHistogram.add(values[i]);
+        (i % 2 ? first : second).add(values[i]);
+        (i % 2 ? firstHistogram : secondHistogram).add(values[i]);
+    }
+    first.merge(second);
+    firstHistogram.merge(secondHistogram);
+    BOOST_CHECK_EQUAL(first.serialize(), all.serialize());
+    BOOST_CHECK_EQUAL(firstHistogram.serialize(), allHistogram.serialize());
+
+    QuantileSketch coarse(0.05);
+    BOOST_CHECK_THROW(first.merge(coarse), std::runtime_error);
+    BOOST_CHECK_THROW(first.merge(allHistogram), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SERIALIZED_SKETCH_LOADS_BACK)
+{
+    auto values = lognormal(5000, 6);
+    QuantileSketch sketch(0.02);
+    LogHistogram histogram(9);
+    for(auto value : values) {
+        sketch.add(value - 100);
+        histogram.add(value);
+    }
+    for(Sketch* original : std::initializer_list<Sketch*>{&sketch, &histogram}) {
+        auto loaded = Sketch::deserialize(original->serialize());
+        BOOST_CHECK_EQUAL(loaded->count(), original->count());
+        for(auto q : QUANTILES) {
+            BOOST_CHECK_EQUAL(loaded->quantile(q), original->quantile(q));
+        }
+        BOOST_CHECK_EQUAL(loaded->serialize(), original->serialize());
+    }
+    auto text = sketch.serialize();
+    BOOST_CHECK_THROW(Sketch::deserialize(text.substr(0, text.size() / 2)), std::runtime_error);
+    BOOST_CHECK_THROW(Sketch::deserialize("!!"), std::runtime_error);
+    BOOST_CHECK_THROW(Sketch::deserialize(""), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SKETCH_REJECTS_WRONG_INPUT)
+{
+    QuantileSketch sketch;
+    BOOST_CHECK_EQUAL(sketch.quantile(0.5), 0);
+    BOOST_CHECK_THROW(sketch.add(std::nan("")), std::runtime_error);
+    BOOST_CHECK_THROW(sketch.add(INFINITY), std::runtime_error);
+    BOOST_CHECK_THROW(sketch.quantile(1.5), std::runtime_error);
+    BOOST_CHECK_THROW(QuantileSketch(0), std::runtime_error);
+    BOOST_CHECK_THROW(LogHistogram(1), std::runtime_error);
+}
+
+// handle created on every iteration is given back, freed one is unknown afterwards
+BOOST_AUTO_TEST_CASE(FREED_SKETCH_RELEASES_HANDLE)
+{
+    auto sketchesBefore = SketchRegistry::instance().size();
+    auto output = runScript(
+            "int s\nfor(i, 0, 50)\ndo\ns = sketch()\nsketch_add(s, i)\nint h\nh = sketch()\n"
+            "sketch_merge(h, s)\nsketch_free(h)\nsketch_free(s)\ndone\n"
+            "s = sketch()\nsketch_add(s, 2)\nint n\nn = sketch_count(s)\nput n\nsketch_free(s)\n$");
+    BOOST_CHECK_EQUAL(output, "1 of int type.\n");
+    BOOST_CHECK_EQUAL(SketchRegistry::instance().size(), sketchesBefore);
+    BOOST_CHECK_THROW(runScript("int s\ns = sketch()\nsketch_free(s)\nsketch_add(s, 1)\n$"), std::runtime_error);
+    BOOST_CHECK_THROW(runScript("int s\ns = sketch()\nsketch_free(s)\nsketch_free(s)\n$"), std::runtime_error);
+}
+
+// quantiles are written next to the report, without a path nothing would show them
+BOOST_AUTO_TEST_CASE(CHECK_SYSTEM_QUANTILES_NEED_REPORT_PATH)
+{
+    BOOST_CHECK_THROW(runScript("system_handler h\nh.register = \"check_system\"\nh.raport_type = \"fds\"\n"
+                                "h.freq = \"0.05\"\nh.quantiles = \"0.5\"\nh.history = \"quantile_history\"\nh.start\n$"),
+                      std::runtime_error);
+    remove("quantile_report");
+    auto output = runScript(
+            "system_handler h\nh.register = \"check_system\"\nh.raport_type = \"fds\"\nh.freq = \"0.05\"\n"
+            "h.quantiles = \"0.5 0.9\"\nh.path = \"quantile_report\"\nh.start\n"
+            "system_handler t\nt.register = \"run\"\nt.path = \"sleep 0.3\"\nt.start\nint s\ns = t.wait\n"
+            "h.stop\ns = h.wait\nput s\n$");
+    BOOST_CHECK_EQUAL(output, "137 of int type.\n");
+    // tick running when schedule was stopped completes on its own and may be rewriting the report
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::ifstream report("quantile_report");
+    std::string content(std::istreambuf_iterator<char>(report), {});
+    BOOST_CHECK(content.rfind("There are ", 0) == 0);
+    BOOST_CHECK(content.find("Quantiles of fds over ") != std::string::npos);
+    BOOST_CHECK(content.find(" p50 ") != std::string::npos && content.find(" p90 ") != std::string::npos);
+}
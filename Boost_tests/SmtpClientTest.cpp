@@ -0,0 +1,103 @@
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+#include "../include/SmtpClient.h"
+#include "FakeRelay.h"
+
+namespace {
+    SmtpMessage message(std::vector<std::string> recipients, const std::string& body) {
+        return SmtpMessage {"tkom@test", std::move(recipients), "Report", body};
+    }
+}
+
+// lines end with CRLF, line starting with a dot gets another one, with and without pipelining
+BOOST_AUTO_TEST_CASE(SMTP_MESSAGE_IS_SENT_WITH_HEADERS_AND_DOT_STUFFING)
+{
+    for(bool pipelining : {true, false}) {
+        FakeRelay relay(pipelining);
+        SmtpPool::instance().send(relay.relay(), message({"a@test", "b@test"}, "first\n.second\nthird"));
+        auto messages = relay.messages();
+        BOOST_REQUIRE_EQUAL(messages.size(), 1u);
+        BOOST_CHECK(messages[0].rfind("From: tkom@test\r\nTo: a@test, b@test\r\nSubject: Report\r\nDate: ", 0) == 0);
+        auto body = messages[0].substr(messages[0].find("\r\n\r\n") + 4);
+        BOOST_CHECK_EQUAL(body, "first\r\n..second\r\nthird\r\n");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SMTP_SESSION_IS_REUSED_FOR_NEXT_MESSAGES)
+{
+    FakeRelay relay(true);
+    for(int i = 0; i < 5; i++) {
+        SmtpPool::instance().send(relay.relay(), message({"a@test"}, "report " + std::to_string(i)));
+    }
+    BOOST_CHECK_EQUAL(relay.messages().size(), 5u);
+    BOOST_CHECK_EQUAL(relay.sessionCount(), 1u);
+    BOOST_CHECK_THROW(SmtpPool::instance().send(relay.relay(), message({}, "nobody")), std::runtime_error);
+}
+
+// partly delivered message is not sent again, refused one leaves session usable
+BOOST_AUTO_TEST_CASE(SMTP_RECIPIENT_REJECTIONS)
+{
+    for(bool pipelining : {true, false}) {
+        FakeRelay relay(pipelining);
+        relay.rejected["gone@test"] = "550 no such user";
+        relay.rejected["full@test"] = "452 mailbox full";
+        auto& pool = SmtpPool::instance();
+        BOOST_CHECK_THROW(pool.send(relay.relay(), message({"a@test", "gone@test"}, "partly")), SmtpRefusal);
+        BOOST_CHECK_EQUAL(relay.messages().size(), 1u);
+        BOOST_CHECK_THROW(pool.send(relay.relay(), message({"gone@test"}, "refused")), SmtpRefusal);
+        try {
+            pool.send(relay.relay(), message({"full@test"}, "later"));
+            BOOST_ERROR("temporary rejection was not reported");
+        } catch(SmtpRefusal&) {
+            BOOST_ERROR("temporary rejection was reported as refusal");
+        } catch(std::runtime_error&) {
+        }
+        pool.send(relay.relay(), message({"a@test"}, "after"));
+        BOOST_CHECK_EQUAL(relay.messages().size(), 2u);
+        BOOST_CHECK_EQUAL(relay.sessionCount(), 1u);
+    }
+}
+
+// idle session cut by relay before the message went out, it is sent once on a fresh session
+BOOST_AUTO_TEST_CASE(SMTP_MESSAGE_IS_SENT_AGAIN_WHEN_SESSION_BROKE_BEFORE_CONTENT)
+{
+    FakeRelay relay(true);
+    relay.cutAtMail = 2;
+    auto& pool = SmtpPool::instance();
+    pool.send(relay.relay(), message({"a@test"}, "first"));
+    pool.send(relay.relay(), message({"a@test"}, "second"));
+    auto messages = relay.messages();
+    BOOST_REQUIRE_EQUAL(messages.size(), 2u);
+    BOOST_CHECK(messages[1].find("second") != std::string::npos);
+    BOOST_CHECK_EQUAL(relay.sessionCount(), 2u);
+}
+
+// content reached relay but its reply did not, sending it again could deliver it twice
+BOOST_AUTO_TEST_CASE(SMTP_MESSAGE_IS_NOT_SENT_AGAIN_AFTER_CONTENT_WAS_WRITTEN)
+{
+    for(bool pipelining : {true, false}) {
+        FakeRelay relay(pipelining);
+        relay.cutAfterContent = 2;
+        auto& pool = SmtpPool::instance();
+        pool.send(relay.relay(), message({"a@test"}, "first"));
+        BOOST_CHECK_THROW(pool.send(relay.relay(), message({"a@test"}, "second")), SmtpRefusal);
+        BOOST_CHECK_EQUAL(relay.messages().size(), 2u);
+        BOOST_CHECK_EQUAL(relay.sessionCount(), 1u);
+        // broken session is not kept, next message opens another one
+        pool.send(relay.relay(), message({"a@test"}, "third"));
+        BOOST_CHECK_EQUAL(relay.messages().size(), 3u);
+        BOOST_CHECK_EQUAL(relay.sessionCount(), 2u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SMTP_UNREACHABLE_RELAY_IS_AN_ERROR)
+{
+    int port;
+    {
+        FakeRelay relay(true);
+        port = std::stoi(relay.relay().substr(relay.relay().find(':') + 1));
+    }
+    BOOST_CHECK_THROW(SmtpPool::instance().send("127.0.0.1:" + std::to_string(port), message({"a@test"}, "x")),
+                      std::runtime_error);
+}
@@ -0,0 +1,97 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/SnapshotBackup.h"
+
+namespace {
+    void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    ino_t inodeOf(const std::string& path) {
+        struct stat info {};
+        stat(path.c_str(), &info);
+        return info.st_ino;
+    }
+
+    std::string latestLink() {
+        char target[256] = {};
+        readlink("snap_root/latest", target, sizeof(target) - 1);
+        return target;
+    }
+
+    // snapshots zz (file v1) then aa (file v2), names sort against their order
+    void makeSnapshots() {
+        system("rm -rf snap_src snap_root && mkdir -p snap_src/sub");
+        writeFile("snap_src/file", "v1");
+        writeFile("snap_src/sub/same", "same");
+        SnapshotBackup("snap_src", "snap_root", false).run("zz");
+        writeFile("snap_src/file", "v2");
+        SnapshotBackup("snap_src", "snap_root", false).run("aa");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SNAPSHOT_LINKS_UNCHANGED_FILES_TO_PREVIOUS)
+{
+    system("rm -rf snap_src snap_root && mkdir -p snap_src/sub");
+    writeFile("snap_src/a", "alpha");
+    writeFile("snap_src/sub/b", "beta");
+    auto first = SnapshotBackup("snap_src", "snap_root", true).run("first");
+    BOOST_CHECK_EQUAL(first.files, 2u);
+    BOOST_CHECK_EQUAL(first.linked, 0u);
+    BOOST_CHECK_EQUAL(latestLink(), "first");
+    writeFile("snap_src/a", "ALPHA");
+    auto second = SnapshotBackup("snap_src", "snap_root", true).run("second");
+    BOOST_CHECK_EQUAL(second.files, 1u);
+    BOOST_CHECK_EQUAL(second.linked, 1u);
+    BOOST_CHECK_EQUAL(inodeOf("snap_root/second/sub/b"), inodeOf("snap_root/first/sub/b"));
+    BOOST_CHECK(inodeOf("snap_root/second/a") != inodeOf("snap_root/first/a"));
+    BOOST_CHECK_EQUAL(latestLink(), "second");
+    BOOST_CHECK_THROW(SnapshotBackup("snap_src", "snap_root", true).run("second"), std::runtime_error);
+}
+
+// previous snapshot is the one latest points at, not the largest name
+BOOST_AUTO_TEST_CASE(SNAPSHOT_PREVIOUS_IS_LATEST_LINK)
+{
+    makeSnapshots();
+    BOOST_REQUIRE_EQUAL(latestLink(), "aa");
+    auto report = SnapshotBackup("snap_src", "snap_root", false).run("mm");
+    BOOST_CHECK_EQUAL(report.linked, 2u);
+    BOOST_CHECK_EQUAL(inodeOf("snap_root/mm/file"), inodeOf("snap_root/aa/file"));
+}
+
+BOOST_AUTO_TEST_CASE(SNAPSHOT_PREVIOUS_FALLS_BACK_TO_NEWEST_CREATED)
+{
+    makeSnapshots();
+    unlink("snap_root/latest");
+    auto report = SnapshotBackup("snap_src", "snap_root", false).run("mm");
+    BOOST_CHECK_EQUAL(report.linked, 2u);
+    BOOST_CHECK_EQUAL(inodeOf("snap_root/mm/file"), inodeOf("snap_root/aa/file"));
+
+    // dangling link is ignored as well
+    system("rm -rf snap_root/mm && ln -sfn gone snap_root/latest");
+    report = SnapshotBackup("snap_src", "snap_root", false).run("nn");
+    BOOST_CHECK_EQUAL(report.linked, 2u);
+    BOOST_CHECK_EQUAL(latestLink(), "nn");
+}
+
+// partial left by an interrupted run still links files of previous snapshot, changed ones are copied beside them
+BOOST_AUTO_TEST_CASE(SNAPSHOT_RESUMED_PARTIAL_LEAVES_PREVIOUS_UNCHANGED)
+{
+    system("rm -rf snap_src snap_root && mkdir -p snap_src");
+    writeFile("snap_src/f", "old");
+    writeFile("snap_src/g", "kept");
+    SnapshotBackup("snap_src", "snap_root", false).run("s1");
+    system("mkdir -p snap_root/s2.partial && ln snap_root/s1/f snap_root/s2.partial/f");
+    writeFile("snap_src/f", "new content");
+    auto report = SnapshotBackup("snap_src", "snap_root", false).run("s2");
+    BOOST_CHECK(report.errors.empty());
+    BOOST_CHECK_EQUAL(report.files, 1u);
+    BOOST_CHECK_EQUAL(report.linked, 1u);
+    std::ifstream previous("snap_root/s1/f"), current("snap_root/s2/f");
+    BOOST_CHECK_EQUAL(std::string(std::istreambuf_iterator<char>(previous), {}), "old");
+    BOOST_CHECK_EQUAL(std::string(std::istreambuf_iterator<char>(current), {}), "new content");
+    BOOST_CHECK(inodeOf("snap_root/s2/f") != inodeOf("snap_root/s1/f"));
+}
@@ -0,0 +1,139 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include "../include/SystemMetrics.h"
+
+namespace {
+    uint64_t meminfoField(const std::string& key) {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string name;
+        uint64_t value;
+        std::string unit;
+        while(meminfo >> name >> value) {
+            if(name == key + ":") {
+                return value * 1024;
+            }
+            std::getline(meminfo, unit);
+        }
+        return 0;
+    }
+}
+
+// content longer than the buffer is read again with a larger one, not cut
+BOOST_AUTO_TEST_CASE(PROC_FILE_READS_WHOLE_CONTENT_FROM_START)
+{
+    std::string content;
+    for(int i = 0; i < 1000; i++) {
+        content += "line " + std::to_string(i) + "\n";
+    }
+    std::ofstream("proc_file_content") << content;
+    ProcFile file("proc_file_content", 16);
+    BOOST_CHECK(file.read() == content);
+    BOOST_CHECK(file.read() == content);
+    BOOST_CHECK_THROW(ProcFile("proc_file_missing").read(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(LOAD_AVERAGE_AND_DESCRIPTORS_ARE_PARSED)
+{
+    SystemMetrics metrics;
+    auto load = metrics.loadAverage();
+    BOOST_CHECK(load.one >= 0 && load.five >= 0 && load.fifteen >= 0);
+    BOOST_CHECK_GE(load.running, 1u);
+    BOOST_CHECK_GE(load.tasks, load.running);
+    auto descriptors = metrics.fileDescriptors();
+    BOOST_CHECK_GT(descriptors.allocated, 0u);
+    BOOST_CHECK_GT(descriptors.maximum, descriptors.allocated);
+}
+
+BOOST_AUTO_TEST_CASE(MEMORY_MATCHES_MEMINFO)
+{
+    SystemMetrics metrics;
+    auto memory = metrics.memory();
+    BOOST_CHECK_EQUAL(memory.total, meminfoField("MemTotal"));
+    BOOST_CHECK_EQUAL(memory.swapTotal, meminfoField("SwapTotal"));
+    BOOST_CHECK_GT(memory.total, 0u);
+    BOOST_CHECK_LE(memory.available, memory.total);
+    BOOST_CHECK_LE(memory.free, memory.total);
+}
+
+BOOST_AUTO_TEST_CASE(DISKS_LEAVE_OUT_PSEUDO_FILESYSTEMS)
+{
+    SystemMetrics metrics;
+    auto& disks = metrics.disks();
+    for(auto& disk : disks) {
+        BOOST_CHECK(disk.mountPoint != "/proc" && disk.mountPoint != "/sys");
+        BOOST_CHECK_LE(disk.availableBytes, disk.totalBytes);
+        BOOST_CHECK_LE(disk.freeFiles, disk.totalFiles);
+    }
+    // same list is sampled again without parsing mounts
+    BOOST_CHECK_EQUAL(metrics.disks().size(), disks.size());
+}
+
+BOOST_AUTO_TEST_CASE(PROCESS_COUNTS_FILES_THREADS_AND_CPU)
+{
+    SystemMetrics metrics;
+    auto before = metrics.process();
+    BOOST_CHECK_EQUAL(before.pid, getpid());
+    BOOST_CHECK_GT(before.residentBytes, 0u);
+    BOOST_CHECK_EQUAL(before.cpuPercent, 0);
+
+    int files[3];
+    for(auto& file : files) {
+        file = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    std::mutex mutex;
+    std::condition_variable released;
+    bool isReleased = false;
+    std::thread sleeper([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&] { return isReleased; });
+    });
+    // busy half a second, one core used fully
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    volatile uint64_t spins = 0;
+    while(std::chrono::steady_clock::now() < until) {
+        spins = spins + 1;
+    }
+    auto after = metrics.process();
+    BOOST_CHECK_EQUAL(after.openFiles, before.openFiles + 3);
+    BOOST_CHECK_EQUAL(after.threads, before.threads + 1);
+    BOOST_CHECK_GT(after.cpuPercent, 30);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isReleased = true;
+    }
+    released.notify_all();
+    sleeper.join();
+    for(auto file : files) {
+        close(file);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(REPORT_TEXT_AND_SAMPLES)
+{
+    SystemMetrics metrics;
+    std::vector<SystemMetrics::Sample> samples;
+    auto text = metrics.report("fds", &samples);
+    BOOST_CHECK_EQUAL(text.rfind("There are ", 0), 0u);
+    BOOST_REQUIRE_EQUAL(samples.size(), 1u);
+    BOOST_CHECK_EQUAL(samples[0].series, "fds");
+    BOOST_CHECK_GT(samples[0].value, 0);
+
+    samples.clear();
+    text = metrics.report("memory", &samples);
+    BOOST_CHECK_EQUAL(text.rfind("Memory: ", 0), 0u);
+    BOOST_REQUIRE_EQUAL(samples.size(), 4u);
+    BOOST_CHECK_EQUAL(samples[0].series, "memory_available");
+
+    samples.clear();
+    metrics.report("loadavg", &samples);
+    BOOST_CHECK_EQUAL(samples.size(), 4u);
+    BOOST_CHECK_EQUAL(metrics.report("unknown", &samples), "");
+    BOOST_CHECK_EQUAL(samples.size(), 4u);
+}
@@ -0,0 +1,37 @@
+#ifndef TKOM_TESTSCRIPT_H
+#define TKOM_TESTSCRIPT_H
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../include/Scanner.h"
+#include "../include/Parser.h"
+#include "../include/Configuration.h"
+
+// runs script in this process and returns what it printed with put
+inline std::string runScript(const std::string& script) {
+    std::ofstream outfile("script.txt", std::ofstream::out | std::ofstream::trunc);
+    outfile << script;
+    outfile.close();
+
+    Configuration configuration;
+    configuration.inputPath = "script.txt";
+    std::ostringstream printed;
+    auto previous = std::cout.rdbuf(printed.rdbuf());
+    try {
+        Parser parser(std::make_shared<Scanner>(configuration));
+        parser.parse();
+        parser.analyzeTree();
+    } catch(...) {
+        std::cout.rdbuf(previous);
+        throw;
+    }
+    std::cout.rdbuf(previous);
+    auto output = printed.str();
+    // scanner greets first
+    std::string greeting = "Scanner launched!\n";
+    return output.compare(0, greeting.size(), greeting) == 0 ? output.substr(greeting.size()) : output;
+}
+
+#endif //TKOM_TESTSCRIPT_H
@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "../include/Hash.h"
+#include "../include/Throttle.h"
+
+namespace {
+    double secondsSince(std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(UNLIMITED_THROTTLE_DOES_NOT_WAIT)
+{
+    Throttle throttle(0, 0);
+    BOOST_CHECK(!throttle.isLimited());
+    BOOST_CHECK_EQUAL(throttle.chunkSize(), SIZE_MAX);
+    auto started = std::chrono::steady_clock::now();
+    for(int i = 0; i < 1000; i++) {
+        throttle.acquire(1024 * 1024 * 1024);
+    }
+    BOOST_CHECK(secondsSince(started) < 0.1);
+}
+
+BOOST_AUTO_TEST_CASE(THROTTLE_CHUNKS_ARE_ONE_BURST_OF_WHOLE_OPERATIONS)
+{
+    // 20 ms of 10 MB/s
+    BOOST_CHECK_EQUAL(Throttle(10e6, 0).chunkSize(), 200000u);
+    BOOST_CHECK_EQUAL(Throttle(100e6, 100).chunkSize(), 128u * 1024);
+    BOOST_CHECK_EQUAL(Throttle(1000, 0).chunkSize(), 4096u);
+}
+
+BOOST_AUTO_TEST_CASE(THROTTLE_LIMITS_BANDWIDTH_SHARED_BY_THREADS)
+{
+    Throttle throttle(4e6, 0);
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&throttle] {
+            for(size_t paid = 0; paid < 500000; paid += throttle.chunkSize()) {
+                throttle.acquire(throttle.chunkSize());
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    // 2 MB at 4 MB/s, less one burst of credit
+    auto elapsed = secondsSince(started);
+    BOOST_CHECK(elapsed > 0.4);
+    BOOST_CHECK(elapsed < 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(THROTTLE_LIMITS_OPERATIONS)
+{
+    Throttle throttle(0, 200);
+    auto started = std::chrono::steady_clock::now();
+    for(int i = 0; i < 60; i++) {
+        throttle.acquireOperation();
+    }
+    auto elapsed = secondsSince(started);
+    BOOST_CHECK(elapsed > 0.25);
+    BOOST_CHECK(elapsed < 0.6);
+}
+
+// hashing pays while it reads, not all of the file before it starts
+BOOST_AUTO_TEST_CASE(THROTTLED_HASH_IS_PACED_AND_UNCHANGED)
+{
+    {
+        std::ofstream file("throttle_hash", std::ios::binary | std::ios::trunc);
+        file << std::string(1000000, 'h');
+    }
+    Throttle throttle(2e6, 0);
+    auto started = std::chrono::steady_clock::now();
+    auto hash = Hasher::hashFile("throttle_hash", &throttle);
+    auto elapsed = secondsSince(started);
+    BOOST_CHECK_EQUAL(hash, Hasher::hashFile("throttle_hash"));
+    BOOST_CHECK(elapsed > 0.4);
+    BOOST_CHECK(elapsed < 1.0);
+    BOOST_CHECK_THROW(Hasher::hashFile("throttle_missing", &throttle), std::runtime_error);
+}
@@ -0,0 +1,148 @@
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <unistd.h>
+#include <vector>
+#include "../include/TimeSeries.h"
+
+namespace {
+    const size_t SMALL_SIZE = 16384 + 2 * 4096;
+    const size_t LARGE_SIZE = TimeSeries::DEFAULT_SIZE;
+
+    struct Sample {
+        int64_t timestamp;
+        double value;
+    };
+
+    uint64_t bitsOf(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    std::vector<Sample> scanAll(const TimeSeries& series, const std::string& name) {
+        std::vector<Sample> samples;
+        series.scan(name, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(),
+                    [&samples](int64_t timestamp, double value) { samples.push_back({timestamp, value}); });
+        return samples;
+    }
+
+    void checkSame(const std::vector<Sample>& decoded, const std::vector<Sample>& expected) {
+        BOOST_REQUIRE_EQUAL(decoded.size(), expected.size());
+        for(size_t i = 0; i < expected.size(); i++) {
+            BOOST_CHECK_EQUAL(decoded[i].timestamp, expected[i].timestamp);
+            // bit for bit, so nan and negative zero count too
+            BOOST_CHECK_EQUAL(bitsOf(decoded[i].value), bitsOf(expected[i].value));
+        }
+    }
+}
+
+// every width of delta of delta and every kind of xor, new window, reused window and no change
+BOOST_AUTO_TEST_CASE(GORILLA_SAMPLES_ARE_DECODED_EXACTLY)
+{
+    unlink("series_exact");
+    auto series = std::make_shared<TimeSeries>("series_exact", LARGE_SIZE);
+    std::vector<Sample> expected;
+    int64_t timestamp = 1700000000000;
+    const int64_t deltas[] = {1000, 1000, 1000, 1001, 937, 1064, 1200, 800, 3000, 1000, 0, 0,
+                              100000, 1, 5000000000, 1000};
+    const double values[] = {1.5, 1.5, 1.75, -1.75, 0.0, -0.0, 1e300, 4.9e-324, 42, 42.000001,
+                             std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+                             -123456.789, 3, 3, 2};
+    for(size_t i = 0; i < 16; i++) {
+        timestamp += deltas[i];
+        expected.push_back({timestamp, values[i]});
+        series->append("mixed", timestamp, values[i]);
+    }
+    std::mt19937_64 random(7);
+    for(int i = 0; i < 300; i++) {
+        timestamp += 1 + (int64_t)(random() % 5000);
+        double value = (random() % 4 == 0) ? expected.back().value : (double)(random() % 100000) / 100;
+        expected.push_back({timestamp, value});
+        series->append("mixed", timestamp, value);
+    }
+    checkSame(scanAll(*series, "mixed"), expected);
+
+    // mapped again read only, decoded straight from file
+    auto reader = std::make_shared<TimeSeries>("series_exact", 0);
+    BOOST_CHECK(!reader->isWritable());
+    checkSame(scanAll(*reader, "mixed"), expected);
+    BOOST_CHECK_THROW(reader->append("mixed", timestamp, 1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GORILLA_SCAN_AND_AGGREGATE_KEEP_WINDOW)
+{
+    unlink("series_window");
+    TimeSeries series("series_window", LARGE_SIZE);
+    for(int i = 0; i < 2000; i++) {
+        series.append("a", i * 10, i);
+        series.append("b", i * 10, -i);
+    }
+    std::vector<Sample> window;
+    series.scan("a", 100, 190, [&window](int64_t timestamp, double value) { window.push_back({timestamp, value}); });
+    BOOST_REQUIRE_EQUAL(window.size(), 10u);
+    BOOST_CHECK_EQUAL(window.front().timestamp, 100);
+    BOOST_CHECK_EQUAL(window.back().value, 19);
+    auto aggregate = series.aggregate("b", 0, 19990);
+    BOOST_CHECK_EQUAL(aggregate.count, 2000u);
+    BOOST_CHECK_EQUAL(aggregate.min, -1999);
+    BOOST_CHECK_EQUAL(aggregate.max, 0);
+    BOOST_CHECK_EQUAL(aggregate.sum, -1999.0 * 2000 / 2);
+    BOOST_CHECK_EQUAL(series.aggregate("missing", 0, 19990).count, 0u);
+}
+
+// two blocks in a ring, the oldest one is taken and the newest samples stay in time order
+BOOST_AUTO_TEST_CASE(FULL_HISTORY_DROPS_OLDEST_SAMPLES)
+{
+    unlink("series_ring");
+    TimeSeries series("series_ring", SMALL_SIZE);
+    std::mt19937_64 random(11);
+    const int total = 5000;
+    for(int i = 0; i < total; i++) {
+        series.append("noisy", i * 1000 + (int64_t)(random() % 700), (double)random() / 3);
+    }
+    auto samples = scanAll(series, "noisy");
+    BOOST_REQUIRE(!samples.empty());
+    BOOST_CHECK_LT(samples.size(), (size_t)total);
+    for(size_t i = 1; i < samples.size(); i++) {
+        BOOST_CHECK_EQUAL(samples[i].timestamp / 1000, samples[i - 1].timestamp / 1000 + 1);
+    }
+    BOOST_CHECK_EQUAL(samples.back().timestamp / 1000, total - 1);
+}
+
+// writer keeps file locked, registry forgets it and unlocks file once its last user is gone
+BOOST_AUTO_TEST_CASE(OPENED_HISTORY_IS_RELEASED_WITH_LAST_USER)
+{
+    unlink("series_open");
+    auto writer = TimeSeries::open("series_open", SMALL_SIZE);
+    BOOST_CHECK(writer->isWritable());
+    BOOST_CHECK_EQUAL(TimeSeries::open("series_open").get(), writer.get());
+    BOOST_CHECK_THROW(TimeSeries("series_open", SMALL_SIZE), std::runtime_error);
+    writer->append("x", 1, 2);
+    writer.reset();
+
+    // nothing left in registry, new writer locks file again
+    BOOST_CHECK_NO_THROW(TimeSeries("series_open", SMALL_SIZE));
+    auto reader = TimeSeries::open("series_open");
+    BOOST_CHECK(!reader->isWritable());
+    BOOST_CHECK_EQUAL(reader->aggregate("x", 0, 10).sum, 2);
+    writer = TimeSeries::open("series_open", SMALL_SIZE);
+    BOOST_CHECK(writer->isWritable());
+    BOOST_CHECK(writer.get() != reader.get());
+}
+
+BOOST_AUTO_TEST_CASE(HISTORY_FILE_IS_VALIDATED)
+{
+    unlink("series_bad");
+    BOOST_CHECK_THROW(TimeSeries("series_bad", 1000), std::runtime_error);
+    unlink("series_bad");
+    BOOST_CHECK_THROW(TimeSeries("series_bad", 0), std::runtime_error);
+    {
+        TimeSeries created("series_bad", SMALL_SIZE);
+    }
+    truncate("series_bad", 100);
+    BOOST_CHECK_THROW(TimeSeries("series_bad", 0), std::runtime_error);
+}
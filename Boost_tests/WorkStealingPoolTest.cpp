@@ -0,0 +1,59 @@
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../include/WorkStealingPool.h"
+
+BOOST_AUTO_TEST_CASE(TASK_GROUP_RUNS_EVERY_TASK)
+{
+    WorkStealingPool pool(4);
+    std::atomic<int> sum {0};
+    {
+        TaskGroup group(pool);
+        for(int i = 1; i <= 1000; i++) {
+            group.run([&sum, i] { sum += i; });
+        }
+        group.wait();
+        BOOST_CHECK_EQUAL(sum.load(), 500500);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TASK_GROUP_NESTED_TASKS_DO_NOT_DEADLOCK)
+{
+    WorkStealingPool pool(2);
+    std::atomic<int> leaves {0};
+    TaskGroup outer(pool);
+    for(int i = 0; i < 16; i++) {
+        outer.run([&] {
+            TaskGroup inner(pool);
+            for(int j = 0; j < 16; j++) {
+                inner.run([&] { leaves++; });
+            }
+        });
+    }
+    outer.wait();
+    BOOST_CHECK_EQUAL(leaves.load(), 256);
+}
+
+// group lives on stack and is destroyed as soon as wait() returns, the last task must be done with it
+BOOST_AUTO_TEST_CASE(TASK_GROUP_SHORT_LIVED_GROUPS_STRESS)
+{
+    WorkStealingPool pool(4);
+    std::vector<std::thread> creators;
+    std::atomic<int> total {0};
+    for(int t = 0; t < 4; t++) {
+        creators.emplace_back([&] {
+            for(int round = 0; round < 5000; round++) {
+                TaskGroup group(pool);
+                group.run([&] { total++; });
+                if(round % 2) {
+                    group.run([&] { total++; });
+                }
+            }
+        });
+    }
+    for(auto& creator : creators) {
+        creator.join();
+    }
+    BOOST_CHECK_EQUAL(total.load(), 4 * (2500 + 5000));
+}
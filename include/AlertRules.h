@@ -0,0 +1,45 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_ALERTRULES_H
+#define TKOM_ALERTRULES_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SystemMetrics.h"
+
+/*
+ * Threshold rules of a check_system handler, written as "series > threshold for seconds".
+ * Rules are parsed once into a table of comparisons indexed by series name, every sample
+ * only looks up its rules and compares numbers. Rule fires when its condition holds for the
+ * whole duration and resolves when it stops holding, only these transitions are reported.
+ */
+class AlertRules {
+public:
+    // comparison is one of > >= < <= == !=, "for seconds" is optional
+    void add(const std::string& rule);
+    bool empty() const { return rules.empty(); }
+    // messages of rules which fired or resolved with these samples, timestamp in milliseconds
+    std::vector<std::string> evaluate(const std::vector<SystemMetrics::Sample>& samples, int64_t timestamp);
+
+private:
+    enum class Comparison {GREATER, GREATER_EQUAL, LESS, LESS_EQUAL, EQUAL, NOT_EQUAL};
+    enum class State {OK, PENDING, FIRING};
+    struct Rule {
+        std::string text;
+        Comparison comparison;
+        double threshold;
+        int64_t duration;
+        State state {State::OK};
+        // when condition started to hold
+        int64_t since {0};
+    };
+
+    std::vector<Rule> rules;
+    std::unordered_map<std::string, std::vector<size_t>> rulesOfSeries;
+};
+
+#endif //TKOM_ALERTRULES_H
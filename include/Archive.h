@@ -0,0 +1,121 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_ARCHIVE_H
+#define TKOM_ARCHIVE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "WorkStealingPool.h"
+#include "Throttle.h"
+
+struct ArchiveReport {
+    size_t files {0};
+    size_t directories {0};
+    size_t links {0};
+    // size of tar stream and of what it was compressed to
+    size_t bytes {0};
+    size_t compressedBytes {0};
+    std::vector<std::string> errors;
+};
+
+/*
+ * Index written next to archive (archive path + ".idx"). Checkpoints are block starts compressed
+ * without a dictionary, inflate can begin there. Every file points at its tar header.
+ */
+struct ArchiveIndex {
+    struct Checkpoint {
+        uint64_t uncompressedOffset;
+        uint64_t compressedOffset;
+    };
+    struct File {
+        std::string path;
+        uint64_t headerOffset;
+    };
+    std::vector<Checkpoint> checkpoints;
+    std::vector<File> files;
+
+    void write(const std::string& path) const;
+    static ArchiveIndex read(const std::string& path);
+};
+
+/*
+ * Streams source tree as ustar into a gzip file, in the style of pigz. Tar stream is cut into
+ * blocks compressed as raw deflate by pool tasks, each primed with last 32 KiB of the previous
+ * block, and written in order by the calling thread. Blocks end with a sync flush, so their
+ * output just concatenates, crc32 of blocks are joined with crc32_combine. Every few blocks
+ * one is compressed without dictionary and becomes a checkpoint for random access restore.
+ * Output is a standard gzip stream, tar xzf reads it.
+ */
+class ArchiveWriter {
+public:
+    ArchiveWriter(std::string path, int level, Throttle* throttle = nullptr,
+                  WorkStealingPool& pool = WorkStealingPool::instance());
+    ~ArchiveWriter();
+    ArchiveReport write(std::string source);
+
+private:
+    struct Block {
+        std::string input;
+        std::string dictionary;
+        bool isLast {false};
+        bool isCheckpoint {false};
+        uint64_t uncompressedStart {0};
+        std::string output;
+        uint32_t crc {0};
+        bool isDone {false};
+        bool isFailed {false};
+    };
+
+    std::string path;
+    int level;
+    Throttle* throttle;
+    WorkStealingPool& pool;
+    int fd {-1};
+    std::shared_ptr<Block> current;
+    std::string previousTail;
+    uint64_t uncompressedOffset {0};
+    uint64_t compressedOffset {0};
+    size_t blockCount {0};
+    uint32_t crc {0};
+    std::deque<std::shared_ptr<Block>> pending;
+    std::mutex mutex;
+    std::condition_variable blockDone;
+    ArchiveIndex index;
+    ArchiveReport report;
+
+    void addTree(const std::string& source, const std::string& relative);
+    void addEntry(const std::string& source, const std::string& relative, const struct stat& info);
+    void addHeader(const std::string& name, const struct stat& info, char type, const std::string& linkTarget);
+    void addLongName(char type, const std::string& name);
+    void addFileData(const std::string& source, uint64_t size);
+    void put(const void* data, size_t size);
+    void pad();
+    void submitBlock(bool isLast);
+    void writeBlocks(bool waitForAll);
+    void writeRaw(const void* data, size_t size);
+    static void compress(Block& block, int level);
+};
+
+/*
+ * Restores whole archive by inflating it from the start, or a single file by looking it up
+ * in the index and inflating from the nearest checkpoint before it.
+ */
+class ArchiveReader {
+public:
+    explicit ArchiveReader(std::string path) : path(std::move(path)) {}
+    ArchiveReport extractAll(const std::string& target);
+    ArchiveReport extractFile(const std::string& name, const std::string& target);
+
+private:
+    std::string path;
+};
+
+#endif //TKOM_ARCHIVE_H
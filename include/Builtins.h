@@ -0,0 +1,33 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_BUILTINS_H
+#define TKOM_BUILTINS_H
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+/*
+ * Functions callable from scripts without declaration. User defined functions
+ * with the same name take precedence. Arguments come already evaluated, strings with quotes.
+ */
+struct Builtins {
+    using Value = std::variant<int, double, std::string>;
+    using Function = std::function<std::optional<Value>(std::vector<Value>& args)>;
+
+    static const Function* find(const std::string& name);
+
+    static int intArg(const std::vector<Value>& args, size_t index, const std::string& name);
+    static double numberArg(const std::vector<Value>& args, size_t index, const std::string& name);
+    // removes outer quotes
+    static std::string stringArg(const std::vector<Value>& args, size_t index, const std::string& name);
+    static Value quoted(const std::string& value);
+    static std::string toString(const Value& value);
+};
+
+#endif //TKOM_BUILTINS_H
@@ -0,0 +1,199 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_CHANNEL_H
+#define TKOM_CHANNEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <variant>
+#include <vector>
+#include "HandleRegistry.h"
+
+// capacity is rounded up to power of two
+inline size_t roundUpToPowerOfTwo(size_t value) {
+    size_t power = 1;
+    while(power < value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+/*
+ * Bounded multi producer multi consumer ring (D. Vyukov). Every cell carries a sequence number
+ * telling whether it is ready to be written or read for a given position, so producers and
+ * consumers only contend on their own position counter.
+ */
+template<typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t requestedCapacity) :
+            capacity(roundUpToPowerOfTwo(requestedCapacity)), mask(capacity - 1), cells(new Cell[capacity]) {
+        for(size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T& value) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells[position & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+            if(difference == 0) {
+                if(enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells[position & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+            if(difference == 0) {
+                if(dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return dequeuePosition.load(std::memory_order_acquire) >= enqueuePosition.load(std::memory_order_acquire);
+    }
+
+    bool full() const {
+        return enqueuePosition.load(std::memory_order_acquire) - dequeuePosition.load(std::memory_order_acquire) >= capacity;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePosition {0};
+    alignas(64) std::atomic<size_t> dequeuePosition {0};
+};
+
+// single producer single consumer ring, each side caches the other index to avoid sharing cache lines
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t requestedCapacity) :
+            capacity(roundUpToPowerOfTwo(requestedCapacity)), mask(capacity - 1), cells(new T[capacity]) {}
+
+    bool tryPush(T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if(currentTail - cachedHead >= capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if(currentTail - cachedHead >= capacity) {
+                return false;
+            }
+        }
+        cells[currentTail & mask] = std::move(value);
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if(currentHead == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if(currentHead == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(cells[currentHead & mask]);
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) >= tail.load(std::memory_order_acquire);
+    }
+
+    bool full() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire) >= capacity;
+    }
+
+private:
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<T[]> cells;
+    alignas(64) std::atomic<size_t> head {0};
+    size_t cachedTail {0};
+    alignas(64) std::atomic<size_t> tail {0};
+    size_t cachedHead {0};
+};
+
+/*
+ * Bounded channel of script values. Fast path is a lock-free ring operation, mutex and
+ * condition variable are touched only when the other side is parked waiting.
+ * Batched operations wake the other side once per batch.
+ */
+class Channel {
+public:
+    using Value = std::variant<int, double, std::string>;
+
+    Channel(size_t capacity, bool singleProducerSingleConsumer);
+
+    // false if channel was closed
+    bool send(Value value);
+    size_t sendBatch(std::vector<Value> values);
+    // false if channel is closed and drained
+    bool receive(Value& value);
+    // waits for at least one value, then takes as many as available up to maxCount
+    size_t receiveBatch(std::vector<Value>& values, size_t maxCount);
+    void close();
+    bool isDrained() const;
+
+private:
+    std::unique_ptr<MpmcRing<Value>> mpmcRing;
+    std::unique_ptr<SpscRing<Value>> spscRing;
+    std::atomic<bool> closed {false};
+    std::atomic<int> parkedSenders {0};
+    std::atomic<int> parkedReceivers {0};
+    std::mutex parkingMutex;
+    std::condition_variable receiversCondition;
+    std::condition_variable sendersCondition;
+
+    bool tryPush(Value& value);
+    bool tryPop(Value& value);
+    bool empty() const;
+    bool full() const;
+    void wake(std::atomic<int>& parked, std::condition_variable& condition);
+    template<typename Predicate>
+    void park(std::atomic<int>& parked, std::condition_variable& condition, Predicate isReady);
+};
+
+using ChannelRegistry = HandleRegistry<Channel>;
+
+#endif //TKOM_CHANNEL_H
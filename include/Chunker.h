@@ -0,0 +1,29 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_CHUNKER_H
+#define TKOM_CHUNKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/*
+ * FastCDC content defined chunking. Gear rolling hash decides cut points from the data itself,
+ * so an insertion moves only the chunks around it and the rest still deduplicates. Normalized
+ * chunking uses a stricter mask before the average size and a looser one after it, keeping
+ * chunk sizes close to the average.
+ */
+namespace Chunker {
+    const size_t MIN_SIZE = 2 * 1024;
+    const size_t AVERAGE_SIZE = 8 * 1024;
+    const size_t MAX_SIZE = 64 * 1024;
+
+    // length of the first chunk of data
+    size_t cut(const unsigned char* data, size_t size);
+    // calls onChunk(offset, length) for consecutive chunks covering the whole data
+    void split(const unsigned char* data, size_t size, const std::function<void(size_t, size_t)>& onChunk);
+}
+
+#endif //TKOM_CHUNKER_H
@@ -0,0 +1,101 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_COPYENGINE_H
+#define TKOM_COPYENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "WorkStealingPool.h"
+#include "Throttle.h"
+
+class Hasher;
+
+struct CopyReport {
+    size_t files {0};
+    // regular files left out by CopyEngine::shouldCopy
+    size_t skipped {0};
+    size_t directories {0};
+    size_t links {0};
+    size_t bytes {0};
+    // files gone from source since previous incremental run
+    size_t deleted {0};
+    // files hard linked to previous snapshot and its name
+    size_t linked {0};
+    std::string snapshot;
+    std::vector<std::string> errors;
+};
+
+/*
+ * In-process replacement of cp -R. Every directory is read by its own pool task, regular files
+ * are copied in batches by further tasks, so trees of many small files use all workers.
+ * File data goes through copy_file_range (no copy through user space, reflinks where file
+ * system supports it), then sendfile, then plain read/write. Modes and timestamps are kept,
+ * directories get theirs after the whole tree is copied, as filling them changes mtime.
+ */
+class CopyEngine {
+public:
+    using FileHook = std::function<bool(const std::string& relativePath, const struct stat& info)>;
+    using CopiedHook = std::function<void(const std::string& relativePath, const struct stat& info, uint64_t hash)>;
+
+    explicit CopyEngine(WorkStealingPool& pool = WorkStealingPool::instance()) : pool(pool) {}
+
+    // same target rules as cp -R: into target/<name of source> if target is an existing directory
+    CopyReport copy(std::string source, std::string target);
+    // copies source tree as target itself, whatever exists there
+    CopyReport mirror(std::string source, std::string target);
+    /*
+     * Called from pool workers for every regular file, path is relative to source.
+     * shouldCopy returning false leaves file out, onCopied is told about every copied file.
+     */
+    FileHook shouldCopy;
+    CopiedHook onCopied;
+    // onCopied gets hash of the bytes as they were copied, 0 otherwise; data then goes through user space
+    bool isHashed {false};
+    // shared by all workers, limits bandwidth and IOPS of the whole copy
+    Throttle* throttle {nullptr};
+    // copies data, mode and timestamps of a regular file, returns number of bytes, hasher is fed with the data
+    static size_t copyFile(const std::string& source, const std::string& target, Throttle* throttle = nullptr,
+                           Hasher* hasher = nullptr);
+
+private:
+    struct Entry {
+        std::string source;
+        std::string target;
+        unsigned char type;
+    };
+    struct DirectoryMetadata {
+        std::string path;
+        mode_t mode;
+        timespec times[2];
+    };
+
+    WorkStealingPool& pool;
+    std::atomic<size_t> files {0};
+    std::atomic<size_t> skipped {0};
+    std::atomic<size_t> directories {0};
+    std::atomic<size_t> links {0};
+    std::atomic<size_t> bytes {0};
+    // copy must not descend into its own target when it lies inside source
+    dev_t targetDevice {0};
+    ino_t targetInode {0};
+    // stripped from source paths to get paths relative to copied tree
+    size_t sourcePrefixLength {0};
+    std::mutex mutex;
+    std::vector<DirectoryMetadata> copiedDirectories;
+    std::vector<std::string> errors;
+
+    void copyDirectory(TaskGroup& group, std::string source, std::string target);
+    void copyEntries(std::vector<Entry> entries);
+    void copyEntry(const Entry& entry);
+    void copyRegularFile(const Entry& entry);
+    void fail(const std::string& message);
+};
+
+#endif //TKOM_COPYENGINE_H
@@ -0,0 +1,122 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_DEDUPSTORE_H
+#define TKOM_DEDUPSTORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "WorkStealingPool.h"
+#include "Throttle.h"
+
+struct ChunkId {
+    uint64_t high {0};
+    uint64_t low {0};
+
+    bool operator==(const ChunkId& other) const { return high == other.high && low == other.low; }
+    // two XXH64 with different seeds, collisions are not a practical concern for backup sizes
+    static ChunkId of(const void* data, size_t size);
+};
+
+struct DedupReport {
+    std::string snapshot;
+    size_t files {0};
+    size_t directories {0};
+    size_t links {0};
+    size_t bytes {0};
+    size_t chunks {0};
+    size_t newChunks {0};
+    // bytes written to pack, what the snapshot really costs
+    size_t storedBytes {0};
+    std::vector<std::string> errors;
+};
+
+/*
+ * Deduplicating backup store. Files are split into content defined chunks (Chunker), every
+ * unique chunk is appended once to a pack file and found again by its ChunkId in the chunk index.
+ * A snapshot lists files with their chunk ids and is enough to restore the tree.
+ *
+ * Store directory holds:
+ *   packs/NNNNNN.pack  chunk data, one pack per backup run, never modified afterwards
+ *   chunks.idx         append only records: chunk id, pack, offset, length
+ *   snapshots/NAME     files, directories and links of one backup run
+ *
+ * Reading, chunking, hashing and storing run as one pool task per file segment, large files are
+ * cut into segments so a single VM image still uses every worker. Pack space is reserved with an
+ * atomic counter and written with pwrite, so storing does not serialize on a lock.
+ */
+class DedupStore {
+public:
+    explicit DedupStore(std::string root, Throttle* throttle = nullptr,
+                        WorkStealingPool& pool = WorkStealingPool::instance());
+    ~DedupStore();
+
+    // empty name picks current time
+    DedupReport backup(std::string source, std::string snapshot = "");
+    // empty name picks the latest snapshot
+    DedupReport restore(std::string target, std::string snapshot = "");
+
+private:
+    struct ChunkIdHash {
+        size_t operator()(const ChunkId& id) const { return id.low; }
+    };
+    struct ChunkLocation {
+        uint32_t pack;
+        uint32_t length;
+        uint64_t offset;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<ChunkId, ChunkLocation, ChunkIdHash> chunks;
+    };
+    struct SnapshotEntry {
+        std::string path;
+        // S_IFREG, S_IFDIR or S_IFLNK with permission bits
+        uint32_t mode {0};
+        int64_t mtimeSeconds {0};
+        uint32_t mtimeNanoseconds {0};
+        uint64_t size {0};
+        std::string linkTarget;
+        std::vector<ChunkId> chunks;
+    };
+
+    static const size_t SHARD_COUNT = 64;
+
+    std::string root;
+    Throttle* throttle;
+    WorkStealingPool& pool;
+    Shard shards[SHARD_COUNT];
+    uint32_t packNumber {0};
+    int packFd {-1};
+    std::atomic<uint64_t> packEnd {0};
+    std::mutex newChunksMutex;
+    std::vector<std::pair<ChunkId, ChunkLocation>> newChunks;
+    std::mutex mutex;
+    std::vector<SnapshotEntry> entries;
+    std::vector<std::string> errors;
+    std::atomic<size_t> chunkCount {0};
+    std::atomic<size_t> storedBytes {0};
+    // a chunk failed to be written, files may refer to it
+    std::atomic<bool> isChunkLost {false};
+
+    Shard& shardOf(const ChunkId& id) { return shards[id.high % SHARD_COUNT]; }
+    void loadIndex();
+    void openPack();
+    void walk(TaskGroup& group, std::string source, std::string relative);
+    void storeFile(TaskGroup& group, std::string source, std::string relative, struct stat info);
+    void storeChunk(const ChunkId& id, const unsigned char* data, size_t length);
+    void writeSnapshot(const std::string& name);
+    std::vector<SnapshotEntry> readSnapshot(const std::string& name);
+    std::string latestSnapshot();
+    // path of entry is opened below targetFd without following symlinks
+    void restoreFile(const SnapshotEntry& entry, int targetFd, const std::vector<int>& packs);
+    void fail(const std::string& message);
+};
+
+#endif //TKOM_DEDUPSTORE_H
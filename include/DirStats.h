@@ -0,0 +1,117 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_DIRSTATS_H
+#define TKOM_DIRSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "WorkStealingPool.h"
+
+class DirStatsCache;
+
+// entries directly in one directory
+struct DirCounts {
+    uint64_t files {0};
+    uint64_t directories {0};
+    uint64_t links {0};
+    uint64_t others {0};
+    uint64_t bytes {0};
+    bool hasBytes {false};
+    std::vector<std::string> subdirectories;
+};
+
+struct DirStats {
+    size_t files {0};
+    size_t directories {0};
+    size_t links {0};
+    // fifos, sockets and devices
+    size_t others {0};
+    // sum of regular file sizes, only counted on request
+    uint64_t bytes {0};
+    // deepest directory level below root, 0 when root has no subdirectories
+    size_t depth {0};
+    std::vector<std::string> errors;
+
+    /*
+     * Reads directories with raw getdents64 into a large per thread buffer, types come from
+     * d_type, so only sizes need a stat call. Every subdirectory is a pool task, wide and deep
+     * trees keep all workers busy. Counts are kept per task and added to the totals at its end.
+     * With a cache, a directory whose mtime and ctime did not change is not read at all, its
+     * files are only stat'ed again when bytes are counted.
+     */
+    static DirStats collect(const std::string& root, bool recursive, bool withBytes, DirStatsCache* cache = nullptr,
+                            WorkStealingPool& pool = WorkStealingPool::instance());
+    /*
+     * Lists a single directory, false if it could not be read completely. Only a root given by
+     * the user is followed if it is a symlink, directories found below it never are.
+     */
+    static bool list(const std::string& path, bool withBytes, DirCounts& counts, std::vector<std::string>& errors,
+                     bool isRoot = false, std::vector<std::string>* fileNames = nullptr);
+};
+
+/*
+ * Counts of entries directly in a directory and names of its subdirectories, keyed by device
+ * and inode. Adding, removing or renaming an entry changes directory mtime, so an entry with
+ * the same mtime and ctime is still valid. A file written in place does not touch its directory,
+ * so sizes are never cached, an entry keeps names of regular files instead and they are stat'ed
+ * again whenever bytes are counted. A directory changed during its scan is not trusted next
+ * time, as the change could fall into the same timestamp tick.
+ *
+ * Cache can be saved to a file of fixed size records followed by subdirectory names, loaded
+ * through mmap by the next interpreter run. Only directories visited since the last save are
+ * written, so removed ones drop out.
+ */
+class DirStatsCache {
+public:
+    struct Key {
+        uint64_t device;
+        uint64_t inode;
+        bool operator==(const Key& other) const { return device == other.device && inode == other.inode; }
+    };
+    struct Entry : DirCounts {
+        // regular files, kept when listed with bytes (hasBytes), bytes themselves are not cached
+        std::vector<std::string> fileNames;
+        int64_t mtimeSeconds {0};
+        uint32_t mtimeNanoseconds {0};
+        int64_t ctimeSeconds {0};
+        uint32_t ctimeNanoseconds {0};
+    };
+
+    DirStatsCache() = default;
+    // missing or damaged file gives an empty cache
+    explicit DirStatsCache(std::string path);
+
+    // valid entry for directory with given times, with file names if bytes are to be counted
+    bool find(const Key& key, const Entry& current, bool withBytes, Entry& entry);
+    void store(const Key& key, Entry entry);
+    // writes entries used since last save, nothing without a file
+    void save();
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return key.inode * 0x9E3779B97F4A7C15ULL ^ key.device; }
+    };
+    struct Slot {
+        Entry entry;
+        bool isUsed {false};
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, Slot, KeyHash> entries;
+    };
+    static const size_t SHARD_COUNT = 32;
+
+    std::string path;
+    Shard shards[SHARD_COUNT];
+
+    Shard& shardOf(const Key& key) { return shards[KeyHash()(key) % SHARD_COUNT]; }
+    void load();
+};
+
+#endif //TKOM_DIRSTATS_H
@@ -0,0 +1,62 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_DIRWATCHER_H
+#define TKOM_DIRWATCHER_H
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "DirStats.h"
+
+/*
+ * Keeps file_number statistics of a tree up to date from inotify events instead of rescanning it.
+ * Every directory has a watch and its own counts, an event only marks its directory, which is
+ * listed again once events settle. New subdirectories get watches, removed or moved away ones
+ * drop together with their subtree. When the kernel queue overflows events are lost, so the
+ * whole tree is scanned again, this is the only full rescan after the first one.
+ */
+class DirWatcher {
+public:
+    DirWatcher(std::string root, bool recursive, bool withBytes);
+    ~DirWatcher();
+    DirWatcher(const DirWatcher&) = delete;
+    DirWatcher& operator=(const DirWatcher&) = delete;
+
+    DirStats stats() const;
+    // blocks until changes settle, with no event for debounce or maxDelay after the first one
+    void waitForChange(std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay);
+    // full scans done, first one included
+    size_t rescans() const { return rescanCount; }
+
+private:
+    struct Directory {
+        std::string path;
+        size_t depth;
+        DirCounts counts;
+    };
+
+    std::string root;
+    bool recursive;
+    bool withBytes;
+    int inotifyFd {-1};
+    uint32_t mask;
+    std::unordered_map<int, Directory> directories;
+    std::unordered_map<std::string, int> watches;
+    std::unordered_set<int> dirty;
+    bool isOverflowed {false};
+    size_t rescanCount {0};
+    std::vector<std::string> errors;
+
+    void rescan();
+    void addTree(const std::string& path, size_t depth);
+    void removeTree(const std::string& path);
+    // true if any event changed statistics
+    bool readEvents();
+    void applyChanges();
+};
+
+#endif //TKOM_DIRWATCHER_H
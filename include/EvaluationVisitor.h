@@ -6,6 +6,27 @@
 #define TKOM_EVALUATIONVISITOR_H
 
 #include "Visitor.h"
+#include "WorkStealingPool.h"
+#include "TaskRegistry.h"
+#include "Builtins.h"
+#include "HandlerSupervisor.h"
+#include "ProcessLauncher.h"
+#include "OutputCollector.h"
+#include "CopyEngine.h"
+#include "IncrementalBackup.h"
+#include "DedupStore.h"
+#include "Archive.h"
+#include "SnapshotBackup.h"
+#include "DirStats.h"
+#include "DirWatcher.h"
+#include "Scheduler.h"
+#include "SystemMetrics.h"
+#include "TimeSeries.h"
+#include "Sketch.h"
+#include "AlertRules.h"
+#include "SmtpClient.h"
+#include "ReportBatcher.h"
+#include "ReportSpool.h"
 #include <iostream>
 #include <memory>
 #include <stack>
@@ -25,45 +46,178 @@
 #include <dirent.h>
 #include <cstring>
 #include <fstream>
+#include <sstream>
 #include <sys/wait.h>
+#include <vector>
+#include <climits>
+#include <limits>
+#include <optional>
+#include <csignal>
+#include <cmath>
 
 struct BaseHandler {
     bool isRegistration {false};
+    // exit status of handler process
+    int exitStatus {0};
     virtual void run() = 0;
     virtual void stop() = 0;
+    // periodic handlers are ticks of interpreter scheduler, no process is started for them
+    virtual std::optional<PeriodicTask> periodicTask() {
+        return std::nullopt;
+    }
+    // registered type and assignments in script order, handler process is configured again from them
+    std::string registeredType;
+    std::vector<std::pair<std::string, std::string>> settings;
+    // starts handler in a child process and returns its pid, by default interpreter binary is spawned
+    // in handler mode, a multithreaded interpreter is never forked
+    virtual pid_t launch() {
+        SpawnOptions options;
+        options.argv = {ProcessLauncher::interpreter(), "--handler", registeredType};
+        for(auto& [op, value] : settings) {
+            options.argv.push_back(op + "=" + value);
+        }
+        std::cout.flush();
+        return ProcessLauncher::spawn(options);
+    }
     ~BaseHandler() = default;
 };
 
+// text of file_number report, recursive one also counts other entries, bytes and depth
+inline std::string fileNumberReport(const std::string& dir, bool recursive, const DirStats& stats) {
+    if(!recursive) {
+        return "In dir " + dir + " there are " + std::to_string(stats.files) + " files.\n";
+    }
+    return "In dir " + dir + " and its subdirectories there are " + std::to_string(stats.files) + " files, "
+           + std::to_string(stats.directories) + " directories, " + std::to_string(stats.links) + " links and "
+           + std::to_string(stats.others) + " other entries, " + std::to_string(stats.bytes) + " bytes, "
+           + std::to_string(stats.depth) + " levels deep.\n";
+}
+
+inline std::string fileNumberReport(const std::string& dir, bool recursive, DirStatsCache* cache = nullptr) {
+    return fileNumberReport(dir, recursive, DirStats::collect(dir, recursive, recursive, cache));
+}
+
+inline void fileNumberSamples(const DirStats& stats, bool recursive, std::vector<SystemMetrics::Sample>& samples) {
+    samples.push_back({"files", (double)stats.files});
+    if(recursive) {
+        samples.push_back({"directories", (double)stats.directories});
+        samples.push_back({"links", (double)stats.links});
+        samples.push_back({"others", (double)stats.others});
+        samples.push_back({"bytes", (double)stats.bytes});
+    }
+}
+
+// addr may list recipients split by commas
+// addresses go into envelope and headers as they are, line breaks or brackets there would add commands,
+// subject holds dir which is only cleaned of line breaks
+inline SmtpMessage reportMessage(const std::string& from, const std::string& addr,
+                                 const std::string& subject, const std::string& text) {
+    if(from.find_first_of("\r\n<>") != std::string::npos) {
+        throw std::runtime_error("Sender " + from + " can not contain line breaks or angle brackets");
+    }
+    SmtpMessage message;
+    message.from = from;
+    for(auto character : subject) {
+        message.subject += character == '\r' || character == '\n' ? ' ' : character;
+    }
+    message.body = text;
+    std::string recipient;
+    std::istringstream recipients(addr);
+    while(std::getline(recipients, recipient, ',')) {
+        recipient.erase(0, recipient.find_first_not_of(' '));
+        recipient.erase(recipient.find_last_not_of(' ') + 1);
+        if(recipient.find_first_of("\r\n<>") != std::string::npos) {
+            throw std::runtime_error("Recipient " + recipient + " can not contain line breaks or angle brackets");
+        }
+        if(!recipient.empty()) {
+            message.recipients.push_back(recipient);
+        }
+    }
+    return message;
+}
+
+// report is sent from memory over a pooled session with relay
+inline void mailReport(const std::string& relay, const std::string& from, const std::string& addr,
+                       const std::string& subject, const std::string& text) {
+    SmtpPool::instance().send(relay, reportMessage(from, addr, subject, text));
+}
+
 struct SendRaportHandler : BaseHandler {
     std::string addr;
     std::string type;
     std::string dir;
-    void run() override {
+    bool recursive {false};
+    // file keeping directory statistics between runs, none by default
+    std::string cacheFile;
+    // host or host:port of SMTP relay, local MTA by default
+    std::string relay {"localhost"};
+    std::string from;
+    // seconds, reports to the same addr are then sent together once the first one waited that long
+    double batchWindow {0};
+    // batch is sent right away when it holds that many different reports
+    size_t batchSize {100};
+    // file keeping reports until relay takes them, they are sent in background and retried
+    std::string spool;
+    // batched report is only queued, its outcome is there until the batch is sent, none otherwise
+    ReportBatcher::Outcome deliver() {
         if(addr.empty() || type.empty() || dir.empty()) {
             throw std::runtime_error("Not enough args to run");
         }
-        if(type == "file_number") {
-            size_t fileNum = 0;
-            DIR * dirp;
-            struct dirent * entry;
-
-            dirp = opendir(dir.c_str());
-            while ((entry = readdir(dirp)) != nullptr) {
-                if (entry->d_type == DT_REG) {
-                    fileNum++;
-                }
+        if(type != "file_number") {
+            return nullptr;
+        }
+        std::string report;
+        if(cacheFile.empty()) {
+            report = fileNumberReport(dir, recursive);
+        } else {
+            DirStatsCache cache(cacheFile);
+            report = fileNumberReport(dir, recursive, &cache);
+            cache.save();
+        }
+        auto message = reportMessage(from, addr, "Raport " + type + " of " + dir, report);
+        if(batchWindow > 0) {
+            return ReportBatcher::instance().submit(relay, spool, std::move(message),
+                                                    std::chrono::milliseconds((long)(batchWindow * 1000)), batchSize);
+        }
+        if(!spool.empty()) {
+            ReportSpool::open(spool)->enqueue(relay, std::move(message));
+        } else {
+            SmtpPool::instance().send(relay, std::move(message));
+        }
+        return nullptr;
+    }
+    void run() override {
+        if(auto outcome = deliver()) {
+            // process ends right after, batch can not wait for its window
+            ReportBatcher::instance().flush();
+            if(*outcome != ReportBatcher::Delivery::SENT) {
+                throw std::runtime_error("Raport to " + addr + " was not delivered");
             }
-            closedir(dirp);
-
-            std::ofstream tmp;
-            tmp.open("/tmp/mail");
-            tmp << "In dir " + dir + " there are " + std::to_string(fileNum).c_str() + " files.\n";
-            tmp.close();
-
-            std::string command = "sendmail " + addr + " < /tmp/mail";
-            system(command.c_str());
         }
     }
+    // report is sent once from interpreter pool, so sessions with relay are reused and nothing is forked,
+    // schedule of a batched report lasts until its batch is sent and fails when it is not delivered
+    std::optional<PeriodicTask> periodicTask() override {
+        if(addr.empty() || type.empty() || dir.empty()) {
+            return std::nullopt;
+        }
+        PeriodicTask task;
+        task.period = std::chrono::milliseconds(100);
+        task.run = [handler = *this, outcome = ReportBatcher::Outcome()]() mutable {
+            if(!outcome) {
+                outcome = handler.deliver();
+                if(!outcome) {
+                    return false;
+                }
+            }
+            auto delivery = outcome->load();
+            if(delivery == ReportBatcher::Delivery::FAILED) {
+                throw std::runtime_error("Raport to " + handler.addr + " was not delivered");
+            }
+            return delivery == ReportBatcher::Delivery::PENDING;
+        };
+        return task;
+    }
 
     void stop() override {
         std::cout << "stopped.\n";
@@ -74,12 +228,112 @@ struct SendRaportHandler : BaseHandler {
 struct BackupHandler : BaseHandler {
     std::string dest;
     std::string dir;
+    /*
+     * "full" copies like cp -R, "incremental" keeps dir as a mirror of dest with a manifest,
+     * "dedup" adds a snapshot of dest to deduplicating store in dir, "restore" restores
+     * snapshot from store or archive in dir to dest, "snapshot" adds a snapshot directory
+     * to dir with unchanged files hard linked to the previous one
+     */
+    std::string mode {"full"};
+    bool useHash {false};
+    // dedup, snapshot and restore, empty means named by time or latest one
+    std::string snapshot;
+    // full backup into a gzip archive with given level, 0 copies files
+    int compressionLevel {0};
+    // restore of a single file from archive
+    std::string file;
+    // megabytes (10^6 bytes) and operations per second for all backup workers, 0 is unlimited
+    double maxMbps {0};
+    double maxIops {0};
+    // io scheduling class of backup process, empty keeps inherited one
+    std::string ioPriority;
     void run() override {
         if(dest.empty() || dir.empty()) {
             throw std::runtime_error("Not enough args to run");
         }
-        std::string command = "cp -R " + dest + " " + dir;
-        system(command.c_str());
+        // before pool workers of this process are started, so they inherit it
+        if(!ioPriority.empty()) {
+            setIoPriority(ioPriority);
+        }
+        Throttle limits(maxMbps * 1000 * 1000, maxIops);
+        auto throttle = limits.isLimited() ? &limits : nullptr;
+        struct stat dirInfo {};
+        bool isArchive = stat(dir.c_str(), &dirInfo) == 0 && S_ISREG(dirInfo.st_mode);
+        if((mode == "full" && compressionLevel > 0) || (mode == "restore" && isArchive)) {
+            ArchiveReport report;
+            if(mode == "full") {
+                // archive is named after dest when dir is a directory, like cp -R does with copies
+                auto archive = dir;
+                if(stat(dir.c_str(), &dirInfo) == 0 && S_ISDIR(dirInfo.st_mode)) {
+                    auto name = dest.substr(0, dest.find_last_not_of('/') + 1);
+                    archive += "/" + name.substr(name.find_last_of('/') + 1) + ".tar.gz";
+                }
+                report = ArchiveWriter(archive, compressionLevel, throttle).write(dest);
+                std::cout << "archive " << archive << ": ";
+            } else {
+                ArchiveReader reader(dir);
+                report = file.empty() ? reader.extractAll(dest) : reader.extractFile(file, dest);
+                std::cout << "restored from " << dir << ": ";
+            }
+            std::cout << report.files << " files, " << report.directories << " directories, " << report.links
+                      << " links, " << report.bytes << " bytes";
+            if(mode == "full") {
+                std::cout << " compressed to " << report.compressedBytes;
+            }
+            std::cout << '\n';
+            for(auto& error : report.errors) {
+                std::cerr << "backup: " << error << '\n';
+            }
+            exitStatus = report.errors.empty() ? 0 : 1;
+            return;
+        }
+        if(mode == "dedup" || mode == "restore") {
+            DedupStore store(dir, throttle);
+            auto report = mode == "dedup" ? store.backup(dest, snapshot) : store.restore(dest, snapshot);
+            std::cout << (mode == "dedup" ? "snapshot " : "restored snapshot ") << report.snapshot << ": "
+                      << report.files << " files, " << report.directories << " directories, " << report.links
+                      << " links, " << report.bytes << " bytes in " << report.chunks << " chunks";
+            if(mode == "dedup") {
+                std::cout << ", " << report.newChunks << " new chunks, " << report.storedBytes << " bytes stored";
+            }
+            std::cout << '\n';
+            for(auto& error : report.errors) {
+                std::cerr << "backup: " << error << '\n';
+            }
+            exitStatus = report.errors.empty() ? 0 : 1;
+            return;
+        }
+        CopyReport report;
+        if(mode == "snapshot") {
+            report = SnapshotBackup(dest, dir, useHash, throttle).run(snapshot);
+        } else if(mode == "incremental") {
+            report = IncrementalBackup(dest, dir, useHash, throttle).run();
+        } else {
+            // same as cp -R dest dir
+            CopyEngine engine;
+            engine.throttle = throttle;
+            report = engine.copy(dest, dir);
+        }
+        std::cout << "backup of " << dest << ": " << report.files << " files, " << report.directories
+                  << " directories, " << report.links << " links, " << report.bytes << " bytes copied";
+        if(mode == "incremental") {
+            std::cout << ", " << report.skipped << " unchanged, " << report.deleted << " deleted";
+        }
+        if(mode == "snapshot") {
+            std::cout << ", " << report.linked << " linked into snapshot " << report.snapshot;
+        }
+        std::cout << '\n';
+        for(auto& error : report.errors) {
+            std::cerr << "backup: " << error << '\n';
+        }
+        exitStatus = report.errors.empty() ? 0 : 1;
+    }
+    void setMode(std::string newMode) {
+        if(newMode != "full" && newMode != "incremental" && newMode != "dedup" && newMode != "restore"
+           && newMode != "snapshot") {
+            throw std::runtime_error("Unknown backup mode " + newMode);
+        }
+        mode = newMode;
     }
     void stop() override {
         std::cout << "stopped.\n";
@@ -91,29 +345,177 @@ struct CheckSystemHandler : BaseHandler {
     std::string output;
     std::string type;
     std::string freq;
+    // root of file_number report
+    std::string dir {"/usr"};
+    bool recursive {false};
+    // statistics are cached between polls anyway, with a file also between runs
+    std::string cacheFile;
+    // counts follow inotify events, output is written only when report changes
+    bool isWatched {false};
+    // quiet time after last event, freq bounds delay of a report during constant changes
+    int debounceMilliseconds {200};
+    // seconds, every poll is delayed by a random part of it
+    double jitter {0};
+    // seconds between polls, fractions allowed, also the longest report delay in watch mode
+    static std::chrono::milliseconds frequencyPeriod(const std::string& value) {
+        size_t parsed = 0;
+        double seconds = 0;
+        try {
+            seconds = std::stod(value, &parsed);
+        } catch(std::exception&) {
+            parsed = 0;
+        }
+        if(parsed == 0 || parsed != value.size() || !std::isfinite(seconds) || seconds * 1000 < 1) {
+            throw std::runtime_error("Wrong frequency " + value + ", it has to be a positive number of seconds");
+        }
+        return std::chrono::milliseconds((long)(seconds * 1000));
+    }
+    void setFreq(const std::string& value) {
+        frequencyPeriod(value);
+        freq = value;
+    }
+    PeriodicTask::Missed missed {PeriodicTask::Missed::SKIP};
+    void setMissed(std::string policy) {
+        if(policy == "skip") {
+            missed = PeriodicTask::Missed::SKIP;
+        } else if(policy == "catchup") {
+            missed = PeriodicTask::Missed::CATCHUP;
+        } else {
+            throw std::runtime_error("Unknown missed tick policy " + policy);
+        }
+    }
+    // process sampled by "process" report, 0 is interpreter itself
+    pid_t pid {0};
+    // file keeping values of every poll, output file is optional when it is set
+    std::string history;
+    size_t historySize {TimeSeries::DEFAULT_SIZE};
+    // every value of report is added to a sketch of its series, report ends with these quantiles
+    std::vector<double> quantiles;
+    void setQuantiles(const std::string& list) {
+        quantiles.clear();
+        std::istringstream values(list);
+        double quantile;
+        while(values >> quantile) {
+            if(quantile < 0 || quantile > 1) {
+                throw std::runtime_error("Quantile has to be between 0 and 1");
+            }
+            quantiles.push_back(quantile);
+        }
+        if(!values.eof()) {
+            throw std::runtime_error("Wrong list of quantiles " + list);
+        }
+    }
+    // every assignment adds a rule, transitions are mailed to alertAddr through relay or printed without it
+    AlertRules alerts;
+    std::string alertAddr;
+    std::string relay {"localhost"};
+    std::string from;
+    static bool isMetricReport(const std::string& type) {
+        return type == "loadavg" || type == "memory" || type == "disk" || type == "process" || type == "fds";
+    }
+    // polling reports run in interpreter, configuration is copied as in a started process
+    std::optional<PeriodicTask> periodicTask() override {
+        // quantiles are written next to the report, without it they would be fed for nothing
+        if(!quantiles.empty() && output.empty()) {
+            throw std::runtime_error("Quantiles of " + type + " raport need a path to write them to");
+        }
+        if((output.empty() && history.empty() && alerts.empty()) || freq.empty() || isWatched
+           || (type != "file_number" && !isMetricReport(type))) {
+            return std::nullopt;
+        }
+        PeriodicTask task;
+        task.period = frequencyPeriod(freq);
+        task.jitter = std::chrono::milliseconds((long)(jitter * 1000));
+        task.missed = missed;
+        std::shared_ptr<TimeSeries> series;
+        if(!history.empty()) {
+            series = TimeSeries::open(history, historySize);
+        }
+        // sketches live as long as the schedule, keyed by series
+        auto sketches = std::make_shared<std::map<std::string, QuantileSketch>>();
+        // ticks of one schedule never overlap, rule states need no lock
+        auto rules = std::make_shared<AlertRules>(alerts);
+        auto write = [output = output, series, quantiles = quantiles, sketches, rules, alertAddr = alertAddr,
+                      relay = relay, from = from, type = type](
+                const std::string& report, const std::vector<SystemMetrics::Sample>& samples) {
+            if(!quantiles.empty()) {
+                for(auto& sample : samples) {
+                    (*sketches)[sample.series].add(sample.value);
+                }
+            }
+            if(!output.empty()) {
+                std::ofstream tmp;
+                tmp.open(output);
+                tmp << report;
+                if(!quantiles.empty()) {
+                    for(auto& sample : samples) {
+                        auto& sketch = (*sketches)[sample.series];
+                        tmp << "Quantiles of " << sample.series << " over " << sketch.count() << " samples:";
+                        for(auto quantile : quantiles) {
+                            tmp << " p" << quantile * 100 << " " << sketch.quantile(quantile) << ",";
+                        }
+                        tmp << " sketch " << sketch.serialize() << ".\n";
+                    }
+                }
+                tmp.close();
+            }
+            auto now = TimeSeries::now();
+            if(series) {
+                for(auto& sample : samples) {
+                    series->append(sample.series, now, sample.value);
+                }
+            }
+            if(!rules->empty()) {
+                std::string transitions;
+                for(auto& message : rules->evaluate(samples, now)) {
+                    transitions += message;
+                }
+                if(!transitions.empty() && alertAddr.empty()) {
+                    std::cout << transitions;
+                    std::cout.flush();
+                } else if(!transitions.empty()) {
+                    mailReport(relay, from, alertAddr, "Alerts of " + type + " raport", transitions);
+                }
+            }
+        };
+        if(isMetricReport(type)) {
+            // sources are opened once, every tick only reads them again
+            task.run = [write, type = type, metrics = std::make_shared<SystemMetrics>(pid)] {
+                std::vector<SystemMetrics::Sample> samples;
+                auto report = metrics->report(type, &samples);
+                write(report, samples);
+                return true;
+            };
+            return task;
+        }
+        task.run = [write, dir = dir, recursive = recursive,
+                    cache = std::make_shared<DirStatsCache>(cacheFile)] {
+            auto stats = DirStats::collect(dir, recursive, recursive, cache.get());
+            std::vector<SystemMetrics::Sample> samples;
+            fileNumberSamples(stats, recursive, samples);
+            write(fileNumberReport(dir, recursive, stats), samples);
+            cache->save();
+            return true;
+        };
+        return task;
+    }
     void run() override {
         if(output.empty() || type.empty() || freq.empty()) {
             throw std::runtime_error("Not enough args to run");
         }
-        if(type == "file_number") {
+        if(type == "file_number" && isWatched) {
+            DirWatcher watcher(dir, recursive, recursive);
+            std::string written;
             while(true) {
-                size_t fileNum = 0;
-                DIR * dirp;
-                struct dirent * entry;
-
-                dirp = opendir("/usr");
-                while ((entry = readdir(dirp)) != nullptr) {
-                    if (entry->d_type == DT_REG) {
-                        fileNum++;
-                    }
+                auto report = fileNumberReport(dir, recursive, watcher.stats());
+                if(report != written) {
+                    std::ofstream tmp;
+                    tmp.open(output);
+                    tmp << report;
+                    tmp.close();
+                    written = report;
                 }
-                closedir(dirp);
-
-                std::ofstream tmp;
-                tmp.open(output);
-                tmp << "In usr there are " << fileNum << " files.\n";
-                tmp.close();
-                usleep(std::stoi(freq) * 1000000);
+                watcher.waitForChange(std::chrono::milliseconds(debounceMilliseconds), frequencyPeriod(freq));
             }
         }
     }
@@ -123,13 +525,88 @@ struct CheckSystemHandler : BaseHandler {
 
 };
 
+/*
+ * Command is spawned directly with posix_spawn, interpreter is never forked. Command line is split
+ * and environment is built once, when handler is configured, not on every start. Shell is used only
+ * if command needs it, shell = "1" or "0" forces the choice.
+ */
 struct RunHandler : BaseHandler {
     std::string path;
-    void run() override {
+    // "auto", "1" or "0"
+    std::string shell {"auto"};
+    SpawnOptions options;
+    // stdout and stderr go to output instead of terminal, output_file or max_output enable it as well
+    bool isCaptured {false};
+    size_t maxOutput {1 << 20};
+    std::string outputFile;
+    std::shared_ptr<CapturedOutput> output;
+    void setPath(std::string command) {
+        path = command;
+        prepareArgs();
+    }
+    void setShell(std::string mode) {
+        if(mode != "auto" && mode != "1" && mode != "0") {
+            throw std::runtime_error("Wrong shell mode " + mode);
+        }
+        shell = mode;
+        prepareArgs();
+    }
+    void setEnvironment(std::string assignments) {
+        options.environment = ProcessLauncher::buildEnvironment(assignments);
+    }
+    void setWorkingDir(std::string dir) {
+        options.workingDir = dir;
+    }
+    pid_t launch() override {
         if(path.empty()) {
             throw std::runtime_error("Not enough args to run");
         }
-        system(path.c_str());
+        std::cout.flush();
+        if(!isCaptured) {
+            return ProcessLauncher::spawn(options);
+        }
+        output = std::make_shared<CapturedOutput>(maxOutput, outputFile);
+        options.stdoutFd = options.stderrFd = output->writeEnd();
+        pid_t pid;
+        try {
+            pid = ProcessLauncher::spawn(options);
+        } catch(std::exception&) {
+            options.stdoutFd = options.stderrFd = -1;
+            throw;
+        }
+        options.stdoutFd = options.stderrFd = -1;
+        output->closeWriteEnd();
+        OutputCollector::instance().collect(output);
+        return pid;
+    }
+    void setCapture(std::string mode) {
+        isCaptured = mode == "1";
+    }
+    void setMaxOutput(std::string bytes) {
+        maxOutput = std::stoul(bytes);
+        isCaptured = true;
+    }
+    void setOutputFile(std::string path) {
+        outputFile = path;
+        isCaptured = true;
+    }
+    std::string capturedText() {
+        if(!output) {
+            throw std::runtime_error("Output of handler was not captured");
+        }
+        return output->text();
+    }
+    size_t capturedLines() {
+        if(!output) {
+            throw std::runtime_error("Output of handler was not captured");
+        }
+        return output->lines();
+    }
+    void run() override {
+        int status;
+        pid_t pid = launch();
+        while(waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+        exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
     }
     void stop() override {
         std::cout << "stopped.\n";
@@ -137,11 +614,29 @@ struct RunHandler : BaseHandler {
     void update(std::shared_ptr<RunHandler> toUpdate) {
         if(!toUpdate->path.empty()) {
             path = toUpdate->path;
+            shell = toUpdate->shell;
+            options = toUpdate->options;
+            isCaptured = toUpdate->isCaptured;
+            maxOutput = toUpdate->maxOutput;
+            outputFile = toUpdate->outputFile;
+        }
+    }
+private:
+    void prepareArgs() {
+        if(path.empty()) {
+            return;
+        }
+        if(shell == "1" || (shell == "auto" && ProcessLauncher::needsShell(path))) {
+            options.argv = {"/bin/sh", "-c", path};
+        } else {
+            options.argv = ProcessLauncher::splitCommandLine(path);
         }
     }
 };
 
 struct EvaluationVisitor : Visitor {
+    using Value = std::variant<int, double, std::string>;
+
     struct FunctionDeclaration {
         std::string specifier;
         struct FunctionArg {
@@ -155,24 +650,96 @@ struct EvaluationVisitor : Visitor {
         std::shared_ptr<BodyExpression> body;
     };
 
+    /*
+     * Handler runs in a child process, start returns as soon as it is launched.
+     * Exit of the child is noticed by HandlerSupervisor event loop, wait (blocking,
+     * bounded by timeout) and poll only read the collected status. Not thread safe,
+     * parallel_for iterations and every ticks only use handlers declared inside them.
+     */
     struct SystemHandlerInfo {
         std::shared_ptr<BaseHandler> handler;
-        pid_t handlerPid;
+        pid_t handlerPid {-1};
+        // set instead of pid for handlers run by scheduler
+        Scheduler::Id scheduleId {0};
+        bool isFinished {false};
+        int exitStatus {0};
+        // seconds, negative waits until handler finishes
+        double waitTimeout {-1};
         SystemHandlerInfo() = default;
         SystemHandlerInfo(std::shared_ptr<BaseHandler> handler)
                 : handler(handler) {}
+        SystemHandlerInfo(const SystemHandlerInfo&) = delete;
+        SystemHandlerInfo& operator=(const SystemHandlerInfo&) = delete;
+        // process or schedule nobody can wait for any more still runs, but is not remembered
+        ~SystemHandlerInfo() {
+            if(handlerPid > 0 && !isFinished) {
+                HandlerSupervisor::instance().release(handlerPid);
+            }
+            if(scheduleId != 0 && !isFinished) {
+                Scheduler::instance().release(scheduleId);
+            }
+        }
+        bool isRunning() {
+            return (handlerPid > 0 || scheduleId != 0) && !isFinished;
+        }
         void run() {
-            pid_t currentHandlerPid = fork();
-            if(currentHandlerPid == 0) {
-                handler->run();
-            } else {
-                handlerPid = currentHandlerPid;
-                wait(NULL);
+            if(!handler) {
+                throw std::runtime_error("Handler not registered");
             }
+            if(isRunning() && !poll()) {
+                throw std::runtime_error("Handler already running");
+            }
+            isFinished = false;
+            exitStatus = 0;
+            if(auto task = handler->periodicTask()) {
+                handlerPid = -1;
+                scheduleId = Scheduler::instance().add(std::move(*task));
+                return;
+            }
+            scheduleId = 0;
+            handlerPid = handler->launch();
+            HandlerSupervisor::instance().watch(handlerPid);
+        }
+        // true if handler is not running anymore
+        bool poll() {
+            if(!isRunning()) {
+                return true;
+            }
+            auto status = scheduleId != 0 ? Scheduler::instance().poll(scheduleId)
+                                          : HandlerSupervisor::instance().poll(handlerPid);
+            if(status) {
+                isFinished = true;
+                exitStatus = *status;
+            }
+            return isFinished;
+        }
+        // exit status, or -1 if handler did not finish in waitTimeout
+        int wait() {
+            if(handlerPid <= 0 && scheduleId == 0) {
+                throw std::runtime_error("Handler was not started");
+            }
+            if(isFinished) {
+                return exitStatus;
+            }
+            auto status = scheduleId != 0 ? Scheduler::instance().waitFor(scheduleId, waitTimeout)
+                                          : HandlerSupervisor::instance().waitFor(handlerPid, waitTimeout);
+            if(!status) {
+                return -1;
+            }
+            isFinished = true;
+            exitStatus = *status;
+            return exitStatus;
         }
         void stop() {
-            auto msg = "kill -9 " + std::to_string(handlerPid);
-            system(msg.c_str());
+            if(!isRunning()) {
+                return;
+            }
+            if(scheduleId != 0) {
+                // same status as a killed handler process
+                Scheduler::instance().cancel(scheduleId, 128 + SIGKILL);
+                return;
+            }
+            HandlerSupervisor::instance().signal(handlerPid, SIGKILL);
         }
     };
 
@@ -204,6 +771,11 @@ struct EvaluationVisitor : Visitor {
     auto getSystemHandlerReferenceByName(std::string name) {
         for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
             if(currentCtx->isSystemHandlerAssigned(name)) {
+                // SystemHandlerInfo has no lock, workers would race the main thread over it
+                if((size_t)std::distance(currentCtx, ctx.rend()) <= sharedContextDepth) {
+                    throw std::runtime_error(name + " is shared by parallel_for iterations or every ticks, "
+                                             "it can only be used outside of them");
+                }
                 return currentCtx->systemHandlerDeclarations[name];
             }
         }
@@ -224,6 +796,86 @@ struct EvaluationVisitor : Visitor {
         return currentContext.getOperandAndPopFromContext();
     }
 
+    // names are kept unquoted on operand queue, literals keep their quotes
+    Value resolveOperand(Value operand) {
+        if (const auto name (std::get_if<std::string>(&operand)); name && !name->empty() && name->front() != '"') {
+            return getAssignedValueFromNearestContext(*name);
+        }
+        return operand;
+    }
+
+    // evaluates expression on its own operand queue, so leftovers of previous statements are not mixed in
+    Value evaluateExpression(std::shared_ptr<Expression> expression) {
+        ctx.push_back({});
+        expression->accept(this);
+        if(ctx.back().operands.empty()) {
+            ctx.pop_back();
+            throw std::runtime_error("Expression has no value");
+        }
+        auto value = moveLocalOperandFromNearestContext();
+        ctx.pop_back();
+        return resolveOperand(value);
+    }
+
+    std::string getDeclaredType(std::string varName) {
+        for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
+            if(currentCtx->declarationMap.find(varName) != currentCtx->declarationMap.end()) {
+                return currentCtx->declarationMap[varName];
+            }
+        }
+        throw std::runtime_error("Variable " + varName + " not declared");
+    }
+
+    // stores value where variable was assigned or declared
+    void storeVariable(std::string varName, Value value) {
+        for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
+            if(currentCtx->isVariableAssigned(varName)) {
+                currentCtx->variableAssignmentMap[varName] = value;
+                return;
+            }
+        }
+        for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
+            if(currentCtx->declarationMap.find(varName) != currentCtx->declarationMap.end()) {
+                currentCtx->variableAssignmentMap[varName] = value;
+                return;
+            }
+        }
+        throw std::runtime_error("Variable " + varName + " not declared");
+    }
+
+    // contexts below this depth belong to the thread which started parallel_for or every
+    // and can be read, but not assigned, by its iterations and ticks
+    size_t sharedContextDepth {0};
+
+    struct LoopRange {
+        std::string variable;
+        int begin;
+        int end;
+    };
+
+    struct Reduction {
+        std::string operation;
+        std::string variable;
+        std::string specifier;
+        Value identity;
+    };
+
+    std::vector<std::shared_ptr<Expression>> flattenArgs(std::shared_ptr<Expression> args);
+    LoopRange evaluateLoopRange(const std::vector<std::shared_ptr<Expression>>& args);
+    std::vector<Reduction> getReductions(const std::vector<std::shared_ptr<Expression>>& args);
+    static Value reduce(const std::string& operation, Value left, Value right);
+
+    // one frame per active call, ret stores function result in the innermost one
+    std::vector<std::optional<Value>> returnValues;
+    // after ret, blocks and loops of the call skip their remaining statements
+    bool isReturning() const { return !returnValues.empty() && returnValues.back().has_value(); }
+
+    bool isFunctionDeclared(std::string funcName);
+    FunctionDeclaration getFunctionDeclaration(std::string funcName);
+    std::vector<Value> evaluateCallArgs(FunctionCallExpression* functionCallExpression);
+    std::optional<Value> callFunction(std::string funcName, const FunctionDeclaration& functionDeclaration,
+                                      const std::vector<Value>& args);
+
     void updateHandler(std::string sign, std::string op, std::shared_ptr<SystemHandlerInfo> handlerRef) {
         auto isSend = std::dynamic_pointer_cast<SendRaportHandler>(handlerRef->handler);
         auto isBackup = std::dynamic_pointer_cast<BackupHandler>(handlerRef->handler);
@@ -256,10 +908,132 @@ struct EvaluationVisitor : Visitor {
                 isBackup->dir = sign;
                 return;
             }
+            if(isCheckSys) {
+                isCheckSys->dir = sign;
+                return;
+            }
+        }
+        if(op == "recursive") {
+            if(isSend) {
+                isSend->recursive = sign == "1";
+                return;
+            }
+            if(isCheckSys) {
+                isCheckSys->recursive = sign == "1";
+                return;
+            }
+        }
+        if(op == "pid") {
+            if(isCheckSys) {
+                isCheckSys->pid = std::stoi(sign);
+                return;
+            }
+        }
+        if(op == "history") {
+            if(isCheckSys) {
+                isCheckSys->history = sign;
+                return;
+            }
+        }
+        if(op == "history_size") {
+            if(isCheckSys) {
+                isCheckSys->historySize = std::stoul(sign);
+                return;
+            }
+        }
+        if(op == "relay") {
+            if(isSend) {
+                isSend->relay = sign;
+                return;
+            }
+            if(isCheckSys) {
+                isCheckSys->relay = sign;
+                return;
+            }
+        }
+        if(op == "spool") {
+            if(isSend) {
+                isSend->spool = sign;
+                return;
+            }
+        }
+        if(op == "batch") {
+            if(isSend) {
+                isSend->batchWindow = std::stod(sign);
+                return;
+            }
+        }
+        if(op == "batch_size") {
+            if(isSend) {
+                isSend->batchSize = std::max(1, std::stoi(sign));
+                return;
+            }
+        }
+        if(op == "from") {
+            if(isSend) {
+                isSend->from = sign;
+                return;
+            }
+            if(isCheckSys) {
+                isCheckSys->from = sign;
+                return;
+            }
+        }
+        if(op == "alert") {
+            if(isCheckSys) {
+                isCheckSys->alerts.add(sign);
+                return;
+            }
+        }
+        if(op == "alert_mail") {
+            if(isCheckSys) {
+                isCheckSys->alertAddr = sign;
+                return;
+            }
+        }
+        if(op == "quantiles") {
+            if(isCheckSys) {
+                isCheckSys->setQuantiles(sign);
+                return;
+            }
+        }
+        if(op == "jitter") {
+            if(isCheckSys) {
+                isCheckSys->jitter = std::stod(sign);
+                return;
+            }
+        }
+        if(op == "missed") {
+            if(isCheckSys) {
+                isCheckSys->setMissed(sign);
+                return;
+            }
+        }
+        if(op == "watch") {
+            if(isCheckSys) {
+                isCheckSys->isWatched = sign == "1";
+                return;
+            }
+        }
+        if(op == "debounce") {
+            if(isCheckSys) {
+                isCheckSys->debounceMilliseconds = std::stoi(sign);
+                return;
+            }
+        }
+        if(op == "cache") {
+            if(isSend) {
+                isSend->cacheFile = sign;
+                return;
+            }
+            if(isCheckSys) {
+                isCheckSys->cacheFile = sign;
+                return;
+            }
         }
         if(op == "path") {
             if(isRun) {
-                isRun->path = sign;
+                isRun->setPath(sign);
                 return;
             }
             if(isCheckSys) {
@@ -267,9 +1041,97 @@ struct EvaluationVisitor : Visitor {
                 return;
             }
         }
+        if(op == "shell") {
+            if(isRun) {
+                isRun->setShell(sign);
+                return;
+            }
+        }
+        if(op == "env") {
+            if(isRun) {
+                isRun->setEnvironment(sign);
+                return;
+            }
+        }
+        if(op == "cwd") {
+            if(isRun) {
+                isRun->setWorkingDir(sign);
+                return;
+            }
+        }
+        if(op == "capture") {
+            if(isRun) {
+                isRun->setCapture(sign);
+                return;
+            }
+        }
+        if(op == "max_output") {
+            if(isRun) {
+                isRun->setMaxOutput(sign);
+                return;
+            }
+        }
+        if(op == "output_file") {
+            if(isRun) {
+                isRun->setOutputFile(sign);
+                return;
+            }
+        }
+        if(op == "mode") {
+            if(isBackup) {
+                isBackup->setMode(sign);
+                return;
+            }
+        }
+        if(op == "snapshot") {
+            if(isBackup) {
+                isBackup->snapshot = sign;
+                return;
+            }
+        }
+        if(op == "compress") {
+            if(isBackup) {
+                auto level = std::stoi(sign);
+                if(level < 0 || level > 9) {
+                    throw std::runtime_error("Compression level has to be between 0 and 9");
+                }
+                isBackup->compressionLevel = level;
+                return;
+            }
+        }
+        if(op == "file") {
+            if(isBackup) {
+                isBackup->file = sign;
+                return;
+            }
+        }
+        if(op == "max_mbps") {
+            if(isBackup) {
+                isBackup->maxMbps = std::stod(sign);
+                return;
+            }
+        }
+        if(op == "max_iops") {
+            if(isBackup) {
+                isBackup->maxIops = std::stod(sign);
+                return;
+            }
+        }
+        if(op == "ioprio") {
+            if(isBackup) {
+                isBackup->ioPriority = sign;
+                return;
+            }
+        }
+        if(op == "hash") {
+            if(isBackup) {
+                isBackup->useHash = sign == "1";
+                return;
+            }
+        }
         if(op == "freq") {
             if(isCheckSys) {
-                isCheckSys->freq = sign;
+                isCheckSys->setFreq(sign);
                 return;
             }
         }
@@ -281,6 +1143,8 @@ struct EvaluationVisitor : Visitor {
         }
     }
     void registerHandler(std::string type, std::shared_ptr<SystemHandlerInfo> handlerRef) {
+        // removes outer quotes
+        type = type.substr(1, type.size() - 2);
         if(type == "check_system") {
             handlerRef->handler = std::make_unique<CheckSystemHandler>();
         } else if(type == "send_raport") {
@@ -289,7 +1153,10 @@ struct EvaluationVisitor : Visitor {
             handlerRef->handler = std::make_unique<BackupHandler>();
         } else if(type == "run") {
             handlerRef->handler = std::make_unique<RunHandler>();
+        } else {
+            throw std::runtime_error("Unknown handler type " + type);
         }
+        handlerRef->handler->registeredType = type;
     }
     void updateSystemHandler() {
         auto wasHandlerDeclared = [](std::string varName, const std::deque<Context> ctx) -> bool {
@@ -323,7 +1190,14 @@ struct EvaluationVisitor : Visitor {
                 registerHandler(*toSignStr, handlerRef);
                 return;
             }
+            if(*operationName == "timeout") {
+                handlerRef->waitTimeout = std::stod(toSignStr->substr(1, toSignStr->size() - 2));
+                return;
+            }
             updateHandler(*toSignStr, *operationName, handlerRef);
+            if(handlerRef->handler) {
+                handlerRef->handler->settings.emplace_back(*operationName, toSignStr->substr(1, toSignStr->size() - 2));
+            }
         }
         return;
     }
@@ -492,6 +1366,9 @@ struct EvaluationVisitor : Visitor {
     void visit(IfExpression* ifExpression) override;
     void visit(ElseExpression* elseExpression) override;
     void visit(WhileExpression* whileExpression) override;
+    void visit(EveryExpression* everyExpression) override;
+    void visit(ForExpression* forExpression) override;
+    void visit(ParallelForExpression* parallelForExpression) override;
     void visit(DoExpression* doExpression) override;
     void visit(FileExpression* fileExpression) override;
     void visit(FieldReferenceExpression* fieldReferenceExpression) override;
@@ -500,6 +1377,8 @@ struct EvaluationVisitor : Visitor {
     void visit(RetExpression* retExpression) override;
     void visit(SystemHandlerExpression* systemHandlerExpression) override;
     void visit(SystemHandlerDeclExpression* systemHandlerDeclExpression) override;
+    void visit(SpawnExpression* spawnExpression) override;
+    void visit(AwaitExpression* awaitExpression) override;
 };
 struct SystemHandlerExpression : Expression {
     std::string name;
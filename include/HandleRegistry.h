@@ -0,0 +1,68 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_HANDLEREGISTRY_H
+#define TKOM_HANDLEREGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+// runtime objects are visible in scripts as plain int handles, so they can be stored
+// in int variables and passed between tasks
+template<typename T>
+class HandleRegistry {
+public:
+    static HandleRegistry& instance() {
+        static HandleRegistry registry;
+        return registry;
+    }
+
+    int add(std::shared_ptr<T> object) {
+        std::lock_guard<std::mutex> lock(mutex);
+        objects[nextHandle] = std::move(object);
+        return nextHandle++;
+    }
+
+    std::shared_ptr<T> get(int handle) {
+        auto object = find(handle);
+        if(!object) {
+            throw std::runtime_error("Unknown handle " + std::to_string(handle));
+        }
+        return object;
+    }
+
+    // nullptr for a removed handle, handles are never reused so one that was never given out still throws
+    std::shared_ptr<T> find(int handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto object = objects.find(handle);
+        if(object != objects.end()) {
+            return object->second;
+        }
+        if(handle <= 0 || handle >= nextHandle) {
+            throw std::runtime_error("Unknown handle " + std::to_string(handle));
+        }
+        return nullptr;
+    }
+
+    // object lives on while someone still holds it, only the handle is released
+    void remove(int handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        objects.erase(handle);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects.size();
+    }
+
+private:
+    std::mutex mutex;
+    int nextHandle {1};
+    std::map<int, std::shared_ptr<T>> objects;
+};
+
+#endif //TKOM_HANDLEREGISTRY_H
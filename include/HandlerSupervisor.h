@@ -0,0 +1,64 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_HANDLERSUPERVISOR_H
+#define TKOM_HANDLERSUPERVISOR_H
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <sys/types.h>
+
+/*
+ * Single event loop thread supervising all handler processes. Every child is tracked by a pidfd
+ * registered in epoll, so its exit is noticed and reaped immediately, no zombies are left behind
+ * and no shell is needed to signal it. SIGCHLD arrives through signalfd and reaps children for
+ * which pidfd_open is not available. SIGCHLD has to be blocked with blockChildSignal() before
+ * any thread is started, so it is never delivered outside of the signalfd. Status of a finished
+ * child is reported once, by poll or waitFor, then the child is forgotten.
+ */
+class HandlerSupervisor {
+public:
+    static HandlerSupervisor& instance();
+    static void blockChildSignal();
+
+    void watch(pid_t pid);
+    // exit status in shell convention if child finished
+    std::optional<int> poll(pid_t pid);
+    // negative timeout waits until child finishes, empty result on timeout
+    std::optional<int> waitFor(pid_t pid, double timeoutSeconds);
+    // nobody will ask for the status, child is forgotten as soon as it is reaped
+    void release(pid_t pid);
+    void signal(pid_t pid, int signalNumber);
+    size_t runningCount();
+
+private:
+    HandlerSupervisor();
+    ~HandlerSupervisor();
+
+    struct Child {
+        int pidfd {-1};
+        bool finished {false};
+        int status {0};
+        bool isReleased {false};
+    };
+
+    int epollFd {-1};
+    int signalFd {-1};
+    int stopFd {-1};
+    std::mutex mutex;
+    std::condition_variable childFinished;
+    std::unordered_map<pid_t, Child> children;
+    std::thread loop;
+
+    void run();
+    void reap(pid_t pid, Child& child);
+    void reapChildrenWithoutPidfd();
+    // mutex held, status of a finished child is handed out and child erased
+    int report(std::unordered_map<pid_t, Child>::iterator child);
+};
+
+#endif //TKOM_HANDLERSUPERVISOR_H
@@ -0,0 +1,36 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_HASH_H
+#define TKOM_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Throttle;
+
+/*
+ * Streaming XXH64, non cryptographic content hash for change detection. Data can be fed
+ * in pieces of any size, result is the same as for one update with all of it.
+ */
+class Hasher {
+public:
+    explicit Hasher(uint64_t seed = 0);
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+    // throws if file cannot be read, every read is paid for in throttle chunks before it is issued
+    static uint64_t hashFile(const std::string& path, Throttle* throttle = nullptr);
+
+private:
+    uint64_t accumulators[4];
+    uint64_t seed;
+    uint64_t totalSize {0};
+    unsigned char pending[32];
+    size_t pendingSize {0};
+};
+
+#endif //TKOM_HASH_H
@@ -0,0 +1,36 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_INCREMENTALBACKUP_H
+#define TKOM_INCREMENTALBACKUP_H
+
+#include <string>
+#include <sys/stat.h>
+#include "CopyEngine.h"
+#include "Manifest.h"
+
+/*
+ * Mirrors source directory into target, copying only files which are new or whose size, mtime
+ * or inode changed since the run recorded in target manifest. With hashing on, a file with
+ * changed metadata but the same size is hashed first and not copied if content is the same.
+ * Files gone from source stay in target and are marked deleted in the manifest.
+ */
+class IncrementalBackup {
+public:
+    static constexpr const char* MANIFEST_NAME = ".tkom_manifest";
+
+    IncrementalBackup(std::string source, std::string target, bool useHash, Throttle* throttle = nullptr);
+    CopyReport run();
+
+private:
+    std::string source;
+    std::string target;
+    bool useHash;
+    Throttle* throttle;
+
+    static bool isUnchanged(const ManifestEntry& entry, const struct stat& info);
+    static ManifestEntry toEntry(const std::string& path, const struct stat& info, uint64_t hash);
+};
+
+#endif //TKOM_INCREMENTALBACKUP_H
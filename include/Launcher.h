@@ -12,6 +12,10 @@
 #include "Scanner.h"
 #include "Parser.h"
 #include "Configuration.h"
+#include "HandlerSupervisor.h"
+#include "Scheduler.h"
+#include "ReportBatcher.h"
+#include "ReportSpool.h"
 
 class Launcher {
 
@@ -31,12 +35,19 @@ private:
     bool isFilePathProper(std::string filepath);
     bool isPathToUpperDirProper(std::string filepath);
 
+    // SIGTERM and SIGINT wait for a thread which flushes reports before interpreter dies,
+    // they are blocked before any other thread exists, so none of them takes the signal
+    static void flushOnTermination();
+
 public:
 
     Launcher() = default;
 
     void readFlags(int argc, char* argv[]);
     void run();
+    // interpreter started as a handler process: --handler type op=value..., returns exit status
+    static bool isHandlerMode(int argc, char* argv[]);
+    static int runHandler(int argc, char* argv[]);
 };
 
 
@@ -0,0 +1,73 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_MANIFEST_H
+#define TKOM_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ManifestEntry {
+    std::string path;
+    uint64_t size {0};
+    int64_t mtimeSeconds {0};
+    uint32_t mtimeNanoseconds {0};
+    uint64_t inode {0};
+    // 0 when hashing is off
+    uint64_t hash {0};
+    // file was removed from source, its last copy stays in backup
+    bool isDeleted {false};
+};
+
+/*
+ * State of the previous backup run. File holds a header, fixed size records sorted by path
+ * and a table of path strings. It is mapped read only, lookups are binary searches over
+ * records, nothing is parsed up front. A new manifest is written aside and renamed over
+ * the old one, so an interrupted run leaves the previous manifest intact.
+ */
+class Manifest {
+public:
+    // missing or damaged file gives an empty manifest, so everything is copied
+    explicit Manifest(const std::string& path);
+    ~Manifest();
+    Manifest(const Manifest&) = delete;
+    Manifest& operator=(const Manifest&) = delete;
+
+    size_t size() const { return count; }
+    ManifestEntry entry(size_t index) const;
+    // index of entry with given path, or size() if there is none
+    size_t find(std::string_view path) const;
+
+    static void write(const std::string& path, std::vector<ManifestEntry> entries);
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+    };
+    struct Record {
+        uint64_t pathOffset;
+        uint32_t pathLength;
+        uint32_t flags;
+        uint64_t size;
+        int64_t mtimeSeconds;
+        uint32_t mtimeNanoseconds;
+        uint32_t reserved;
+        uint64_t inode;
+        uint64_t hash;
+    };
+
+    void* mapping {nullptr};
+    size_t mappingSize {0};
+    size_t count {0};
+    const Record* records {nullptr};
+    const char* strings {nullptr};
+
+    std::string_view pathOf(const Record& record) const;
+};
+
+#endif //TKOM_MANIFEST_H
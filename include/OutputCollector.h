@@ -0,0 +1,70 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_OUTPUTCOLLECTOR_H
+#define TKOM_OUTPUTCOLLECTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/*
+ * Captured stdout and stderr of one handler. Child writes into a pipe, read end is non-blocking
+ * and drained by OutputCollector into a buffer keeping only the last maxBytes, so a chatty command
+ * never blocks on a full pipe. With a file given, pipe content is spliced into it without copying
+ * through user space, buffer is then read back from the file on demand.
+ */
+class CapturedOutput {
+public:
+    CapturedOutput(size_t maxBytes, const std::string& filePath);
+    ~CapturedOutput();
+
+    // duplicated onto child's stdout and stderr, closed by parent once child is started
+    int writeEnd() const { return writeFd; }
+    void closeWriteEnd();
+    // last maxBytes of output
+    std::string text();
+    size_t lines();
+
+private:
+    friend class OutputCollector;
+    std::mutex mutex;
+    int readFd {-1};
+    int writeFd {-1};
+    int fileFd {-1};
+    size_t maxBytes;
+    std::string buffer;
+    size_t lineCount {0};
+    bool isClosed {false};
+
+    // reads at most limit bytes, false once all writers closed the pipe
+    bool drain(size_t limit);
+    void append(const char* data, size_t size);
+};
+
+// single epoll loop draining pipes of all captured handlers
+class OutputCollector {
+public:
+    static OutputCollector& instance();
+    void collect(std::shared_ptr<CapturedOutput> output);
+
+private:
+    OutputCollector();
+    ~OutputCollector();
+
+    int epollFd {-1};
+    int stopFd {-1};
+    uint64_t nextId {1};
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<CapturedOutput>> outputs;
+    std::thread loop;
+
+    void run();
+};
+
+#endif //TKOM_OUTPUTCOLLECTOR_H
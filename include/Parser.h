@@ -53,9 +53,13 @@ private:
     void createNoArgFunctionExpression(Token token);
     void createNextLineExpression(Token token);
     void createForExpression(Token token);
+    void createParallelForExpression(Token token);
+    void createSpawnExpression(Token token);
+    void createAwaitExpression(Token token);
     void createIfExpression(Token token);
     void createElseExpression(Token token);
     void createWhileExpression(Token token);
+    void createEveryExpression(Token token);
     void createDoExpression(Token token);
     void createDoneExpression(Token token);
     void createStringExpression(Token token);
@@ -91,6 +95,11 @@ private:
             {T_END, [&](Token token){dummy();}},
             {T_NO_ARG_FUNCTION_NAME, [&](Token token){createNoArgFunctionExpression(token);}},
             {T_WHILE, [&](Token token){createWhileExpression(token);}},
+            {T_EVERY, [&](Token token){createEveryExpression(token);}},
+            {T_FOR, [&](Token token){createForExpression(token);}},
+            {T_PARALLEL_FOR, [&](Token token){createParallelForExpression(token);}},
+            {T_SPAWN, [&](Token token){createSpawnExpression(token);}},
+            {T_AWAIT, [&](Token token){createAwaitExpression(token);}},
             {T_IF, [&](Token token){createIfExpression(token);}},
             {T_ELSE, [&](Token token){createElseExpression(token);}},
             {T_DO, [&](Token token){createDoExpression(token);}},
@@ -127,14 +136,18 @@ private:
             {T_BOOLEAN_OPERATOR, {7,6}},
             {T_ADD_OPERATOR, {8,7}},
             {T_MULT_OPERATOR, {9,8}},
+            {T_SPAWN, {10,9}},
+            {T_AWAIT, {10,9}},
             {T_FUNCTION_NAME, {10,9}},
             {T_FUNCTION_CALL, {10,9}},
             {T_NO_ARG_FUNCTION_NAME, {10,9}},
             {T_SEMICON, {11,10}},
             {T_FOR,{12,11}},
+            {T_PARALLEL_FOR,{12,11}},
             {T_IF, {13,12}},
             {T_ELSE, {14,13}},
             {T_WHILE, {15,14}},
+            {T_EVERY, {15,14}},
             {T_DO, {16,15}},
             {T_DONE, {17,16}},
             {T_NEXT_LINE, {18,17}},
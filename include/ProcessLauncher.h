@@ -0,0 +1,40 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_PROCESSLAUNCHER_H
+#define TKOM_PROCESSLAUNCHER_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/*
+ * Starts commands straight from the interpreter with posix_spawn (clone + exec without copying
+ * interpreter memory). Everything a launch needs is prepared once, when handler is configured.
+ */
+struct SpawnOptions {
+    std::vector<std::string> argv;
+    // full environment passed to the command, empty means inherited one
+    std::vector<std::string> environment;
+    std::string workingDir;
+    // descriptors duplicated onto child's stdout and stderr, -1 keeps inherited ones
+    int stdoutFd {-1};
+    int stderrFd {-1};
+};
+
+namespace ProcessLauncher {
+    // splits on whitespace, honours '...', "..." and backslash escapes
+    std::vector<std::string> splitCommandLine(const std::string& commandLine);
+    // true if command uses shell syntax: pipes, redirections, variables, globs, separators,
+    // builtins or leading assignments
+    bool needsShell(const std::string& commandLine);
+    // current environment with NAME=value assignments separated by ';' applied on top
+    std::vector<std::string> buildEnvironment(const std::string& assignments);
+    pid_t spawn(const SpawnOptions& options);
+    // binary started in handler mode for handlers which are not plain commands, /proc/self/exe by default
+    const std::string& interpreter();
+    void setInterpreter(const std::string& path);
+}
+
+#endif //TKOM_PROCESSLAUNCHER_H
@@ -0,0 +1,75 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_REPORTBATCHER_H
+#define TKOM_REPORTBATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SmtpClient.h"
+
+/*
+ * Collects reports going to the same recipients through the same relay and sends them as one
+ * digest when the window of the first one passes or batch reaches its size. A report equal to
+ * the previous one in batch only counts a repeat. Digest relay did not take is put back with
+ * reports which came meanwhile and tried again after a growing delay, after the last attempt or
+ * a refusal its reports are undeliverable. Batches are kept in memory, interpreter flushes them
+ * before it exits, also when it is terminated by a signal.
+ */
+class ReportBatcher {
+public:
+    enum class Delivery {PENDING, SENT, FAILED};
+    // what happened to a submitted report, set once its batch is sent or given up
+    using Outcome = std::shared_ptr<std::atomic<Delivery>>;
+
+    static ReportBatcher& instance();
+
+    // digest goes through spool when its path is given
+    Outcome submit(const std::string& relay, const std::string& spool, SmtpMessage message,
+                   std::chrono::milliseconds window, size_t maxReports);
+    // sends every batch now, once, and waits for ones being sent
+    void flush();
+
+private:
+    struct Report {
+        std::string subject;
+        std::string body;
+        size_t repeats {1};
+    };
+    struct Batch {
+        std::string key;
+        std::string relay;
+        std::string spool;
+        SmtpMessage message;
+        std::vector<Report> reports;
+        std::chrono::steady_clock::time_point deadline;
+        std::vector<Outcome> outcomes;
+        int failures {0};
+    };
+    static const int MAX_ATTEMPTS = 4;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::string, Batch> batches;
+    // batches taken out of map and not yet sent
+    size_t sending {0};
+    std::thread flusher;
+    bool isStopping {false};
+
+    ReportBatcher() = default;
+    ~ReportBatcher();
+    void run();
+    // failed batch is put back unless it was the last attempt
+    void send(Batch& batch, bool isLastAttempt);
+    void requeue(Batch batch);
+    static void finish(Batch& batch, Delivery delivery);
+};
+
+#endif //TKOM_REPORTBATCHER_H
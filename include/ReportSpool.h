@@ -0,0 +1,114 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_REPORTSPOOL_H
+#define TKOM_REPORTSPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "SmtpClient.h"
+
+/*
+ * Append only file of reports waiting for relay. Enqueue only serializes report into a memory
+ * buffer. Committer thread writes whatever gathered in buffer meanwhile and syncs it with one
+ * fdatasync, so reports coming together share it. Sender thread mails reports already on disk
+ * and marks them done with another record; failures are retried with exponential backoff,
+ * reports refused for good are dropped. Reports left in file are sent by the next run, file
+ * is truncated whenever nothing waits in it and rewritten with waiting reports only once records
+ * of sent ones take more than compactBytes. Group which failed to be written is cut off the file
+ * and written again, so no record is ever appended behind a torn one.
+ */
+class ReportSpool {
+public:
+    // spool is shared by handlers of interpreter, only one interpreter may use a file
+    static std::shared_ptr<ReportSpool> open(const std::string& path);
+    // commits every spool and sends what is due, reports waiting for retry stay in files
+    static void closeAll();
+
+    static const uint64_t DEFAULT_COMPACT_BYTES = 1 << 20;
+
+    explicit ReportSpool(const std::string& path, uint64_t compactBytes = DEFAULT_COMPACT_BYTES);
+    ~ReportSpool();
+    ReportSpool(const ReportSpool&) = delete;
+    ReportSpool& operator=(const ReportSpool&) = delete;
+
+    void enqueue(const std::string& relay, SmtpMessage message);
+    // waits until every report is on disk and none is due for sending
+    void drain();
+
+private:
+    enum RecordType : uint8_t {REPORT = 1, DONE = 2};
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t length;
+        // of type, id and payload
+        uint32_t checksum;
+        uint8_t type;
+        uint8_t reserved[3];
+        uint64_t id;
+    };
+    struct Entry {
+        std::string relay;
+        SmtpMessage message;
+        // stream position after its record, report is on disk once it is committed
+        uint64_t end {0};
+        // of its record in file
+        uint64_t size {0};
+    };
+    // failing relay is left alone for twice as long after every failure
+    struct Backoff {
+        int failures {0};
+        std::chrono::steady_clock::time_point resumeAt;
+    };
+
+    std::string path;
+    uint64_t compactBytes;
+    // only committer touches file after recovery, it also replaces it when compacting
+    int fd {-1};
+    std::mutex mutex;
+    // committer waits on written for buffer, sender and drain on changed for everything else
+    std::condition_variable written;
+    std::condition_variable changed;
+    std::string buffer;
+    // buffer holds more than done records, so it has to be synced
+    bool hasReports {false};
+    // group which could not be written is missing in file, next commit rewrites it
+    bool isBehind {false};
+    // positions in stream of records, appended counts buffer too
+    uint64_t appended {0};
+    uint64_t committed {0};
+    uint64_t fileSize {0};
+    // records of entries, the rest of file is dead
+    uint64_t liveBytes {0};
+    uint64_t nextId {1};
+    std::map<uint64_t, Entry> entries;
+    std::map<std::string, Backoff> backoffs;
+    // id of report being sent, 0 when sender is idle
+    uint64_t inFlight {0};
+    bool isStopping {false};
+    // committer stops after sender, so done record of last report is written too
+    bool isClosed {false};
+    std::thread committer;
+    std::thread sender;
+
+    static std::string record(RecordType type, uint64_t id, const std::string& payload);
+    void append(RecordType type, uint64_t id, const std::string& payload);
+    // first report on disk whose relay is not backing off, entries.end() when none
+    std::map<uint64_t, Entry>::iterator findDue(std::chrono::steady_clock::time_point now);
+    void recover();
+    void commit();
+    // appends group, after a failed attempt cuts file back to its last good size and tries again
+    bool write(const std::string& group, bool isSynced);
+    // replaces file with given records of waiting reports
+    void compact(const std::string& records);
+    void send();
+};
+
+#endif //TKOM_REPORTSPOOL_H
@@ -50,6 +50,7 @@ private:
             {"system_handler", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_SYSTEM_HANDLER, position));}},
             {"while", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_WHILE, position));}},
             {"for", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_FOR, position));}},
+            {"parallel_for", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_PARALLEL_FOR, position));}},
             {"if", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_IF, position));}},
             {"do", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_DO, position));}},
             {"else", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_ELSE, position));}},
@@ -66,6 +67,9 @@ private:
             {"raport_type", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_RAPORT_TYPE, position));}},
             {"mail", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_MAIL, position));}},
             {"ret", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_RET, position));}},
+            {"spawn", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_SPAWN, position));}},
+            {"await", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_AWAIT, position));}},
+            {"every", [&](std::string value) {tokens.push(std::make_shared<Token>(std::move(value), T_EVERY, position));}},
 
     };
 
@@ -90,10 +94,11 @@ private:
 
     char getNextSign();
     char getSignAndReadNext();
-    void getNextToken();
     void readToken();
 public:
     Scanner(Configuration configuration);
+    // reads one token into queue, tests drive scanner with it
+    void getNextToken();
     // simple printing tokens
     void scan();
     Token getTokenValue();
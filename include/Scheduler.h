@@ -0,0 +1,103 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_SCHEDULER_H
+#define TKOM_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include "WorkStealingPool.h"
+
+struct PeriodicTask {
+    // what happens to ticks due while previous one still runs or scheduler was late
+    enum class Missed {SKIP, CATCHUP};
+
+    std::chrono::milliseconds period {1000};
+    // every tick is delayed by a random part of it, so schedules started together spread out
+    std::chrono::milliseconds jitter {0};
+    Missed missed {Missed::SKIP};
+    // one tick, false when task is done
+    std::function<bool()> run;
+};
+
+/*
+ * Runs periodic tasks on the interpreter pool instead of a sleeping process per task. Timers sit
+ * in a hierarchical wheel of four levels of 256 slots with 10 ms ticks, adding and cancelling
+ * is O(1) and timers move to a lower level only when their slot comes up. Ticks are fixed rate,
+ * the next one is placed when the current one fires, not when it ends. A tick due while the
+ * previous one still runs is dropped with SKIP, with CATCHUP it runs right after it, so no tick
+ * is lost. Driver thread is started with the first schedule and sleeps until next busy slot.
+ * A finished schedule is forgotten once its status is read, or right away when it was released.
+ */
+class Scheduler {
+public:
+    using Id = uint64_t;
+
+    static Scheduler& instance();
+
+    Id add(PeriodicTask task);
+    // finishes schedule with given status, running tick completes on its own
+    void cancel(Id id, int status);
+    // status of finished schedule, given once, the schedule is forgotten after it
+    std::optional<int> poll(Id id);
+    // negative timeout waits until schedule finishes, empty result on timeout
+    std::optional<int> waitFor(Id id, double timeoutSeconds);
+    // nobody asks for status of schedule any more, it is forgotten as soon as it finishes
+    void release(Id id);
+    // schedules still known, active or finished and not reported yet
+    size_t size();
+    // blocks while any schedule is active, interpreter does it before exit
+    void waitForActive();
+
+private:
+    Scheduler() = default;
+    ~Scheduler();
+
+    struct Timer;
+    struct Slot {
+        Timer* first {nullptr};
+    };
+    static const size_t LEVELS = 4;
+    static const size_t SLOT_BITS = 8;
+    static const size_t SLOTS = 1 << SLOT_BITS;
+
+    WorkStealingPool& pool {WorkStealingPool::instance()};
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::condition_variable finished;
+    std::thread driver;
+    bool stopping {false};
+    Id nextId {1};
+    size_t activeCount {0};
+    std::unordered_map<Id, std::shared_ptr<Timer>> timers;
+    Slot wheel[LEVELS][SLOTS];
+    // last tick processed by driver
+    uint64_t currentTick {0};
+    std::chrono::steady_clock::time_point start;
+    std::mt19937_64 random {std::random_device{}()};
+
+    uint64_t tickOf(std::chrono::steady_clock::time_point time) const;
+    uint64_t ticksOf(std::chrono::milliseconds duration) const;
+    void place(Timer* timer);
+    void unlink(Timer* timer);
+    void scheduleNext(Timer* timer);
+    void fire(Timer* timer);
+    void runTick(std::shared_ptr<Timer> timer);
+    void finish(Timer* timer, int status);
+    int report(std::unordered_map<Id, std::shared_ptr<Timer>>::iterator timer);
+    void advance(uint64_t nowTick);
+    // tick to wake up at, or none when wheel is empty
+    std::optional<uint64_t> nextBusyTick() const;
+    void run();
+};
+
+#endif //TKOM_SCHEDULER_H
@@ -0,0 +1,117 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_SKETCH_H
+#define TKOM_SKETCH_H
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "HandleRegistry.h"
+
+/*
+ * Summary of a stream of values answering quantile queries in bounded memory. Insertion costs
+ * one bucket increment, sketches of the same kind and accuracy merge by adding buckets, and
+ * state is serialized as base64 text, so it can travel in reports and be loaded back.
+ * Every call locks the sketch, one handle can be fed by many tasks.
+ */
+class Sketch {
+public:
+    virtual ~Sketch() = default;
+
+    void add(double value);
+    // nearest rank estimate, 0 for an empty sketch
+    double quantile(double q);
+    uint64_t count();
+    // other has to be of the same kind and accuracy
+    void merge(Sketch& other);
+    std::string serialize();
+    static std::unique_ptr<Sketch> deserialize(const std::string& text);
+
+protected:
+    std::mutex mutex;
+    uint64_t total {0};
+    double minimum {std::numeric_limits<double>::infinity()};
+    double maximum {-std::numeric_limits<double>::infinity()};
+
+    virtual void insert(double value) = 0;
+    virtual double estimate(uint64_t rank) const = 0;
+    virtual bool isCompatible(const Sketch& other) const = 0;
+    virtual void mergeBuckets(const Sketch& other) = 0;
+    virtual void writeBuckets(std::string& out) const = 0;
+    virtual bool readBuckets(const std::string& in, size_t& position) = 0;
+};
+
+// buckets of exponentially growing width with counts kept from a lowest index up
+struct BucketStore {
+    std::vector<uint64_t> counts;
+    int offset {0};
+
+    void increment(int index, uint64_t count = 1);
+    // lowest buckets are folded into one when store grows over limit
+    void collapse(size_t maximumBuckets);
+};
+
+/*
+ * DDSketch (Masson, Rim, Lee): value v goes to bucket ceil(log_gamma |v|) with gamma = (1 + a) / (1 - a),
+ * so every quantile is returned with relative error below accuracy a, whatever the distribution.
+ */
+class QuantileSketch : public Sketch {
+public:
+    explicit QuantileSketch(double accuracy = 0.01);
+
+private:
+    // values closer to zero are counted as zero
+    static constexpr double MINIMUM_VALUE = 1e-9;
+    static const size_t MAXIMUM_BUCKETS = 2048;
+
+    double accuracy;
+    double gamma;
+    double multiplier;
+    BucketStore positive;
+    BucketStore negative;
+    uint64_t zeroCount {0};
+
+    int indexOf(double value) const;
+    double valueOf(int index) const;
+
+    void insert(double value) override;
+    double estimate(uint64_t rank) const override;
+    bool isCompatible(const Sketch& other) const override;
+    void mergeBuckets(const Sketch& other) override;
+    void writeBuckets(std::string& out) const override;
+    bool readBuckets(const std::string& in, size_t& position) override;
+};
+
+/*
+ * HDR style histogram of non negative integers. Values below 2^bits are counted exactly, above that
+ * every power of two range is split into 2^(bits - 1) buckets, which bounds relative error by 2^(1 - bits).
+ * Bucket index comes from the position of the highest set bit, no logarithm is computed. Fractions
+ * are truncated, negative values count as 0, so values should be scaled to integers first.
+ */
+class LogHistogram : public Sketch {
+public:
+    explicit LogHistogram(int bits = 7);
+
+private:
+    int bits;
+    std::vector<uint64_t> counts;
+
+    size_t indexOf(uint64_t value) const;
+    uint64_t lowestOf(size_t index) const;
+
+    void insert(double value) override;
+    double estimate(uint64_t rank) const override;
+    bool isCompatible(const Sketch& other) const override;
+    void mergeBuckets(const Sketch& other) override;
+    void writeBuckets(std::string& out) const override;
+    bool readBuckets(const std::string& in, size_t& position) override;
+};
+
+using SketchRegistry = HandleRegistry<Sketch>;
+
+#endif //TKOM_SKETCH_H
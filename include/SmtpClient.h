@@ -0,0 +1,87 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_SMTPCLIENT_H
+#define TKOM_SMTPCLIENT_H
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct SmtpMessage {
+    // empty sender is replaced by user at this host
+    std::string from;
+    std::vector<std::string> recipients;
+    std::string subject;
+    std::string body;
+};
+
+// relay refused message for good, other failures may pass when it is sent again
+struct SmtpRefusal : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/*
+ * One session with a relay. With PIPELINING announced, envelope and DATA go in a single write
+ * and replies are read afterwards, so a message costs two round trips. Session stays open for
+ * next messages, it is closed with QUIT when dropped. Once content of a message is written the
+ * relay may have taken it, a session breaking after that is a refusal, so it is not sent again.
+ */
+class SmtpConnection {
+public:
+    SmtpConnection(const std::string& host, const std::string& port);
+    ~SmtpConnection();
+    SmtpConnection(const SmtpConnection&) = delete;
+    SmtpConnection& operator=(const SmtpConnection&) = delete;
+
+    void send(const SmtpMessage& message);
+    // connection can not be used any more, relay went away or broke the protocol
+    bool isBroken() const { return broken; }
+    // relay closed idle session or said it is going to
+    bool isClosedByRelay() const;
+
+    std::chrono::steady_clock::time_point lastUsed;
+
+private:
+    std::string relay;
+    int fd {-1};
+    bool broken {false};
+    bool pipelining {false};
+    std::string received;
+
+    void writeAll(const std::string& data);
+    std::string readLine();
+    // code of whole, possibly multiline, reply
+    int readReply(std::string& text);
+    int command(const std::string& line, std::string& text);
+    void fail(const std::string& reason);
+};
+
+/*
+ * Idle sessions kept per relay, every send borrows one or opens a new one. A session reused after
+ * a while may turn out closed by the relay, then message is sent once more on a fresh session,
+ * as long as the session broke before content of the message was written.
+ */
+class SmtpPool {
+public:
+    static SmtpPool& instance();
+
+    // relay is host or host:port, port 25 by default
+    void send(const std::string& relay, SmtpMessage message);
+
+private:
+    SmtpPool() = default;
+
+    std::mutex mutex;
+    std::map<std::string, std::vector<std::unique_ptr<SmtpConnection>>> idle;
+
+    std::unique_ptr<SmtpConnection> take(const std::string& relay);
+    void giveBack(const std::string& relay, std::unique_ptr<SmtpConnection> connection);
+};
+
+#endif //TKOM_SMTPCLIENT_H
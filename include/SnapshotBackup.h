@@ -0,0 +1,38 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_SNAPSHOTBACKUP_H
+#define TKOM_SNAPSHOTBACKUP_H
+
+#include <atomic>
+#include <string>
+#include <sys/stat.h>
+#include "CopyEngine.h"
+
+/*
+ * rsync --link-dest style snapshots. Every run makes a new directory in root, a file with the
+ * same size, mtime and mode as in the previous snapshot (and the same content when hashing is
+ * on) becomes a hard link to it, only the rest is copied. Tree is walked by CopyEngine, so the
+ * decisions run on pool workers in parallel across directories, for an unchanged file they cost
+ * a statx of the previous copy and a link. Snapshot is built as NAME.partial and renamed when
+ * complete, root/latest points at the newest one and is what the next run links against.
+ */
+class SnapshotBackup {
+public:
+    SnapshotBackup(std::string source, std::string root, bool useHash, Throttle* throttle = nullptr);
+    // empty name picks current time
+    CopyReport run(std::string name = "");
+
+private:
+    std::string source;
+    std::string root;
+    bool useHash;
+    Throttle* throttle;
+    std::atomic<size_t> linked {0};
+
+    std::string previousSnapshot();
+    bool isSame(const std::string& previous, const std::string& current, const struct stat& info);
+};
+
+#endif //TKOM_SNAPSHOTBACKUP_H
@@ -0,0 +1,123 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_SYSTEMMETRICS_H
+#define TKOM_SYSTEMMETRICS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+/*
+ * File of /proc kept open and read again from offset 0 with pread, procfs regenerates its content
+ * on every read, so one descriptor serves all samples. Buffer is allocated once.
+ */
+class ProcFile {
+public:
+    explicit ProcFile(std::string path, size_t capacity = 4096);
+    ~ProcFile();
+    ProcFile(const ProcFile&) = delete;
+    ProcFile& operator=(const ProcFile&) = delete;
+
+    // whole content, valid until next read, buffer grows when content does not fit
+    std::string_view read();
+
+private:
+    std::string path;
+    int fd {-1};
+    int openError {0};
+    std::vector<char> buffer;
+};
+
+/*
+ * Samples system state for check_system reports. Every source stays open between samples and
+ * is parsed in place from its buffer, nothing is allocated per sample, except when list of
+ * mounts changes. Cpu usage of a process is the share of one core used since previous sample.
+ */
+class SystemMetrics {
+public:
+    struct LoadAverage {
+        double one {0};
+        double five {0};
+        double fifteen {0};
+        uint64_t running {0};
+        uint64_t tasks {0};
+    };
+    // bytes
+    struct Memory {
+        uint64_t total {0};
+        uint64_t free {0};
+        uint64_t available {0};
+        uint64_t buffers {0};
+        uint64_t cached {0};
+        uint64_t swapTotal {0};
+        uint64_t swapFree {0};
+    };
+    struct Disk {
+        std::string mountPoint;
+        uint64_t totalBytes {0};
+        uint64_t availableBytes {0};
+        uint64_t totalFiles {0};
+        uint64_t freeFiles {0};
+    };
+    struct Process {
+        pid_t pid {0};
+        uint64_t residentBytes {0};
+        double cpuPercent {0};
+        uint64_t threads {0};
+        uint64_t openFiles {0};
+    };
+    struct FileDescriptors {
+        uint64_t allocated {0};
+        uint64_t maximum {0};
+    };
+    // value of a report kept in history, disk series are named after mount point
+    struct Sample {
+        std::string series;
+        double value;
+    };
+
+    // process metrics are read for given pid, interpreter itself by default
+    explicit SystemMetrics(pid_t pid = 0);
+    ~SystemMetrics();
+    SystemMetrics(const SystemMetrics&) = delete;
+    SystemMetrics& operator=(const SystemMetrics&) = delete;
+
+    LoadAverage loadAverage();
+    Memory memory();
+    // filesystems backed by a device, pseudo filesystems are left out
+    const std::vector<Disk>& disks();
+    Process process();
+    FileDescriptors fileDescriptors();
+
+    // text of a check_system report, empty for unknown type, values it shows are added to samples
+    std::string report(const std::string& type, std::vector<Sample>* samples = nullptr);
+
+private:
+    struct Mount {
+        Disk disk;
+        int fd {-1};
+    };
+
+    pid_t pid;
+    ProcFile loadFile {"/proc/loadavg"};
+    ProcFile memoryFile {"/proc/meminfo"};
+    ProcFile mountsFile {"/proc/self/mounts", 16384};
+    ProcFile fileNumberFile {"/proc/sys/fs/file-nr"};
+    ProcFile statFile;
+    int processFdDirectory {-1};
+    std::string mountsContent;
+    std::vector<Mount> mounts;
+    std::vector<Disk> diskSamples;
+    uint64_t lastCpuTicks {0};
+    uint64_t lastSampleNanoseconds {0};
+    long ticksPerSecond;
+
+    void updateMounts(std::string_view content);
+    void closeMounts();
+};
+
+#endif //TKOM_SYSTEMMETRICS_H
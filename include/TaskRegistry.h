@@ -0,0 +1,37 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_TASKREGISTRY_H
+#define TKOM_TASKREGISTRY_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <variant>
+#include "WorkStealingPool.h"
+#include "HandleRegistry.h"
+
+// result of a function started with spawn, read by await
+struct SpawnedTask {
+    using Value = std::variant<int, double, std::string>;
+
+    void complete(std::optional<Value> value);
+    void fail(std::exception_ptr error);
+    // helps the pool until task is done, rethrows error of the task
+    std::optional<Value> get();
+
+private:
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done {false};
+    std::optional<Value> result;
+    std::exception_ptr error;
+};
+
+using TaskRegistry = HandleRegistry<SpawnedTask>;
+
+#endif //TKOM_TASKREGISTRY_H
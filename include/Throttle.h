@@ -0,0 +1,46 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_THROTTLE_H
+#define TKOM_THROTTLE_H
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+/*
+ * Token buckets for bandwidth and IOPS shared by all workers of one handler. Every bucket keeps
+ * the time at which it is drained (generic cell rate algorithm), a caller reserves its cost
+ * under the lock and sleeps outside of it until its share is due. Burst is limited to 20 ms
+ * of traffic, so the rate is smooth at sub-second scale. An operation is a request of up to
+ * 128 KiB, callers pass data in chunkSize() pieces.
+ */
+class Throttle {
+public:
+    // zero disables a limit
+    Throttle(double bytesPerSecond, double operationsPerSecond);
+
+    void acquire(size_t bytes);
+    // metadata operation without data, like opening a file
+    void acquireOperation();
+    size_t chunkSize() const;
+    bool isLimited() const { return bytesPerSecond > 0 || operationsPerSecond > 0; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double bytesPerSecond;
+    double operationsPerSecond;
+    std::mutex mutex;
+    Clock::time_point bytesDrained;
+    Clock::time_point operationsDrained;
+
+    void reserve(size_t bytes, size_t operations);
+};
+
+// "idle", "best-effort" or "best-effort:LEVEL" with level 0 (highest) to 7, for calling thread and threads it starts
+void setIoPriority(const std::string& priority);
+
+#endif //TKOM_THROTTLE_H
@@ -0,0 +1,106 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_TIMESERIES_H
+#define TKOM_TIMESERIES_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * History of check_system samples in a fixed size file mapped into memory. File is split into
+ * blocks, each block holds samples of one series compressed as in Gorilla: timestamps are stored
+ * as delta of delta, values as xor with previous value. When no block is free the oldest one is
+ * taken, so file keeps the newest samples and never grows. Queries decode blocks straight from
+ * the mapping. One process writes, any number reads; sample count of a block is published after
+ * its bits and a reused block is recognised by its generation, so readers take no lock.
+ */
+class TimeSeries {
+public:
+    struct Aggregate {
+        uint64_t count {0};
+        double min {std::numeric_limits<double>::infinity()};
+        double max {-std::numeric_limits<double>::infinity()};
+        double sum {0};
+    };
+
+    static const size_t DEFAULT_SIZE = 4 * 1024 * 1024;
+
+    // shared mapping of file, opened for writing when size is given, existing file keeps its size,
+    // unmapped and unlocked when its last user releases it
+    static std::shared_ptr<TimeSeries> open(const std::string& path, size_t size = 0);
+
+    TimeSeries(const std::string& path, size_t size);
+    ~TimeSeries();
+    TimeSeries(const TimeSeries&) = delete;
+    TimeSeries& operator=(const TimeSeries&) = delete;
+
+    // milliseconds since epoch, samples of a series have to come in time order
+    void append(const std::string& series, int64_t timestamp, double value);
+    // samples with from <= timestamp <= to, in time order
+    void scan(const std::string& series, int64_t from, int64_t to,
+              const std::function<void(int64_t timestamp, double value)>& visit) const;
+    Aggregate aggregate(const std::string& series, int64_t from, int64_t to) const;
+
+    bool isWritable() const { return writable; }
+    static int64_t now();
+
+private:
+    struct Series {
+        char name[120];
+        // index + 1 of block taking new samples, 0 when series has none
+        uint32_t openBlock;
+        uint32_t reserved;
+    };
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t blockSize;
+        uint32_t blockCount;
+        // block taken when an open one is full, blocks are reused in a ring
+        uint32_t nextBlock;
+        uint32_t seriesCount;
+        uint64_t reserved;
+        Series series[127];
+    };
+    struct BlockHeader {
+        // odd while block is rewritten
+        uint64_t generation;
+        // index + 1 of series, 0 for an unused block
+        uint32_t series;
+        uint32_t count;
+        uint32_t bitLength;
+        uint8_t leading;
+        uint8_t trailing;
+        uint16_t reserved;
+        int64_t firstTimestamp;
+        int64_t lastTimestamp;
+        int64_t lastDelta;
+        uint64_t firstValue;
+        uint64_t lastValue;
+    };
+
+    std::string path;
+    int fd {-1};
+    bool writable;
+    uint64_t inode {0};
+    void* mapping {nullptr};
+    size_t mappingSize {0};
+    Header* header {nullptr};
+    std::mutex appendMutex;
+    std::unordered_map<std::string, uint32_t> seriesIndexes;
+
+    BlockHeader* block(uint32_t index) const;
+    uint8_t* bits(uint32_t index) const;
+    // index + 1 of series, 0 when file has no such series
+    uint32_t findSeries(const std::string& series) const;
+    uint32_t takeBlock(uint32_t series, int64_t timestamp, double value);
+};
+
+#endif //TKOM_TIMESERIES_H
@@ -57,6 +57,10 @@ enum Type {
     T_RAPORT_TYPE = 44,
     T_RAPORT_DIR = 45,
     T_RET = 46,
+    T_PARALLEL_FOR = 47,
+    T_SPAWN = 48,
+    T_AWAIT = 49,
+    T_EVERY = 50,
 };
 
 class Token {
@@ -93,11 +97,12 @@ public:
         return type == T_MULT_OPERATOR || type == T_BOOLEAN_AND || type == T_ADD_OPERATOR ||
                type == T_BOOLEAN_OPERATOR || type == T_BOOLEAN_OR || type == T_OPENING_PARENTHESIS
                 || type == T_ASSIGN_OPERATOR || type == T_SEMICON || type == T_DOT || type == T_DO
-                || type == T_CON;
+                || type == T_CON || type == T_SPAWN || type == T_AWAIT;
     }
 
     bool isCondition() {
-        return type == T_WHILE || type == T_FOR || type == T_IF || type == T_ELSE;
+        return type == T_WHILE || type == T_FOR || type == T_PARALLEL_FOR || type == T_IF || type == T_ELSE
+                || type == T_EVERY;
     }
 
     bool isFunction() {
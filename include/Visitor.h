@@ -41,6 +41,9 @@ struct StringExpression;
 struct IfExpression;
 struct ElseExpression;
 struct WhileExpression;
+struct EveryExpression;
+struct ForExpression;
+struct ParallelForExpression;
 
 // generic structure for double args expressions
 struct DoubleArgsExpression;
@@ -66,6 +69,9 @@ struct DoExpression;
 struct FileExpression;
 struct SystemHandlerExpression;
 struct SystemHandlerDeclExpression;
+// tasks
+struct SpawnExpression;
+struct AwaitExpression;
 
 struct Visitor {
     // visit root
@@ -112,8 +118,15 @@ struct Visitor {
     virtual void visit(IfExpression* ifExpression) = 0;
     virtual void visit(ElseExpression* elseExpression) = 0;
     virtual void visit(WhileExpression* whileExpression) = 0;
+    virtual void visit(EveryExpression* everyExpression) = 0;
+    virtual void visit(ForExpression* forExpression) = 0;
+    virtual void visit(ParallelForExpression* parallelForExpression) = 0;
     virtual void visit(SystemHandlerExpression* systemHandlerExpression) = 0;
     virtual void visit(SystemHandlerDeclExpression* systemHandlerDeclExpression) = 0;
+
+    // tasks
+    virtual void visit(SpawnExpression* spawnExpression) = 0;
+    virtual void visit(AwaitExpression* awaitExpression) = 0;
 };
 
 struct ExpressionVisitor : Visitor {
@@ -141,6 +154,9 @@ struct ExpressionVisitor : Visitor {
     void visit(IfExpression* ifExpression) override;
     void visit(ElseExpression* elseExpression) override;
     void visit(WhileExpression* whileExpression) override;
+    void visit(EveryExpression* everyExpression) override;
+    void visit(ForExpression* forExpression) override;
+    void visit(ParallelForExpression* parallelForExpression) override;
     void visit(DoExpression* doExpression) override;
     void visit(FileExpression* fileExpression) override;
     void visit(FieldReferenceExpression* fieldReferenceExpression) override;
@@ -148,6 +164,8 @@ struct ExpressionVisitor : Visitor {
     void visit(RetExpression* retExpression) override;
     void visit(SystemHandlerExpression* systemHandlerExpression) override;
     void visit(SystemHandlerDeclExpression* systemHandlerDeclExpression) override;
+    void visit(SpawnExpression* spawnExpression) override;
+    void visit(AwaitExpression* awaitExpression) override;
 };
 
 struct Expression {
@@ -228,6 +246,27 @@ struct WhileExpression : DoubleArgsExpression {
     }
 };
 
+// left holds interval in seconds, optionally followed by number of runs: every(interval, runs)
+struct EveryExpression : DoubleArgsExpression {
+    void accept(Visitor* visitor) override {
+        visitor->visit(this);
+    }
+};
+
+// left holds range args: for(i, from, to)
+struct ForExpression : DoubleArgsExpression {
+    void accept(Visitor* visitor) override {
+        visitor->visit(this);
+    }
+};
+
+// left holds range args followed by reductions: parallel_for(i, from, to, sum, total)
+struct ParallelForExpression : ForExpression {
+    void accept(Visitor* visitor) override {
+        visitor->visit(this);
+    }
+};
+
 struct IfExpression : DoubleArgsExpression {
     std::shared_ptr<BodyExpression> elseCondition {nullptr};
     void accept(Visitor* visitor) override {
@@ -343,5 +382,17 @@ struct SystemHandlerDeclExpression : Expression {
         visitor->visit(this);
     }
 };
+struct SpawnExpression : Expression {
+    std::shared_ptr<FunctionCallExpression> call;
+    void accept(Visitor* visitor) override {
+        visitor->visit(this);
+    }
+};
+struct AwaitExpression : Expression {
+    std::shared_ptr<Expression> handle;
+    void accept(Visitor* visitor) override {
+        visitor->visit(this);
+    }
+};
 
 #endif //TKOM_VISITOR_H
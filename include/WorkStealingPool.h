@@ -0,0 +1,91 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#ifndef TKOM_WORKSTEALINGPOOL_H
+#define TKOM_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Every worker owns a deque. Tasks submitted from a worker go to the back of its own deque
+ * and are popped from the back (LIFO, cache friendly), idle workers steal from the front
+ * of other deques. Threads waiting for a TaskGroup help by running pending tasks, so nested
+ * parallel constructs do not deadlock the pool. Tasks blocked on something another task has
+ * to do (a channel) do not help, they report it instead: when every pool thread is blocked
+ * and tasks are still queued, a spare thread runs them and ends when the queues are empty.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t workerCount);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // shared interpreter pool, recreated in forked children
+    static WorkStealingPool& instance();
+
+    // tasks must not throw, callers capture their own exceptions
+    void submit(Task task);
+    // runs one pending task on the calling thread, false if nothing was found
+    bool runPendingTask();
+    size_t size() const { return workers.size(); }
+    // around a blocking wait, no-op on threads not belonging to the pool
+    void beginBlocking();
+    void endBlocking();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue {0};
+    std::atomic<size_t> pendingTasks {0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    bool stopping {false};
+    // guarded by sleepMutex
+    size_t blocked {0};
+    size_t spares {0};
+    std::condition_variable sparesFinished;
+
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    void workerLoop(size_t index);
+    // sleepMutex held
+    void startSpareIfStuck();
+    void spareLoop();
+};
+
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& pool = WorkStealingPool::instance()) : pool(pool) {}
+    ~TaskGroup() { wait(); }
+
+    void run(WorkStealingPool::Task task);
+    // blocks until all tasks of the group finished, helping the pool meanwhile
+    void wait();
+
+private:
+    WorkStealingPool& pool;
+    // guarded by mutex, last task notifies under it so wait() can not return while it runs
+    size_t pending {0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    bool isFinished();
+};
+
+#endif //TKOM_WORKSTEALINGPOOL_H
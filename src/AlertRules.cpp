@@ -0,0 +1,88 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/AlertRules.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    std::string number(double value) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+}
+
+void AlertRules::add(const std::string& rule) {
+    std::istringstream words(rule);
+    std::string series, comparison, keyword, rest;
+    Rule parsed;
+    double seconds = 0;
+    if(!(words >> series >> comparison >> parsed.threshold)) {
+        throw std::runtime_error("Wrong alert rule " + rule);
+    }
+    if(words >> keyword && (keyword != "for" || !(words >> seconds) || seconds < 0 || words >> rest)) {
+        throw std::runtime_error("Wrong alert rule " + rule);
+    }
+    if(comparison == ">") {
+        parsed.comparison = Comparison::GREATER;
+    } else if(comparison == ">=") {
+        parsed.comparison = Comparison::GREATER_EQUAL;
+    } else if(comparison == "<") {
+        parsed.comparison = Comparison::LESS;
+    } else if(comparison == "<=") {
+        parsed.comparison = Comparison::LESS_EQUAL;
+    } else if(comparison == "==") {
+        parsed.comparison = Comparison::EQUAL;
+    } else if(comparison == "!=") {
+        parsed.comparison = Comparison::NOT_EQUAL;
+    } else {
+        throw std::runtime_error("Unknown comparison " + comparison + " in alert rule " + rule);
+    }
+    parsed.duration = (int64_t)(seconds * 1000);
+    parsed.text = series + " " + comparison + " " + number(parsed.threshold);
+    if(parsed.duration > 0) {
+        parsed.text += " for " + number(seconds) + "s";
+    }
+    rulesOfSeries[series].push_back(rules.size());
+    rules.push_back(std::move(parsed));
+}
+
+std::vector<std::string> AlertRules::evaluate(const std::vector<SystemMetrics::Sample>& samples, int64_t timestamp) {
+    std::vector<std::string> messages;
+    for(auto& sample : samples) {
+        auto found = rulesOfSeries.find(sample.series);
+        if(found == rulesOfSeries.end()) {
+            continue;
+        }
+        for(auto index : found->second) {
+            auto& rule = rules[index];
+            bool holds;
+            switch(rule.comparison) {
+                case Comparison::GREATER: holds = sample.value > rule.threshold; break;
+                case Comparison::GREATER_EQUAL: holds = sample.value >= rule.threshold; break;
+                case Comparison::LESS: holds = sample.value < rule.threshold; break;
+                case Comparison::LESS_EQUAL: holds = sample.value <= rule.threshold; break;
+                case Comparison::EQUAL: holds = sample.value == rule.threshold; break;
+                case Comparison::NOT_EQUAL: holds = sample.value != rule.threshold; break;
+            }
+            if(!holds) {
+                if(rule.state == State::FIRING) {
+                    messages.push_back("Alert " + rule.text + " resolved, value is " + number(sample.value) + ".\n");
+                }
+                rule.state = State::OK;
+                continue;
+            }
+            if(rule.state == State::OK) {
+                rule.state = State::PENDING;
+                rule.since = timestamp;
+            }
+            if(rule.state == State::PENDING && timestamp - rule.since >= rule.duration) {
+                rule.state = State::FIRING;
+                messages.push_back("Alert " + rule.text + " is firing, value is " + number(sample.value) + ".\n");
+            }
+        }
+    }
+    return messages;
+}
@@ -0,0 +1,835 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Archive.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+    const size_t BLOCK_SIZE = 128 * 1024;
+    const size_t WINDOW_SIZE = 32 * 1024;
+    // every n-th block is compressed without dictionary and can start inflating
+    const size_t CHECKPOINT_INTERVAL = 8;
+    const size_t TAR_BLOCK = 512;
+    const char INDEX_MAGIC[4] = {'T', 'K', 'A', 'I'};
+
+    std::string errorText(const std::string& path) {
+        return path + ": " + strerror(errno);
+    }
+
+    void writeAll(int fd, const void* data, size_t size, const std::string& path) {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = write(fd, bytes, size);
+            if(written == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(errorText(path));
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    struct TarHeader {
+        char name[100];
+        char mode[8];
+        char uid[8];
+        char gid[8];
+        char size[12];
+        char mtime[12];
+        char checksum[8];
+        char type;
+        char linkName[100];
+        char magic[6];
+        char version[2];
+        char userName[32];
+        char groupName[32];
+        char deviceMajor[8];
+        char deviceMinor[8];
+        char prefix[155];
+        char padding[12];
+    };
+    static_assert(sizeof(TarHeader) == TAR_BLOCK, "ustar header is one tar block");
+
+    void putOctal(char* field, size_t width, uint64_t value) {
+        // base-256 for values not fitting in octal digits, GNU tar extension
+        if(width < 2 || value >= (1ULL << (3 * (width - 1)))) {
+            memset(field, 0, width);
+            field[0] = (char)0x80;
+            for(size_t i = width - 1; i > 0 && value; i--, value >>= 8) {
+                field[i] = (char)(value & 0xff);
+            }
+            return;
+        }
+        snprintf(field, width, "%0*llo", (int)width - 1, (unsigned long long)value);
+    }
+
+    uint64_t getOctal(const char* field, size_t width) {
+        if((unsigned char)field[0] & 0x80) {
+            uint64_t value = 0;
+            for(size_t i = 1; i < width; i++) {
+                value = (value << 8) | (unsigned char)field[i];
+            }
+            return value;
+        }
+        uint64_t value = 0;
+        for(size_t i = 0; i < width && field[i]; i++) {
+            if(field[i] >= '0' && field[i] <= '7') {
+                value = value * 8 + (field[i] - '0');
+            }
+        }
+        return value;
+    }
+
+    void setChecksum(TarHeader& header) {
+        memset(header.checksum, ' ', sizeof(header.checksum));
+        unsigned sum = 0;
+        auto bytes = reinterpret_cast<const unsigned char*>(&header);
+        for(size_t i = 0; i < sizeof(header); i++) {
+            sum += bytes[i];
+        }
+        snprintf(header.checksum, sizeof(header.checksum), "%06o", sum);
+        header.checksum[7] = ' ';
+    }
+
+    std::string fieldString(const char* field, size_t width) {
+        return std::string(field, strnlen(field, width));
+    }
+
+    // absolute paths and .. components could write outside of target
+    bool isUnsafe(const std::string& name) {
+        if(name.empty() || name[0] == '/') {
+            return true;
+        }
+        size_t begin = 0;
+        while(begin <= name.size()) {
+            auto end = name.find('/', begin);
+            if(end == std::string::npos) {
+                end = name.size();
+            }
+            if(name.compare(begin, end - begin, "..") == 0) {
+                return true;
+            }
+            begin = end + 1;
+        }
+        return false;
+    }
+
+    struct Descriptor {
+        int fd {-1};
+        ~Descriptor() {
+            if(fd != -1) {
+                close(fd);
+            }
+        }
+    };
+
+    /*
+     * Opens directory holding entry name below target, creating missing directories. Every
+     * component is opened with O_NOFOLLOW relative to the previous one, so a symlink extracted
+     * (or planted) earlier cannot redirect later entries outside of target. Returns -1 with
+     * errno set, leaf gets the last component.
+     */
+    int openParent(int targetFd, const std::string& name, std::string& leaf) {
+        int directoryFd = dup(targetFd);
+        size_t begin = 0;
+        while(directoryFd != -1) {
+            auto end = name.find('/', begin);
+            if(end == std::string::npos) {
+                leaf = name.substr(begin);
+                return directoryFd;
+            }
+            auto component = name.substr(begin, end - begin);
+            begin = end + 1;
+            if(component.empty() || component == ".") {
+                continue;
+            }
+            int next = openat(directoryFd, component.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if(next == -1 && errno == ENOENT && mkdirat(directoryFd, component.c_str(), 0755) == 0) {
+                next = openat(directoryFd, component.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            }
+            auto error = errno;
+            close(directoryFd);
+            directoryFd = next;
+            errno = error;
+        }
+        return -1;
+    }
+
+    std::string extractError(const std::string& name) {
+        if(errno == ELOOP || errno == ENOTDIR) {
+            return name + ": path goes through a symlink, skipped";
+        }
+        return errorText(name);
+    }
+
+    // raw inflate of archive from a checkpoint on
+    class InflateStream {
+    public:
+        InflateStream(const std::string& path, uint64_t compressedOffset) : path(path) {
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(fd == -1) {
+                throw std::runtime_error(errorText(path));
+            }
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            if(lseek(fd, compressedOffset, SEEK_SET) == -1 || inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+                close(fd);
+                throw std::runtime_error(path + ": cannot start inflating");
+            }
+        }
+        ~InflateStream() {
+            inflateEnd(&stream);
+            close(fd);
+        }
+
+        // fills whole buffer, false at end of deflate stream
+        bool read(void* target, size_t size) {
+            stream.next_out = static_cast<Bytef*>(target);
+            stream.avail_out = size;
+            while(stream.avail_out > 0) {
+                if(isFinished) {
+                    return false;
+                }
+                if(stream.avail_in == 0) {
+                    auto got = ::read(fd, input, sizeof(input));
+                    if(got <= 0) {
+                        if(got == -1 && errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error(path + ": archive is truncated");
+                    }
+                    stream.next_in = input;
+                    stream.avail_in = got;
+                }
+                auto result = inflate(&stream, Z_NO_FLUSH);
+                if(result == Z_STREAM_END) {
+                    isFinished = true;
+                } else if(result != Z_OK && result != Z_BUF_ERROR) {
+                    throw std::runtime_error(path + ": archive is damaged");
+                }
+            }
+            return true;
+        }
+
+        void skip(uint64_t size) {
+            char buffer[64 * 1024];
+            while(size > 0) {
+                auto part = std::min<uint64_t>(size, sizeof(buffer));
+                if(!read(buffer, part)) {
+                    throw std::runtime_error(path + ": archive is truncated");
+                }
+                size -= part;
+            }
+        }
+
+    private:
+        std::string path;
+        int fd;
+        z_stream stream {};
+        unsigned char input[128 * 1024];
+        bool isFinished {false};
+    };
+
+    struct TarEntry {
+        std::string name;
+        std::string linkTarget;
+        char type;
+        uint64_t size;
+        mode_t mode;
+        int64_t mtime;
+    };
+
+    // next entry of tar stream, false at its end
+    bool readEntry(InflateStream& stream, TarEntry& entry) {
+        std::string longName;
+        std::string longLink;
+        while(true) {
+            TarHeader header {};
+            if(!stream.read(&header, sizeof(header))) {
+                return false;
+            }
+            if(header.name[0] == '\0') {
+                return false;
+            }
+            auto size = getOctal(header.size, sizeof(header.size));
+            if(header.type == 'L' || header.type == 'K') {
+                std::string value(size, '\0');
+                stream.read(value.data(), size);
+                stream.skip((TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+                value.resize(strnlen(value.c_str(), size));
+                (header.type == 'L' ? longName : longLink) = value;
+                continue;
+            }
+            entry.name = longName;
+            if(entry.name.empty()) {
+                auto prefix = fieldString(header.prefix, sizeof(header.prefix));
+                entry.name = (prefix.empty() ? "" : prefix + "/") + fieldString(header.name, sizeof(header.name));
+            }
+            entry.linkTarget = longLink.empty() ? fieldString(header.linkName, sizeof(header.linkName)) : longLink;
+            entry.type = header.type;
+            entry.size = size;
+            entry.mode = getOctal(header.mode, sizeof(header.mode));
+            entry.mtime = getOctal(header.mtime, sizeof(header.mtime));
+            while(!entry.name.empty() && entry.name.back() == '/') {
+                entry.name.pop_back();
+            }
+            return true;
+        }
+    }
+
+    void extractEntry(InflateStream& stream, const TarEntry& entry, int targetFd, ArchiveReport& report,
+                      std::vector<TarEntry>& directories) {
+        auto paddedSize = (entry.size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        if(isUnsafe(entry.name)) {
+            report.errors.push_back(entry.name + ": unsafe path, skipped");
+            stream.skip(paddedSize);
+            return;
+        }
+        std::string leaf;
+        Descriptor parent {openParent(targetFd, entry.name, leaf)};
+        if(parent.fd == -1 || leaf.empty() || leaf == ".") {
+            report.errors.push_back(extractError(entry.name));
+            stream.skip(paddedSize);
+            return;
+        }
+        if(entry.type == '5') {
+            if(mkdirat(parent.fd, leaf.c_str(), 0700) == -1 && errno != EEXIST) {
+                report.errors.push_back(errorText(entry.name));
+            }
+            directories.push_back(entry);
+            report.directories++;
+            stream.skip(paddedSize);
+            return;
+        }
+        if(entry.type == '2') {
+            unlinkat(parent.fd, leaf.c_str(), 0);
+            if(symlinkat(entry.linkTarget.c_str(), parent.fd, leaf.c_str()) == -1) {
+                report.errors.push_back(errorText(entry.name));
+            }
+            report.links++;
+            stream.skip(paddedSize);
+            return;
+        }
+        if(entry.type != '0' && entry.type != '\0') {
+            report.errors.push_back(entry.name + ": unsupported entry type, skipped");
+            stream.skip(paddedSize);
+            return;
+        }
+        // never writes through a symlink, even one this archive has just created
+        int fd = openat(parent.fd, leaf.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if(fd == -1) {
+            report.errors.push_back(errno == ELOOP ? entry.name + ": is a symlink, not written" : errorText(entry.name));
+            stream.skip(paddedSize);
+            return;
+        }
+        char buffer[64 * 1024];
+        uint64_t left = entry.size;
+        while(left > 0) {
+            auto part = std::min<uint64_t>(left, sizeof(buffer));
+            if(!stream.read(buffer, part)) {
+                close(fd);
+                throw std::runtime_error(entry.name + ": archive is truncated");
+            }
+            writeAll(fd, buffer, part, entry.name);
+            left -= part;
+        }
+        stream.skip(paddedSize - entry.size);
+        timespec times[2] = {{entry.mtime, 0}, {entry.mtime, 0}};
+        fchmod(fd, entry.mode & 07777);
+        futimens(fd, times);
+        close(fd);
+        report.files++;
+        report.bytes += entry.size;
+    }
+
+    void restoreDirectories(const std::vector<TarEntry>& directories, int targetFd) {
+        for(auto& entry : directories) {
+            std::string leaf;
+            Descriptor parent {openParent(targetFd, entry.name, leaf)};
+            Descriptor directory {parent.fd == -1 ? -1
+                    : openat(parent.fd, leaf.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)};
+            if(directory.fd == -1) {
+                continue;
+            }
+            timespec times[2] = {{entry.mtime, 0}, {entry.mtime, 0}};
+            fchmod(directory.fd, entry.mode & 07777);
+            futimens(directory.fd, times);
+        }
+    }
+
+    int openTarget(const std::string& target) {
+        mkdir(target.c_str(), 0755);
+        // target itself is given by the user and may be a symlink
+        int fd = open(target.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(fd == -1) {
+            throw std::runtime_error(errorText(target));
+        }
+        return fd;
+    }
+}
+
+void ArchiveIndex::write(const std::string& path) const {
+    std::string buffer(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    auto append = [&buffer](const auto& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    append((uint64_t)checkpoints.size());
+    for(auto& checkpoint : checkpoints) {
+        append(checkpoint.uncompressedOffset);
+        append(checkpoint.compressedOffset);
+    }
+    append((uint64_t)files.size());
+    for(auto& file : files) {
+        append((uint32_t)file.path.size());
+        buffer += file.path;
+        append(file.headerOffset);
+    }
+    auto temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(errorText(temporaryPath));
+    }
+    writeAll(fd, buffer.data(), buffer.size(), temporaryPath);
+    fdatasync(fd);
+    close(fd);
+    if(rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        throw std::runtime_error(errorText(path));
+    }
+}
+
+ArchiveIndex ArchiveIndex::read(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        throw std::runtime_error(errorText(path));
+    }
+    std::string content;
+    char buffer[64 * 1024];
+    ssize_t got;
+    while((got = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, got);
+    }
+    close(fd);
+    size_t position = 0;
+    auto take = [&](void* target, size_t size) {
+        if(content.size() - position < size) {
+            throw std::runtime_error(path + ": damaged archive index");
+        }
+        memcpy(target, content.data() + position, size);
+        position += size;
+    };
+    char magic[4];
+    take(magic, sizeof(magic));
+    if(memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error(path + ": not an archive index");
+    }
+    ArchiveIndex index;
+    uint64_t count;
+    take(&count, sizeof(count));
+    for(uint64_t i = 0; i < count; i++) {
+        Checkpoint checkpoint {};
+        take(&checkpoint.uncompressedOffset, sizeof(uint64_t));
+        take(&checkpoint.compressedOffset, sizeof(uint64_t));
+        index.checkpoints.push_back(checkpoint);
+    }
+    take(&count, sizeof(count));
+    for(uint64_t i = 0; i < count; i++) {
+        File file;
+        uint32_t length;
+        take(&length, sizeof(length));
+        file.path.resize(length);
+        take(file.path.data(), length);
+        take(&file.headerOffset, sizeof(uint64_t));
+        index.files.push_back(std::move(file));
+    }
+    return index;
+}
+
+ArchiveWriter::ArchiveWriter(std::string path, int level, Throttle* throttle, WorkStealingPool& pool)
+        : path(std::move(path)), level(level), throttle(throttle), pool(pool) {}
+
+ArchiveWriter::~ArchiveWriter() {
+    if(fd != -1) {
+        close(fd);
+    }
+}
+
+void ArchiveWriter::writeRaw(const void* data, size_t size) {
+    writeAll(fd, data, size, path);
+    compressedOffset += size;
+}
+
+void ArchiveWriter::compress(Block& block, int level) {
+    block.crc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(block.input.data()), block.input.size());
+    z_stream stream {};
+    if(deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Cannot start compression");
+    }
+    if(!block.dictionary.empty()) {
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(block.dictionary.data()), block.dictionary.size());
+    }
+    // bound plus room for the sync flush marker
+    block.output.resize(deflateBound(&stream, block.input.size()) + 16);
+    stream.next_in = reinterpret_cast<Bytef*>(block.input.data());
+    stream.avail_in = block.input.size();
+    stream.next_out = reinterpret_cast<Bytef*>(block.output.data());
+    stream.avail_out = block.output.size();
+    auto result = deflate(&stream, block.isLast ? Z_FINISH : Z_SYNC_FLUSH);
+    auto produced = block.output.size() - stream.avail_out;
+    deflateEnd(&stream);
+    if(result == Z_STREAM_ERROR || (block.isLast && result != Z_STREAM_END) || stream.avail_in != 0) {
+        throw std::runtime_error("Compression failed");
+    }
+    block.output.resize(produced);
+}
+
+void ArchiveWriter::submitBlock(bool isLast) {
+    auto block = std::move(current);
+    block->isLast = isLast;
+    block->isCheckpoint = blockCount % CHECKPOINT_INTERVAL == 0;
+    block->uncompressedStart = uncompressedOffset;
+    if(!block->isCheckpoint) {
+        block->dictionary = previousTail;
+    }
+    auto& input = block->input;
+    if(input.size() >= WINDOW_SIZE) {
+        previousTail.assign(input, input.size() - WINDOW_SIZE, WINDOW_SIZE);
+    } else {
+        previousTail += input;
+        if(previousTail.size() > WINDOW_SIZE) {
+            previousTail.erase(0, previousTail.size() - WINDOW_SIZE);
+        }
+    }
+    uncompressedOffset += input.size();
+    blockCount++;
+    pending.push_back(block);
+    pool.submit([this, block] {
+        bool isCompressed = true;
+        try {
+            compress(*block, level);
+        } catch(std::exception&) {
+            isCompressed = false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        block->isDone = true;
+        block->isFailed = !isCompressed;
+        blockDone.notify_all();
+    });
+    current = std::make_shared<Block>();
+    current->input.reserve(BLOCK_SIZE);
+    // memory stays bounded, producer waits when too many blocks are in flight
+    writeBlocks(false);
+}
+
+void ArchiveWriter::writeBlocks(bool waitForAll) {
+    auto maxPending = waitForAll ? 0 : 2 * (pool.size() + 1);
+    while(!pending.empty()) {
+        auto block = pending.front();
+        bool isDone;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isDone = block->isDone;
+        }
+        if(!isDone) {
+            if(pending.size() <= maxPending) {
+                return;
+            }
+            if(!pool.runPendingTask()) {
+                std::unique_lock<std::mutex> lock(mutex);
+                blockDone.wait_for(lock, std::chrono::milliseconds(1), [&] { return block->isDone; });
+            }
+            continue;
+        }
+        if(block->isFailed) {
+            throw std::runtime_error(path + ": compression failed");
+        }
+        if(block->isCheckpoint) {
+            index.checkpoints.push_back({block->uncompressedStart, compressedOffset});
+        }
+        crc = crc32_combine(crc, block->crc, block->input.size());
+        writeRaw(block->output.data(), block->output.size());
+        pending.pop_front();
+    }
+}
+
+void ArchiveWriter::put(const void* data, size_t size) {
+    auto bytes = static_cast<const char*>(data);
+    while(size > 0) {
+        auto part = std::min(size, BLOCK_SIZE - current->input.size());
+        current->input.append(bytes, part);
+        bytes += part;
+        size -= part;
+        if(current->input.size() == BLOCK_SIZE) {
+            submitBlock(false);
+        }
+    }
+}
+
+void ArchiveWriter::pad() {
+    static const char zeros[TAR_BLOCK] = {};
+    auto position = uncompressedOffset + current->input.size();
+    auto remainder = position % TAR_BLOCK;
+    if(remainder != 0) {
+        put(zeros, TAR_BLOCK - remainder);
+    }
+}
+
+void ArchiveWriter::addLongName(char type, const std::string& name) {
+    TarHeader header {};
+    strcpy(header.name, "././@LongLink");
+    putOctal(header.mode, sizeof(header.mode), 0644);
+    putOctal(header.uid, sizeof(header.uid), 0);
+    putOctal(header.gid, sizeof(header.gid), 0);
+    putOctal(header.size, sizeof(header.size), name.size() + 1);
+    putOctal(header.mtime, sizeof(header.mtime), 0);
+    header.type = type;
+    memcpy(header.magic, "ustar ", 6);
+    memcpy(header.version, " ", 2);
+    setChecksum(header);
+    put(&header, sizeof(header));
+    put(name.c_str(), name.size() + 1);
+    pad();
+}
+
+void ArchiveWriter::addHeader(const std::string& name, const struct stat& info, char type, const std::string& linkTarget) {
+    TarHeader header {};
+    bool fits = name.size() <= sizeof(header.name);
+    if(!fits && name.size() <= sizeof(header.prefix) + 1 + sizeof(header.name)) {
+        // ustar splits long names at a slash into prefix and name
+        auto slash = name.find('/', name.size() - sizeof(header.name) - 1);
+        if(slash != std::string::npos && slash <= sizeof(header.prefix)) {
+            memcpy(header.prefix, name.data(), slash);
+            memcpy(header.name, name.data() + slash + 1, name.size() - slash - 1);
+            fits = true;
+        }
+    }
+    if(!fits) {
+        addLongName('L', name);
+        memcpy(header.name, name.data(), sizeof(header.name));
+    } else if(header.name[0] == '\0') {
+        memcpy(header.name, name.data(), name.size());
+    }
+    if(linkTarget.size() > sizeof(header.linkName)) {
+        addLongName('K', linkTarget);
+    }
+    memcpy(header.linkName, linkTarget.data(), std::min(linkTarget.size(), sizeof(header.linkName)));
+    putOctal(header.mode, sizeof(header.mode), info.st_mode & 07777);
+    putOctal(header.uid, sizeof(header.uid), info.st_uid);
+    putOctal(header.gid, sizeof(header.gid), info.st_gid);
+    putOctal(header.size, sizeof(header.size), type == '0' ? info.st_size : 0);
+    putOctal(header.mtime, sizeof(header.mtime), info.st_mtim.tv_sec);
+    header.type = type;
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+    setChecksum(header);
+    put(&header, sizeof(header));
+}
+
+void ArchiveWriter::addFileData(const std::string& source, uint64_t size) {
+    if(throttle) {
+        throttle->acquireOperation();
+    }
+    int in = open(source.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if(in == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // reads straight into the block being filled, a block worth of data per read
+    uint64_t left = size;
+    while(left > 0) {
+        auto& input = current->input;
+        auto part = std::min<uint64_t>(left, BLOCK_SIZE - input.size());
+        if(throttle) {
+            part = std::min<uint64_t>(part, throttle->chunkSize());
+            throttle->acquire(part);
+        }
+        auto used = input.size();
+        input.resize(used + part);
+        auto got = read(in, input.data() + used, part);
+        if(got <= 0) {
+            if(got == -1 && errno == EINTR) {
+                input.resize(used);
+                continue;
+            }
+            // file shrank while archived, header already promised size bytes
+            input.resize(used);
+            static const char zeros[64 * 1024] = {};
+            report.errors.push_back(source + ": changed while archived");
+            while(left > 0) {
+                auto zeroPart = std::min<uint64_t>(left, sizeof(zeros));
+                put(zeros, zeroPart);
+                left -= zeroPart;
+            }
+            break;
+        }
+        input.resize(used + got);
+        left -= got;
+        if(input.size() == BLOCK_SIZE) {
+            submitBlock(false);
+        }
+    }
+    close(in);
+    pad();
+}
+
+void ArchiveWriter::addEntry(const std::string& source, const std::string& relative, const struct stat& info) {
+    if(S_ISDIR(info.st_mode)) {
+        addHeader(relative + "/", info, '5', "");
+        report.directories++;
+        addTree(source, relative);
+        return;
+    }
+    if(S_ISLNK(info.st_mode)) {
+        std::string linkTarget(PATH_MAX, '\0');
+        auto length = readlink(source.c_str(), linkTarget.data(), linkTarget.size());
+        if(length == -1) {
+            throw std::runtime_error(errorText(source));
+        }
+        linkTarget.resize(length);
+        addHeader(relative, info, '2', linkTarget);
+        report.links++;
+        return;
+    }
+    if(!S_ISREG(info.st_mode)) {
+        throw std::runtime_error(source + ": special files are not archived");
+    }
+    index.files.push_back({relative, uncompressedOffset + current->input.size()});
+    addHeader(relative, info, '0', "");
+    addFileData(source, info.st_size);
+    report.files++;
+}
+
+void ArchiveWriter::addTree(const std::string& source, const std::string& relative) {
+    DIR* directory = opendir(source.c_str());
+    if(!directory) {
+        report.errors.push_back(errorText(source));
+        return;
+    }
+    // sorted, so the same tree always gives the same archive
+    std::vector<std::string> names;
+    while(auto entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if(name != "." && name != "..") {
+            names.push_back(name);
+        }
+    }
+    closedir(directory);
+    std::sort(names.begin(), names.end());
+    for(auto& name : names) {
+        auto childSource = source + "/" + name;
+        struct stat info {};
+        if(lstat(childSource.c_str(), &info) == -1) {
+            report.errors.push_back(errorText(childSource));
+            continue;
+        }
+        try {
+            addEntry(childSource, relative.empty() ? name : relative + "/" + name, info);
+        } catch(std::exception& e) {
+            report.errors.push_back(e.what());
+        }
+    }
+}
+
+ArchiveReport ArchiveWriter::write(std::string source) {
+    while(source.size() > 1 && source.back() == '/') {
+        source.pop_back();
+    }
+    struct stat info {};
+    if(lstat(source.c_str(), &info) == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    auto temporaryPath = path + ".tmp";
+    fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(errorText(temporaryPath));
+    }
+    // gzip member header: deflate, no flags, no mtime, unix
+    const unsigned char gzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+    writeRaw(gzipHeader, sizeof(gzipHeader));
+    crc = crc32(0, Z_NULL, 0);
+    current = std::make_shared<Block>();
+    current->input.reserve(BLOCK_SIZE);
+
+    try {
+        auto slash = source.find_last_of('/');
+        auto name = slash == std::string::npos ? source : source.substr(slash + 1);
+        addEntry(source, name, info);
+        // end of tar stream
+        static const char zeros[2 * TAR_BLOCK] = {};
+        put(zeros, sizeof(zeros));
+        submitBlock(true);
+        writeBlocks(true);
+    } catch(std::exception&) {
+        writeBlocks(true);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+    unsigned char trailer[8];
+    auto size = (uint32_t)uncompressedOffset;
+    for(int i = 0; i < 4; i++) {
+        trailer[i] = (crc >> (8 * i)) & 0xff;
+        trailer[4 + i] = (size >> (8 * i)) & 0xff;
+    }
+    writeRaw(trailer, sizeof(trailer));
+    if(fdatasync(fd) == -1 || rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        throw std::runtime_error(errorText(path));
+    }
+    index.write(path + ".idx");
+    report.bytes = uncompressedOffset;
+    report.compressedBytes = compressedOffset;
+    return report;
+}
+
+ArchiveReport ArchiveReader::extractAll(const std::string& target) {
+    ArchiveReport report;
+    Descriptor targetDirectory {openTarget(target)};
+    // archive written by ArchiveWriter has a plain 10 byte gzip header
+    InflateStream stream(path, 10);
+    TarEntry entry;
+    std::vector<TarEntry> directories;
+    while(readEntry(stream, entry)) {
+        extractEntry(stream, entry, targetDirectory.fd, report, directories);
+    }
+    restoreDirectories(directories, targetDirectory.fd);
+    return report;
+}
+
+ArchiveReport ArchiveReader::extractFile(const std::string& name, const std::string& target) {
+    auto index = ArchiveIndex::read(path + ".idx");
+    auto file = std::find_if(index.files.begin(), index.files.end(), [&](const ArchiveIndex::File& file) {
+        return file.path == name;
+    });
+    if(file == index.files.end()) {
+        throw std::runtime_error(name + " is not in " + path);
+    }
+    auto checkpoint = std::upper_bound(index.checkpoints.begin(), index.checkpoints.end(), file->headerOffset,
+            [](uint64_t offset, const ArchiveIndex::Checkpoint& checkpoint) {
+        return offset < checkpoint.uncompressedOffset;
+    });
+    if(checkpoint == index.checkpoints.begin()) {
+        throw std::runtime_error(path + ": damaged archive index");
+    }
+    checkpoint--;
+    InflateStream stream(path, checkpoint->compressedOffset);
+    stream.skip(file->headerOffset - checkpoint->uncompressedOffset);
+    ArchiveReport report;
+    Descriptor targetDirectory {openTarget(target)};
+    TarEntry entry;
+    std::vector<TarEntry> directories;
+    if(!readEntry(stream, entry) || entry.name != name) {
+        throw std::runtime_error(path + ": archive does not match its index");
+    }
+    extractEntry(stream, entry, targetDirectory.fd, report, directories);
+    return report;
+}
@@ -0,0 +1,270 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Builtins.h"
+#include "../include/Channel.h"
+#include "../include/Sketch.h"
+#include "../include/TimeSeries.h"
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // closed and drained channel gives its handle back, later calls see it as drained
+    void releaseIfDrained(int handle, Channel& channel) {
+        if(channel.isDrained()) {
+            ChannelRegistry::instance().remove(handle);
+        }
+    }
+
+    void expectArgs(const std::vector<Builtins::Value>& args, size_t min, size_t max, const std::string& name) {
+        if(args.size() < min || args.size() > max) {
+            throw std::runtime_error("Wrong number of arguments in " + name + " call");
+        }
+    }
+
+    std::optional<Builtins::Value> createChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 2, "chan");
+        int capacity = Builtins::intArg(args, 0, "chan");
+        if(capacity <= 0) {
+            throw std::runtime_error("Channel capacity has to be positive");
+        }
+        bool isSpsc = args.size() == 2 && Builtins::stringArg(args, 1, "chan") == "spsc";
+        return ChannelRegistry::instance().add(std::make_shared<Channel>(capacity, isSpsc));
+    }
+
+    std::optional<Builtins::Value> sendToChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, 2, "send");
+        auto channel = ChannelRegistry::instance().find(Builtins::intArg(args, 0, "send"));
+        return (int)(channel && channel->send(args[1]));
+    }
+
+    std::optional<Builtins::Value> sendAllToChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, SIZE_MAX, "send_all");
+        auto channel = ChannelRegistry::instance().find(Builtins::intArg(args, 0, "send_all"));
+        return channel ? (int)channel->sendBatch({args.begin() + 1, args.end()}) : 0;
+    }
+
+    std::optional<Builtins::Value> receiveFromChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "recv");
+        int handle = Builtins::intArg(args, 0, "recv");
+        auto channel = ChannelRegistry::instance().find(handle);
+        Builtins::Value value;
+        if(!channel || !channel->receive(value)) {
+            value = 0;
+        }
+        if(channel) {
+            releaseIfDrained(handle, *channel);
+        }
+        return value;
+    }
+
+    std::optional<Builtins::Value> receiveBatchFromChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, 2, "recv_batch");
+        int handle = Builtins::intArg(args, 0, "recv_batch");
+        auto channel = ChannelRegistry::instance().find(handle);
+        std::vector<Builtins::Value> values;
+        if(channel) {
+            channel->receiveBatch(values, Builtins::intArg(args, 1, "recv_batch"));
+            releaseIfDrained(handle, *channel);
+        }
+        std::string joined;
+        for(auto& value : values) {
+            joined += (joined.empty() ? "" : " ") + Builtins::toString(value);
+        }
+        return Builtins::quoted(joined);
+    }
+
+    std::optional<Builtins::Value> closeChannel(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "close");
+        int handle = Builtins::intArg(args, 0, "close");
+        if(auto channel = ChannelRegistry::instance().find(handle)) {
+            channel->close();
+            releaseIfDrained(handle, *channel);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Builtins::Value> isChannelDrained(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "drained");
+        int handle = Builtins::intArg(args, 0, "drained");
+        auto channel = ChannelRegistry::instance().find(handle);
+        if(channel) {
+            releaseIfDrained(handle, *channel);
+        }
+        return (int)(!channel || channel->isDrained());
+    }
+
+    std::optional<Builtins::Value> createSketch(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 0, 1, "sketch");
+        auto accuracy = args.empty() ? 0.01 : Builtins::numberArg(args, 0, "sketch");
+        return SketchRegistry::instance().add(std::make_shared<QuantileSketch>(accuracy));
+    }
+
+    std::optional<Builtins::Value> createHistogram(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 0, 1, "histogram");
+        auto bits = args.empty() ? 7 : Builtins::intArg(args, 0, "histogram");
+        return SketchRegistry::instance().add(std::make_shared<LogHistogram>(bits));
+    }
+
+    std::optional<Builtins::Value> addToSketch(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, 2, "sketch_add");
+        auto sketch = SketchRegistry::instance().get(Builtins::intArg(args, 0, "sketch_add"));
+        sketch->add(Builtins::numberArg(args, 1, "sketch_add"));
+        return std::nullopt;
+    }
+
+    std::optional<Builtins::Value> sketchQuantile(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, 2, "quantile");
+        auto sketch = SketchRegistry::instance().get(Builtins::intArg(args, 0, "quantile"));
+        return sketch->quantile(Builtins::numberArg(args, 1, "quantile"));
+    }
+
+    std::optional<Builtins::Value> sketchCount(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "sketch_count");
+        return (int)SketchRegistry::instance().get(Builtins::intArg(args, 0, "sketch_count"))->count();
+    }
+
+    std::optional<Builtins::Value> mergeSketches(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 2, 2, "sketch_merge");
+        auto sketch = SketchRegistry::instance().get(Builtins::intArg(args, 0, "sketch_merge"));
+        sketch->merge(*SketchRegistry::instance().get(Builtins::intArg(args, 1, "sketch_merge")));
+        return std::nullopt;
+    }
+
+    std::optional<Builtins::Value> saveSketch(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "sketch_save");
+        return Builtins::quoted(SketchRegistry::instance().get(Builtins::intArg(args, 0, "sketch_save"))->serialize());
+    }
+
+    std::optional<Builtins::Value> loadSketch(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "sketch_load");
+        std::shared_ptr<Sketch> sketch = Sketch::deserialize(Builtins::stringArg(args, 0, "sketch_load"));
+        return SketchRegistry::instance().add(sketch);
+    }
+
+    // sketches are not drained like channels, script gives the handle back when it is done with it
+    std::optional<Builtins::Value> freeSketch(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 1, 1, "sketch_free");
+        int handle = Builtins::intArg(args, 0, "sketch_free");
+        SketchRegistry::instance().get(handle);
+        SketchRegistry::instance().remove(handle);
+        return std::nullopt;
+    }
+
+    // samples of series from history file within last seconds, optionally ending given seconds ago
+    TimeSeries::Aggregate historyWindow(std::vector<Builtins::Value>& args, const std::string& name) {
+        expectArgs(args, 3, 4, name);
+        auto seconds = Builtins::numberArg(args, 2, name);
+        auto ago = args.size() == 4 ? Builtins::numberArg(args, 3, name) : 0;
+        auto to = TimeSeries::now() - (int64_t)(ago * 1000);
+        auto series = TimeSeries::open(Builtins::stringArg(args, 0, name));
+        return series->aggregate(Builtins::stringArg(args, 1, name), to - (int64_t)(seconds * 1000), to);
+    }
+
+    std::optional<Builtins::Value> historyCount(std::vector<Builtins::Value>& args) {
+        return (int)historyWindow(args, "ts_count").count;
+    }
+
+    // empty window gives 0, ts_count tells it apart
+    std::optional<Builtins::Value> historyMin(std::vector<Builtins::Value>& args) {
+        auto window = historyWindow(args, "ts_min");
+        return window.count == 0 ? 0.0 : window.min;
+    }
+
+    std::optional<Builtins::Value> historyMax(std::vector<Builtins::Value>& args) {
+        auto window = historyWindow(args, "ts_max");
+        return window.count == 0 ? 0.0 : window.max;
+    }
+
+    std::optional<Builtins::Value> historyAverage(std::vector<Builtins::Value>& args) {
+        auto window = historyWindow(args, "ts_avg");
+        return window.count == 0 ? 0.0 : window.sum / window.count;
+    }
+
+    std::optional<Builtins::Value> historyValues(std::vector<Builtins::Value>& args) {
+        expectArgs(args, 3, 3, "ts_values");
+        auto to = TimeSeries::now();
+        auto from = to - (int64_t)(Builtins::numberArg(args, 2, "ts_values") * 1000);
+        std::string joined;
+        TimeSeries::open(Builtins::stringArg(args, 0, "ts_values"))->scan(
+                Builtins::stringArg(args, 1, "ts_values"), from, to, [&joined](int64_t, double value) {
+                    joined += (joined.empty() ? "" : " ") + Builtins::toString(value);
+                });
+        return Builtins::quoted(joined);
+    }
+
+    const std::map<std::string, Builtins::Function> functions {
+            {"chan", createChannel},
+            {"send", sendToChannel},
+            {"send_all", sendAllToChannel},
+            {"recv", receiveFromChannel},
+            {"recv_batch", receiveBatchFromChannel},
+            {"close", closeChannel},
+            {"drained", isChannelDrained},
+            {"sketch", createSketch},
+            {"histogram", createHistogram},
+            {"sketch_add", addToSketch},
+            {"quantile", sketchQuantile},
+            {"sketch_count", sketchCount},
+            {"sketch_merge", mergeSketches},
+            {"sketch_save", saveSketch},
+            {"sketch_load", loadSketch},
+            {"sketch_free", freeSketch},
+            {"ts_count", historyCount},
+            {"ts_min", historyMin},
+            {"ts_max", historyMax},
+            {"ts_avg", historyAverage},
+            {"ts_values", historyValues},
+    };
+}
+
+const Builtins::Function* Builtins::find(const std::string& name) {
+    auto function = functions.find(name);
+    return function == functions.end() ? nullptr : &function->second;
+}
+
+int Builtins::intArg(const std::vector<Value>& args, size_t index, const std::string& name) {
+    if(const auto value (std::get_if<int>(&args.at(index))); value) {
+        return *value;
+    }
+    throw std::runtime_error("Arg mismatch in function " + name + " call.");
+}
+
+double Builtins::numberArg(const std::vector<Value>& args, size_t index, const std::string& name) {
+    if(const auto value (std::get_if<int>(&args.at(index))); value) {
+        return *value;
+    }
+    if(const auto value (std::get_if<double>(&args.at(index))); value) {
+        return *value;
+    }
+    throw std::runtime_error("Arg mismatch in function " + name + " call.");
+}
+
+std::string Builtins::stringArg(const std::vector<Value>& args, size_t index, const std::string& name) {
+    if(const auto value (std::get_if<std::string>(&args.at(index))); value && value->size() >= 2) {
+        return value->substr(1, value->size() - 2);
+    }
+    throw std::runtime_error("Arg mismatch in function " + name + " call.");
+}
+
+Builtins::Value Builtins::quoted(const std::string& value) {
+    return "\"" + value + "\"";
+}
+
+std::string Builtins::toString(const Value& value) {
+    if(const auto valueToInt (std::get_if<int>(&value)); valueToInt) {
+        return std::to_string(*valueToInt);
+    }
+    if(const auto valueToDouble (std::get_if<double>(&value)); valueToDouble) {
+        std::ostringstream out;
+        out << *valueToDouble;
+        return out.str();
+    }
+    auto text = std::get<std::string>(value);
+    if(text.size() >= 2 && text.front() == '"') {
+        return text.substr(1, text.size() - 2);
+    }
+    return text;
+}
@@ -0,0 +1,131 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Channel.h"
+#include "../include/WorkStealingPool.h"
+#include <chrono>
+
+Channel::Channel(size_t capacity, bool singleProducerSingleConsumer) {
+    if(capacity == 0) {
+        capacity = 1;
+    }
+    if(singleProducerSingleConsumer) {
+        spscRing = std::make_unique<SpscRing<Value>>(capacity);
+    } else {
+        mpmcRing = std::make_unique<MpmcRing<Value>>(capacity);
+    }
+}
+
+bool Channel::tryPush(Value& value) {
+    return spscRing ? spscRing->tryPush(value) : mpmcRing->tryPush(value);
+}
+
+bool Channel::tryPop(Value& value) {
+    return spscRing ? spscRing->tryPop(value) : mpmcRing->tryPop(value);
+}
+
+bool Channel::empty() const {
+    return spscRing ? spscRing->empty() : mpmcRing->empty();
+}
+
+bool Channel::full() const {
+    return spscRing ? spscRing->full() : mpmcRing->full();
+}
+
+void Channel::wake(std::atomic<int>& parked, std::condition_variable& condition) {
+    // pairs with increment in park(), either we see the parked side or it sees our value
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(parked.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(parkingMutex);
+        condition.notify_all();
+    }
+}
+
+template<typename Predicate>
+void Channel::park(std::atomic<int>& parked, std::condition_variable& condition, Predicate isReady) {
+    // running a queued task here could run our own counterpart on top of us, it would block
+    // on this frame forever; pool gives the queued tasks a spare thread instead
+    auto& pool = WorkStealingPool::instance();
+    pool.beginBlocking();
+    parked.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(parkingMutex);
+        condition.wait_for(lock, std::chrono::milliseconds(10), isReady);
+    }
+    parked.fetch_sub(1, std::memory_order_seq_cst);
+    pool.endBlocking();
+}
+
+bool Channel::send(Value value) {
+    while(!closed.load(std::memory_order_acquire)) {
+        if(tryPush(value)) {
+            wake(parkedReceivers, receiversCondition);
+            return true;
+        }
+        park(parkedSenders, sendersCondition, [&] { return !full() || closed.load(); });
+    }
+    return false;
+}
+
+size_t Channel::sendBatch(std::vector<Value> values) {
+    size_t sent = 0;
+    while(sent < values.size() && !closed.load(std::memory_order_acquire)) {
+        size_t sentBefore = sent;
+        while(sent < values.size() && tryPush(values[sent])) {
+            sent++;
+        }
+        if(sent != sentBefore) {
+            wake(parkedReceivers, receiversCondition);
+        }
+        if(sent < values.size()) {
+            park(parkedSenders, sendersCondition, [&] { return !full() || closed.load(); });
+        }
+    }
+    return sent;
+}
+
+bool Channel::receive(Value& value) {
+    while(true) {
+        if(tryPop(value)) {
+            wake(parkedSenders, sendersCondition);
+            return true;
+        }
+        if(closed.load(std::memory_order_acquire)) {
+            // value could be pushed just before close
+            return tryPop(value);
+        }
+        park(parkedReceivers, receiversCondition, [&] { return !empty() || closed.load(); });
+    }
+}
+
+size_t Channel::receiveBatch(std::vector<Value>& values, size_t maxCount) {
+    size_t received = 0;
+    Value value;
+    while(received == 0 && maxCount > 0) {
+        while(received < maxCount && tryPop(value)) {
+            values.push_back(std::move(value));
+            received++;
+        }
+        if(received != 0) {
+            wake(parkedSenders, sendersCondition);
+            break;
+        }
+        if(closed.load(std::memory_order_acquire) && empty()) {
+            break;
+        }
+        park(parkedReceivers, receiversCondition, [&] { return !empty() || closed.load(); });
+    }
+    return received;
+}
+
+void Channel::close() {
+    closed.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(parkingMutex);
+    receiversCondition.notify_all();
+    sendersCondition.notify_all();
+}
+
+bool Channel::isDrained() const {
+    return closed.load(std::memory_order_acquire) && empty();
+}
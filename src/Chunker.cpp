@@ -0,0 +1,62 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Chunker.h"
+#include <array>
+
+namespace {
+    // masks from FastCDC paper for 8 KiB average, 15 and 11 bits spread over the word
+    const uint64_t MASK_SMALL = 0x0003590703530000ULL;
+    const uint64_t MASK_LARGE = 0x0000d90003530000ULL;
+
+    // fixed seed, cut points and so chunk ids have to be the same in every run
+    std::array<uint64_t, 256> makeGearTable() {
+        std::array<uint64_t, 256> table {};
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for(auto& value : table) {
+            state += 0x9E3779B97F4A7C15ULL;
+            uint64_t mixed = state;
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+            value = mixed ^ (mixed >> 31);
+        }
+        return table;
+    }
+
+    const std::array<uint64_t, 256> GEAR = makeGearTable();
+}
+
+size_t Chunker::cut(const unsigned char* data, size_t size) {
+    if(size <= MIN_SIZE) {
+        return size;
+    }
+    if(size > MAX_SIZE) {
+        size = MAX_SIZE;
+    }
+    auto normalSize = size < AVERAGE_SIZE ? size : AVERAGE_SIZE;
+    uint64_t fingerprint = 0;
+    size_t i = MIN_SIZE;
+    for(; i < normalSize; i++) {
+        fingerprint = (fingerprint << 1) + GEAR[data[i]];
+        if(!(fingerprint & MASK_SMALL)) {
+            return i;
+        }
+    }
+    for(; i < size; i++) {
+        fingerprint = (fingerprint << 1) + GEAR[data[i]];
+        if(!(fingerprint & MASK_LARGE)) {
+            return i;
+        }
+    }
+    return size;
+}
+
+void Chunker::split(const unsigned char* data, size_t size, const std::function<void(size_t, size_t)>& onChunk) {
+    size_t offset = 0;
+    while(offset < size) {
+        auto length = cut(data + offset, size - offset);
+        onChunk(offset, length);
+        offset += length;
+    }
+}
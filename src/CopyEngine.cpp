@@ -0,0 +1,338 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/CopyEngine.h"
+#include "../include/Hash.h"
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/sendfile.h>
+#include <climits>
+#include <unistd.h>
+
+namespace {
+    // files copied by one task, large enough to amortize scheduling of tiny files
+    const size_t BATCH_SIZE = 64;
+
+    std::string errorText(const std::string& path) {
+        return path + ": " + strerror(errno);
+    }
+
+    // closes descriptor on every path out of copyFile
+    struct FileDescriptor {
+        int fd;
+        explicit FileDescriptor(int fd) : fd(fd) {}
+        ~FileDescriptor() {
+            if(fd != -1) {
+                close(fd);
+            }
+        }
+    };
+
+    bool isUnsupported(int error) {
+        return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP;
+    }
+
+    // every call moves at most one throttle chunk, paid for before it is issued
+    size_t nextPiece(Throttle* throttle, size_t left) {
+        if(!throttle) {
+            return left;
+        }
+        auto piece = std::min(left, throttle->chunkSize());
+        throttle->acquire(piece);
+        return piece;
+    }
+
+    size_t copyData(int in, int out, size_t size, const std::string& path, Throttle* throttle, Hasher* hasher) {
+        size_t copied = 0;
+        // data copied in kernel is never seen, hashed one is read and written here
+        bool isSupported = hasher == nullptr;
+        while(isSupported && copied < size) {
+            auto moved = copy_file_range(in, nullptr, out, nullptr, nextPiece(throttle, size - copied), 0);
+            if(moved > 0) {
+                copied += moved;
+            } else if(moved == 0) {
+                break;
+            } else if(isUnsupported(errno)) {
+                isSupported = false;
+            } else if(errno != EINTR) {
+                throw std::runtime_error(errorText(path));
+            }
+        }
+        if(!isSupported && !hasher) {
+            isSupported = true;
+            while(isSupported && copied < size) {
+                auto moved = sendfile(out, in, nullptr, nextPiece(throttle, size - copied));
+                if(moved > 0) {
+                    copied += moved;
+                } else if(moved == 0) {
+                    break;
+                } else if(isUnsupported(errno)) {
+                    isSupported = false;
+                } else if(errno != EINTR) {
+                    throw std::runtime_error(errorText(path));
+                }
+            }
+        }
+        // also files reporting no size, like the ones in /proc
+        if(copied < size || size == 0) {
+            char buffer[64 * 1024];
+            while(true) {
+                auto got = read(in, buffer, nextPiece(throttle, sizeof(buffer)));
+                if(got == 0) {
+                    break;
+                }
+                if(got == -1) {
+                    if(errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(errorText(path));
+                }
+                if(hasher) {
+                    hasher->update(buffer, got);
+                }
+                for(ssize_t written = 0; written < got;) {
+                    auto put = write(out, buffer + written, got - written);
+                    if(put == -1) {
+                        if(errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error(errorText(path));
+                    }
+                    written += put;
+                }
+                copied += got;
+            }
+        }
+        return copied;
+    }
+
+    std::string baseName(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+size_t CopyEngine::copyFile(const std::string& source, const std::string& target, Throttle* throttle, Hasher* hasher) {
+    if(throttle) {
+        throttle->acquireOperation();
+    }
+    FileDescriptor in(open(source.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    if(in.fd == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    struct stat info {};
+    if(fstat(in.fd, &info) == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    FileDescriptor out(open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+    if(out.fd == -1) {
+        throw std::runtime_error(errorText(target));
+    }
+    auto copied = copyData(in.fd, out.fd, info.st_size, source, throttle, hasher);
+    timespec times[2] = {info.st_atim, info.st_mtim};
+    if(fchmod(out.fd, info.st_mode & 07777) == -1 || futimens(out.fd, times) == -1) {
+        throw std::runtime_error(errorText(target));
+    }
+    return copied;
+}
+
+CopyReport CopyEngine::copy(std::string source, std::string target) {
+    while(source.size() > 1 && source.back() == '/') {
+        source.pop_back();
+    }
+    struct stat targetInfo {};
+    if(stat(target.c_str(), &targetInfo) == 0 && S_ISDIR(targetInfo.st_mode)) {
+        target += "/" + baseName(source);
+    }
+    return mirror(source, target);
+}
+
+CopyReport CopyEngine::mirror(std::string source, std::string target) {
+    while(source.size() > 1 && source.back() == '/') {
+        source.pop_back();
+    }
+    struct stat info {};
+    if(lstat(source.c_str(), &info) == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    sourcePrefixLength = source.size() + 1;
+
+    TaskGroup group(pool);
+    if(S_ISDIR(info.st_mode)) {
+        if(mkdir(target.c_str(), 0700) == -1 && errno != EEXIST) {
+            throw std::runtime_error(errorText(target));
+        }
+        struct stat targetInfo {};
+        if(stat(target.c_str(), &targetInfo) == -1) {
+            throw std::runtime_error(errorText(target));
+        }
+        targetDevice = targetInfo.st_dev;
+        targetInode = targetInfo.st_ino;
+        copyDirectory(group, source, target);
+    } else {
+        // relative path of a single file is its name
+        auto slash = source.find_last_of('/');
+        sourcePrefixLength = slash == std::string::npos ? 0 : slash + 1;
+        copyEntry(Entry {source, target, DT_UNKNOWN});
+    }
+    group.wait();
+
+    // parents keep the times of their children changes otherwise
+    for(auto& directory : copiedDirectories) {
+        if(chmod(directory.path.c_str(), directory.mode & 07777) == -1
+           || utimensat(AT_FDCWD, directory.path.c_str(), directory.times, 0) == -1) {
+            fail(errorText(directory.path));
+        }
+    }
+
+    CopyReport report;
+    report.files = files.load();
+    report.skipped = skipped.load();
+    report.directories = directories.load();
+    report.links = links.load();
+    report.bytes = bytes.load();
+    report.errors = std::move(errors);
+    return report;
+}
+
+void CopyEngine::copyDirectory(TaskGroup& group, std::string source, std::string target) {
+    int sourceFd = open(source.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+    if(sourceFd == -1) {
+        fail(errorText(source));
+        return;
+    }
+    struct stat info {};
+    fstat(sourceFd, &info);
+    if(info.st_dev == targetDevice && info.st_ino == targetInode) {
+        close(sourceFd);
+        return;
+    }
+    if(mkdir(target.c_str(), 0700) == -1 && errno != EEXIST) {
+        fail(errorText(target));
+        close(sourceFd);
+        return;
+    }
+    directories.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        copiedDirectories.push_back({target, info.st_mode, {info.st_atim, info.st_mtim}});
+    }
+
+    DIR* directory = fdopendir(sourceFd);
+    if(!directory) {
+        fail(errorText(source));
+        close(sourceFd);
+        return;
+    }
+    std::vector<Entry> batch;
+    while(auto entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if(name == "." || name == "..") {
+            continue;
+        }
+        auto type = entry->d_type;
+        if(type == DT_UNKNOWN) {
+            struct stat entryInfo {};
+            if(fstatat(sourceFd, entry->d_name, &entryInfo, AT_SYMLINK_NOFOLLOW) == -1) {
+                fail(errorText(source + "/" + name));
+                continue;
+            }
+            type = IFTODT(entryInfo.st_mode);
+        }
+        if(type == DT_DIR) {
+            group.run([this, &group, source = source + "/" + name, target = target + "/" + name] {
+                copyDirectory(group, source, target);
+            });
+            continue;
+        }
+        batch.push_back({source + "/" + name, target + "/" + name, type});
+        if(batch.size() == BATCH_SIZE) {
+            group.run([this, batch = std::move(batch)]() mutable { copyEntries(std::move(batch)); });
+            batch.clear();
+        }
+    }
+    closedir(directory);
+    // last files are copied by this task, it has nothing else to do
+    copyEntries(std::move(batch));
+}
+
+void CopyEngine::copyEntries(std::vector<Entry> entries) {
+    for(auto& entry : entries) {
+        try {
+            copyEntry(entry);
+        } catch(std::exception& e) {
+            fail(e.what());
+        }
+    }
+}
+
+void CopyEngine::copyRegularFile(const Entry& entry) {
+    if(!shouldCopy && !onCopied) {
+        bytes.fetch_add(copyFile(entry.source, entry.target, throttle), std::memory_order_relaxed);
+        files.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // hooks need metadata, plain copy gets it from the opened file
+    struct stat info {};
+    if(lstat(entry.source.c_str(), &info) == -1) {
+        throw std::runtime_error(errorText(entry.source));
+    }
+    auto relativePath = entry.source.substr(sourcePrefixLength);
+    if(shouldCopy && !shouldCopy(relativePath, info)) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Hasher hasher;
+    bytes.fetch_add(copyFile(entry.source, entry.target, throttle, isHashed ? &hasher : nullptr),
+                    std::memory_order_relaxed);
+    files.fetch_add(1, std::memory_order_relaxed);
+    if(onCopied) {
+        onCopied(relativePath, info, isHashed ? hasher.digest() : 0);
+    }
+}
+
+void CopyEngine::copyEntry(const Entry& entry) {
+    if(entry.type == DT_REG) {
+        copyRegularFile(entry);
+        return;
+    }
+    struct stat info {};
+    if(lstat(entry.source.c_str(), &info) == -1) {
+        throw std::runtime_error(errorText(entry.source));
+    }
+    if(S_ISREG(info.st_mode)) {
+        copyRegularFile(entry);
+        return;
+    }
+    if(S_ISLNK(info.st_mode)) {
+        std::string linkTarget(info.st_size > 0 ? info.st_size : PATH_MAX, '\0');
+        auto length = readlink(entry.source.c_str(), linkTarget.data(), linkTarget.size());
+        if(length == -1) {
+            throw std::runtime_error(errorText(entry.source));
+        }
+        linkTarget.resize(length);
+        unlink(entry.target.c_str());
+        if(symlink(linkTarget.c_str(), entry.target.c_str()) == -1) {
+            throw std::runtime_error(errorText(entry.target));
+        }
+        timespec times[2] = {info.st_atim, info.st_mtim};
+        utimensat(AT_FDCWD, entry.target.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        links.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // fifos, sockets and devices are recreated like cp -R does
+    unlink(entry.target.c_str());
+    if(mknod(entry.target.c_str(), info.st_mode, info.st_rdev) == -1) {
+        throw std::runtime_error(errorText(entry.target));
+    }
+    files.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CopyEngine::fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.push_back(message);
+}
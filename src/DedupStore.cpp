@@ -0,0 +1,820 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/DedupStore.h"
+#include "../include/Chunker.h"
+#include "../include/Hash.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char SNAPSHOT_MAGIC[4] = {'T', 'K', 'S', 'N'};
+    // version 2 records the pack number of its run, an ordering independent of names and clocks
+    const uint32_t SNAPSHOT_VERSION = 2;
+    // large files are chunked in independent segments of this size, in parallel
+    const size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+    // file data is read into a window of this size, chunked and read on
+    const size_t WINDOW_SIZE = 4 * 1024 * 1024;
+    const size_t BATCH_SIZE = 64;
+
+    std::string errorText(const std::string& path) {
+        return path + ": " + strerror(errno);
+    }
+
+    void writeAll(int fd, const void* data, size_t size, const std::string& path) {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = write(fd, bytes, size);
+            if(written == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(errorText(path));
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    template<typename T>
+    void append(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    // bounds checked reading of a snapshot file
+    struct Reader {
+        const std::string& data;
+        size_t position {0};
+
+        template<typename T>
+        T read() {
+            T value;
+            take(&value, sizeof(value));
+            return value;
+        }
+        std::string readString() {
+            auto length = read<uint32_t>();
+            std::string value(length, '\0');
+            take(value.data(), length);
+            return value;
+        }
+        void take(void* target, size_t size) {
+            if(data.size() - position < size) {
+                throw std::runtime_error("Damaged snapshot");
+            }
+            memcpy(target, data.data() + position, size);
+            position += size;
+        }
+    };
+
+    // shared by segment tasks of one file, each reads its range with pread
+    struct OpenFile {
+        int fd {-1};
+        size_t size {0};
+        ~OpenFile() {
+            if(fd != -1) {
+                close(fd);
+            }
+        }
+    };
+
+    // pack number (0 before version 2) and mtime of a snapshot file
+    std::tuple<uint32_t, int64_t, long> snapshotOrder(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd == -1) {
+            return {0, 0, 0};
+        }
+        struct stat info {};
+        fstat(fd, &info);
+        char header[sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(uint32_t)];
+        uint32_t version = 0;
+        uint32_t pack = 0;
+        if(pread(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header)
+           && memcmp(header, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0) {
+            memcpy(&version, header + sizeof(SNAPSHOT_MAGIC), sizeof(version));
+            memcpy(&pack, header + sizeof(SNAPSHOT_MAGIC) + sizeof(version), sizeof(pack));
+        }
+        close(fd);
+        return {version == SNAPSHOT_VERSION ? pack : 0, info.st_mtim.tv_sec, info.st_mtim.tv_nsec};
+    }
+
+    std::string readWholeFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd == -1) {
+            throw std::runtime_error(errorText(path));
+        }
+        std::string content;
+        char buffer[64 * 1024];
+        ssize_t got;
+        while((got = read(fd, buffer, sizeof(buffer))) != 0) {
+            if(got == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                close(fd);
+                throw std::runtime_error(errorText(path));
+            }
+            content.append(buffer, got);
+        }
+        close(fd);
+        return content;
+    }
+
+    struct Descriptor {
+        int fd {-1};
+        ~Descriptor() {
+            if(fd != -1) {
+                close(fd);
+            }
+        }
+    };
+
+    // absolute paths and .. components could write outside of target
+    bool isUnsafe(const std::string& path) {
+        if(path.empty() || path[0] == '/') {
+            return true;
+        }
+        size_t begin = 0;
+        while(begin <= path.size()) {
+            auto end = path.find('/', begin);
+            if(end == std::string::npos) {
+                end = path.size();
+            }
+            if(path.compare(begin, end - begin, "..") == 0) {
+                return true;
+            }
+            begin = end + 1;
+        }
+        return false;
+    }
+
+    /*
+     * Opens directory holding path below target, as archive extraction does. Every component is
+     * opened with O_NOFOLLOW relative to the previous one, so a symlink already in target or
+     * restored from the snapshot cannot redirect entries outside of it. Returns -1 with errno set,
+     * leaf gets the last component.
+     */
+    int openParent(int targetFd, const std::string& path, std::string& leaf) {
+        int directoryFd = dup(targetFd);
+        size_t begin = 0;
+        while(directoryFd != -1) {
+            auto end = path.find('/', begin);
+            if(end == std::string::npos) {
+                leaf = path.substr(begin);
+                return directoryFd;
+            }
+            auto component = path.substr(begin, end - begin);
+            begin = end + 1;
+            if(component.empty() || component == ".") {
+                continue;
+            }
+            int next = openat(directoryFd, component.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if(next == -1 && errno == ENOENT && mkdirat(directoryFd, component.c_str(), 0755) == 0) {
+                next = openat(directoryFd, component.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            }
+            auto error = errno;
+            close(directoryFd);
+            directoryFd = next;
+            errno = error;
+        }
+        return -1;
+    }
+
+    std::string restoreError(const std::string& path) {
+        if(errno == ELOOP || errno == ENOTDIR) {
+            return path + ": path goes through a symlink, skipped";
+        }
+        return errorText(path);
+    }
+
+    void syncDirectory(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+}
+
+ChunkId ChunkId::of(const void* data, size_t size) {
+    return ChunkId {Hasher::hash(data, size, 0), Hasher::hash(data, size, 0x9E3779B97F4A7C15ULL)};
+}
+
+DedupStore::DedupStore(std::string root, Throttle* throttle, WorkStealingPool& pool)
+        : root(std::move(root)), throttle(throttle), pool(pool) {
+    while(this->root.size() > 1 && this->root.back() == '/') {
+        this->root.pop_back();
+    }
+}
+
+DedupStore::~DedupStore() {
+    if(packFd != -1) {
+        close(packFd);
+    }
+}
+
+void DedupStore::fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.push_back(message);
+}
+
+void DedupStore::loadIndex() {
+    auto path = root + "/chunks.idx";
+    if(access(path.c_str(), F_OK) == -1) {
+        return;
+    }
+    auto content = readWholeFile(path);
+    // record is id (16 bytes), pack, length and offset
+    const size_t recordSize = 32;
+    for(size_t position = 0; position + recordSize <= content.size(); position += recordSize) {
+        ChunkId id;
+        ChunkLocation location {};
+        memcpy(&id.high, content.data() + position, 8);
+        memcpy(&id.low, content.data() + position + 8, 8);
+        memcpy(&location.pack, content.data() + position + 16, 4);
+        memcpy(&location.length, content.data() + position + 20, 4);
+        memcpy(&location.offset, content.data() + position + 24, 8);
+        shardOf(id).chunks.emplace(id, location);
+        packNumber = std::max(packNumber, location.pack);
+    }
+}
+
+void DedupStore::openPack() {
+    char name[32];
+    while(true) {
+        packNumber++;
+        snprintf(name, sizeof(name), "/packs/%06u.pack", packNumber);
+        packFd = open((root + name).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if(packFd != -1) {
+            return;
+        }
+        if(errno != EEXIST) {
+            throw std::runtime_error(errorText(root + name));
+        }
+    }
+}
+
+void DedupStore::storeChunk(const ChunkId& id, const unsigned char* data, size_t length) {
+    chunkCount.fetch_add(1, std::memory_order_relaxed);
+    ChunkLocation location {};
+    {
+        auto& shard = shardOf(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if(shard.chunks.find(id) != shard.chunks.end()) {
+            return;
+        }
+        location = ChunkLocation {packNumber, (uint32_t)length, packEnd.fetch_add(length, std::memory_order_relaxed)};
+        shard.chunks.emplace(id, location);
+    }
+    // space is reserved, writers do not wait for each other
+    size_t written = 0;
+    while(written < length) {
+        auto put = pwrite(packFd, data + written, length - written, location.offset + written);
+        if(put == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            auto error = errorText(root + "/packs");
+            // later files must not dedup against bytes never written, files which already did
+            // refer to a lost chunk, so the snapshot is not recorded
+            {
+                auto& shard = shardOf(id);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.chunks.erase(id);
+            }
+            isChunkLost = true;
+            throw std::runtime_error(error);
+        }
+        written += put;
+    }
+    storedBytes.fetch_add(length, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(newChunksMutex);
+    newChunks.emplace_back(id, location);
+}
+
+void DedupStore::storeFile(TaskGroup& group, std::string source, std::string relative, struct stat info) {
+    SnapshotEntry entry;
+    entry.path = relative;
+    entry.mode = info.st_mode;
+    entry.mtimeSeconds = info.st_mtim.tv_sec;
+    entry.mtimeNanoseconds = info.st_mtim.tv_nsec;
+    entry.size = info.st_size;
+    if(info.st_size == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(entry));
+        return;
+    }
+    if(throttle) {
+        throttle->acquireOperation();
+    }
+    int fd = open(source.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if(fd == -1) {
+        throw std::runtime_error(errorText(source));
+    }
+    auto file = std::make_shared<OpenFile>();
+    file->fd = fd;
+    file->size = info.st_size;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    /*
+     * Read with pread instead of mapping, a file truncated while it is stored gives a short
+     * read and an error instead of SIGBUS. Only the tail shorter than MAX_SIZE is kept over
+     * to the next read, Chunker::cut looks no further, so cut points are the same as over
+     * the whole segment at once.
+     */
+    auto storeSegment = [this, file, source](size_t begin, size_t end, std::vector<ChunkId>& chunks) {
+        std::vector<unsigned char> window(std::min(WINDOW_SIZE, end - begin));
+        size_t filled = 0;
+        size_t position = begin;
+        while(true) {
+            while(filled < window.size() && position < end) {
+                auto want = std::min(window.size() - filled, end - position);
+                if(throttle) {
+                    want = std::min(want, throttle->chunkSize());
+                    throttle->acquire(want);
+                }
+                auto got = pread(file->fd, window.data() + filled, want, position);
+                if(got == -1 && errno == EINTR) {
+                    continue;
+                }
+                if(got == -1) {
+                    throw std::runtime_error(errorText(source));
+                }
+                if(got == 0) {
+                    throw std::runtime_error(source + ": file shrank while it was stored");
+                }
+                filled += got;
+                position += got;
+            }
+            bool isLast = position == end;
+            size_t offset = 0;
+            while(offset < filled && (isLast || filled - offset >= Chunker::MAX_SIZE)) {
+                auto length = Chunker::cut(window.data() + offset, filled - offset);
+                auto id = ChunkId::of(window.data() + offset, length);
+                storeChunk(id, window.data() + offset, length);
+                chunks.push_back(id);
+                offset += length;
+            }
+            if(isLast) {
+                return;
+            }
+            memmove(window.data(), window.data() + offset, filled - offset);
+            filled -= offset;
+        }
+    };
+    if(file->size <= SEGMENT_SIZE) {
+        storeSegment(0, file->size, entry.chunks);
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(entry));
+        return;
+    }
+
+    // segments are stored in parallel, the last one to finish assembles the entry
+    struct Segments {
+        SnapshotEntry entry;
+        std::vector<std::vector<ChunkId>> chunks;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> isFailed {false};
+    };
+    auto segmentCount = (file->size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+    auto segments = std::make_shared<Segments>();
+    segments->entry = std::move(entry);
+    segments->chunks.resize(segmentCount);
+    segments->remaining = segmentCount;
+    for(size_t segment = 0; segment < segmentCount; segment++) {
+        group.run([this, file, segments, segment, storeSegment, source] {
+            try {
+                auto begin = segment * SEGMENT_SIZE;
+                storeSegment(begin, std::min(begin + SEGMENT_SIZE, file->size), segments->chunks[segment]);
+            } catch(std::exception& e) {
+                segments->isFailed = true;
+                fail(e.what());
+            }
+            if(segments->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1 || segments->isFailed) {
+                return;
+            }
+            for(auto& chunks : segments->chunks) {
+                segments->entry.chunks.insert(segments->entry.chunks.end(), chunks.begin(), chunks.end());
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.push_back(std::move(segments->entry));
+        });
+    }
+}
+
+void DedupStore::walk(TaskGroup& group, std::string source, std::string relative) {
+    auto path = relative.empty() ? source : source + "/" + relative;
+    DIR* directory = opendir(path.c_str());
+    if(!directory) {
+        fail(errorText(path));
+        return;
+    }
+    std::vector<std::pair<std::string, struct stat>> batch;
+    auto flush = [&] {
+        group.run([this, &group, source, batch = std::move(batch)] {
+            for(auto& [file, info] : batch) {
+                try {
+                    storeFile(group, source + "/" + file, file, info);
+                } catch(std::exception& e) {
+                    fail(e.what());
+                }
+            }
+        });
+        batch.clear();
+    };
+    while(auto entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if(name == "." || name == "..") {
+            continue;
+        }
+        auto childRelative = relative.empty() ? name : relative + "/" + name;
+        struct stat info {};
+        if(fstatat(dirfd(directory), entry->d_name, &info, AT_SYMLINK_NOFOLLOW) == -1) {
+            fail(errorText(path + "/" + name));
+            continue;
+        }
+        if(S_ISDIR(info.st_mode)) {
+            SnapshotEntry snapshotEntry;
+            snapshotEntry.path = childRelative;
+            snapshotEntry.mode = info.st_mode;
+            snapshotEntry.mtimeSeconds = info.st_mtim.tv_sec;
+            snapshotEntry.mtimeNanoseconds = info.st_mtim.tv_nsec;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                entries.push_back(std::move(snapshotEntry));
+            }
+            group.run([this, &group, source, childRelative] { walk(group, source, childRelative); });
+        } else if(S_ISLNK(info.st_mode)) {
+            SnapshotEntry snapshotEntry;
+            snapshotEntry.path = childRelative;
+            snapshotEntry.mode = info.st_mode;
+            snapshotEntry.mtimeSeconds = info.st_mtim.tv_sec;
+            snapshotEntry.mtimeNanoseconds = info.st_mtim.tv_nsec;
+            snapshotEntry.linkTarget.resize(PATH_MAX);
+            auto length = readlinkat(dirfd(directory), entry->d_name, snapshotEntry.linkTarget.data(), PATH_MAX);
+            if(length == -1) {
+                fail(errorText(path + "/" + name));
+                continue;
+            }
+            snapshotEntry.linkTarget.resize(length);
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.push_back(std::move(snapshotEntry));
+        } else if(S_ISREG(info.st_mode)) {
+            batch.emplace_back(childRelative, info);
+            if(batch.size() == BATCH_SIZE) {
+                flush();
+            }
+        } else {
+            fail(path + "/" + name + ": special files are not stored");
+        }
+    }
+    closedir(directory);
+    if(!batch.empty()) {
+        flush();
+    }
+}
+
+void DedupStore::writeSnapshot(const std::string& name) {
+    std::sort(entries.begin(), entries.end(), [](const SnapshotEntry& left, const SnapshotEntry& right) {
+        return left.path < right.path;
+    });
+    std::string buffer(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    append(buffer, SNAPSHOT_VERSION);
+    append(buffer, packNumber);
+    append(buffer, (uint64_t)entries.size());
+    for(auto& entry : entries) {
+        append(buffer, (uint32_t)entry.path.size());
+        buffer += entry.path;
+        append(buffer, entry.mode);
+        append(buffer, entry.mtimeSeconds);
+        append(buffer, entry.mtimeNanoseconds);
+        append(buffer, entry.size);
+        append(buffer, (uint32_t)entry.linkTarget.size());
+        buffer += entry.linkTarget;
+        append(buffer, (uint32_t)entry.chunks.size());
+        for(auto& id : entry.chunks) {
+            append(buffer, id.high);
+            append(buffer, id.low);
+        }
+    }
+    auto path = root + "/snapshots/" + name;
+    auto temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(errorText(temporaryPath));
+    }
+    try {
+        writeAll(fd, buffer.data(), buffer.size(), temporaryPath);
+        if(fdatasync(fd) == -1) {
+            throw std::runtime_error(errorText(temporaryPath));
+        }
+    } catch(std::exception&) {
+        close(fd);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+    close(fd);
+    if(rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        throw std::runtime_error(errorText(path));
+    }
+    syncDirectory(root + "/snapshots");
+}
+
+std::vector<DedupStore::SnapshotEntry> DedupStore::readSnapshot(const std::string& name) {
+    auto content = readWholeFile(root + "/snapshots/" + name);
+    Reader reader {content};
+    char magic[4];
+    reader.take(magic, sizeof(magic));
+    auto version = memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0 ? reader.read<uint32_t>() : 0;
+    if(version != 1 && version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Not a snapshot: " + name);
+    }
+    if(version == SNAPSHOT_VERSION) {
+        reader.read<uint32_t>();
+    }
+    auto count = reader.read<uint64_t>();
+    std::vector<SnapshotEntry> snapshot;
+    for(uint64_t i = 0; i < count; i++) {
+        SnapshotEntry entry;
+        entry.path = reader.readString();
+        entry.mode = reader.read<uint32_t>();
+        entry.mtimeSeconds = reader.read<int64_t>();
+        entry.mtimeNanoseconds = reader.read<uint32_t>();
+        entry.size = reader.read<uint64_t>();
+        entry.linkTarget = reader.readString();
+        auto chunkCount = reader.read<uint32_t>();
+        for(uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            ChunkId id;
+            id.high = reader.read<uint64_t>();
+            id.low = reader.read<uint64_t>();
+            entry.chunks.push_back(id);
+        }
+        snapshot.push_back(std::move(entry));
+    }
+    return snapshot;
+}
+
+std::string DedupStore::latestSnapshot() {
+    DIR* directory = opendir((root + "/snapshots").c_str());
+    if(!directory) {
+        throw std::runtime_error(errorText(root + "/snapshots"));
+    }
+    // names are free form, the pack number of the run orders snapshots, then mtime, then name
+    std::string latest;
+    std::tuple<uint32_t, int64_t, long> latestOrder {0, 0, 0};
+    while(auto entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if(name[0] == '.' || (name.size() >= 4 && name.substr(name.size() - 4) == ".tmp")) {
+            continue;
+        }
+        auto order = snapshotOrder(root + "/snapshots/" + name);
+        if(latest.empty() || order > latestOrder || (order == latestOrder && name > latest)) {
+            latest = name;
+            latestOrder = order;
+        }
+    }
+    closedir(directory);
+    if(latest.empty()) {
+        throw std::runtime_error("No snapshots in " + root);
+    }
+    return latest;
+}
+
+DedupReport DedupStore::backup(std::string source, std::string snapshot) {
+    while(source.size() > 1 && source.back() == '/') {
+        source.pop_back();
+    }
+    for(auto& directory : {root, root + "/packs", root + "/snapshots"}) {
+        if(mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+            throw std::runtime_error(errorText(directory));
+        }
+    }
+    if(snapshot.empty()) {
+        char name[32];
+        auto now = time(nullptr);
+        tm local {};
+        localtime_r(&now, &local);
+        strftime(name, sizeof(name), "%Y%m%d-%H%M%S", &local);
+        snapshot = name;
+        for(int suffix = 1; access((root + "/snapshots/" + snapshot).c_str(), F_OK) == 0; suffix++) {
+            snapshot = std::string(name) + "-" + std::to_string(suffix);
+        }
+    }
+    loadIndex();
+    openPack();
+
+    {
+        TaskGroup group(pool);
+        walk(group, source, "");
+        group.wait();
+    }
+
+    // chunks have to be durable before anything refers to them
+    if(fdatasync(packFd) == -1) {
+        throw std::runtime_error(errorText(root + "/packs"));
+    }
+    if(packEnd.load() == 0) {
+        char name[32];
+        snprintf(name, sizeof(name), "/packs/%06u.pack", packNumber);
+        unlink((root + name).c_str());
+    }
+    if(!newChunks.empty()) {
+        std::string records;
+        for(auto& [id, location] : newChunks) {
+            append(records, id.high);
+            append(records, id.low);
+            append(records, location.pack);
+            append(records, location.length);
+            append(records, location.offset);
+        }
+        auto indexPath = root + "/chunks.idx";
+        int fd = open(indexPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if(fd == -1) {
+            throw std::runtime_error(errorText(indexPath));
+        }
+        writeAll(fd, records.data(), records.size(), indexPath);
+        fdatasync(fd);
+        close(fd);
+    }
+    // chunks which were written are kept in index, later runs reuse them
+    if(isChunkLost) {
+        throw std::runtime_error("Chunks could not be written to " + root + ", snapshot " + snapshot + " is not recorded");
+    }
+    writeSnapshot(snapshot);
+
+    DedupReport report;
+    report.snapshot = snapshot;
+    for(auto& entry : entries) {
+        if(S_ISDIR(entry.mode)) {
+            report.directories++;
+        } else if(S_ISLNK(entry.mode)) {
+            report.links++;
+        } else {
+            report.files++;
+            report.bytes += entry.size;
+        }
+    }
+    report.chunks = chunkCount.load();
+    report.newChunks = newChunks.size();
+    report.storedBytes = storedBytes.load();
+    report.errors = std::move(errors);
+    return report;
+}
+
+void DedupStore::restoreFile(const SnapshotEntry& entry, int targetFd, const std::vector<int>& packs) {
+    auto& target = entry.path;
+    std::string leaf;
+    Descriptor parent {openParent(targetFd, entry.path, leaf)};
+    if(parent.fd == -1) {
+        throw std::runtime_error(restoreError(target));
+    }
+    // never writes through a symlink, even one this restore has just created
+    int fd = openat(parent.fd, leaf.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if(fd == -1) {
+        throw std::runtime_error(errno == ELOOP ? target + ": is a symlink, not written" : errorText(target));
+    }
+    std::unique_ptr<unsigned char[]> buffer(new unsigned char[Chunker::MAX_SIZE]);
+    try {
+        for(auto& id : entry.chunks) {
+            auto& shard = shardOf(id);
+            auto found = shard.chunks.find(id);
+            if(found == shard.chunks.end() || found->second.pack >= packs.size() || packs[found->second.pack] == -1
+               || found->second.length > Chunker::MAX_SIZE) {
+                throw std::runtime_error(target + ": chunk missing from store");
+            }
+            auto& location = found->second;
+            size_t got = 0;
+            while(got < location.length) {
+                auto read = pread(packs[location.pack], buffer.get() + got, location.length - got, location.offset + got);
+                if(read <= 0) {
+                    if(read == -1 && errno == EINTR) {
+                        continue;
+                    }
+                    throw std::runtime_error(target + ": chunk cannot be read from store");
+                }
+                got += read;
+            }
+            if(!(ChunkId::of(buffer.get(), location.length) == id)) {
+                throw std::runtime_error(target + ": damaged chunk in store");
+            }
+            writeAll(fd, buffer.get(), location.length, target);
+        }
+        timespec times[2] = {{entry.mtimeSeconds, entry.mtimeNanoseconds}, {entry.mtimeSeconds, entry.mtimeNanoseconds}};
+        fchmod(fd, entry.mode & 07777);
+        futimens(fd, times);
+    } catch(std::exception&) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+DedupReport DedupStore::restore(std::string target, std::string snapshot) {
+    if(snapshot.empty()) {
+        snapshot = latestSnapshot();
+    }
+    auto snapshotEntries = readSnapshot(snapshot);
+    loadIndex();
+    std::vector<int> packs(packNumber + 1, -1);
+    for(uint32_t pack = 1; pack <= packNumber; pack++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/packs/%06u.pack", pack);
+        packs[pack] = open((root + name).c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    DedupReport report;
+    report.snapshot = snapshot;
+    mkdir(target.c_str(), 0755);
+    // target itself is given by the user and may be a symlink
+    Descriptor targetDirectory {open(target.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if(targetDirectory.fd == -1) {
+        throw std::runtime_error(errorText(target));
+    }
+    std::vector<const SnapshotEntry*> safeEntries;
+    for(auto& entry : snapshotEntries) {
+        if(isUnsafe(entry.path)) {
+            fail(entry.path + ": unsafe path, skipped");
+        } else {
+            safeEntries.push_back(&entry);
+        }
+    }
+    // sorted by path, so every directory is created before its content
+    for(auto entry : safeEntries) {
+        if(!S_ISDIR(entry->mode) && !S_ISLNK(entry->mode)) {
+            continue;
+        }
+        std::string leaf;
+        Descriptor parent {openParent(targetDirectory.fd, entry->path, leaf)};
+        if(S_ISDIR(entry->mode)) {
+            if(parent.fd == -1) {
+                fail(restoreError(entry->path));
+            } else if(mkdirat(parent.fd, leaf.c_str(), 0700) == -1 && errno != EEXIST) {
+                fail(errorText(entry->path));
+            }
+            report.directories++;
+        } else {
+            if(parent.fd == -1) {
+                fail(restoreError(entry->path));
+            } else {
+                unlinkat(parent.fd, leaf.c_str(), 0);
+                if(symlinkat(entry->linkTarget.c_str(), parent.fd, leaf.c_str()) == -1) {
+                    fail(errorText(entry->path));
+                }
+            }
+            report.links++;
+        }
+    }
+    {
+        TaskGroup group(pool);
+        for(auto entry : safeEntries) {
+            if(!S_ISREG(entry->mode)) {
+                continue;
+            }
+            report.files++;
+            report.bytes += entry->size;
+            report.chunks += entry->chunks.size();
+            group.run([this, entry, targetFd = targetDirectory.fd, &packs] {
+                try {
+                    restoreFile(*entry, targetFd, packs);
+                } catch(std::exception& e) {
+                    fail(e.what());
+                }
+            });
+        }
+        group.wait();
+    }
+    // filling directories changed their times, so they are set last
+    for(auto entry : safeEntries) {
+        if(!S_ISDIR(entry->mode)) {
+            continue;
+        }
+        std::string leaf;
+        Descriptor parent {openParent(targetDirectory.fd, entry->path, leaf)};
+        Descriptor directory {parent.fd == -1 ? -1
+                : openat(parent.fd, leaf.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)};
+        if(directory.fd == -1) {
+            continue;
+        }
+        timespec times[2] = {{entry->mtimeSeconds, entry->mtimeNanoseconds}, {entry->mtimeSeconds, entry->mtimeNanoseconds}};
+        fchmod(directory.fd, entry->mode & 07777);
+        futimens(directory.fd, times);
+    }
+    for(auto fd : packs) {
+        if(fd != -1) {
+            close(fd);
+        }
+    }
+    report.errors = std::move(errors);
+    return report;
+}
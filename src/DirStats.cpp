@@ -0,0 +1,429 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/DirStats.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace {
+    const size_t BUFFER_SIZE = 256 * 1024;
+    const char MAGIC[4] = {'T', 'K', 'D', 'C'};
+    // version 2 keeps file names instead of byte totals
+    const uint32_t VERSION = 2;
+    const uint32_t HAS_BYTES_FLAG = 1;
+    // timestamps are taken from a coarse clock, a change this close to scan could share its tick
+    const int64_t RACY_SECONDS = 2;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+    };
+    struct Record {
+        uint64_t device;
+        uint64_t inode;
+        int64_t mtimeSeconds;
+        int64_t ctimeSeconds;
+        uint32_t mtimeNanoseconds;
+        uint32_t ctimeNanoseconds;
+        uint64_t files;
+        uint64_t directories;
+        uint64_t links;
+        uint64_t others;
+        // subdirectory names followed by regular file names, each ended with NUL
+        uint64_t namesOffset;
+        uint32_t namesLength;
+        uint32_t fileNamesLength;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    void writeAll(int fd, const void* data, size_t size, const std::string& path) {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = write(fd, bytes, size);
+            if(written == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    // layout returned by getdents64, glibc does not declare it
+    struct LinuxDirent64 {
+        uint64_t inode;
+        int64_t offset;
+        unsigned short length;
+        unsigned char type;
+        char name[];
+    };
+
+    struct Totals {
+        std::atomic<size_t> files {0};
+        std::atomic<size_t> directories {0};
+        std::atomic<size_t> links {0};
+        std::atomic<size_t> others {0};
+        std::atomic<uint64_t> bytes {0};
+        std::atomic<size_t> depth {0};
+        std::mutex mutex;
+        std::vector<std::string> errors;
+        bool recursive;
+        bool withBytes;
+        DirStatsCache* cache;
+        int64_t startSeconds;
+
+        void fail(const std::string& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            errors.push_back(message);
+        }
+    };
+
+    void countDirectory(TaskGroup& group, Totals& totals, std::string path, size_t depth);
+
+    // sizes of files named by a cache entry, false if one of them is gone and directory has to be listed
+    bool statFiles(const std::string& path, bool isRoot, DirStatsCache::Entry& entry) {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | (isRoot ? 0 : O_NOFOLLOW));
+        if(fd == -1) {
+            return false;
+        }
+        entry.bytes = 0;
+        for(auto& name : entry.fileNames) {
+            struct stat info {};
+            if(fstatat(fd, name.c_str(), &info, AT_SYMLINK_NOFOLLOW) == -1 || !S_ISREG(info.st_mode)) {
+                close(fd);
+                return false;
+            }
+            entry.bytes += info.st_size;
+        }
+        close(fd);
+        return true;
+    }
+
+    void countSubdirectory(TaskGroup& group, Totals& totals, std::string path, size_t depth) {
+        group.run([&group, &totals, path = std::move(path), depth] {
+            countDirectory(group, totals, path, depth);
+        });
+    }
+
+    void addCounts(Totals& totals, const DirCounts& counts) {
+        totals.files.fetch_add(counts.files, std::memory_order_relaxed);
+        totals.directories.fetch_add(counts.directories, std::memory_order_relaxed);
+        totals.links.fetch_add(counts.links, std::memory_order_relaxed);
+        totals.others.fetch_add(counts.others, std::memory_order_relaxed);
+        totals.bytes.fetch_add(counts.bytes, std::memory_order_relaxed);
+    }
+
+    void countDirectory(TaskGroup& group, Totals& totals, std::string path, size_t depth) {
+        size_t current = totals.depth.load(std::memory_order_relaxed);
+        while(depth > current && !totals.depth.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {}
+
+        // times are read before listing, a change made during it leaves them outdated
+        DirStatsCache::Key key {};
+        DirStatsCache::Entry counts;
+        if(totals.cache) {
+            struct statx info {};
+            int flags = depth == 0 ? 0 : AT_SYMLINK_NOFOLLOW;
+            if(statx(AT_FDCWD, path.c_str(), flags, STATX_INO | STATX_MTIME | STATX_CTIME, &info) == -1) {
+                totals.fail(path + ": " + strerror(errno));
+                return;
+            }
+            key = {makedev(info.stx_dev_major, info.stx_dev_minor), info.stx_ino};
+            counts.mtimeSeconds = info.stx_mtime.tv_sec;
+            counts.mtimeNanoseconds = info.stx_mtime.tv_nsec;
+            counts.ctimeSeconds = info.stx_ctime.tv_sec;
+            counts.ctimeNanoseconds = info.stx_ctime.tv_nsec;
+            DirStatsCache::Entry cached;
+            if(totals.cache->find(key, counts, totals.withBytes, cached)
+               && (!totals.withBytes || statFiles(path, depth == 0, cached))) {
+                addCounts(totals, cached);
+                if(totals.recursive) {
+                    for(auto& name : cached.subdirectories) {
+                        countSubdirectory(group, totals, path + "/" + name, depth + 1);
+                    }
+                }
+                return;
+            }
+        }
+
+        std::vector<std::string> errors;
+        bool isComplete = DirStats::list(path, totals.withBytes, counts, errors, depth == 0,
+                                         totals.cache && totals.withBytes ? &counts.fileNames : nullptr);
+        for(auto& error : errors) {
+            totals.fail(error);
+        }
+        if(totals.recursive) {
+            for(auto& name : counts.subdirectories) {
+                countSubdirectory(group, totals, path + "/" + name, depth + 1);
+            }
+        }
+        addCounts(totals, counts);
+        bool isRacy = counts.ctimeSeconds >= totals.startSeconds - RACY_SECONDS
+                      || counts.mtimeSeconds >= totals.startSeconds - RACY_SECONDS;
+        if(totals.cache && isComplete && !isRacy) {
+            counts.bytes = 0;
+            totals.cache->store(key, std::move(counts));
+        }
+    }
+}
+
+bool DirStats::list(const std::string& path, bool withBytes, DirCounts& counts, std::vector<std::string>& errors,
+                    bool isRoot, std::vector<std::string>* fileNames) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | (isRoot ? 0 : O_NOFOLLOW));
+    if(fd == -1) {
+        errors.push_back(path + ": " + strerror(errno));
+        return false;
+    }
+    thread_local std::vector<char> buffer(BUFFER_SIZE);
+    counts.hasBytes = withBytes;
+    bool isComplete = true;
+    while(true) {
+        auto got = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if(got == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            errors.push_back(path + ": " + strerror(errno));
+            isComplete = false;
+            break;
+        }
+        if(got == 0) {
+            break;
+        }
+        for(long position = 0; position < got;) {
+            auto entry = reinterpret_cast<LinuxDirent64*>(buffer.data() + position);
+            position += entry->length;
+            auto name = entry->name;
+            if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            auto type = entry->type;
+            struct stat info {};
+            bool isStated = false;
+            if(type == DT_UNKNOWN || (type == DT_REG && withBytes)) {
+                if(fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) == -1) {
+                    errors.push_back(path + "/" + name + ": " + strerror(errno));
+                    isComplete = false;
+                    continue;
+                }
+                type = IFTODT(info.st_mode);
+                isStated = true;
+            }
+            if(type == DT_REG) {
+                counts.files++;
+                if(isStated) {
+                    counts.bytes += info.st_size;
+                }
+                if(fileNames) {
+                    fileNames->emplace_back(name);
+                }
+            } else if(type == DT_DIR) {
+                counts.directories++;
+                counts.subdirectories.emplace_back(name);
+            } else if(type == DT_LNK) {
+                counts.links++;
+            } else {
+                counts.others++;
+            }
+        }
+    }
+    close(fd);
+    return isComplete;
+}
+
+DirStats DirStats::collect(const std::string& root, bool recursive, bool withBytes, DirStatsCache* cache,
+                           WorkStealingPool& pool) {
+    Totals totals;
+    totals.recursive = recursive;
+    totals.withBytes = withBytes;
+    totals.cache = cache;
+    totals.startSeconds = time(nullptr);
+    {
+        TaskGroup group(pool);
+        countDirectory(group, totals, root, 0);
+        group.wait();
+    }
+    if(!totals.errors.empty() && totals.directories.load() == 0 && totals.files.load() == 0) {
+        throw std::runtime_error(totals.errors.front());
+    }
+    DirStats stats;
+    stats.files = totals.files.load();
+    stats.directories = totals.directories.load();
+    stats.links = totals.links.load();
+    stats.others = totals.others.load();
+    stats.bytes = totals.bytes.load();
+    stats.depth = recursive ? totals.depth.load() : 0;
+    stats.errors = std::move(totals.errors);
+    return stats;
+}
+
+DirStatsCache::DirStatsCache(std::string path) : path(std::move(path)) {
+    load();
+}
+
+bool DirStatsCache::find(const Key& key, const Entry& current, bool withBytes, Entry& entry) {
+    auto& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.entries.find(key);
+    if(found == shard.entries.end()) {
+        return false;
+    }
+    auto& cached = found->second.entry;
+    if(cached.mtimeSeconds != current.mtimeSeconds || cached.mtimeNanoseconds != current.mtimeNanoseconds
+       || cached.ctimeSeconds != current.ctimeSeconds || cached.ctimeNanoseconds != current.ctimeNanoseconds
+       || (withBytes && !cached.hasBytes)) {
+        return false;
+    }
+    found->second.isUsed = true;
+    entry = cached;
+    return true;
+}
+
+void DirStatsCache::store(const Key& key, Entry entry) {
+    auto& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& slot = shard.entries[key];
+    slot.entry = std::move(entry);
+    slot.isUsed = true;
+}
+
+void DirStatsCache::load() {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        return;
+    }
+    struct stat info {};
+    if(fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(Header)) {
+        close(fd);
+        return;
+    }
+    size_t mappingSize = info.st_size;
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        return;
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    auto header = static_cast<const Header*>(mapping);
+    auto recordsEnd = sizeof(Header) + header->count * sizeof(Record);
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+       || header->count > mappingSize / sizeof(Record) || recordsEnd > mappingSize) {
+        munmap(mapping, mappingSize);
+        return;
+    }
+    auto records = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(Header));
+    auto names = static_cast<const char*>(mapping) + recordsEnd;
+    auto namesSize = mappingSize - recordsEnd;
+    for(size_t i = 0; i < header->count; i++) {
+        auto& record = records[i];
+        auto namesEnd = record.namesOffset + record.namesLength + record.fileNamesLength;
+        if(namesEnd > namesSize || (record.namesLength > 0 && names[record.namesOffset + record.namesLength - 1] != '\0')
+           || (record.fileNamesLength > 0 && names[namesEnd - 1] != '\0')) {
+            continue;
+        }
+        Entry entry;
+        entry.mtimeSeconds = record.mtimeSeconds;
+        entry.mtimeNanoseconds = record.mtimeNanoseconds;
+        entry.ctimeSeconds = record.ctimeSeconds;
+        entry.ctimeNanoseconds = record.ctimeNanoseconds;
+        entry.hasBytes = record.flags & HAS_BYTES_FLAG;
+        entry.files = record.files;
+        entry.directories = record.directories;
+        entry.links = record.links;
+        entry.others = record.others;
+        auto name = names + record.namesOffset;
+        for(; name < names + record.namesOffset + record.namesLength; name += entry.subdirectories.back().size() + 1) {
+            entry.subdirectories.emplace_back(name);
+        }
+        for(auto end = name + record.fileNamesLength; name < end; name += entry.fileNames.back().size() + 1) {
+            entry.fileNames.emplace_back(name);
+        }
+        // loaded entries are not used yet, directories gone since last run are not saved again
+        Key key {record.device, record.inode};
+        shardOf(key).entries[key].entry = std::move(entry);
+    }
+    munmap(mapping, mappingSize);
+}
+
+void DirStatsCache::save() {
+    if(path.empty()) {
+        return;
+    }
+    std::vector<Record> records;
+    std::string names;
+    for(auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for(auto slot = shard.entries.begin(); slot != shard.entries.end();) {
+            if(!slot->second.isUsed) {
+                slot = shard.entries.erase(slot);
+                continue;
+            }
+            slot->second.isUsed = false;
+            auto& entry = slot->second.entry;
+            Record record {};
+            record.device = slot->first.device;
+            record.inode = slot->first.inode;
+            record.mtimeSeconds = entry.mtimeSeconds;
+            record.mtimeNanoseconds = entry.mtimeNanoseconds;
+            record.ctimeSeconds = entry.ctimeSeconds;
+            record.ctimeNanoseconds = entry.ctimeNanoseconds;
+            record.files = entry.files;
+            record.directories = entry.directories;
+            record.links = entry.links;
+            record.others = entry.others;
+            record.flags = entry.hasBytes ? HAS_BYTES_FLAG : 0;
+            record.namesOffset = names.size();
+            for(auto& name : entry.subdirectories) {
+                names += name;
+                names += '\0';
+            }
+            record.namesLength = names.size() - record.namesOffset;
+            for(auto& name : entry.fileNames) {
+                names += name;
+                names += '\0';
+            }
+            record.fileNamesLength = names.size() - record.namesOffset - record.namesLength;
+            records.push_back(record);
+            slot++;
+        }
+    }
+    Header header {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = records.size();
+
+    auto temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+    }
+    try {
+        writeAll(fd, &header, sizeof(header), temporaryPath);
+        writeAll(fd, records.data(), records.size() * sizeof(Record), temporaryPath);
+        writeAll(fd, names.data(), names.size(), temporaryPath);
+    } catch(std::exception&) {
+        close(fd);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+    close(fd);
+    // cache is only a hint, losing it on power failure costs one full scan, so it is not synced
+    if(rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
@@ -0,0 +1,244 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/DirWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    const size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
+    std::string parentOf(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash);
+    }
+}
+
+DirWatcher::DirWatcher(std::string root, bool recursive, bool withBytes)
+        : root(std::move(root)), recursive(recursive), withBytes(withBytes) {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd == -1) {
+        throw std::runtime_error(std::string("Cannot watch directories: ") + strerror(errno));
+    }
+    mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+    if(withBytes) {
+        // sizes change without touching directory
+        mask |= IN_MODIFY | IN_CLOSE_WRITE;
+    }
+    rescan();
+    if(directories.empty()) {
+        close(inotifyFd);
+        throw std::runtime_error(errors.empty() ? this->root + ": cannot be watched" : errors.front());
+    }
+}
+
+DirWatcher::~DirWatcher() {
+    close(inotifyFd);
+}
+
+void DirWatcher::rescan() {
+    for(auto& [wd, directory] : directories) {
+        inotify_rm_watch(inotifyFd, wd);
+    }
+    directories.clear();
+    watches.clear();
+    dirty.clear();
+    errors.clear();
+    isOverflowed = false;
+    rescanCount++;
+    addTree(root, 0);
+}
+
+void DirWatcher::addTree(const std::string& path, size_t depth) {
+    std::vector<std::pair<std::string, size_t>> pending {{path, depth}};
+    while(!pending.empty()) {
+        auto [current, currentDepth] = std::move(pending.back());
+        pending.pop_back();
+        // watch is added before listing, an entry created in between is listed again later
+        // root may be a symlink, directories below it are not followed
+        int wd = inotify_add_watch(inotifyFd, current.c_str(), currentDepth == 0 ? mask & ~IN_DONT_FOLLOW : mask);
+        if(wd == -1) {
+            if(errno == ENOSPC) {
+                throw std::runtime_error(current + ": inotify watch limit reached, raise fs.inotify.max_user_watches");
+            }
+            errors.push_back(current + ": " + strerror(errno));
+            continue;
+        }
+        // same directory reached by another path, its old place is gone
+        auto known = directories.find(wd);
+        if(known != directories.end()) {
+            watches.erase(known->second.path);
+        }
+        Directory directory {current, currentDepth, {}};
+        DirStats::list(current, withBytes, directory.counts, errors, currentDepth == 0);
+        if(recursive) {
+            for(auto& name : directory.counts.subdirectories) {
+                pending.emplace_back(current + "/" + name, currentDepth + 1);
+            }
+        }
+        watches[current] = wd;
+        directories[wd] = std::move(directory);
+    }
+}
+
+void DirWatcher::removeTree(const std::string& path) {
+    std::vector<std::string> pending {path};
+    while(!pending.empty()) {
+        auto current = std::move(pending.back());
+        pending.pop_back();
+        auto watch = watches.find(current);
+        if(watch == watches.end()) {
+            continue;
+        }
+        int wd = watch->second;
+        watches.erase(watch);
+        auto directory = directories.find(wd);
+        if(directory == directories.end()) {
+            continue;
+        }
+        for(auto& name : directory->second.counts.subdirectories) {
+            pending.push_back(current + "/" + name);
+        }
+        // fails for a watch removed by kernel already
+        inotify_rm_watch(inotifyFd, wd);
+        directories.erase(directory);
+        dirty.erase(wd);
+    }
+}
+
+bool DirWatcher::readEvents() {
+    alignas(inotify_event) static thread_local char buffer[EVENT_BUFFER_SIZE];
+    bool isChanged = false;
+    while(true) {
+        auto got = read(inotifyFd, buffer, sizeof(buffer));
+        if(got == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN) {
+                return isChanged;
+            }
+            throw std::runtime_error(std::string("Cannot read directory events: ") + strerror(errno));
+        }
+        for(long position = 0; position < got;) {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + position);
+            position += sizeof(inotify_event) + event->len;
+            if(event->mask & IN_Q_OVERFLOW) {
+                isOverflowed = true;
+                isChanged = true;
+                continue;
+            }
+            auto directory = directories.find(event->wd);
+            if(directory == directories.end()) {
+                continue;
+            }
+            if(event->mask & IN_IGNORED) {
+                // directory was deleted or unmounted, parent lists it again if it came back
+                auto path = directory->second.path;
+                auto parent = watches.find(parentOf(path));
+                if(parent != watches.end()) {
+                    dirty.insert(parent->second);
+                }
+                removeTree(path);
+                isChanged = true;
+                continue;
+            }
+            dirty.insert(event->wd);
+            isChanged = true;
+        }
+    }
+}
+
+void DirWatcher::applyChanges() {
+    if(isOverflowed) {
+        rescan();
+        return;
+    }
+    // errors are those of the last change only
+    errors.clear();
+    std::vector<std::string> removed;
+    std::vector<std::pair<std::string, size_t>> added;
+    for(int wd : dirty) {
+        auto found = directories.find(wd);
+        if(found == directories.end()) {
+            continue;
+        }
+        auto& directory = found->second;
+        DirCounts counts;
+        DirStats::list(directory.path, withBytes, counts, errors, directory.depth == 0);
+        if(recursive) {
+            std::unordered_set<std::string> current(counts.subdirectories.begin(), counts.subdirectories.end());
+            for(auto& name : directory.counts.subdirectories) {
+                if(!current.count(name)) {
+                    removed.push_back(directory.path + "/" + name);
+                }
+            }
+            for(auto& name : counts.subdirectories) {
+                auto path = directory.path + "/" + name;
+                if(!watches.count(path)) {
+                    added.emplace_back(path, directory.depth + 1);
+                }
+            }
+        }
+        directory.counts = std::move(counts);
+    }
+    dirty.clear();
+    // directory moved inside tree keeps its watch, it is dropped first and added at new place
+    for(auto& path : removed) {
+        removeTree(path);
+    }
+    for(auto& [path, depth] : added) {
+        addTree(path, depth);
+    }
+}
+
+void DirWatcher::waitForChange(std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay) {
+    using Clock = std::chrono::steady_clock;
+    std::optional<Clock::time_point> firstChange;
+    while(true) {
+        int timeout = -1;
+        if(firstChange) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*firstChange + maxDelay - Clock::now());
+            timeout = (int)std::max<long>(0, std::min(debounce.count(), (long)left.count()));
+        }
+        pollfd descriptor {inotifyFd, POLLIN, 0};
+        int ready = poll(&descriptor, 1, timeout);
+        if(ready == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Cannot wait for directory events: ") + strerror(errno));
+        }
+        if(ready == 0) {
+            break;
+        }
+        if(readEvents() && !firstChange) {
+            firstChange = Clock::now();
+        }
+        if(firstChange && Clock::now() >= *firstChange + maxDelay) {
+            break;
+        }
+    }
+    applyChanges();
+}
+
+DirStats DirWatcher::stats() const {
+    DirStats stats;
+    for(auto& [wd, directory] : directories) {
+        stats.files += directory.counts.files;
+        stats.directories += directory.counts.directories;
+        stats.links += directory.counts.links;
+        stats.others += directory.counts.others;
+        stats.bytes += directory.counts.bytes;
+        stats.depth = std::max(stats.depth, directory.depth);
+    }
+    stats.errors = errors;
+    return stats;
+}
@@ -72,7 +72,7 @@ void EvaluationVisitor::visit(AssignExpression *assignExpression) {
     }
 
     assignExpression->right->accept(this);
-    auto valueToBeAssigned = moveLocalOperandFromNearestContext();
+    auto valueToBeAssigned = resolveOperand(moveLocalOperandFromNearestContext());
 
     auto getTypeOf = [](std::string varName, std::deque<Context> ctx) -> std::string {
         for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
@@ -99,6 +99,10 @@ void EvaluationVisitor::visit(AssignExpression *assignExpression) {
 
     for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
         if(currentCtx->variableAssignmentMap.find(varName) != currentCtx->variableAssignmentMap.end()) {
+            if((size_t)std::distance(currentCtx, ctx.rend()) <= sharedContextDepth) {
+                throw std::runtime_error(varName + " is shared by parallel_for iterations or every ticks, "
+                                         "it can only be read or reduced by parallel_for");
+            }
             currentCtx->variableAssignmentMap[varName] = valueToBeAssigned;
             return;
         }
@@ -198,6 +202,11 @@ void EvaluationVisitor::visit(BodyExpression *bodyExpression) {
     ctx.push_back({});
     for(auto statement : bodyExpression->statements) {
         statement->accept(this);
+        // like root expressions, value of a statement is not passed to the next one
+        ctx.back().operands = {};
+        if(isReturning()) {
+            break;
+        }
     }
     ctx.pop_back();
 }
@@ -230,78 +239,397 @@ void EvaluationVisitor::visit(WhileExpression *whileExpression) {
     }
     while(conditionToInt != 0) {
         whileExpression->right->accept(this);
+        if(isReturning()) {
+            break;
+        }
         whileExpression->left->accept(this);
         auto currentCondition = moveLocalOperandFromNearestContext();
         if (const auto condToInt (std::get_if<int>(&currentCondition)); condToInt) {
             conditionToInt = *condToInt;
         }
     }
-    ctx.pop_back();
 }
 
-void EvaluationVisitor::visit(DoExpression *doExpression) {
-    /* unused */
+/*
+ * Block is not evaluated here, it is compiled into a schedule ticking on the pool, so a periodic
+ * check costs no process. Like parallel_for iterations, ticks see contexts as they were when every
+ * was reached, outer variables can be read but not assigned. ret in the block ends the schedule.
+ */
+void EvaluationVisitor::visit(EveryExpression *everyExpression) {
+    auto args = flattenArgs(everyExpression->left);
+    if(args.empty() || args.size() > 2) {
+        throw std::runtime_error("every expects interval and optional number of runs");
+    }
+    auto interval = evaluateExpression(args[0]);
+    double seconds;
+    if(const auto intervalToInt (std::get_if<int>(&interval)); intervalToInt) {
+        seconds = *intervalToInt;
+    } else if(const auto intervalToDouble (std::get_if<double>(&interval)); intervalToDouble) {
+        seconds = *intervalToDouble;
+    } else {
+        throw std::runtime_error("every interval has to be a number");
+    }
+    if(seconds <= 0) {
+        throw std::runtime_error("every interval has to be positive");
+    }
+    // negative runs forever
+    int runs = -1;
+    if(args.size() == 2) {
+        auto count = evaluateExpression(args[1]);
+        const auto countToInt (std::get_if<int>(&count));
+        if(!countToInt) {
+            throw std::runtime_error("every number of runs has to be int");
+        }
+        runs = *countToInt;
+    }
+    if(runs == 0 || !everyExpression->right) {
+        return;
+    }
+
+    auto worker = std::make_shared<EvaluationVisitor>();
+    worker->ctx = ctx;
+    for(auto& context : worker->ctx) {
+        context.operands = {};
+    }
+    worker->sharedContextDepth = worker->ctx.size();
+    PeriodicTask task;
+    task.period = std::chrono::milliseconds((long)(seconds * 1000));
+    task.run = [worker, body = everyExpression->right, runs]() mutable {
+        worker->returnValues.emplace_back();
+        body->accept(worker.get());
+        bool isReturned = worker->returnValues.back().has_value();
+        worker->returnValues.pop_back();
+        return !isReturned && (runs < 0 || --runs > 0);
+    };
+    // nothing waits for an every block, it is forgotten once done
+    auto& scheduler = Scheduler::instance();
+    scheduler.release(scheduler.add(std::move(task)));
 }
 
-void EvaluationVisitor::visit(FunctionCallExpression *functionCallExpression) {
+std::vector<std::shared_ptr<Expression>> EvaluationVisitor::flattenArgs(std::shared_ptr<Expression> args) {
+    std::vector<std::shared_ptr<Expression>> flatArgs;
+    if(auto isArg = std::dynamic_pointer_cast<FunctionArgExpression>(args)) {
+        for(auto side : {isArg->left, isArg->right}) {
+            auto sideArgs = flattenArgs(side);
+            flatArgs.insert(flatArgs.end(), sideArgs.begin(), sideArgs.end());
+        }
+        return flatArgs;
+    }
+    if(args) {
+        flatArgs.push_back(args);
+    }
+    return flatArgs;
+}
 
-    auto funcNameExpression = functionCallExpression->left;
-    auto funcName = std::dynamic_pointer_cast<VarNameExpression>(funcNameExpression)->value;
+EvaluationVisitor::LoopRange EvaluationVisitor::evaluateLoopRange(const std::vector<std::shared_ptr<Expression>>& args) {
+    if(args.size() < 3) {
+        throw std::runtime_error("Loop needs variable, begin and end");
+    }
+    auto isVarName = std::dynamic_pointer_cast<VarNameExpression>(args[0]);
+    if(!isVarName) {
+        throw std::runtime_error("Loop variable has to be a name");
+    }
+    auto begin = evaluateExpression(args[1]);
+    auto end = evaluateExpression(args[2]);
+    const auto beginToInt (std::get_if<int>(&begin));
+    const auto endToInt (std::get_if<int>(&end));
+    if(!beginToInt || !endToInt) {
+        throw std::runtime_error("Loop bounds have to be int");
+    }
+    return {isVarName->value, *beginToInt, *endToInt};
+}
 
-    auto isDeclaredIntGivenCtx = [](std::string funcName, std::deque<Context> ctx) -> bool {
-        for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
-            if(currentCtx->functionDeclarationMap.find(funcName) != currentCtx->functionDeclarationMap.end()) {
-                return true;
-            }
+std::vector<EvaluationVisitor::Reduction> EvaluationVisitor::getReductions(const std::vector<std::shared_ptr<Expression>>& args) {
+    std::vector<Reduction> reductions;
+    if((args.size() - 3) % 2 != 0) {
+        throw std::runtime_error("Reduction needs operation and variable");
+    }
+    for(size_t i = 3; i < args.size(); i += 2) {
+        auto operation = std::dynamic_pointer_cast<VarNameExpression>(args[i]);
+        auto variable = std::dynamic_pointer_cast<VarNameExpression>(args[i + 1]);
+        if(!operation || !variable) {
+            throw std::runtime_error("Reduction needs operation and variable");
         }
-        return false;
+        Reduction reduction {operation->value, variable->value, getDeclaredType(variable->value), 0};
+        if(reduction.specifier != "int" && reduction.specifier != "float") {
+            throw std::runtime_error("Only int and float variables can be reduced");
+        }
+        bool isInt = reduction.specifier == "int";
+        if(reduction.operation == "sum") {
+            reduction.identity = isInt ? Value(0) : Value(0.0);
+        } else if(reduction.operation == "min") {
+            reduction.identity = isInt ? Value(INT_MAX) : Value(std::numeric_limits<double>::infinity());
+        } else if(reduction.operation == "max") {
+            reduction.identity = isInt ? Value(INT_MIN) : Value(-std::numeric_limits<double>::infinity());
+        } else {
+            throw std::runtime_error("Unknown reduction " + reduction.operation);
+        }
+        reductions.push_back(reduction);
+    }
+    return reductions;
+}
+
+EvaluationVisitor::Value EvaluationVisitor::reduce(const std::string& operation, Value left, Value right) {
+    const auto leftToInt (std::get_if<int>(&left));
+    const auto rightToInt (std::get_if<int>(&right));
+    if(leftToInt && rightToInt) {
+        if(operation == "sum") {
+            return *leftToInt + *rightToInt;
+        }
+        return operation == "min" ? std::min(*leftToInt, *rightToInt) : std::max(*leftToInt, *rightToInt);
+    }
+    auto toDouble = [](Value value) -> double {
+        if (const auto valueToInt (std::get_if<int>(&value)); valueToInt) {
+            return *valueToInt;
+        }
+        if (const auto valueToDouble (std::get_if<double>(&value)); valueToDouble) {
+            return *valueToDouble;
+        }
+        throw std::runtime_error("Only numbers can be reduced");
     };
-    if(!isDeclaredIntGivenCtx(funcName, ctx)) {
-        throw std::runtime_error("Function not defined");
+    if(operation == "sum") {
+        return toDouble(left) + toDouble(right);
     }
+    return operation == "min" ? std::min(toDouble(left), toDouble(right)) : std::max(toDouble(left), toDouble(right));
+}
 
-    if(functionCallExpression->right) {
-        functionCallExpression->right->accept(this);
+void EvaluationVisitor::visit(ForExpression *forExpression) {
+    auto args = flattenArgs(forExpression->left);
+    if(args.size() != 3) {
+        throw std::runtime_error("for expects variable, begin and end");
     }
+    auto range = evaluateLoopRange(args);
 
-    auto getNearestFunctionDeclaration = [](std::string funcName, std::deque<Context> ctx)
-            -> FunctionDeclaration {
-        for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
-            if(currentCtx->functionDeclarationMap.find(funcName) != currentCtx->functionDeclarationMap.end()) {
-                return currentCtx->functionDeclarationMap[funcName];
-            }
+    // loop variable lives in its own context, body declarations are private to each iteration
+    ctx.push_back({});
+    ctx.back().declarationMap[range.variable] = "int";
+    for(int i = range.begin; i < range.end; i++) {
+        ctx.back().variableAssignmentMap[range.variable] = i;
+        if(forExpression->right) {
+            forExpression->right->accept(this);
+        }
+        if(isReturning()) {
+            break;
         }
-        throw std::runtime_error("Declaration not found");
+    }
+    ctx.pop_back();
+}
+
+/*
+ * Iterations are split into chunks run on the work stealing pool. Every chunk evaluates
+ * on its own copy of contexts: outer variables are readable, assigning them is an error,
+ * unless they are listed as reductions. Reduced variables start from operation identity
+ * in each chunk, partial results are combined in chunk order with the value from before the loop.
+ */
+void EvaluationVisitor::visit(ParallelForExpression *parallelForExpression) {
+    auto args = flattenArgs(parallelForExpression->left);
+    auto range = evaluateLoopRange(args);
+    auto reductions = getReductions(args);
+    if(range.end <= range.begin) {
+        return;
+    }
+
+    auto& pool = WorkStealingPool::instance();
+    size_t iterations = (size_t)range.end - range.begin;
+    size_t chunks = std::min(iterations, (pool.size() + 1) * 4);
+    size_t chunkSize = (iterations + chunks - 1) / chunks;
+
+    struct ChunkResult {
+        std::vector<Value> partials;
+        std::exception_ptr error;
     };
-    auto functionDeclaration = getNearestFunctionDeclaration(funcName, ctx);
-    auto& currentCtxOperands = ctx.back().operands;
-    if(currentCtxOperands.size() != functionDeclaration.args.size()) {
-        throw std::runtime_error("Wrong number of arguments");
+    std::vector<ChunkResult> results(chunks);
+
+    auto snapshot = ctx;
+    for(auto& context : snapshot) {
+        context.operands = {};
+    }
+    auto body = parallelForExpression->right;
+
+    TaskGroup group(pool);
+    for(size_t chunk = 0; chunk < chunks; chunk++) {
+        int chunkBegin = range.begin + (int)(chunk * chunkSize);
+        int chunkEnd = std::min(range.end, chunkBegin + (int)chunkSize);
+        group.run([&, chunk, chunkBegin, chunkEnd] {
+            try {
+                EvaluationVisitor worker;
+                worker.ctx = snapshot;
+                worker.sharedContextDepth = worker.ctx.size();
+                worker.ctx.push_back({});
+                auto& loopContext = worker.ctx.back();
+                for(auto& reduction : reductions) {
+                    loopContext.declarationMap[reduction.variable] = reduction.specifier;
+                    loopContext.variableAssignmentMap[reduction.variable] = reduction.identity;
+                }
+                loopContext.declarationMap[range.variable] = "int";
+                for(int i = chunkBegin; i < chunkEnd; i++) {
+                    worker.ctx.back().variableAssignmentMap[range.variable] = i;
+                    if(body) {
+                        body->accept(&worker);
+                    }
+                }
+                for(auto& reduction : reductions) {
+                    results[chunk].partials.push_back(worker.ctx.back().variableAssignmentMap[reduction.variable]);
+                }
+            } catch(...) {
+                results[chunk].error = std::current_exception();
+            }
+        });
     }
+    group.wait();
 
-    auto currentArg = functionDeclaration.args.cbegin();
-    while(!currentCtxOperands.empty()) {
-        auto calledArg = moveLocalOperandFromNearestContext();
+    for(auto& result : results) {
+        if(result.error) {
+            std::rethrow_exception(result.error);
+        }
+    }
+    for(size_t i = 0; i < reductions.size(); i++) {
+        auto& reduction = reductions[i];
+        Value reduced = reduction.identity;
+        bool wasAssigned = false;
+        for(auto& context : ctx) {
+            wasAssigned |= context.isVariableAssigned(reduction.variable);
+        }
+        if(wasAssigned) {
+            reduced = getAssignedValueFromNearestContext(reduction.variable);
+        }
+        for(auto& result : results) {
+            reduced = reduce(reduction.operation, reduced, result.partials[i]);
+        }
+        storeVariable(reduction.variable, reduced);
+    }
+}
 
-        if (const auto value (std::get_if<std::string>(&calledArg)); value
-                                                                     && currentArg->specifier != "int") {
-            throw std::runtime_error("Arg mismatch in function " + funcName + " call.");
+void EvaluationVisitor::visit(DoExpression *doExpression) {
+    /* unused */
+}
+
+bool EvaluationVisitor::isFunctionDeclared(std::string funcName) {
+    for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
+        if(currentCtx->functionDeclarationMap.find(funcName) != currentCtx->functionDeclarationMap.end()) {
+            return true;
         }
-        if (const auto value (std::get_if<double>(&calledArg)); value
-                                                                && currentArg->specifier != "double") {
-            throw std::runtime_error("Arg mismatch in function " + funcName + " call.");
+    }
+    return false;
+}
+
+EvaluationVisitor::FunctionDeclaration EvaluationVisitor::getFunctionDeclaration(std::string funcName) {
+    for(auto currentCtx = ctx.rbegin(); currentCtx != ctx.rend(); currentCtx++) {
+        if(currentCtx->functionDeclarationMap.find(funcName) != currentCtx->functionDeclarationMap.end()) {
+            return currentCtx->functionDeclarationMap[funcName];
         }
-        if (const auto value (std::get_if<int>(&calledArg)); value
-                                                             && currentArg->specifier != "string") {
+    }
+    throw std::runtime_error("Function not defined");
+}
+
+std::vector<EvaluationVisitor::Value> EvaluationVisitor::evaluateCallArgs(FunctionCallExpression *functionCallExpression) {
+    std::vector<Value> args;
+    for(auto arg : flattenArgs(functionCallExpression->right)) {
+        args.push_back(evaluateExpression(arg));
+    }
+    return args;
+}
+
+std::optional<EvaluationVisitor::Value> EvaluationVisitor::callFunction(std::string funcName,
+        const FunctionDeclaration& functionDeclaration, const std::vector<Value>& args) {
+    if(args.size() != functionDeclaration.args.size()) {
+        throw std::runtime_error("Wrong number of arguments");
+    }
+
+    // arguments are declared in their own context, function body opens the next one
+    ctx.push_back({});
+    auto currentArg = functionDeclaration.args.cbegin();
+    for(auto& calledArg : args) {
+        if ((std::get_if<std::string>(&calledArg) && currentArg->specifier != "string")
+                || (std::get_if<double>(&calledArg) && currentArg->specifier != "float")
+                || (std::get_if<int>(&calledArg) && currentArg->specifier != "int")) {
+            ctx.pop_back();
             throw std::runtime_error("Arg mismatch in function " + funcName + " call.");
         }
+        ctx.back().declarationMap[currentArg->name] = currentArg->specifier;
+        ctx.back().variableAssignmentMap[currentArg->name] = calledArg;
         currentArg++;
+    }
 
-        if(currentArg == functionDeclaration.args.cend()) {
-            break;
+    returnValues.emplace_back();
+    try {
+        if(functionDeclaration.body) {
+            functionDeclaration.body->accept(this);
         }
+    } catch(...) {
+        returnValues.pop_back();
+        ctx.pop_back();
+        throw;
     }
-    functionDeclaration.body->accept(this);
+    auto returnValue = returnValues.back();
+    returnValues.pop_back();
+    ctx.pop_back();
+    return returnValue;
+}
+
+void EvaluationVisitor::visit(FunctionCallExpression *functionCallExpression) {
+
+    auto funcNameExpression = functionCallExpression->left;
+    auto funcName = std::dynamic_pointer_cast<VarNameExpression>(funcNameExpression)->value;
+
+    if(!isFunctionDeclared(funcName)) {
+        if(auto builtin = Builtins::find(funcName)) {
+            auto args = evaluateCallArgs(functionCallExpression);
+            if(auto returnValue = (*builtin)(args)) {
+                addToCurrentContext(*returnValue);
+            }
+            return;
+        }
+    }
+    auto functionDeclaration = getFunctionDeclaration(funcName);
+    auto returnValue = callFunction(funcName, functionDeclaration, evaluateCallArgs(functionCallExpression));
+    if(returnValue) {
+        addToCurrentContext(*returnValue);
+    }
+}
+
+/*
+ * Spawned function runs on the work stealing pool with its own evaluator. Its scope is built only
+ * from arguments evaluated here and function declarations visible at spawn, so the task never
+ * touches caller's contexts and can not race with it.
+ */
+void EvaluationVisitor::visit(SpawnExpression *spawnExpression) {
+    auto funcName = std::dynamic_pointer_cast<VarNameExpression>(spawnExpression->call->left)->value;
+    auto functionDeclaration = getFunctionDeclaration(funcName);
+    auto args = evaluateCallArgs(spawnExpression->call.get());
+
+    Context captured;
+    for(auto& context : ctx) {
+        for(auto& [name, declaration] : context.functionDeclarationMap) {
+            captured.functionDeclarationMap[name] = declaration;
+        }
+    }
+
+    auto task = std::make_shared<SpawnedTask>();
+    WorkStealingPool::instance().submit([task, captured, funcName, functionDeclaration, args] {
+        try {
+            EvaluationVisitor taskVisitor;
+            taskVisitor.ctx.push_back(captured);
+            task->complete(taskVisitor.callFunction(funcName, functionDeclaration, args));
+        } catch(...) {
+            task->fail(std::current_exception());
+        }
+    });
+    addToCurrentContext(TaskRegistry::instance().add(task));
+}
+
+void EvaluationVisitor::visit(AwaitExpression *awaitExpression) {
+    auto handle = evaluateExpression(awaitExpression->handle);
+    const auto handleToInt (std::get_if<int>(&handle));
+    if(!handleToInt) {
+        throw std::runtime_error("await expects task handle");
+    }
+    auto task = TaskRegistry::instance().get(*handleToInt);
+    // like join, a task is awaited once, its handle is released even when the task failed
+    TaskRegistry::instance().remove(*handleToInt);
+    auto result = task->get();
+    // tasks without ret give 0, so await can always be assigned
+    addToCurrentContext(result ? *result : Value(0));
 }
 
 void EvaluationVisitor::visit(FileExpression *fileExpression) {
@@ -331,6 +659,32 @@ void EvaluationVisitor::visit(FieldReferenceExpression *fieldReferenceExpression
             handlerRef->stop();
             return;
         }
+        if(isVarNameExpr->value == "wait") {
+            auto handlerName = std::dynamic_pointer_cast<VarNameExpression>(fieldReferenceExpression->left)->value;
+            auto handlerRef = getSystemHandlerReferenceByName(handlerName);
+            addToCurrentContext(handlerRef->wait());
+            return;
+        }
+        if(isVarNameExpr->value == "poll") {
+            auto handlerName = std::dynamic_pointer_cast<VarNameExpression>(fieldReferenceExpression->left)->value;
+            auto handlerRef = getSystemHandlerReferenceByName(handlerName);
+            addToCurrentContext((int)handlerRef->poll());
+            return;
+        }
+        if(isVarNameExpr->value == "output" || isVarNameExpr->value == "lines") {
+            auto handlerName = std::dynamic_pointer_cast<VarNameExpression>(fieldReferenceExpression->left)->value;
+            auto handlerRef = getSystemHandlerReferenceByName(handlerName);
+            auto isRun = std::dynamic_pointer_cast<RunHandler>(handlerRef->handler);
+            if(!isRun) {
+                throw std::runtime_error("Only run handler output can be read");
+            }
+            if(isVarNameExpr->value == "output") {
+                addToCurrentContext(Builtins::quoted(isRun->capturedText()));
+            } else {
+                addToCurrentContext((int)isRun->capturedLines());
+            }
+            return;
+        }
 
     }
     fieldReferenceExpression->left->accept(this);
@@ -406,11 +760,8 @@ void EvaluationVisitor::visit(SystemHandlerDeclExpression *systemHandlerDeclExpr
 }
 
 void EvaluationVisitor::visit(RetExpression *retExpression) {
-    retExpression->toRet->accept(this);
-    auto toRet = ctx.back().operands.front();
-    // go to previous ctx
-    // (ctx from which function was called)
-    auto ctxIt = ctx.rbegin();
-    ctxIt++;
-    ctxIt->operands.push(toRet);
+    if(returnValues.empty()) {
+        throw std::runtime_error("ret outside of function");
+    }
+    returnValues.back() = evaluateExpression(retExpression->toRet);
 }
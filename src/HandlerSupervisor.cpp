@@ -0,0 +1,253 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/HandlerSupervisor.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // epoll user data, pids are always positive
+    const uint64_t SIGNAL_EVENT = 0;
+    const uint64_t STOP_EVENT = UINT64_MAX;
+
+    int openPidfd(pid_t pid) {
+        return (int)syscall(SYS_pidfd_open, pid, 0);
+    }
+
+    int sendSignal(int pidfd, int signalNumber) {
+        return (int)syscall(SYS_pidfd_send_signal, pidfd, signalNumber, nullptr, 0);
+    }
+
+    int toExitStatus(int status) {
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+
+    sigset_t childSignalSet() {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGCHLD);
+        return signals;
+    }
+}
+
+void HandlerSupervisor::blockChildSignal() {
+    auto signals = childSignalSet();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+HandlerSupervisor& HandlerSupervisor::instance() {
+    static HandlerSupervisor supervisor;
+    return supervisor;
+}
+
+HandlerSupervisor::HandlerSupervisor() {
+    // every running handler holds a pidfd
+    rlimit limit {};
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    auto signals = childSignalSet();
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(epollFd == -1 || signalFd == -1 || stopFd == -1) {
+        throw std::runtime_error(std::string("Cannot create handler event loop: ") + strerror(errno));
+    }
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = SIGNAL_EVENT;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+    event.data.u64 = STOP_EVENT;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event);
+
+    loop = std::thread([this] { run(); });
+}
+
+HandlerSupervisor::~HandlerSupervisor() {
+    uint64_t one = 1;
+    if(write(stopFd, &one, sizeof(one)) == sizeof(one) && loop.joinable()) {
+        loop.join();
+    } else if(loop.joinable()) {
+        loop.detach();
+    }
+    for(auto& [pid, child] : children) {
+        if(child.pidfd != -1) {
+            close(child.pidfd);
+        }
+    }
+    close(epollFd);
+    close(signalFd);
+    close(stopFd);
+}
+
+void HandlerSupervisor::watch(pid_t pid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& child = children[pid];
+    child = Child {};
+    child.pidfd = openPidfd(pid);
+    if(child.pidfd == -1) {
+        // without pidfd exit is noticed through SIGCHLD, child could exit before it was added
+        int status;
+        if(waitpid(pid, &status, WNOHANG) == pid) {
+            child.finished = true;
+            child.status = toExitStatus(status);
+            childFinished.notify_all();
+        }
+        return;
+    }
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = (uint64_t)pid;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, child.pidfd, &event);
+}
+
+void HandlerSupervisor::reap(pid_t pid, Child& child) {
+    int status;
+    if(waitpid(pid, &status, WNOHANG) != pid) {
+        return;
+    }
+    child.finished = true;
+    child.status = toExitStatus(status);
+    if(child.pidfd != -1) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, child.pidfd, nullptr);
+        close(child.pidfd);
+        child.pidfd = -1;
+    }
+    childFinished.notify_all();
+}
+
+void HandlerSupervisor::reapChildrenWithoutPidfd() {
+    for(auto child = children.begin(); child != children.end();) {
+        if(!child->second.finished && child->second.pidfd == -1) {
+            reap(child->first, child->second);
+        }
+        if(child->second.finished && child->second.isReleased) {
+            child = children.erase(child);
+        } else {
+            child++;
+        }
+    }
+}
+
+void HandlerSupervisor::run() {
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+    while(true) {
+        int ready = epoll_wait(epollFd, events, maxEvents, -1);
+        if(ready == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for(int i = 0; i < ready; i++) {
+            auto data = events[i].data.u64;
+            if(data == STOP_EVENT) {
+                return;
+            }
+            if(data == SIGNAL_EVENT) {
+                signalfd_siginfo info {};
+                while(read(signalFd, &info, sizeof(info)) == sizeof(info)) {}
+                reapChildrenWithoutPidfd();
+                continue;
+            }
+            auto child = children.find((pid_t)data);
+            if(child != children.end() && !child->second.finished) {
+                reap(child->first, child->second);
+                if(child->second.finished && child->second.isReleased) {
+                    children.erase(child);
+                }
+            }
+        }
+    }
+}
+
+int HandlerSupervisor::report(std::unordered_map<pid_t, Child>::iterator child) {
+    auto status = child->second.status;
+    children.erase(child);
+    return status;
+}
+
+std::optional<int> HandlerSupervisor::poll(pid_t pid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto child = children.find(pid);
+    if(child == children.end()) {
+        throw std::runtime_error("Process " + std::to_string(pid) + " is not supervised");
+    }
+    if(child->second.finished) {
+        return report(child);
+    }
+    return std::nullopt;
+}
+
+std::optional<int> HandlerSupervisor::waitFor(pid_t pid, double timeoutSeconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if(children.find(pid) == children.end()) {
+        throw std::runtime_error("Process " + std::to_string(pid) + " is not supervised");
+    }
+    // child may be reported to another waiter meanwhile, so it is looked up again after every wakeup
+    auto isFinished = [&] {
+        auto child = children.find(pid);
+        return child == children.end() || child->second.finished;
+    };
+    if(timeoutSeconds < 0) {
+        childFinished.wait(lock, isFinished);
+    } else if(!childFinished.wait_for(lock, std::chrono::duration<double>(timeoutSeconds), isFinished)) {
+        return std::nullopt;
+    }
+    auto child = children.find(pid);
+    if(child == children.end()) {
+        throw std::runtime_error("Process " + std::to_string(pid) + " is not supervised");
+    }
+    return report(child);
+}
+
+void HandlerSupervisor::release(pid_t pid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto child = children.find(pid);
+    if(child == children.end()) {
+        return;
+    }
+    if(child->second.finished) {
+        children.erase(child);
+    } else {
+        child->second.isReleased = true;
+    }
+}
+
+void HandlerSupervisor::signal(pid_t pid, int signalNumber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto child = children.find(pid);
+    if(child == children.end() || child->second.finished) {
+        return;
+    }
+    if(child->second.pidfd != -1) {
+        sendSignal(child->second.pidfd, signalNumber);
+    } else {
+        kill(pid, signalNumber);
+    }
+}
+
+size_t HandlerSupervisor::runningCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t running = 0;
+    for(auto& [pid, child] : children) {
+        running += !child.finished;
+    }
+    return running;
+}
@@ -0,0 +1,162 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Hash.h"
+#include "../include/Throttle.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t read64(const unsigned char* data) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t read32(const unsigned char* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint64_t round(uint64_t accumulator, uint64_t input) {
+        accumulator += input * PRIME2;
+        return rotateLeft(accumulator, 31) * PRIME1;
+    }
+
+    uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+        accumulator ^= round(0, value);
+        return accumulator * PRIME1 + PRIME4;
+    }
+}
+
+Hasher::Hasher(uint64_t seed) : seed(seed) {
+    accumulators[0] = seed + PRIME1 + PRIME2;
+    accumulators[1] = seed + PRIME2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - PRIME1;
+}
+
+void Hasher::update(const void* data, size_t size) {
+    auto input = static_cast<const unsigned char*>(data);
+    totalSize += size;
+    if(pendingSize + size < sizeof(pending)) {
+        memcpy(pending + pendingSize, input, size);
+        pendingSize += size;
+        return;
+    }
+    if(pendingSize > 0) {
+        auto missing = sizeof(pending) - pendingSize;
+        memcpy(pending + pendingSize, input, missing);
+        for(int lane = 0; lane < 4; lane++) {
+            accumulators[lane] = round(accumulators[lane], read64(pending + lane * 8));
+        }
+        input += missing;
+        size -= missing;
+        pendingSize = 0;
+    }
+    while(size >= 32) {
+        for(int lane = 0; lane < 4; lane++) {
+            accumulators[lane] = round(accumulators[lane], read64(input + lane * 8));
+        }
+        input += 32;
+        size -= 32;
+    }
+    memcpy(pending, input, size);
+    pendingSize = size;
+}
+
+uint64_t Hasher::digest() const {
+    uint64_t result;
+    if(totalSize >= 32) {
+        result = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7)
+                 + rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for(auto accumulator : accumulators) {
+            result = mergeRound(result, accumulator);
+        }
+    } else {
+        result = seed + PRIME5;
+    }
+    result += totalSize;
+
+    auto tail = pending;
+    auto size = pendingSize;
+    while(size >= 8) {
+        result ^= round(0, read64(tail));
+        result = rotateLeft(result, 27) * PRIME1 + PRIME4;
+        tail += 8;
+        size -= 8;
+    }
+    if(size >= 4) {
+        result ^= (uint64_t)read32(tail) * PRIME1;
+        result = rotateLeft(result, 23) * PRIME2 + PRIME3;
+        tail += 4;
+        size -= 4;
+    }
+    while(size > 0) {
+        result ^= *tail * PRIME5;
+        result = rotateLeft(result, 11) * PRIME1;
+        tail++;
+        size--;
+    }
+
+    result ^= result >> 33;
+    result *= PRIME2;
+    result ^= result >> 29;
+    result *= PRIME3;
+    result ^= result >> 32;
+    return result;
+}
+
+uint64_t Hasher::hash(const void* data, size_t size, uint64_t seed) {
+    Hasher hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+uint64_t Hasher::hashFile(const std::string& path, Throttle* throttle) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    Hasher hasher;
+    char buffer[64 * 1024];
+    while(true) {
+        auto piece = sizeof(buffer);
+        if(throttle) {
+            piece = std::min(piece, throttle->chunkSize());
+            throttle->acquire(piece);
+        }
+        auto got = read(fd, buffer, piece);
+        if(got == 0) {
+            break;
+        }
+        if(got == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            auto error = path + ": " + strerror(errno);
+            close(fd);
+            throw std::runtime_error(error);
+        }
+        hasher.update(buffer, got);
+    }
+    close(fd);
+    return hasher.digest();
+}
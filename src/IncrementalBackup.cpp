@@ -0,0 +1,116 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/IncrementalBackup.h"
+#include "../include/Hash.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+IncrementalBackup::IncrementalBackup(std::string source, std::string target, bool useHash, Throttle* throttle)
+        : source(std::move(source)), target(std::move(target)), useHash(useHash), throttle(throttle) {
+    while(this->source.size() > 1 && this->source.back() == '/') {
+        this->source.pop_back();
+    }
+}
+
+bool IncrementalBackup::isUnchanged(const ManifestEntry& entry, const struct stat& info) {
+    return !entry.isDeleted && entry.size == (uint64_t)info.st_size && entry.mtimeSeconds == info.st_mtim.tv_sec
+           && entry.mtimeNanoseconds == (uint32_t)info.st_mtim.tv_nsec && entry.inode == info.st_ino;
+}
+
+ManifestEntry IncrementalBackup::toEntry(const std::string& path, const struct stat& info, uint64_t hash) {
+    ManifestEntry entry;
+    entry.path = path;
+    entry.size = info.st_size;
+    entry.mtimeSeconds = info.st_mtim.tv_sec;
+    entry.mtimeNanoseconds = info.st_mtim.tv_nsec;
+    entry.inode = info.st_ino;
+    entry.hash = hash;
+    return entry;
+}
+
+CopyReport IncrementalBackup::run() {
+    struct stat sourceInfo {};
+    if(stat(source.c_str(), &sourceInfo) == -1 || !S_ISDIR(sourceInfo.st_mode)) {
+        throw std::runtime_error("Incremental backup needs a source directory: " + source);
+    }
+    auto manifestPath = target + "/" + MANIFEST_NAME;
+    Manifest previous(manifestPath);
+
+    std::mutex mutex;
+    std::vector<ManifestEntry> entries;
+    // files which were to be copied, a failed copy must not look like a deletion
+    std::unordered_set<std::string> attempted;
+
+    // hashing reads whole files, it is paid for like copying, chunk by chunk as it reads
+    auto hashFile = [this](const std::string& path) {
+        return Hasher::hashFile(path, throttle);
+    };
+
+    CopyEngine engine;
+    engine.throttle = throttle;
+    engine.shouldCopy = [&](const std::string& path, const struct stat& info) {
+        auto index = previous.find(path);
+        if(index != previous.size()) {
+            auto entry = previous.entry(index);
+            if(isUnchanged(entry, info)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                entries.push_back(std::move(entry));
+                return false;
+            }
+            if(useHash && !entry.isDeleted && entry.hash != 0 && entry.size == (uint64_t)info.st_size) {
+                try {
+                    if(hashFile(source + "/" + path) == entry.hash) {
+                        // only metadata changed, backup copy gets the new times
+                        timespec times[2] = {info.st_atim, info.st_mtim};
+                        utimensat(AT_FDCWD, (target + "/" + path).c_str(), times, 0);
+                        std::lock_guard<std::mutex> lock(mutex);
+                        entries.push_back(toEntry(path, info, entry.hash));
+                        return false;
+                    }
+                } catch(std::exception&) {
+                    // unreadable now, copy reports the error
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        attempted.insert(path);
+        return true;
+    };
+    // copied file is hashed from the bytes written, source is not read again
+    engine.isHashed = useHash;
+    engine.onCopied = [&](const std::string& path, const struct stat& info, uint64_t hash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(toEntry(path, info, hash));
+    };
+    auto report = engine.mirror(source, target);
+
+    std::sort(entries.begin(), entries.end(), [](const ManifestEntry& left, const ManifestEntry& right) {
+        return left.path < right.path;
+    });
+    auto isSeen = [&](const std::string& path) {
+        auto found = std::lower_bound(entries.begin(), entries.end(), path, [](const ManifestEntry& entry, const std::string& path) {
+            return entry.path < path;
+        });
+        return found != entries.end() && found->path == path;
+    };
+    std::vector<ManifestEntry> missing;
+    for(size_t i = 0; i < previous.size(); i++) {
+        auto entry = previous.entry(i);
+        if(isSeen(entry.path)) {
+            continue;
+        }
+        if(!entry.isDeleted && attempted.find(entry.path) == attempted.end()) {
+            entry.isDeleted = true;
+            report.deleted++;
+        }
+        missing.push_back(std::move(entry));
+    }
+    entries.insert(entries.end(), std::make_move_iterator(missing.begin()), std::make_move_iterator(missing.end()));
+    Manifest::write(manifestPath, std::move(entries));
+    return report;
+}
@@ -1,4 +1,6 @@
 #include "../include/Launcher.h"
+#include <csignal>
+#include <thread>
 
 bool Launcher::isPathFlag(std::string potentialFlag) {
         return std::find(filePathFlags.begin(), filePathFlags.end(), potentialFlag.c_str()) != filePathFlags.end();
@@ -57,9 +59,78 @@ void Launcher::readFlags(int argc, char* argv[]) {
     }
 }
 
+void Launcher::flushOnTermination() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread([signals] {
+        int signalNumber = 0;
+        if(sigwait(&signals, &signalNumber) != 0) {
+            return;
+        }
+        ReportBatcher::instance().flush();
+        ReportSpool::closeAll();
+        // interpreter still ends as killed by the signal
+        signal(signalNumber, SIG_DFL);
+        sigset_t received;
+        sigemptyset(&received);
+        sigaddset(&received, signalNumber);
+        pthread_sigmask(SIG_UNBLOCK, &received, nullptr);
+        raise(signalNumber);
+    }).detach();
+}
+
 void Launcher::run() {
+    // before any thread exists, so children are reported only through supervisor's signalfd
+    HandlerSupervisor::blockChildSignal();
+    flushOnTermination();
     scanner = std::make_shared<Scanner>(configuration);
     parser = std::make_unique<Parser>(scanner);
     parser->parse();
-    parser->analyzeTree();
+    try {
+        parser->analyzeTree();
+    } catch(std::exception&) {
+        // reports waiting in batches are not lost with the script
+        ReportBatcher::instance().flush();
+        ReportSpool::closeAll();
+        throw;
+    }
+    // periodic handlers run inside interpreter, it lives as long as they do
+    Scheduler::instance().waitForActive();
+    ReportBatcher::instance().flush();
+    ReportSpool::closeAll();
+}
+
+bool Launcher::isHandlerMode(int argc, char* argv[]) {
+    return argc > 1 && std::string(argv[1]) == "--handler";
+}
+
+int Launcher::runHandler(int argc, char* argv[]) {
+    int status;
+    try {
+        if(argc < 3) {
+            throw std::runtime_error("Handler type not provided");
+        }
+        // configured the same way script did it, assignments are applied in their order
+        EvaluationVisitor visitor;
+        auto handlerRef = std::make_shared<EvaluationVisitor::SystemHandlerInfo>();
+        visitor.registerHandler("\"" + std::string(argv[2]) + "\"", handlerRef);
+        for(int i = 3; i < argc; i++) {
+            std::string setting(argv[i]);
+            auto separator = setting.find('=');
+            if(separator == std::string::npos) {
+                throw std::runtime_error("Wrong handler setting " + setting);
+            }
+            visitor.updateHandler("\"" + setting.substr(separator + 1) + "\"", setting.substr(0, separator), handlerRef);
+        }
+        handlerRef->handler->run();
+        status = handlerRef->handler->exitStatus;
+    } catch(std::exception &e) {
+        std::cerr << e.what() << '\n';
+        status = 1;
+    }
+    std::cout.flush();
+    return status;
 }
\ No newline at end of file
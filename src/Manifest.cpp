@@ -0,0 +1,161 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Manifest.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = {'T', 'K', 'M', 'F'};
+    const uint32_t VERSION = 1;
+    const uint32_t DELETED_FLAG = 1;
+
+    void writeAll(int fd, const void* data, size_t size, const std::string& path) {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = write(fd, bytes, size);
+            if(written == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+}
+
+Manifest::Manifest(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        return;
+    }
+    struct stat info {};
+    if(fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(Header)) {
+        close(fd);
+        return;
+    }
+    mappingSize = info.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return;
+    }
+    auto header = static_cast<const Header*>(mapping);
+    auto recordsEnd = sizeof(Header) + header->count * sizeof(Record);
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+       || header->count > mappingSize / sizeof(Record) || recordsEnd > mappingSize) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        return;
+    }
+    records = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(Header));
+    strings = static_cast<const char*>(mapping) + recordsEnd;
+    auto stringsSize = mappingSize - recordsEnd;
+    for(size_t i = 0; i < header->count; i++) {
+        if(records[i].pathOffset + records[i].pathLength > stringsSize) {
+            munmap(mapping, mappingSize);
+            mapping = nullptr;
+            return;
+        }
+    }
+    count = header->count;
+    madvise(mapping, mappingSize, MADV_RANDOM);
+}
+
+Manifest::~Manifest() {
+    if(mapping) {
+        munmap(mapping, mappingSize);
+    }
+}
+
+std::string_view Manifest::pathOf(const Record& record) const {
+    return std::string_view(strings + record.pathOffset, record.pathLength);
+}
+
+ManifestEntry Manifest::entry(size_t index) const {
+    auto& record = records[index];
+    ManifestEntry entry;
+    entry.path = std::string(pathOf(record));
+    entry.size = record.size;
+    entry.mtimeSeconds = record.mtimeSeconds;
+    entry.mtimeNanoseconds = record.mtimeNanoseconds;
+    entry.inode = record.inode;
+    entry.hash = record.hash;
+    entry.isDeleted = record.flags & DELETED_FLAG;
+    return entry;
+}
+
+size_t Manifest::find(std::string_view path) const {
+    auto found = std::lower_bound(records, records + count, path, [this](const Record& record, std::string_view path) {
+        return pathOf(record) < path;
+    });
+    if(found == records + count || pathOf(*found) != path) {
+        return count;
+    }
+    return found - records;
+}
+
+void Manifest::write(const std::string& path, std::vector<ManifestEntry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const ManifestEntry& left, const ManifestEntry& right) {
+        return left.path < right.path;
+    });
+    Header header {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = entries.size();
+    std::vector<Record> records;
+    records.reserve(entries.size());
+    std::string strings;
+    for(auto& entry : entries) {
+        Record record {};
+        record.pathOffset = strings.size();
+        record.pathLength = entry.path.size();
+        record.flags = entry.isDeleted ? DELETED_FLAG : 0;
+        record.size = entry.size;
+        record.mtimeSeconds = entry.mtimeSeconds;
+        record.mtimeNanoseconds = entry.mtimeNanoseconds;
+        record.inode = entry.inode;
+        record.hash = entry.hash;
+        records.push_back(record);
+        strings += entry.path;
+    }
+
+    auto temporaryPath = path + ".tmp";
+    int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+    }
+    try {
+        writeAll(fd, &header, sizeof(header), temporaryPath);
+        writeAll(fd, records.data(), records.size() * sizeof(Record), temporaryPath);
+        writeAll(fd, strings.data(), strings.size(), temporaryPath);
+        if(fdatasync(fd) == -1) {
+            throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+        }
+    } catch(std::exception&) {
+        close(fd);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+    close(fd);
+    if(rename(temporaryPath.c_str(), path.c_str()) == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    // rename itself is durable only once directory is synced
+    auto directory = path.substr(0, path.find_last_of('/') + 1);
+    int directoryFd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(directoryFd != -1) {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+}
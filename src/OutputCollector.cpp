@@ -0,0 +1,211 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/OutputCollector.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+    const uint64_t STOP_EVENT = 0;
+    // bytes taken from one pipe per event, so one command cannot starve the others
+    const size_t CHUNK_SIZE = 64 * 1024;
+}
+
+CapturedOutput::CapturedOutput(size_t maxBytes, const std::string& filePath) : maxBytes(maxBytes) {
+    int fds[2];
+    if(pipe2(fds, O_CLOEXEC) == -1) {
+        throw std::runtime_error(std::string("Cannot capture output: ") + strerror(errno));
+    }
+    readFd = fds[0];
+    writeFd = fds[1];
+    // only parent side is non-blocking, child writes block as usual
+    fcntl(readFd, F_SETFL, fcntl(readFd, F_GETFL) | O_NONBLOCK);
+    if(!filePath.empty()) {
+        fileFd = open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fileFd == -1) {
+            auto error = std::string("Cannot open ") + filePath + ": " + strerror(errno);
+            close(readFd);
+            close(writeFd);
+            throw std::runtime_error(error);
+        }
+    }
+}
+
+CapturedOutput::~CapturedOutput() {
+    for(int fd : {readFd, writeFd, fileFd}) {
+        if(fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+void CapturedOutput::closeWriteEnd() {
+    close(writeFd);
+    writeFd = -1;
+}
+
+void CapturedOutput::append(const char* data, size_t size) {
+    lineCount += std::count(data, data + size, '\n');
+    buffer.append(data, size);
+    // trimmed in bulk, so dropping old output stays amortized constant per byte
+    if(buffer.size() > 2 * maxBytes) {
+        buffer.erase(0, buffer.size() - maxBytes);
+    }
+}
+
+bool CapturedOutput::drain(size_t limit) {
+    if(isClosed) {
+        return false;
+    }
+    size_t taken = 0;
+    char chunk[CHUNK_SIZE];
+    while(taken < limit) {
+        ssize_t moved = -1;
+        if(fileFd != -1) {
+            moved = splice(readFd, nullptr, fileFd, nullptr, CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if(moved == -1 && errno == EINVAL) {
+                // file system without splice support
+                moved = read(readFd, chunk, sizeof(chunk));
+                if(moved > 0 && write(fileFd, chunk, moved) != moved) {
+                    moved = -1;
+                }
+            }
+        } else {
+            moved = read(readFd, chunk, sizeof(chunk));
+            if(moved > 0) {
+                append(chunk, moved);
+            }
+        }
+        if(moved == 0) {
+            isClosed = true;
+            return false;
+        }
+        if(moved == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN) {
+                return true;
+            }
+            isClosed = true;
+            return false;
+        }
+        taken += moved;
+    }
+    return true;
+}
+
+std::string CapturedOutput::text() {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain(SIZE_MAX);
+    if(fileFd == -1) {
+        return buffer.size() > maxBytes ? buffer.substr(buffer.size() - maxBytes) : buffer;
+    }
+    auto size = lseek(fileFd, 0, SEEK_END);
+    auto offset = size > (off_t)maxBytes ? size - (off_t)maxBytes : 0;
+    std::string content(size - offset, '\0');
+    auto got = pread(fileFd, content.data(), content.size(), offset);
+    content.resize(got > 0 ? got : 0);
+    return content;
+}
+
+size_t CapturedOutput::lines() {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain(SIZE_MAX);
+    if(fileFd == -1) {
+        return lineCount;
+    }
+    size_t count = 0;
+    char chunk[CHUNK_SIZE];
+    off_t offset = 0;
+    ssize_t got;
+    while((got = pread(fileFd, chunk, sizeof(chunk), offset)) > 0) {
+        count += std::count(chunk, chunk + got, '\n');
+        offset += got;
+    }
+    return count;
+}
+
+OutputCollector& OutputCollector::instance() {
+    static OutputCollector collector;
+    return collector;
+}
+
+OutputCollector::OutputCollector() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(epollFd == -1 || stopFd == -1) {
+        throw std::runtime_error(std::string("Cannot create output event loop: ") + strerror(errno));
+    }
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = STOP_EVENT;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event);
+    loop = std::thread([this] { run(); });
+}
+
+OutputCollector::~OutputCollector() {
+    uint64_t one = 1;
+    if(write(stopFd, &one, sizeof(one)) == sizeof(one) && loop.joinable()) {
+        loop.join();
+    } else if(loop.joinable()) {
+        loop.detach();
+    }
+    close(epollFd);
+    close(stopFd);
+}
+
+void OutputCollector::collect(std::shared_ptr<CapturedOutput> output) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // ids instead of descriptors, a closed descriptor number can be reused by next capture
+    auto id = nextId++;
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, output->readFd, &event) == -1) {
+        throw std::runtime_error(std::string("Cannot capture output: ") + strerror(errno));
+    }
+    outputs[id] = std::move(output);
+}
+
+void OutputCollector::run() {
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+    while(true) {
+        int ready = epoll_wait(epollFd, events, maxEvents, -1);
+        if(ready == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for(int i = 0; i < ready; i++) {
+            auto id = events[i].data.u64;
+            if(id == STOP_EVENT) {
+                return;
+            }
+            auto found = outputs.find(id);
+            if(found == outputs.end()) {
+                continue;
+            }
+            // kept alive until unlocked, handler could have dropped its reference already
+            auto output = found->second;
+            std::lock_guard<std::mutex> outputLock(output->mutex);
+            // level triggered, whatever is left over comes back in next round
+            if(!output->drain(CHUNK_SIZE)) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, output->readFd, nullptr);
+                close(output->readFd);
+                output->readFd = -1;
+                outputs.erase(found);
+            }
+        }
+    }
+}
@@ -57,6 +57,13 @@ std::shared_ptr<RootExpression> Parser::tryToBuildVarNamePrefixStatement() {
         return newRoot;
     }
 
+    if(token.getType() == T_RET) {
+        token = getTokenValFromScanner();
+        auto newRoot = std::make_shared<RootExpression>();
+        newRoot->expr = std::make_shared<RetExpression>();
+        return newRoot;
+    }
+
     if(token.getType() == T_SYSTEM_HANDLER) {
         auto systemHandlerToken = token;
         token = getTokenValFromScanner();
@@ -74,7 +81,7 @@ std::shared_ptr<RootExpression> Parser::tryToBuildVarNamePrefixStatement() {
             return newRoot;
         }
     }
-
+    return nullptr;
 }
 
 std::shared_ptr<TypeSpecifierExpression> Parser::getExpressionWithAssignedSpecifier() {
@@ -148,6 +155,48 @@ void Parser::createWhileExpression(Token token) {
     recentExpressions.size();
     recentExpressions.push(std::move(whileExpr));
 }
+void Parser::createEveryExpression(Token token) {
+    auto everyExpr = std::make_shared<EveryExpression>();
+    if(recentExpressions.empty()) {
+        throw std::runtime_error("every expects interval");
+    }
+    everyExpr->left = recentExpressions.top();
+    recentExpressions.pop();
+    recentExpressions.push(std::move(everyExpr));
+}
+void Parser::createForExpression(Token token) {
+    auto forExpr = std::make_shared<ForExpression>();
+    auto range = recentExpressions.top();
+    recentExpressions.pop();
+
+    forExpr->left = range;
+    recentExpressions.push(std::move(forExpr));
+}
+
+void Parser::createParallelForExpression(Token token) {
+    auto parallelForExpr = std::make_shared<ParallelForExpression>();
+    auto range = recentExpressions.top();
+    recentExpressions.pop();
+
+    parallelForExpr->left = range;
+    recentExpressions.push(std::move(parallelForExpr));
+}
+void Parser::createSpawnExpression(Token token) {
+    auto spawnExpr = std::make_shared<SpawnExpression>();
+    spawnExpr->call = std::dynamic_pointer_cast<FunctionCallExpression>(recentExpressions.top());
+    if(!spawnExpr->call) {
+        throw std::runtime_error("spawn expects function call");
+    }
+    recentExpressions.pop();
+    recentExpressions.push(std::move(spawnExpr));
+}
+
+void Parser::createAwaitExpression(Token token) {
+    auto awaitExpr = std::make_shared<AwaitExpression>();
+    awaitExpr->handle = recentExpressions.top();
+    recentExpressions.pop();
+    recentExpressions.push(std::move(awaitExpr));
+}
 void Parser::setDoubleArgsExpr(std::shared_ptr<DoubleArgsExpression> doubleArgsExpression) {
     if(recentExpressions.size() < 2) {
         throw std::runtime_error("Not enough args for operation");
@@ -244,6 +293,13 @@ std::shared_ptr<RootExpression> Parser::assignTreeToRoot() {
 }
 
 void Parser::createDoExpression(Token token) {
+    // condition written on the same line as do is a statement of its own, as if do was on the next line
+    if(!recentExpressions.empty()) {
+        auto condition = std::make_shared<RootExpression>();
+        condition->expr = recentExpressions.top();
+        recentExpressions.pop();
+        handleNewExpression(condition);
+    }
     auto condBody = std::make_shared<DoExpression>();
     recentExpressions.push(condBody);
 }
@@ -512,17 +568,18 @@ void Parser::handleNewExpression(std::shared_ptr<RootExpression> nextRoot) {
 
     if(mainRoot->roots.empty()) {
         mainRoot->roots.push_back(nextRoot);
-    } else if(auto maybePut = std::dynamic_pointer_cast<PutExpression>(mainRoot->roots.back()->expr)) {
+        return;
+    }
+    // argument of put/ret is a part of it, not a separate statement
+    if(auto maybePut = std::dynamic_pointer_cast<PutExpression>(mainRoot->roots.back()->expr)) {
         if(maybePut->toPrint == nullptr) {
             maybePut->toPrint = nextRoot->expr;
-        } else {
-            mainRoot->roots.push_back(nextRoot);
+            return;
         }
     } else if(auto maybeRet = std::dynamic_pointer_cast<RetExpression>(mainRoot->roots.back()->expr)) {
         if(maybeRet->toRet == nullptr) {
             maybeRet->toRet = nextRoot->expr;
-        } else {
-            mainRoot->roots.push_back(nextRoot);
+            return;
         }
     }
     mainRoot->roots.push_back(nextRoot);
@@ -0,0 +1,158 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/ProcessLauncher.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <map>
+#include <set>
+#include <spawn.h>
+#include <stdexcept>
+
+extern char **environ;
+
+namespace {
+    std::string interpreterPath {"/proc/self/exe"};
+}
+
+const std::string& ProcessLauncher::interpreter() {
+    return interpreterPath;
+}
+
+void ProcessLauncher::setInterpreter(const std::string& path) {
+    interpreterPath = path;
+}
+
+std::vector<std::string> ProcessLauncher::splitCommandLine(const std::string& commandLine) {
+    std::vector<std::string> args;
+    std::string current;
+    bool hasToken = false;
+    char quote = 0;
+    for(size_t i = 0; i < commandLine.size(); i++) {
+        char sign = commandLine[i];
+        if(quote) {
+            if(sign == quote) {
+                quote = 0;
+            } else if(sign == '\\' && quote == '"' && i + 1 < commandLine.size()) {
+                current += commandLine[++i];
+            } else {
+                current += sign;
+            }
+        } else if(sign == '\'' || sign == '"') {
+            quote = sign;
+            hasToken = true;
+        } else if(sign == '\\' && i + 1 < commandLine.size()) {
+            current += commandLine[++i];
+            hasToken = true;
+        } else if(isspace((unsigned char)sign)) {
+            if(hasToken) {
+                args.push_back(current);
+                current.clear();
+                hasToken = false;
+            }
+        } else {
+            current += sign;
+            hasToken = true;
+        }
+    }
+    if(quote) {
+        throw std::runtime_error("Unterminated quote in command: " + commandLine);
+    }
+    if(hasToken) {
+        args.push_back(current);
+    }
+    return args;
+}
+
+bool ProcessLauncher::needsShell(const std::string& commandLine) {
+    if(commandLine.find_first_of(";|&<>$`*?[]{}()~#\n") != std::string::npos) {
+        return true;
+    }
+    // builtins and keywords have no binary to exec, NAME=value prefix is an assignment
+    static const std::set<std::string> shellWords {
+        "exit", "cd", "export", "source", ".", "alias", "unalias", "set", "unset", "exec", "eval",
+        "read", "shift", "trap", "ulimit", "umask", "wait", "return", "readonly", "local",
+        "if", "for", "while", "until", "case", "!"
+    };
+    auto start = commandLine.find_first_not_of(" \t");
+    if(start == std::string::npos) {
+        return false;
+    }
+    auto first = commandLine.substr(start, commandLine.find_first_of(" \t", start) - start);
+    return shellWords.count(first) || first.find('=') != std::string::npos;
+}
+
+std::vector<std::string> ProcessLauncher::buildEnvironment(const std::string& assignments) {
+    std::map<std::string, std::string> variables;
+    for(char **variable = environ; *variable; variable++) {
+        std::string entry(*variable);
+        variables[entry.substr(0, entry.find('='))] = entry;
+    }
+    size_t begin = 0;
+    while(begin < assignments.size()) {
+        size_t end = assignments.find(';', begin);
+        if(end == std::string::npos) {
+            end = assignments.size();
+        }
+        auto assignment = assignments.substr(begin, end - begin);
+        auto separator = assignment.find('=');
+        if(separator == std::string::npos || separator == 0) {
+            throw std::runtime_error("Wrong environment assignment: " + assignment);
+        }
+        variables[assignment.substr(0, separator)] = assignment;
+        begin = end + 1;
+    }
+    std::vector<std::string> environment;
+    for(auto& [name, entry] : variables) {
+        environment.push_back(entry);
+    }
+    return environment;
+}
+
+pid_t ProcessLauncher::spawn(const SpawnOptions& options) {
+    if(options.argv.empty()) {
+        throw std::runtime_error("Nothing to run");
+    }
+    std::vector<char*> argv;
+    for(auto& arg : options.argv) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    std::vector<char*> envp;
+    for(auto& entry : options.environment) {
+        envp.push_back(const_cast<char*>(entry.c_str()));
+    }
+    envp.push_back(nullptr);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    // interpreter blocks SIGCHLD for its supervisor and termination signals for flushing, commands get a clean mask
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    posix_spawnattr_setsigmask(&attributes, &emptyMask);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    if(!options.workingDir.empty()) {
+        posix_spawn_file_actions_addchdir_np(&fileActions, options.workingDir.c_str());
+    }
+    if(options.stdoutFd != -1) {
+        posix_spawn_file_actions_adddup2(&fileActions, options.stdoutFd, STDOUT_FILENO);
+    }
+    if(options.stderrFd != -1) {
+        posix_spawn_file_actions_adddup2(&fileActions, options.stderrFd, STDERR_FILENO);
+    }
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &fileActions, &attributes, argv.data(),
+                             options.environment.empty() ? environ : envp.data());
+    posix_spawn_file_actions_destroy(&fileActions);
+    posix_spawnattr_destroy(&attributes);
+    if(error != 0) {
+        throw std::runtime_error("Cannot run " + options.argv[0] + ": " + strerror(error));
+    }
+    return pid;
+}
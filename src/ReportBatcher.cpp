@@ -0,0 +1,194 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/ReportBatcher.h"
+#include "../include/ReportSpool.h"
+#include <iostream>
+
+namespace {
+    // doubled after every failed attempt
+    const std::chrono::milliseconds RETRY_DELAY(250);
+}
+
+ReportBatcher& ReportBatcher::instance() {
+    static ReportBatcher batcher;
+    return batcher;
+}
+
+ReportBatcher::~ReportBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    changed.notify_all();
+    if(flusher.joinable()) {
+        flusher.join();
+    }
+}
+
+ReportBatcher::Outcome ReportBatcher::submit(const std::string& relay, const std::string& spool, SmtpMessage message,
+                                             std::chrono::milliseconds window, size_t maxReports) {
+    std::string key = relay + '\n' + spool + '\n' + message.from;
+    for(auto& recipient : message.recipients) {
+        key += '\n' + recipient;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if(!flusher.joinable()) {
+        flusher = std::thread([this] { run(); });
+    }
+    auto& batch = batches[key];
+    if(batch.reports.empty()) {
+        batch.key = key;
+        batch.relay = relay;
+        batch.spool = spool;
+        batch.deadline = std::chrono::steady_clock::now() + window;
+    }
+    auto& reports = batch.reports;
+    if(!reports.empty() && reports.back().subject == message.subject && reports.back().body == message.body) {
+        reports.back().repeats++;
+    } else {
+        reports.push_back({std::move(message.subject), std::move(message.body)});
+    }
+    batch.message = std::move(message);
+    auto outcome = std::make_shared<std::atomic<Delivery>>(Delivery::PENDING);
+    batch.outcomes.push_back(outcome);
+    if(batch.reports.size() >= maxReports) {
+        auto full = std::move(batch);
+        batches.erase(key);
+        sending++;
+        lock.unlock();
+        send(full, false);
+        lock.lock();
+        sending--;
+        changed.notify_all();
+        return outcome;
+    }
+    changed.notify_all();
+    return outcome;
+}
+
+void ReportBatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!isStopping) {
+        auto now = std::chrono::steady_clock::now();
+        auto nextDeadline = std::chrono::steady_clock::time_point::max();
+        std::vector<Batch> due;
+        for(auto batch = batches.begin(); batch != batches.end();) {
+            if(batch->second.deadline <= now) {
+                due.push_back(std::move(batch->second));
+                batch = batches.erase(batch);
+            } else {
+                nextDeadline = std::min(nextDeadline, batch->second.deadline);
+                batch++;
+            }
+        }
+        if(!due.empty()) {
+            sending += due.size();
+            lock.unlock();
+            for(auto& batch : due) {
+                send(batch, false);
+            }
+            lock.lock();
+            sending -= due.size();
+            changed.notify_all();
+            continue;
+        }
+        if(nextDeadline == std::chrono::steady_clock::time_point::max()) {
+            changed.wait(lock);
+        } else {
+            changed.wait_until(lock, nextDeadline);
+        }
+    }
+}
+
+void ReportBatcher::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        std::vector<Batch> all;
+        for(auto& [key, batch] : batches) {
+            all.push_back(std::move(batch));
+        }
+        batches.clear();
+        if(all.empty()) {
+            if(sending == 0) {
+                return;
+            }
+            // batch failing in flusher meanwhile is put back and taken by next round
+            changed.wait(lock);
+            continue;
+        }
+        sending += all.size();
+        lock.unlock();
+        for(auto& batch : all) {
+            send(batch, true);
+        }
+        lock.lock();
+        sending -= all.size();
+        changed.notify_all();
+    }
+}
+
+void ReportBatcher::finish(Batch& batch, Delivery delivery) {
+    for(auto& outcome : batch.outcomes) {
+        outcome->store(delivery);
+    }
+}
+
+void ReportBatcher::requeue(Batch batch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto retryAt = std::chrono::steady_clock::now() + RETRY_DELAY * (1 << (batch.failures - 1));
+    auto& current = batches[batch.key];
+    if(!current.reports.empty()) {
+        // reports which came meanwhile follow the older ones in the same digest
+        batch.reports.insert(batch.reports.end(), current.reports.begin(), current.reports.end());
+        batch.outcomes.insert(batch.outcomes.end(), current.outcomes.begin(), current.outcomes.end());
+        retryAt = std::min(retryAt, current.deadline);
+    }
+    batch.deadline = retryAt;
+    current = std::move(batch);
+    changed.notify_all();
+}
+
+void ReportBatcher::send(Batch& batch, bool isLastAttempt) {
+    auto& message = batch.message;
+    bool isDigest = batch.reports.size() > 1;
+    message.subject = isDigest ? "Digest of " + std::to_string(batch.reports.size()) + " raports"
+                               : batch.reports[0].subject;
+    message.body.clear();
+    for(auto& report : batch.reports) {
+        if(isDigest) {
+            message.body += "== " + report.subject + " ==\n";
+        }
+        message.body += report.body;
+        if(!message.body.empty() && message.body.back() != '\n') {
+            message.body += '\n';
+        }
+        if(report.repeats > 1) {
+            message.body += "Repeated " + std::to_string(report.repeats) + " times.\n";
+        }
+    }
+    try {
+        if(batch.spool.empty()) {
+            SmtpPool::instance().send(batch.relay, message);
+        } else {
+            ReportSpool::open(batch.spool)->enqueue(batch.relay, message);
+        }
+        finish(batch, Delivery::SENT);
+        return;
+    } catch(SmtpRefusal& e) {
+        std::cerr << e.what() << '\n';
+    } catch(std::exception& e) {
+        std::cerr << e.what() << '\n';
+        if(!isLastAttempt && ++batch.failures < MAX_ATTEMPTS) {
+            requeue(std::move(batch));
+            return;
+        }
+    }
+    std::string recipients;
+    for(auto& recipient : message.recipients) {
+        recipients += (recipients.empty() ? "" : ", ") + recipient;
+    }
+    std::cerr << batch.reports.size() << " raports to " << recipients << " were not delivered\n";
+    finish(batch, Delivery::FAILED);
+}
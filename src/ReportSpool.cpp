@@ -0,0 +1,423 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/ReportSpool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+    const uint32_t MAGIC = 0x50534B54;
+    const auto FIRST_RETRY = std::chrono::seconds(1);
+    const auto LAST_RETRY = std::chrono::seconds(300);
+    // failed write of a group is tried again after a growing delay
+    const int WRITE_ATTEMPTS = 3;
+    const auto WRITE_RETRY = std::chrono::milliseconds(100);
+
+    std::mutex openMutex;
+    std::map<std::string, std::shared_ptr<ReportSpool>> opened;
+
+    void writeAll(int fd, const void* data, size_t size, const std::string& path) {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = write(fd, bytes, size);
+            if(written == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    void putString(std::string& out, const std::string& value) {
+        uint32_t length = value.size();
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out += value;
+    }
+
+    bool getString(const std::string& in, size_t& position, std::string& value) {
+        uint32_t length;
+        if(position + sizeof(length) > in.size()) {
+            return false;
+        }
+        memcpy(&length, in.data() + position, sizeof(length));
+        position += sizeof(length);
+        if(position + length > in.size()) {
+            return false;
+        }
+        value = in.substr(position, length);
+        position += length;
+        return true;
+    }
+
+    std::string payloadOf(const std::string& relay, const SmtpMessage& message) {
+        std::string payload;
+        putString(payload, relay);
+        putString(payload, message.from);
+        putString(payload, message.subject);
+        putString(payload, message.body);
+        for(auto& recipient : message.recipients) {
+            putString(payload, recipient);
+        }
+        return payload;
+    }
+
+    bool readPayload(const std::string& payload, std::string& relay, SmtpMessage& message) {
+        size_t position = 0;
+        if(!getString(payload, position, relay) || !getString(payload, position, message.from)
+           || !getString(payload, position, message.subject) || !getString(payload, position, message.body)) {
+            return false;
+        }
+        std::string recipient;
+        while(position < payload.size()) {
+            if(!getString(payload, position, recipient)) {
+                return false;
+            }
+            message.recipients.push_back(recipient);
+        }
+        return true;
+    }
+
+    uint32_t checksumOf(uint8_t type, uint64_t id, const char* payload, size_t length) {
+        auto checksum = crc32(0, &type, sizeof(type));
+        checksum = crc32(checksum, reinterpret_cast<const Bytef*>(&id), sizeof(id));
+        return crc32(checksum, reinterpret_cast<const Bytef*>(payload), length);
+    }
+}
+
+std::shared_ptr<ReportSpool> ReportSpool::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(openMutex);
+    auto& spool = opened[path];
+    if(!spool) {
+        spool = std::make_shared<ReportSpool>(path);
+    }
+    return spool;
+}
+
+void ReportSpool::closeAll() {
+    std::lock_guard<std::mutex> lock(openMutex);
+    for(auto& [path, spool] : opened) {
+        spool->drain();
+    }
+    opened.clear();
+}
+
+ReportSpool::ReportSpool(const std::string& path, uint64_t compactBytes) : path(path), compactBytes(compactBytes) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    try {
+        if(flock(fd, LOCK_EX | LOCK_NB) == -1) {
+            throw std::runtime_error(path + ": " + (errno == EWOULDBLOCK ? "spool is used by another process"
+                                                                          : strerror(errno)));
+        }
+        recover();
+    } catch(std::exception&) {
+        close(fd);
+        throw;
+    }
+    committer = std::thread([this] { commit(); });
+    sender = std::thread([this] { send(); });
+}
+
+ReportSpool::~ReportSpool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    changed.notify_all();
+    sender.join();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isClosed = true;
+    }
+    written.notify_all();
+    committer.join();
+    close(fd);
+}
+
+void ReportSpool::recover() {
+    struct stat info {};
+    if(fstat(fd, &info) == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    std::string content(info.st_size, '\0');
+    size_t got = 0;
+    while(got < content.size()) {
+        auto read = pread(fd, &content[got], content.size() - got, got);
+        if(read == -1 && errno == EINTR) {
+            continue;
+        }
+        if(read <= 0) {
+            throw std::runtime_error(path + ": " + (read == 0 ? "file shrank while read" : strerror(errno)));
+        }
+        got += read;
+    }
+    // records after a damaged one are a write cut by a crash, they were never acknowledged
+    size_t position = 0;
+    while(position + sizeof(RecordHeader) <= content.size()) {
+        RecordHeader header {};
+        memcpy(&header, content.data() + position, sizeof(header));
+        auto payloadStart = position + sizeof(header);
+        if(header.magic != MAGIC || header.length > content.size() - payloadStart
+           || header.checksum != checksumOf(header.type, header.id, content.data() + payloadStart, header.length)) {
+            break;
+        }
+        if(header.type == REPORT) {
+            Entry entry;
+            entry.size = sizeof(header) + header.length;
+            if(readPayload(content.substr(payloadStart, header.length), entry.relay, entry.message)) {
+                entries[header.id] = std::move(entry);
+            }
+        } else if(header.type == DONE) {
+            entries.erase(header.id);
+        }
+        nextId = std::max(nextId, header.id + 1);
+        position = payloadStart + header.length;
+    }
+    for(auto& [id, entry] : entries) {
+        liveBytes += entry.size;
+    }
+    fileSize = entries.empty() ? 0 : position;
+    if(fileSize != content.size() && ftruncate(fd, fileSize) == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+}
+
+std::string ReportSpool::record(RecordType type, uint64_t id, const std::string& payload) {
+    RecordHeader header {};
+    header.magic = MAGIC;
+    header.length = payload.size();
+    header.checksum = checksumOf(type, id, payload.data(), payload.size());
+    header.type = type;
+    header.id = id;
+    std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    return bytes + payload;
+}
+
+void ReportSpool::append(RecordType type, uint64_t id, const std::string& payload) {
+    bool wasEmpty = buffer.empty();
+    buffer += record(type, id, payload);
+    appended += sizeof(RecordHeader) + payload.size();
+    hasReports |= type == REPORT;
+    // committer sleeps only on an empty buffer, otherwise it takes this record with its next group
+    if(wasEmpty) {
+        written.notify_one();
+    }
+}
+
+void ReportSpool::enqueue(const std::string& relay, SmtpMessage message) {
+    auto payload = payloadOf(relay, message);
+    std::lock_guard<std::mutex> lock(mutex);
+    if(isStopping) {
+        throw std::runtime_error(path + ": spool is closed");
+    }
+    auto id = nextId++;
+    append(REPORT, id, payload);
+    auto& entry = entries[id];
+    entry.relay = relay;
+    entry.message = std::move(message);
+    entry.end = appended;
+    entry.size = sizeof(RecordHeader) + payload.size();
+    liveBytes += entry.size;
+}
+
+void ReportSpool::commit() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        written.wait(lock, [this] { return !buffer.empty() || isClosed; });
+        if(buffer.empty()) {
+            return;
+        }
+        if(entries.empty()) {
+            // everything was sent, records in buffer would only be undone by truncation
+            buffer.clear();
+            hasReports = false;
+            committed = appended;
+            if(fileSize > 0 && ftruncate(fd, 0) == 0) {
+                fileSize = 0;
+            }
+            changed.notify_all();
+            continue;
+        }
+        std::string group;
+        group.swap(buffer);
+        auto upTo = appended;
+        bool isSynced = hasReports;
+        hasReports = false;
+        // records of sent reports only grow the file, waiting ones are written anew instead of the group
+        std::string records;
+        auto total = fileSize + group.size();
+        if(isBehind || (total > liveBytes && total - liveBytes > compactBytes)) {
+            for(auto& [id, entry] : entries) {
+                records += record(REPORT, id, payloadOf(entry.relay, entry.message));
+            }
+        }
+        lock.unlock();
+        bool isCompacted = false;
+        if(!records.empty()) {
+            try {
+                compact(records);
+                isCompacted = true;
+            } catch(std::exception& e) {
+                std::cerr << e.what() << '\n';
+            }
+        }
+        bool isWritten = isCompacted || write(group, isSynced);
+        lock.lock();
+        if(isCompacted) {
+            fileSize = records.size();
+        } else if(isWritten) {
+            fileSize += group.size();
+        } else {
+            // reports are still sent from memory, only their durability is lost until next commit
+            std::cerr << path << ": reports are not on disk\n";
+        }
+        isBehind = !isCompacted && (isBehind || !isWritten);
+        committed = upTo;
+        changed.notify_all();
+    }
+}
+
+bool ReportSpool::write(const std::string& group, bool isSynced) {
+    for(int attempt = 1;; attempt++) {
+        try {
+            writeAll(fd, group.data(), group.size(), path);
+            // done records may wait for the next sync, a crash before it only sends a report twice
+            if(isSynced && fdatasync(fd) == -1) {
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            return true;
+        } catch(std::exception& e) {
+            std::cerr << e.what() << '\n';
+        }
+        // recovery stops at a torn record, so part of group which got in is cut off before next write
+        if(ftruncate(fd, fileSize) == -1) {
+            std::cerr << path << ": " << strerror(errno) << '\n';
+            return false;
+        }
+        if(attempt == WRITE_ATTEMPTS) {
+            return false;
+        }
+        std::this_thread::sleep_for(WRITE_RETRY * (1 << (attempt - 1)));
+    }
+}
+
+void ReportSpool::compact(const std::string& records) {
+    auto temporaryPath = path + ".tmp";
+    int compactedFd = ::open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if(compactedFd == -1) {
+        throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+    }
+    try {
+        // locked before it gets the name of spool, so no other interpreter takes it meanwhile
+        if(flock(compactedFd, LOCK_EX | LOCK_NB) == -1) {
+            throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+        }
+        writeAll(compactedFd, records.data(), records.size(), temporaryPath);
+        if(fdatasync(compactedFd) == -1) {
+            throw std::runtime_error(temporaryPath + ": " + strerror(errno));
+        }
+        if(rename(temporaryPath.c_str(), path.c_str()) == -1) {
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+    } catch(std::exception&) {
+        close(compactedFd);
+        unlink(temporaryPath.c_str());
+        throw;
+    }
+    // rename itself is durable only once directory is synced
+    auto directory = path.substr(0, path.find_last_of('/') + 1);
+    int directoryFd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(directoryFd != -1) {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+    close(fd);
+    fd = compactedFd;
+}
+
+std::map<uint64_t, ReportSpool::Entry>::iterator ReportSpool::findDue(std::chrono::steady_clock::time_point now) {
+    for(auto entry = entries.begin(); entry != entries.end(); entry++) {
+        // ids grow with position, rest of entries is not on disk yet either
+        if(entry->second.end > committed) {
+            break;
+        }
+        auto backoff = backoffs.find(entry->second.relay);
+        if(backoff == backoffs.end() || backoff->second.resumeAt <= now) {
+            return entry;
+        }
+    }
+    return entries.end();
+}
+
+void ReportSpool::send() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!isStopping) {
+        auto now = std::chrono::steady_clock::now();
+        auto due = findDue(now);
+        if(due == entries.end()) {
+            // backoff already over has no report waiting on disk, committer wakes sender for new ones
+            auto resumeAt = std::chrono::steady_clock::time_point::max();
+            for(auto& [relay, backoff] : backoffs) {
+                if(backoff.resumeAt > now) {
+                    resumeAt = std::min(resumeAt, backoff.resumeAt);
+                }
+            }
+            if(resumeAt == std::chrono::steady_clock::time_point::max()) {
+                changed.wait(lock);
+            } else {
+                changed.wait_until(lock, resumeAt);
+            }
+            continue;
+        }
+        // only this thread removes entries, so the entry stays valid while it is sent unlocked
+        inFlight = due->first;
+        auto& entry = due->second;
+        lock.unlock();
+        bool isDone = true;
+        try {
+            SmtpPool::instance().send(entry.relay, entry.message);
+        } catch(SmtpRefusal& e) {
+            std::cerr << e.what() << ", report is dropped\n";
+        } catch(std::exception& e) {
+            isDone = false;
+            std::cerr << e.what() << '\n';
+        }
+        lock.lock();
+        inFlight = 0;
+        if(isDone) {
+            backoffs.erase(entry.relay);
+            liveBytes -= entry.size;
+            append(DONE, due->first, "");
+            entries.erase(due);
+        } else {
+            auto& backoff = backoffs[entry.relay];
+            auto delay = std::min<std::chrono::steady_clock::duration>(FIRST_RETRY * (1 << std::min(backoff.failures, 16)),
+                                                                       LAST_RETRY);
+            backoff.failures++;
+            backoff.resumeAt = std::chrono::steady_clock::now() + delay;
+        }
+        changed.notify_all();
+    }
+}
+
+void ReportSpool::drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] {
+        return buffer.empty() && committed == appended && inFlight == 0
+               && findDue(std::chrono::steady_clock::now()) == entries.end();
+    });
+}
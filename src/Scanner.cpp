@@ -126,6 +126,7 @@ bool Scanner::tryToBuildRealNumWithGivenPrefix(std::string val) {
     if(isalpha(sign) || sign == '(' ) {
         throw std::runtime_error("Forbidden sign in num!");
     }
+    return false;
 }
 bool Scanner::tryToBuildNonQuotedSign() {
     if (isalpha(sign) || sign == '_') {
@@ -0,0 +1,323 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Scheduler.h"
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    const std::chrono::milliseconds TICK(10);
+}
+
+struct Scheduler::Timer {
+    Id id;
+    PeriodicTask task;
+    uint64_t periodTicks;
+    uint64_t jitterTicks;
+    // start of current period, due is later by jitter
+    uint64_t base;
+    uint64_t due;
+    Timer* previous {nullptr};
+    Timer* next {nullptr};
+    Slot* slot {nullptr};
+    bool isRunning {false};
+    // ticks caught up after the running one
+    size_t pendingRuns {0};
+    bool isFinished {false};
+    bool isReleased {false};
+    int status {0};
+};
+
+Scheduler& Scheduler::instance() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        changed.notify_all();
+    }
+    if(driver.joinable()) {
+        driver.join();
+    }
+}
+
+uint64_t Scheduler::tickOf(std::chrono::steady_clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time - start) / TICK;
+}
+
+uint64_t Scheduler::ticksOf(std::chrono::milliseconds duration) const {
+    return (duration.count() + TICK.count() - 1) / TICK.count();
+}
+
+Scheduler::Id Scheduler::add(PeriodicTask task) {
+    if(!task.run) {
+        throw std::runtime_error("Periodic task has nothing to run");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!driver.joinable()) {
+        start = std::chrono::steady_clock::now();
+        currentTick = 0;
+        driver = std::thread([this] { run(); });
+    }
+    auto timer = std::make_shared<Timer>();
+    timer->id = nextId++;
+    timer->periodTicks = std::max<uint64_t>(1, ticksOf(task.period));
+    // larger jitter could reorder ticks of one schedule
+    timer->jitterTicks = std::min(ticksOf(task.jitter), timer->periodTicks - 1);
+    timer->task = std::move(task);
+    // first tick is right away, spread by jitter only
+    timer->base = std::max(currentTick, tickOf(std::chrono::steady_clock::now()));
+    scheduleNext(timer.get());
+    timers[timer->id] = timer;
+    activeCount++;
+    changed.notify_all();
+    return timer->id;
+}
+
+void Scheduler::scheduleNext(Timer* timer) {
+    timer->due = timer->base;
+    if(timer->jitterTicks > 0) {
+        timer->due += std::uniform_int_distribution<uint64_t>(0, timer->jitterTicks)(random);
+    }
+    place(timer);
+}
+
+void Scheduler::place(Timer* timer) {
+    if(timer->due < currentTick) {
+        timer->due = currentTick;
+    }
+    auto delta = timer->due - currentTick;
+    size_t level = 0;
+    while(level + 1 < LEVELS && delta >= (uint64_t)1 << (SLOT_BITS * (level + 1))) {
+        level++;
+    }
+    if(level == LEVELS - 1 && delta >= (uint64_t)1 << (SLOT_BITS * LEVELS)) {
+        // beyond the wheel, placed at its end and placed again once it comes closer
+        timer->due = currentTick + ((uint64_t)1 << (SLOT_BITS * LEVELS)) - 1;
+    }
+    auto& slot = wheel[level][(timer->due >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    timer->slot = &slot;
+    timer->previous = nullptr;
+    timer->next = slot.first;
+    if(slot.first) {
+        slot.first->previous = timer;
+    }
+    slot.first = timer;
+}
+
+void Scheduler::unlink(Timer* timer) {
+    if(!timer->slot) {
+        return;
+    }
+    if(timer->previous) {
+        timer->previous->next = timer->next;
+    } else {
+        timer->slot->first = timer->next;
+    }
+    if(timer->next) {
+        timer->next->previous = timer->previous;
+    }
+    timer->slot = nullptr;
+    timer->previous = nullptr;
+    timer->next = nullptr;
+}
+
+void Scheduler::fire(Timer* timer) {
+    size_t runs = 1;
+    timer->base += timer->periodTicks;
+    if(timer->base < currentTick) {
+        // driver was late, periods passed without a tick
+        auto late = (currentTick - timer->base + timer->periodTicks - 1) / timer->periodTicks;
+        timer->base += late * timer->periodTicks;
+        if(timer->task.missed == PeriodicTask::Missed::CATCHUP) {
+            runs += late;
+        }
+    }
+    scheduleNext(timer);
+    if(timer->isRunning) {
+        if(timer->task.missed == PeriodicTask::Missed::CATCHUP) {
+            timer->pendingRuns += runs;
+        }
+        return;
+    }
+    timer->isRunning = true;
+    timer->pendingRuns = runs - 1;
+    pool.submit([this, timer = timers.at(timer->id)] { runTick(timer); });
+}
+
+void Scheduler::runTick(std::shared_ptr<Timer> timer) {
+    while(true) {
+        bool isContinued = false;
+        int status = 0;
+        try {
+            isContinued = timer->task.run();
+        } catch(std::exception& e) {
+            std::cerr << e.what() << '\n';
+            status = 1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!isContinued) {
+            finish(timer.get(), status);
+        }
+        if(timer->isFinished || timer->pendingRuns == 0) {
+            timer->isRunning = false;
+            return;
+        }
+        timer->pendingRuns--;
+    }
+}
+
+void Scheduler::finish(Timer* timer, int status) {
+    if(timer->isFinished) {
+        return;
+    }
+    unlink(timer);
+    timer->isFinished = true;
+    timer->status = status;
+    timer->pendingRuns = 0;
+    activeCount--;
+    finished.notify_all();
+    // last use of timer here, erasing can destroy it
+    if(timer->isReleased) {
+        timers.erase(timer->id);
+    }
+}
+
+int Scheduler::report(std::unordered_map<Id, std::shared_ptr<Timer>>::iterator timer) {
+    auto status = timer->second->status;
+    timers.erase(timer);
+    return status;
+}
+
+void Scheduler::release(Id id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto timer = timers.find(id);
+    if(timer == timers.end()) {
+        return;
+    }
+    if(timer->second->isFinished) {
+        timers.erase(timer);
+        return;
+    }
+    timer->second->isReleased = true;
+}
+
+size_t Scheduler::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return timers.size();
+}
+
+void Scheduler::cancel(Id id, int status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto timer = timers.find(id);
+    if(timer == timers.end()) {
+        throw std::runtime_error("Schedule " + std::to_string(id) + " does not exist");
+    }
+    finish(timer->second.get(), status);
+}
+
+std::optional<int> Scheduler::poll(Id id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto timer = timers.find(id);
+    if(timer == timers.end()) {
+        throw std::runtime_error("Schedule " + std::to_string(id) + " does not exist");
+    }
+    if(timer->second->isFinished) {
+        return report(timer);
+    }
+    return std::nullopt;
+}
+
+std::optional<int> Scheduler::waitFor(Id id, double timeoutSeconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto found = timers.find(id);
+    if(found == timers.end()) {
+        throw std::runtime_error("Schedule " + std::to_string(id) + " does not exist");
+    }
+    auto timer = found->second;
+    auto isFinished = [&] { return timer->isFinished; };
+    if(timeoutSeconds < 0) {
+        finished.wait(lock, isFinished);
+    } else if(!finished.wait_for(lock, std::chrono::duration<double>(timeoutSeconds), isFinished)) {
+        return std::nullopt;
+    }
+    // another waiter could have been given the status already
+    timers.erase(id);
+    return timer->status;
+}
+
+void Scheduler::waitForActive() {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return activeCount == 0; });
+}
+
+std::optional<uint64_t> Scheduler::nextBusyTick() const {
+    if(activeCount == 0) {
+        return std::nullopt;
+    }
+    // level 0 up to the next cascade, higher levels are looked at when they cascade
+    auto cascade = (currentTick | (SLOTS - 1)) + 1;
+    for(auto tick = currentTick; tick < cascade; tick++) {
+        if(wheel[0][tick & (SLOTS - 1)].first) {
+            return tick;
+        }
+    }
+    return cascade;
+}
+
+void Scheduler::advance(uint64_t nowTick) {
+    while(currentTick <= nowTick) {
+        auto busy = nextBusyTick();
+        if(!busy || *busy > nowTick) {
+            // nothing due until now and no cascade on the way
+            currentTick = nowTick + 1;
+            return;
+        }
+        currentTick = *busy;
+        auto tick = currentTick;
+        for(size_t level = 1; level < LEVELS; level++) {
+            auto shift = SLOT_BITS * level;
+            if((tick & (((uint64_t)1 << shift) - 1)) != 0) {
+                break;
+            }
+            auto& slot = wheel[level][(tick >> shift) & (SLOTS - 1)];
+            auto timer = slot.first;
+            slot.first = nullptr;
+            while(timer) {
+                auto next = timer->next;
+                timer->slot = nullptr;
+                place(timer);
+                timer = next;
+            }
+        }
+        auto& slot = wheel[0][tick & (SLOTS - 1)];
+        auto timer = slot.first;
+        slot.first = nullptr;
+        currentTick = tick + 1;
+        while(timer) {
+            auto next = timer->next;
+            timer->slot = nullptr;
+            timer->previous = nullptr;
+            timer->next = nullptr;
+            fire(timer);
+            timer = next;
+        }
+    }
+}
+
+void Scheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!stopping) {
+        advance(tickOf(std::chrono::steady_clock::now()));
+        auto busy = nextBusyTick();
+        if(!busy) {
+            changed.wait(lock);
+        } else {
+            changed.wait_until(lock, start + *busy * TICK);
+        }
+    }
+}
@@ -0,0 +1,407 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Sketch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char QUANTILE_KIND = 'D';
+    const char HISTOGRAM_KIND = 'H';
+    const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    void writeVarint(std::string& out, uint64_t value) {
+        while(value >= 0x80) {
+            out += (char)(value | 0x80);
+            value >>= 7;
+        }
+        out += (char)value;
+    }
+
+    bool readVarint(const std::string& in, size_t& position, uint64_t& value) {
+        value = 0;
+        for(int shift = 0; shift < 64 && position < in.size(); shift += 7) {
+            auto byte = (uint8_t)in[position++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if(!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void writeDouble(std::string& out, double value) {
+        char bytes[sizeof(value)];
+        memcpy(bytes, &value, sizeof(value));
+        out.append(bytes, sizeof(bytes));
+    }
+
+    bool readDouble(const std::string& in, size_t& position, double& value) {
+        if(position + sizeof(value) > in.size()) {
+            return false;
+        }
+        memcpy(&value, in.data() + position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    }
+
+    // non zero counts as gaps between their indexes
+    void writeCounts(std::string& out, const std::vector<uint64_t>& counts) {
+        writeVarint(out, counts.size() - std::count(counts.begin(), counts.end(), 0));
+        size_t previous = 0;
+        for(size_t i = 0; i < counts.size(); i++) {
+            if(counts[i] != 0) {
+                writeVarint(out, i - previous);
+                writeVarint(out, counts[i]);
+                previous = i;
+            }
+        }
+    }
+
+    bool readCounts(const std::string& in, size_t& position, std::vector<uint64_t>& counts, size_t limit) {
+        uint64_t nonZero = 0, index = 0;
+        if(!readVarint(in, position, nonZero)) {
+            return false;
+        }
+        for(uint64_t i = 0; i < nonZero; i++) {
+            uint64_t gap = 0, count = 0;
+            if(!readVarint(in, position, gap) || !readVarint(in, position, count) || index + gap >= limit) {
+                return false;
+            }
+            index += gap;
+            if(index >= counts.size()) {
+                counts.resize(index + 1);
+            }
+            counts[index] = count;
+        }
+        return true;
+    }
+
+    std::string encodeBase64(const std::string& data) {
+        std::string text;
+        for(size_t i = 0; i < data.size(); i += 3) {
+            uint32_t group = (uint8_t)data[i] << 16;
+            if(i + 1 < data.size()) {
+                group |= (uint8_t)data[i + 1] << 8;
+            }
+            if(i + 2 < data.size()) {
+                group |= (uint8_t)data[i + 2];
+            }
+            text += BASE64[group >> 18 & 63];
+            text += BASE64[group >> 12 & 63];
+            text += i + 1 < data.size() ? BASE64[group >> 6 & 63] : '=';
+            text += i + 2 < data.size() ? BASE64[group & 63] : '=';
+        }
+        return text;
+    }
+
+    std::string decodeBase64(const std::string& text) {
+        std::string data;
+        uint32_t group = 0;
+        int bits = 0;
+        for(auto character : text) {
+            if(character == '=') {
+                break;
+            }
+            auto found = strchr(BASE64, character);
+            if(!found || character == '\0') {
+                throw std::runtime_error("Damaged sketch");
+            }
+            group = group << 6 | (found - BASE64);
+            bits += 6;
+            if(bits >= 8) {
+                bits -= 8;
+                data += (char)(group >> bits & 0xFF);
+            }
+        }
+        return data;
+    }
+}
+
+void Sketch::add(double value) {
+    if(!std::isfinite(value)) {
+        throw std::runtime_error("Sketch value has to be finite");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    total++;
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+    insert(value);
+}
+
+double Sketch::quantile(double q) {
+    if(q < 0 || q > 1) {
+        throw std::runtime_error("Quantile has to be between 0 and 1");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if(total == 0) {
+        return 0;
+    }
+    auto rank = (uint64_t)(q * (total - 1));
+    if(rank == 0 || rank == total - 1) {
+        return rank == 0 ? minimum : maximum;
+    }
+    // bucket estimate never leaves range of seen values
+    return std::clamp(estimate(rank), minimum, maximum);
+}
+
+uint64_t Sketch::count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total;
+}
+
+void Sketch::merge(Sketch& other) {
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    std::unique_lock<std::mutex> otherLock(other.mutex, std::defer_lock);
+    if(&other == this) {
+        lock.lock();
+    } else {
+        std::lock(lock, otherLock);
+    }
+    if(!isCompatible(other)) {
+        throw std::runtime_error("Only sketches of the same kind and accuracy can be merged");
+    }
+    total += other.total;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+    mergeBuckets(other);
+}
+
+std::string Sketch::serialize() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+    writeBuckets(out);
+    writeVarint(out, total);
+    writeDouble(out, minimum);
+    writeDouble(out, maximum);
+    return encodeBase64(out);
+}
+
+std::unique_ptr<Sketch> Sketch::deserialize(const std::string& text) {
+    auto in = decodeBase64(text);
+    size_t position = 1;
+    std::unique_ptr<Sketch> sketch;
+    if(!in.empty() && in[0] == QUANTILE_KIND) {
+        double accuracy = 0;
+        if(!readDouble(in, position, accuracy) || !(accuracy > 0 && accuracy < 1)) {
+            throw std::runtime_error("Damaged sketch");
+        }
+        sketch = std::make_unique<QuantileSketch>(accuracy);
+    } else if(!in.empty() && in[0] == HISTOGRAM_KIND && in.size() > 1) {
+        int bits = (uint8_t)in[position++];
+        if(bits < 2 || bits > 16) {
+            throw std::runtime_error("Damaged sketch");
+        }
+        sketch = std::make_unique<LogHistogram>(bits);
+    } else {
+        throw std::runtime_error("Damaged sketch");
+    }
+    if(!sketch->readBuckets(in, position) || !readVarint(in, position, sketch->total)
+       || !readDouble(in, position, sketch->minimum) || !readDouble(in, position, sketch->maximum)) {
+        throw std::runtime_error("Damaged sketch");
+    }
+    return sketch;
+}
+
+void BucketStore::increment(int index, uint64_t count) {
+    if(counts.empty()) {
+        offset = index;
+    }
+    if(index < offset) {
+        counts.insert(counts.begin(), offset - index, 0);
+        offset = index;
+    }
+    if((size_t)(index - offset) >= counts.size()) {
+        counts.resize(index - offset + 1);
+    }
+    counts[index - offset] += count;
+}
+
+void BucketStore::collapse(size_t maximumBuckets) {
+    if(counts.size() <= maximumBuckets) {
+        return;
+    }
+    auto excess = counts.size() - maximumBuckets;
+    for(size_t i = 0; i < excess; i++) {
+        counts[excess] += counts[i];
+    }
+    counts.erase(counts.begin(), counts.begin() + excess);
+    offset += excess;
+}
+
+QuantileSketch::QuantileSketch(double accuracy) : accuracy(accuracy) {
+    if(!(accuracy > 0 && accuracy < 1)) {
+        throw std::runtime_error("Sketch accuracy has to be between 0 and 1");
+    }
+    gamma = (1 + accuracy) / (1 - accuracy);
+    multiplier = 1 / std::log(gamma);
+}
+
+int QuantileSketch::indexOf(double value) const {
+    return (int)std::ceil(std::log(value) * multiplier);
+}
+
+double QuantileSketch::valueOf(int index) const {
+    // middle of (gamma^(i-1), gamma^i] in relative terms
+    return 2 * std::pow(gamma, index) / (gamma + 1);
+}
+
+void QuantileSketch::insert(double value) {
+    if(value > MINIMUM_VALUE) {
+        positive.increment(indexOf(value));
+        positive.collapse(MAXIMUM_BUCKETS);
+    } else if(value < -MINIMUM_VALUE) {
+        negative.increment(indexOf(-value));
+        negative.collapse(MAXIMUM_BUCKETS);
+    } else {
+        zeroCount++;
+    }
+}
+
+double QuantileSketch::estimate(uint64_t rank) const {
+    uint64_t seen = 0;
+    // most negative values have highest indexes in negative store
+    for(size_t i = negative.counts.size(); i-- > 0;) {
+        seen += negative.counts[i];
+        if(seen > rank) {
+            return -valueOf(negative.offset + (int)i);
+        }
+    }
+    seen += zeroCount;
+    if(seen > rank) {
+        return 0;
+    }
+    for(size_t i = 0; i < positive.counts.size(); i++) {
+        seen += positive.counts[i];
+        if(seen > rank) {
+            return valueOf(positive.offset + (int)i);
+        }
+    }
+    return maximum;
+}
+
+bool QuantileSketch::isCompatible(const Sketch& other) const {
+    auto sketch = dynamic_cast<const QuantileSketch*>(&other);
+    return sketch && sketch->accuracy == accuracy;
+}
+
+void QuantileSketch::mergeBuckets(const Sketch& other) {
+    auto& sketch = static_cast<const QuantileSketch&>(other);
+    // copies, merge with itself reads what it writes
+    auto positiveCounts = sketch.positive.counts;
+    auto negativeCounts = sketch.negative.counts;
+    for(size_t i = 0; i < positiveCounts.size(); i++) {
+        if(positiveCounts[i]) {
+            positive.increment(sketch.positive.offset + (int)i, positiveCounts[i]);
+        }
+    }
+    for(size_t i = 0; i < negativeCounts.size(); i++) {
+        if(negativeCounts[i]) {
+            negative.increment(sketch.negative.offset + (int)i, negativeCounts[i]);
+        }
+    }
+    positive.collapse(MAXIMUM_BUCKETS);
+    negative.collapse(MAXIMUM_BUCKETS);
+    zeroCount += sketch.zeroCount;
+}
+
+void QuantileSketch::writeBuckets(std::string& out) const {
+    out += QUANTILE_KIND;
+    writeDouble(out, accuracy);
+    writeVarint(out, zeroCount);
+    for(auto store : {&positive, &negative}) {
+        // zigzag, offsets of values below 1 are negative
+        writeVarint(out, (uint64_t)(int64_t)store->offset << 1 ^ (uint64_t)((int64_t)store->offset >> 63));
+        writeCounts(out, store->counts);
+    }
+}
+
+bool QuantileSketch::readBuckets(const std::string& in, size_t& position) {
+    if(!readVarint(in, position, zeroCount)) {
+        return false;
+    }
+    for(auto store : {&positive, &negative}) {
+        uint64_t offset = 0;
+        if(!readVarint(in, position, offset) || !readCounts(in, position, store->counts, MAXIMUM_BUCKETS)) {
+            return false;
+        }
+        store->offset = (int)(int64_t)(offset >> 1 ^ -(offset & 1));
+    }
+    return true;
+}
+
+LogHistogram::LogHistogram(int bits) : bits(bits) {
+    if(bits < 2 || bits > 16) {
+        throw std::runtime_error("Histogram precision has to be between 2 and 16 bits");
+    }
+}
+
+size_t LogHistogram::indexOf(uint64_t value) const {
+    if(value < (1ull << bits)) {
+        return value;
+    }
+    int shift = 63 - __builtin_clzll(value) - bits + 1;
+    return ((size_t)shift << (bits - 1)) + (value >> shift);
+}
+
+uint64_t LogHistogram::lowestOf(size_t index) const {
+    if(index < (1ull << bits)) {
+        return index;
+    }
+    auto shift = (index >> (bits - 1)) - 1;
+    return (index - (shift << (bits - 1))) << shift;
+}
+
+void LogHistogram::insert(double value) {
+    uint64_t integer = 0;
+    if(value >= 18446744073709551615.0) {
+        integer = UINT64_MAX;
+    } else if(value > 0) {
+        integer = (uint64_t)value;
+    }
+    auto index = indexOf(integer);
+    if(index >= counts.size()) {
+        counts.resize(index + 1);
+    }
+    counts[index]++;
+}
+
+double LogHistogram::estimate(uint64_t rank) const {
+    uint64_t seen = 0;
+    for(size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if(seen > rank) {
+            auto width = lowestOf(i + 1) - lowestOf(i);
+            return (double)lowestOf(i) + (double)(width - 1) / 2;
+        }
+    }
+    return maximum;
+}
+
+bool LogHistogram::isCompatible(const Sketch& other) const {
+    auto histogram = dynamic_cast<const LogHistogram*>(&other);
+    return histogram && histogram->bits == bits;
+}
+
+void LogHistogram::mergeBuckets(const Sketch& other) {
+    auto otherCounts = static_cast<const LogHistogram&>(other).counts;
+    if(otherCounts.size() > counts.size()) {
+        counts.resize(otherCounts.size());
+    }
+    for(size_t i = 0; i < otherCounts.size(); i++) {
+        counts[i] += otherCounts[i];
+    }
+}
+
+void LogHistogram::writeBuckets(std::string& out) const {
+    out += HISTOGRAM_KIND;
+    out += (char)bits;
+    writeCounts(out, counts);
+}
+
+bool LogHistogram::readBuckets(const std::string& in, size_t& position) {
+    return readCounts(in, position, counts, indexOf(UINT64_MAX) + 1);
+}
@@ -0,0 +1,372 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/SmtpClient.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pwd.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    const int CONNECT_TIMEOUT_MILLISECONDS = 10000;
+    const int REPLY_TIMEOUT_MILLISECONDS = 60000;
+    // relays drop idle sessions after a few minutes, older ones are not worth trying
+    const auto IDLE_LIMIT = std::chrono::seconds(60);
+    const size_t MAX_IDLE_PER_RELAY = 4;
+
+    std::string hostName() {
+        char name[256] {};
+        if(gethostname(name, sizeof(name) - 1) == -1 || name[0] == '\0') {
+            return "localhost";
+        }
+        return name;
+    }
+
+    std::string defaultSender() {
+        auto user = getpwuid(getuid());
+        return std::string(user ? user->pw_name : "tkom") + "@" + hostName();
+    }
+
+    // lines end with CRLF and a line starting with a dot gets another one
+    std::string dataOf(const SmtpMessage& message, const std::string& from) {
+        char date[64];
+        auto now = time(nullptr);
+        struct tm local {};
+        localtime_r(&now, &local);
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S %z", &local);
+        std::string to;
+        for(auto& recipient : message.recipients) {
+            to += (to.empty() ? "" : ", ") + recipient;
+        }
+        std::string data = "From: " + from + "\r\nTo: " + to + "\r\nSubject: " + message.subject
+                           + "\r\nDate: " + date + "\r\n\r\n";
+        bool isLineStart = true;
+        for(auto character : message.body) {
+            if(isLineStart && character == '.') {
+                data += '.';
+            }
+            if(character == '\n' && (data.empty() || data.back() != '\r')) {
+                data += '\r';
+            }
+            data += character;
+            isLineStart = character == '\n';
+        }
+        if(!isLineStart) {
+            data += "\r\n";
+        }
+        return data + ".\r\n";
+    }
+}
+
+SmtpConnection::SmtpConnection(const std::string& host, const std::string& port) : relay(host + ":" + port) {
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    auto resolved = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if(resolved != 0) {
+        throw std::runtime_error("Cannot resolve relay " + relay + ": " + gai_strerror(resolved));
+    }
+    std::string error = "no address";
+    for(auto address = addresses; address && fd == -1; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+        if(fd == -1) {
+            error = strerror(errno);
+            continue;
+        }
+        int connectError = connect(fd, address->ai_addr, address->ai_addrlen) == 0 ? 0 : errno;
+        if(connectError == EINPROGRESS) {
+            pollfd connecting {fd, POLLOUT, 0};
+            connectError = ETIMEDOUT;
+            socklen_t length = sizeof(connectError);
+            if(poll(&connecting, 1, CONNECT_TIMEOUT_MILLISECONDS) == 1) {
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &connectError, &length);
+            }
+        }
+        if(connectError != 0) {
+            error = strerror(connectError);
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if(fd == -1) {
+        throw std::runtime_error("Cannot connect to relay " + relay + ": " + error);
+    }
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+
+    try {
+        std::string text;
+        if(readReply(text) != 220) {
+            fail("relay refused session: " + text);
+        }
+        if(command("EHLO " + hostName(), text) == 250) {
+            // first line is greeting, each next one an extension
+            for(size_t line = text.find('\n'); line != std::string::npos; line = text.find('\n', line + 1)) {
+                pipelining |= text.compare(line + 1, 10, "PIPELINING") == 0;
+            }
+        } else if(command("HELO " + hostName(), text) != 250) {
+            fail("relay refused greeting: " + text);
+        }
+    } catch(std::exception&) {
+        close(fd);
+        throw;
+    }
+    lastUsed = std::chrono::steady_clock::now();
+}
+
+SmtpConnection::~SmtpConnection() {
+    if(!broken) {
+        // relay answer is not awaited, message is delivered already
+        std::string quit = "QUIT\r\n";
+        ::send(fd, quit.data(), quit.size(), MSG_NOSIGNAL);
+    }
+    close(fd);
+}
+
+void SmtpConnection::fail(const std::string& reason) {
+    broken = true;
+    throw std::runtime_error("SMTP " + relay + ": " + reason);
+}
+
+void SmtpConnection::writeAll(const std::string& data) {
+    size_t written = 0;
+    while(written < data.size()) {
+        auto sent = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if(sent == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN) {
+                pollfd writable {fd, POLLOUT, 0};
+                if(poll(&writable, 1, REPLY_TIMEOUT_MILLISECONDS) != 1) {
+                    fail("write timed out");
+                }
+                continue;
+            }
+            fail(strerror(errno));
+        }
+        written += sent;
+    }
+}
+
+std::string SmtpConnection::readLine() {
+    while(true) {
+        auto end = received.find('\n');
+        if(end != std::string::npos) {
+            auto line = received.substr(0, end > 0 && received[end - 1] == '\r' ? end - 1 : end);
+            received.erase(0, end + 1);
+            return line;
+        }
+        pollfd readable {fd, POLLIN, 0};
+        auto ready = poll(&readable, 1, REPLY_TIMEOUT_MILLISECONDS);
+        if(ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if(ready != 1) {
+            fail("no reply from relay");
+        }
+        char buffer[4096];
+        auto got = recv(fd, buffer, sizeof(buffer), 0);
+        if(got == -1 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+        if(got <= 0) {
+            fail(got == 0 ? "relay closed connection" : strerror(errno));
+        }
+        received.append(buffer, got);
+    }
+}
+
+int SmtpConnection::readReply(std::string& text) {
+    text.clear();
+    for(bool isFirst = true;; isFirst = false) {
+        auto line = readLine();
+        if(line.size() < 3 || !isdigit(line[0]) || !isdigit(line[1]) || !isdigit(line[2])) {
+            fail("malformed reply " + line);
+        }
+        text += (isFirst ? "" : "\n") + line.substr(std::min<size_t>(4, line.size()));
+        if(line.size() == 3 || line[3] != '-') {
+            auto code = std::stoi(line.substr(0, 3));
+            // relay is shutting the session down, whatever was asked
+            if(code == 421) {
+                fail("relay closed session: " + text);
+            }
+            return code;
+        }
+    }
+}
+
+int SmtpConnection::command(const std::string& line, std::string& text) {
+    writeAll(line + "\r\n");
+    return readReply(text);
+}
+
+bool SmtpConnection::isClosedByRelay() const {
+    // idle session has nothing to read, anything there is 421 or end of stream
+    pollfd readable {fd, POLLIN, 0};
+    return poll(&readable, 1, 0) != 0;
+}
+
+void SmtpConnection::send(const SmtpMessage& message) {
+    auto from = message.from.empty() ? defaultSender() : message.from;
+    std::string envelope = "MAIL FROM:<" + from + ">\r\n";
+    for(auto& recipient : message.recipients) {
+        envelope += "RCPT TO:<" + recipient + ">\r\n";
+    }
+    envelope += "DATA\r\n";
+    auto data = dataOf(message, from);
+
+    std::string text, rejected;
+    size_t accepted = 0;
+    bool isRejectionTemporary = false;
+    int code, mailCode;
+    if(pipelining) {
+        writeAll(envelope);
+        mailCode = readReply(text);
+        auto mailText = text;
+        for(auto& recipient : message.recipients) {
+            auto recipientCode = readReply(text);
+            if(recipientCode / 100 == 2) {
+                accepted++;
+            } else {
+                rejected += " " + recipient + " (" + text + ")";
+                isRejectionTemporary |= recipientCode / 100 == 4;
+            }
+        }
+        code = readReply(text);
+        if(mailCode / 100 != 2) {
+            code = mailCode;
+            text = mailText;
+        }
+    } else {
+        code = mailCode = command("MAIL FROM:<" + from + ">", text);
+        for(size_t i = 0; i < message.recipients.size() && code / 100 == 2; i++) {
+            auto recipientCode = command("RCPT TO:<" + message.recipients[i] + ">", text);
+            if(recipientCode / 100 == 2) {
+                accepted++;
+            } else {
+                rejected += " " + message.recipients[i] + " (" + text + ")";
+                isRejectionTemporary |= recipientCode / 100 == 4;
+            }
+        }
+        if(code / 100 == 2 && accepted > 0) {
+            code = command("DATA", text);
+        }
+    }
+    if(code != 354 || accepted == 0) {
+        // a DATA accepted without recipients is ended empty, then session is reset for next message
+        if(code == 354) {
+            writeAll(".\r\n");
+            readReply(text);
+        }
+        std::string reset;
+        if(command("RSET", reset) != 250) {
+            broken = true;
+        }
+        lastUsed = std::chrono::steady_clock::now();
+        auto reason = "SMTP " + relay + " refused message: "
+                      + (mailCode / 100 == 2 && accepted == 0 ? "recipients" + rejected : text);
+        bool isPermanent = mailCode / 100 != 2 ? mailCode / 100 == 5
+                           : accepted == 0 ? !isRejectionTemporary : code / 100 == 5;
+        if(isPermanent) {
+            throw SmtpRefusal(reason);
+        }
+        throw std::runtime_error(reason);
+    }
+    try {
+        writeAll(data);
+        code = readReply(text);
+    } catch(std::exception& e) {
+        // relay may have queued message before session broke, sending it again could duplicate it
+        throw SmtpRefusal(std::string(e.what()) + ", message may be delivered and is not sent again");
+    }
+    lastUsed = std::chrono::steady_clock::now();
+    if(code / 100 == 5) {
+        throw SmtpRefusal("SMTP " + relay + " refused message: " + text);
+    }
+    if(code != 250) {
+        throw std::runtime_error("SMTP " + relay + " refused message: " + text);
+    }
+    // message went to the others, sending it again would duplicate it
+    if(!rejected.empty()) {
+        throw SmtpRefusal("SMTP " + relay + " refused recipients" + rejected);
+    }
+}
+
+SmtpPool& SmtpPool::instance() {
+    static SmtpPool pool;
+    return pool;
+}
+
+std::unique_ptr<SmtpConnection> SmtpPool::take(const std::string& relay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& connections = idle[relay];
+    auto now = std::chrono::steady_clock::now();
+    while(!connections.empty()) {
+        auto connection = std::move(connections.back());
+        connections.pop_back();
+        if(now - connection->lastUsed < IDLE_LIMIT && !connection->isClosedByRelay()) {
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+void SmtpPool::giveBack(const std::string& relay, std::unique_ptr<SmtpConnection> connection) {
+    if(connection->isBroken()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& connections = idle[relay];
+    if(connections.size() < MAX_IDLE_PER_RELAY) {
+        connections.push_back(std::move(connection));
+    }
+}
+
+void SmtpPool::send(const std::string& relay, SmtpMessage message) {
+    if(message.recipients.empty()) {
+        throw std::runtime_error("Report has no recipients");
+    }
+    auto host = relay, port = std::string("25");
+    auto colon = relay.rfind(':');
+    if(colon != std::string::npos && relay.find(':') == colon) {
+        host = relay.substr(0, colon);
+        port = relay.substr(colon + 1);
+    }
+    if(auto connection = take(relay)) {
+        try {
+            connection->send(message);
+            giveBack(relay, std::move(connection));
+            return;
+        } catch(SmtpRefusal&) {
+            giveBack(relay, std::move(connection));
+            throw;
+        } catch(std::exception&) {
+            // session went stale between check and use, otherwise relay refused the message itself
+            if(!connection->isBroken()) {
+                giveBack(relay, std::move(connection));
+                throw;
+            }
+        }
+    }
+    auto connection = std::make_unique<SmtpConnection>(host, port);
+    try {
+        connection->send(message);
+    } catch(std::exception&) {
+        giveBack(relay, std::move(connection));
+        throw;
+    }
+    giveBack(relay, std::move(connection));
+}
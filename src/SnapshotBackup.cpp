@@ -0,0 +1,174 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/SnapshotBackup.h"
+#include "../include/Hash.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+    const std::string PARTIAL_SUFFIX = ".partial";
+    const std::string LATEST_LINK = "latest";
+
+    std::string errorText(const std::string& path) {
+        return path + ": " + strerror(errno);
+    }
+
+    bool endsWith(const std::string& value, const std::string& suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool isSnapshotName(const std::string& name) {
+        return !name.empty() && name[0] != '.' && name != LATEST_LINK && !endsWith(name, PARTIAL_SUFFIX)
+               && name.find('/') == std::string::npos;
+    }
+
+    // birth time where file system keeps it, change time otherwise, mtime is copied from source
+    std::pair<int64_t, uint32_t> creationTime(const std::string& path) {
+        struct statx info {};
+        if(statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, STATX_BTIME | STATX_CTIME, &info) == -1) {
+            return {0, 0};
+        }
+        auto& time = (info.stx_mask & STATX_BTIME) ? info.stx_btime : info.stx_ctime;
+        return {time.tv_sec, time.tv_nsec};
+    }
+}
+
+SnapshotBackup::SnapshotBackup(std::string source, std::string root, bool useHash, Throttle* throttle)
+        : source(std::move(source)), root(std::move(root)), useHash(useHash), throttle(throttle) {
+    while(this->source.size() > 1 && this->source.back() == '/') {
+        this->source.pop_back();
+    }
+    while(this->root.size() > 1 && this->root.back() == '/') {
+        this->root.pop_back();
+    }
+}
+
+std::string SnapshotBackup::previousSnapshot() {
+    // latest is moved only after a snapshot is complete, it is the one to link against
+    char target[PATH_MAX];
+    auto length = readlink((root + "/" + LATEST_LINK).c_str(), target, sizeof(target) - 1);
+    if(length > 0) {
+        std::string name(target, length);
+        struct stat info {};
+        if(isSnapshotName(name) && lstat((root + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            return name;
+        }
+    }
+    DIR* directory = opendir(root.c_str());
+    if(!directory) {
+        return "";
+    }
+    // without the link names can be anything, the most recently created snapshot wins
+    std::string latest;
+    std::pair<int64_t, uint32_t> latestCreated {0, 0};
+    while(auto entry = readdir(directory)) {
+        std::string name(entry->d_name);
+        if(!isSnapshotName(name) || entry->d_type != DT_DIR) {
+            continue;
+        }
+        auto created = creationTime(root + "/" + name);
+        if(latest.empty() || created > latestCreated || (created == latestCreated && name > latest)) {
+            latest = name;
+            latestCreated = created;
+        }
+    }
+    closedir(directory);
+    return latest;
+}
+
+bool SnapshotBackup::isSame(const std::string& previous, const std::string& current, const struct stat& info) {
+    struct statx previousInfo {};
+    if(statx(AT_FDCWD, previous.c_str(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+             STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME, &previousInfo) == -1) {
+        return false;
+    }
+    if(!S_ISREG(previousInfo.stx_mode) || previousInfo.stx_size != (uint64_t)info.st_size
+       || (previousInfo.stx_mode & 07777) != (info.st_mode & 07777)
+       || previousInfo.stx_mtime.tv_sec != info.st_mtim.tv_sec
+       || previousInfo.stx_mtime.tv_nsec != (uint32_t)info.st_mtim.tv_nsec) {
+        return false;
+    }
+    if(!useHash) {
+        return true;
+    }
+    try {
+        return Hasher::hashFile(previous, throttle) == Hasher::hashFile(current, throttle);
+    } catch(std::exception&) {
+        return false;
+    }
+}
+
+CopyReport SnapshotBackup::run(std::string name) {
+    if(mkdir(root.c_str(), 0755) == -1 && errno != EEXIST) {
+        throw std::runtime_error(errorText(root));
+    }
+    auto previous = previousSnapshot();
+    if(name.empty()) {
+        char timeName[32];
+        auto now = time(nullptr);
+        tm local {};
+        localtime_r(&now, &local);
+        strftime(timeName, sizeof(timeName), "%Y%m%d-%H%M%S", &local);
+        name = timeName;
+        for(int suffix = 1; access((root + "/" + name).c_str(), F_OK) == 0; suffix++) {
+            name = std::string(timeName) + "-" + std::to_string(suffix);
+        }
+    } else if(access((root + "/" + name).c_str(), F_OK) == 0) {
+        throw std::runtime_error("Snapshot " + name + " already exists in " + root);
+    }
+    auto previousRoot = root + "/" + previous;
+    // a left over of an interrupted run is completed, existing entries are replaced
+    auto partial = root + "/" + name + PARTIAL_SUFFIX;
+
+    CopyEngine engine;
+    engine.throttle = throttle;
+    engine.shouldCopy = [&](const std::string& path, const struct stat& info) {
+        auto target = partial + "/" + path;
+        auto previousPath = previousRoot + "/" + path;
+        if(!previous.empty() && isSame(previousPath, source + "/" + path, info)) {
+            if(throttle) {
+                throttle->acquireOperation();
+            }
+            if(link(previousPath.c_str(), target.c_str()) == 0
+               || (errno == EEXIST && unlink(target.c_str()) == 0 && link(previousPath.c_str(), target.c_str()) == 0)) {
+                linked.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // too many links or another file system, a copy still does
+        }
+        // partial of an interrupted run may hold a link into a snapshot, copy must not write through it
+        if(unlink(target.c_str()) == -1 && errno != ENOENT) {
+            throw std::runtime_error(errorText(target));
+        }
+        return true;
+    };
+    auto report = engine.mirror(source, partial);
+    report.linked = linked.load();
+    report.skipped -= report.linked;
+
+    auto snapshot = root + "/" + name;
+    if(rename(partial.c_str(), snapshot.c_str()) == -1) {
+        throw std::runtime_error(errorText(snapshot));
+    }
+    // latest is replaced atomically, readers never find it missing
+    auto temporaryLink = root + "/." + LATEST_LINK + ".tmp";
+    unlink(temporaryLink.c_str());
+    if(symlink(name.c_str(), temporaryLink.c_str()) == 0) {
+        rename(temporaryLink.c_str(), (root + "/" + LATEST_LINK).c_str());
+    }
+    int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+    report.snapshot = name;
+    return report;
+}
@@ -0,0 +1,363 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/SystemMetrics.h"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    const size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+
+    struct LinuxDirent64 {
+        uint64_t inode;
+        int64_t offset;
+        unsigned short length;
+        unsigned char type;
+        char name[];
+    };
+
+    void skipSpaces(std::string_view text, size_t& position) {
+        while(position < text.size() && (text[position] == ' ' || text[position] == '\t')) {
+            position++;
+        }
+    }
+
+    uint64_t parseUnsigned(std::string_view text, size_t& position) {
+        skipSpaces(text, position);
+        uint64_t value = 0;
+        auto result = std::from_chars(text.data() + position, text.data() + text.size(), value);
+        position = result.ptr - text.data();
+        return value;
+    }
+
+    double parseDouble(std::string_view text, size_t& position) {
+        skipSpaces(text, position);
+        double value = 0;
+        auto result = std::from_chars(text.data() + position, text.data() + text.size(), value);
+        position = result.ptr - text.data();
+        return value;
+    }
+
+    // value of "Key:   123 kB" line in bytes
+    uint64_t memoryField(std::string_view content, std::string_view key) {
+        for(size_t line = 0; line < content.size();) {
+            auto end = content.find('\n', line);
+            if(end == std::string_view::npos) {
+                end = content.size();
+            }
+            if(content.compare(line, key.size(), key) == 0 && content[line + key.size()] == ':') {
+                size_t position = line + key.size() + 1;
+                return parseUnsigned(content, position) * 1024;
+            }
+            line = end + 1;
+        }
+        return 0;
+    }
+
+    uint64_t monotonicNanoseconds() {
+        timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    }
+
+    // mounts file escapes space, tab, newline and backslash as octal
+    std::string unescapeMountPoint(std::string_view field) {
+        std::string path;
+        for(size_t i = 0; i < field.size(); i++) {
+            if(field[i] == '\\' && i + 3 < field.size()) {
+                path += (char)((field[i + 1] - '0') * 64 + (field[i + 2] - '0') * 8 + (field[i + 3] - '0'));
+                i += 3;
+            } else {
+                path += field[i];
+            }
+        }
+        return path;
+    }
+
+    std::string megabytes(uint64_t bytes) {
+        return std::to_string(bytes / (1024 * 1024)) + " MiB";
+    }
+
+    std::string fixed(double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f", value);
+        return text;
+    }
+}
+
+ProcFile::ProcFile(std::string path, size_t capacity) : path(std::move(path)), buffer(capacity) {
+    fd = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        openError = errno;
+    }
+}
+
+ProcFile::~ProcFile() {
+    if(fd != -1) {
+        close(fd);
+    }
+}
+
+std::string_view ProcFile::read() {
+    if(fd == -1) {
+        throw std::runtime_error(path + ": " + strerror(openError));
+    }
+    while(true) {
+        auto got = pread(fd, buffer.data(), buffer.size(), 0);
+        if(got == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+        // procfs fills what fits, a full buffer may be a cut content
+        if((size_t)got < buffer.size()) {
+            return std::string_view(buffer.data(), got);
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+SystemMetrics::SystemMetrics(pid_t pid)
+        : pid(pid), statFile((pid > 0 ? "/proc/" + std::to_string(pid) : std::string("/proc/self")) + "/stat") {
+    auto fdPath = (pid > 0 ? "/proc/" + std::to_string(pid) : std::string("/proc/self")) + "/fd";
+    processFdDirectory = open(fdPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    ticksPerSecond = sysconf(_SC_CLK_TCK);
+}
+
+SystemMetrics::~SystemMetrics() {
+    closeMounts();
+    if(processFdDirectory != -1) {
+        close(processFdDirectory);
+    }
+}
+
+SystemMetrics::LoadAverage SystemMetrics::loadAverage() {
+    // 0.52 0.58 0.59 1/234 5678
+    auto content = loadFile.read();
+    LoadAverage load;
+    size_t position = 0;
+    load.one = parseDouble(content, position);
+    load.five = parseDouble(content, position);
+    load.fifteen = parseDouble(content, position);
+    load.running = parseUnsigned(content, position);
+    position++;
+    load.tasks = parseUnsigned(content, position);
+    return load;
+}
+
+SystemMetrics::Memory SystemMetrics::memory() {
+    auto content = memoryFile.read();
+    Memory memory;
+    memory.total = memoryField(content, "MemTotal");
+    memory.free = memoryField(content, "MemFree");
+    memory.available = memoryField(content, "MemAvailable");
+    memory.buffers = memoryField(content, "Buffers");
+    memory.cached = memoryField(content, "Cached");
+    memory.swapTotal = memoryField(content, "SwapTotal");
+    memory.swapFree = memoryField(content, "SwapFree");
+    return memory;
+}
+
+void SystemMetrics::closeMounts() {
+    for(auto& mount : mounts) {
+        if(mount.fd != -1) {
+            close(mount.fd);
+        }
+    }
+    mounts.clear();
+}
+
+void SystemMetrics::updateMounts(std::string_view content) {
+    closeMounts();
+    mountsContent.assign(content);
+    for(size_t line = 0; line < content.size();) {
+        auto end = content.find('\n', line);
+        if(end == std::string_view::npos) {
+            end = content.size();
+        }
+        auto entry = content.substr(line, end - line);
+        line = end + 1;
+        // device mountpoint type options dump pass
+        auto deviceEnd = entry.find(' ');
+        if(deviceEnd == std::string_view::npos || entry[0] != '/') {
+            continue;
+        }
+        auto pointEnd = entry.find(' ', deviceEnd + 1);
+        if(pointEnd == std::string_view::npos) {
+            continue;
+        }
+        Mount mount;
+        mount.disk.mountPoint = unescapeMountPoint(entry.substr(deviceEnd + 1, pointEnd - deviceEnd - 1));
+        bool isDuplicate = false;
+        for(auto& known : mounts) {
+            isDuplicate |= known.disk.mountPoint == mount.disk.mountPoint;
+        }
+        if(isDuplicate) {
+            continue;
+        }
+        // path descriptor keeps mount reachable for fstatvfs without a lookup per sample
+        mount.fd = open(mount.disk.mountPoint.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if(mount.fd != -1) {
+            mounts.push_back(std::move(mount));
+        }
+    }
+    diskSamples.clear();
+    for(auto& mount : mounts) {
+        diskSamples.push_back(mount.disk);
+    }
+}
+
+const std::vector<SystemMetrics::Disk>& SystemMetrics::disks() {
+    auto content = mountsFile.read();
+    if(content != mountsContent) {
+        updateMounts(content);
+    }
+    for(size_t i = 0; i < mounts.size(); i++) {
+        struct statvfs info {};
+        if(fstatvfs(mounts[i].fd, &info) == -1) {
+            continue;
+        }
+        auto& disk = diskSamples[i];
+        disk.totalBytes = (uint64_t)info.f_blocks * info.f_frsize;
+        disk.availableBytes = (uint64_t)info.f_bavail * info.f_frsize;
+        disk.totalFiles = info.f_files;
+        disk.freeFiles = info.f_ffree;
+    }
+    return diskSamples;
+}
+
+SystemMetrics::Process SystemMetrics::process() {
+    auto content = statFile.read();
+    Process process;
+    process.pid = pid > 0 ? pid : getpid();
+    // command name may hold spaces and parentheses, fields start after the last one
+    auto nameEnd = content.rfind(')');
+    if(nameEnd == std::string_view::npos) {
+        throw std::runtime_error("Cannot parse stat of process " + std::to_string(process.pid));
+    }
+    size_t position = nameEnd + 2;
+    uint64_t utime = 0, stime = 0;
+    // state is field 3, utime 14, stime 15, num_threads 20, rss 24
+    for(int field = 3; field <= 24 && position < content.size(); field++) {
+        skipSpaces(content, position);
+        if(field == 3) {
+            position++;
+            continue;
+        }
+        uint64_t value = 0;
+        if(content[position] == '-') {
+            position++;
+        }
+        value = parseUnsigned(content, position);
+        if(field == 14) {
+            utime = value;
+        } else if(field == 15) {
+            stime = value;
+        } else if(field == 20) {
+            process.threads = value;
+        } else if(field == 24) {
+            process.residentBytes = value * sysconf(_SC_PAGESIZE);
+        }
+    }
+    auto now = monotonicNanoseconds();
+    auto cpuTicks = utime + stime;
+    if(lastSampleNanoseconds != 0 && now > lastSampleNanoseconds) {
+        double cpuSeconds = (double)(cpuTicks - lastCpuTicks) / ticksPerSecond;
+        double wallSeconds = (double)(now - lastSampleNanoseconds) / 1e9;
+        process.cpuPercent = 100 * cpuSeconds / wallSeconds;
+    }
+    lastCpuTicks = cpuTicks;
+    lastSampleNanoseconds = now;
+
+    if(processFdDirectory != -1 && lseek(processFdDirectory, 0, SEEK_SET) == 0) {
+        thread_local std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+        while(true) {
+            auto got = syscall(SYS_getdents64, processFdDirectory, buffer.data(), buffer.size());
+            if(got <= 0) {
+                break;
+            }
+            for(long offset = 0; offset < got;) {
+                auto entry = reinterpret_cast<LinuxDirent64*>(buffer.data() + offset);
+                offset += entry->length;
+                process.openFiles += entry->name[0] != '.';
+            }
+        }
+    }
+    return process;
+}
+
+SystemMetrics::FileDescriptors SystemMetrics::fileDescriptors() {
+    // allocated, unused (always 0 since 2.6), maximum
+    auto content = fileNumberFile.read();
+    FileDescriptors descriptors;
+    size_t position = 0;
+    descriptors.allocated = parseUnsigned(content, position);
+    parseUnsigned(content, position);
+    descriptors.maximum = parseUnsigned(content, position);
+    return descriptors;
+}
+
+std::string SystemMetrics::report(const std::string& type, std::vector<Sample>* samples) {
+    auto add = [samples](std::string series, double value) {
+        if(samples) {
+            samples->push_back({std::move(series), value});
+        }
+    };
+    if(type == "loadavg") {
+        auto load = loadAverage();
+        add("load1", load.one);
+        add("load5", load.five);
+        add("load15", load.fifteen);
+        add("running", load.running);
+        return "Load average is " + fixed(load.one) + ", " + fixed(load.five) + ", " + fixed(load.fifteen) + ", "
+               + std::to_string(load.running) + " of " + std::to_string(load.tasks) + " tasks running.\n";
+    }
+    if(type == "memory") {
+        auto memory = this->memory();
+        add("memory_available", memory.available);
+        add("memory_free", memory.free);
+        add("memory_cached", memory.buffers + memory.cached);
+        add("swap_free", memory.swapFree);
+        return "Memory: " + megabytes(memory.available) + " of " + megabytes(memory.total) + " available, "
+               + megabytes(memory.free) + " free, " + megabytes(memory.buffers + memory.cached) + " in buffers and cache, swap "
+               + megabytes(memory.swapFree) + " of " + megabytes(memory.swapTotal) + " free.\n";
+    }
+    if(type == "disk") {
+        std::string text;
+        for(auto& disk : disks()) {
+            add("disk_available:" + disk.mountPoint, disk.availableBytes);
+            add("disk_free_inodes:" + disk.mountPoint, disk.freeFiles);
+            text += "Disk " + disk.mountPoint + ": " + megabytes(disk.availableBytes) + " of "
+                    + megabytes(disk.totalBytes) + " available, " + std::to_string(disk.freeFiles) + " of "
+                    + std::to_string(disk.totalFiles) + " inodes free.\n";
+        }
+        return text;
+    }
+    if(type == "process") {
+        auto process = this->process();
+        add("rss", process.residentBytes);
+        add("cpu", process.cpuPercent);
+        add("threads", process.threads);
+        add("open_files", process.openFiles);
+        return "Process " + std::to_string(process.pid) + " uses " + megabytes(process.residentBytes) + " resident, "
+               + fixed(process.cpuPercent) + "% cpu, " + std::to_string(process.threads) + " threads, "
+               + std::to_string(process.openFiles) + " open files.\n";
+    }
+    if(type == "fds") {
+        auto descriptors = fileDescriptors();
+        add("fds", descriptors.allocated);
+        return "There are " + std::to_string(descriptors.allocated) + " of " + std::to_string(descriptors.maximum)
+               + " file descriptors allocated.\n";
+    }
+    return "";
+}
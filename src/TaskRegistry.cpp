@@ -0,0 +1,38 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/TaskRegistry.h"
+#include <chrono>
+
+void SpawnedTask::complete(std::optional<Value> value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    result = std::move(value);
+    done = true;
+    finished.notify_all();
+}
+
+void SpawnedTask::fail(std::exception_ptr taskError) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = taskError;
+    done = true;
+    finished.notify_all();
+}
+
+std::optional<SpawnedTask::Value> SpawnedTask::get() {
+    auto& pool = WorkStealingPool::instance();
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!done) {
+        // awaiting task may itself run on a worker, so it has to help instead of blocking it
+        lock.unlock();
+        bool helped = pool.runPendingTask();
+        lock.lock();
+        if(!helped && !done) {
+            finished.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+    return result;
+}
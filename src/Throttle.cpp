@@ -0,0 +1,96 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/Throttle.h"
+#include <algorithm>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    const size_t OPERATION_SIZE = 128 * 1024;
+    const auto MAX_BURST = std::chrono::milliseconds(20);
+
+    // from linux/ioprio.h
+    const int IOPRIO_CLASS_SHIFT = 13;
+    const int IOPRIO_CLASS_BEST_EFFORT = 2;
+    const int IOPRIO_CLASS_IDLE = 3;
+    const int IOPRIO_WHO_PROCESS = 1;
+}
+
+Throttle::Throttle(double bytesPerSecond, double operationsPerSecond)
+        : bytesPerSecond(bytesPerSecond), operationsPerSecond(operationsPerSecond),
+          bytesDrained(Clock::now()), operationsDrained(Clock::now()) {}
+
+size_t Throttle::chunkSize() const {
+    if(!isLimited()) {
+        return SIZE_MAX;
+    }
+    // about one burst worth of data, but whole operations
+    size_t size = 8 * 1024 * 1024;
+    if(bytesPerSecond > 0) {
+        size = std::min(size, (size_t)(bytesPerSecond * std::chrono::duration<double>(MAX_BURST).count()));
+    }
+    if(operationsPerSecond > 0) {
+        size = std::min(size, OPERATION_SIZE);
+    }
+    return std::max(size, (size_t)4096);
+}
+
+void Throttle::acquire(size_t bytes) {
+    reserve(bytes, std::max<size_t>(1, (bytes + OPERATION_SIZE - 1) / OPERATION_SIZE));
+}
+
+void Throttle::acquireOperation() {
+    reserve(0, 1);
+}
+
+void Throttle::reserve(size_t bytes, size_t operations) {
+    if(!isLimited()) {
+        return;
+    }
+    Clock::time_point allowedAt;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = Clock::now();
+        allowedAt = now;
+        auto take = [&](Clock::time_point& drained, double cost, double rate) {
+            if(rate <= 0) {
+                return;
+            }
+            // idle time earns at most one burst of credit
+            drained = std::max(drained, now - std::chrono::duration_cast<Clock::duration>(MAX_BURST));
+            drained += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cost / rate));
+            allowedAt = std::max(allowedAt, drained - std::chrono::duration_cast<Clock::duration>(MAX_BURST));
+        };
+        take(bytesDrained, (double)bytes, bytesPerSecond);
+        take(operationsDrained, (double)operations, operationsPerSecond);
+    }
+    std::this_thread::sleep_until(allowedAt);
+}
+
+void setIoPriority(const std::string& priority) {
+    int value;
+    if(priority == "idle") {
+        value = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    } else if(priority.rfind("best-effort", 0) == 0) {
+        int level = 4;
+        if(priority.size() > 11) {
+            if(priority[11] != ':' || priority.size() != 13 || priority[12] < '0' || priority[12] > '7') {
+                throw std::runtime_error("Wrong io priority " + priority);
+            }
+            level = priority[12] - '0';
+        }
+        value = (IOPRIO_CLASS_BEST_EFFORT << IOPRIO_CLASS_SHIFT) | level;
+    } else {
+        throw std::runtime_error("Wrong io priority " + priority);
+    }
+    if(syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, value) == -1) {
+        throw std::runtime_error(std::string("Cannot set io priority: ") + strerror(errno));
+    }
+}
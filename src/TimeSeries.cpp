@@ -0,0 +1,421 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/TimeSeries.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <map>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    const char MAGIC[4] = {'T', 'K', 'T', 'S'};
+    const uint32_t VERSION = 1;
+    const size_t HEADER_SIZE = 16384;
+    const uint32_t BLOCK_SIZE = 4096;
+    // timestamp with raw delta of delta and value with new window
+    const uint32_t MAX_SAMPLE_BITS = 4 + 64 + 2 + 5 + 6 + 64;
+    const uint8_t NO_WINDOW = 0xFF;
+
+    std::mutex openMutex;
+    // entry goes away with the last user, so a writer gives up its lock once it is done
+    std::map<std::string, std::weak_ptr<TimeSeries>> opened;
+
+    void putBits(uint8_t* data, uint32_t& position, uint64_t value, int count) {
+        for(int i = count - 1; i >= 0; i--) {
+            if((value >> i) & 1) {
+                data[position >> 3] |= 0x80 >> (position & 7);
+            }
+            position++;
+        }
+    }
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, uint32_t capacity) : data(data), capacity(capacity) {}
+
+        // false when block ends, which only happens if it is rewritten meanwhile
+        bool read(int count, uint64_t& value) {
+            if(position + count > capacity) {
+                return false;
+            }
+            value = 0;
+            for(int i = 0; i < count; i++, position++) {
+                value = value << 1 | ((data[position >> 3] >> (7 - (position & 7))) & 1);
+            }
+            return true;
+        }
+
+    private:
+        const uint8_t* data;
+        uint32_t capacity;
+        uint32_t position {0};
+    };
+
+    uint64_t toBits(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(uint64_t bits) {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+std::shared_ptr<TimeSeries> TimeSeries::open(const std::string& path, size_t size) {
+    // dropped after the lock is, deleter of the last reference takes it too
+    std::shared_ptr<TimeSeries> series, replaced;
+    std::lock_guard<std::mutex> lock(openMutex);
+    auto known = opened.find(path);
+    if(known != opened.end()) {
+        series = known->second.lock();
+    }
+    if(series && size == 0 && !series->writable) {
+        // file replaced by a new writer is mapped again
+        struct stat info {};
+        if(stat(path.c_str(), &info) == 0 && info.st_ino != series->inode) {
+            replaced = std::move(series);
+        }
+    }
+    if(!series || (size > 0 && !series->writable)) {
+        if(series) {
+            replaced = std::move(series);
+        }
+        series.reset(new TimeSeries(path, size), [path](TimeSeries* released) {
+            delete released;
+            std::lock_guard<std::mutex> lock(openMutex);
+            auto entry = opened.find(path);
+            if(entry != opened.end() && entry->second.expired()) {
+                opened.erase(entry);
+            }
+        });
+        opened[path] = series;
+    }
+    return series;
+}
+
+TimeSeries::TimeSeries(const std::string& path, size_t size) : path(path), writable(size > 0) {
+    fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        throw std::runtime_error(path + ": " + strerror(errno));
+    }
+    try {
+        if(writable && flock(fd, LOCK_EX | LOCK_NB) == -1) {
+            throw std::runtime_error(path + ": " + (errno == EWOULDBLOCK ? "history is written by another process"
+                                                                          : strerror(errno)));
+        }
+        struct stat info {};
+        if(fstat(fd, &info) == -1) {
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+        inode = info.st_ino;
+        bool isNew = writable && info.st_size == 0;
+        if(isNew) {
+            if(size < HEADER_SIZE + 2 * BLOCK_SIZE) {
+                throw std::runtime_error(path + ": history size has to be at least "
+                                         + std::to_string(HEADER_SIZE + 2 * BLOCK_SIZE) + " bytes");
+            }
+            mappingSize = HEADER_SIZE + (size - HEADER_SIZE) / BLOCK_SIZE * BLOCK_SIZE;
+            if(ftruncate(fd, mappingSize) == -1) {
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+        } else {
+            mappingSize = info.st_size;
+            if(mappingSize < HEADER_SIZE) {
+                throw std::runtime_error(path + " is not a history file");
+            }
+        }
+        mapping = mmap(nullptr, mappingSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if(mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error(path + ": " + strerror(errno));
+        }
+        header = static_cast<Header*>(mapping);
+        if(isNew) {
+            header->version = VERSION;
+            header->blockSize = BLOCK_SIZE;
+            header->blockCount = (mappingSize - HEADER_SIZE) / BLOCK_SIZE;
+            memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        }
+        if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+           || header->blockSize != BLOCK_SIZE || header->blockCount < 2
+           || HEADER_SIZE + (size_t)header->blockCount * BLOCK_SIZE > mappingSize
+           || header->nextBlock >= header->blockCount
+           || header->seriesCount > sizeof(header->series) / sizeof(Series)) {
+            throw std::runtime_error(path + " is not a history file");
+        }
+    } catch(std::exception&) {
+        if(mapping) {
+            munmap(mapping, mappingSize);
+        }
+        close(fd);
+        throw;
+    }
+    if(writable) {
+        // previous writer may have stopped in the middle of a block, new samples go to fresh ones
+        for(uint32_t i = 0; i < header->seriesCount; i++) {
+            header->series[i].openBlock = 0;
+        }
+        for(uint32_t i = 0; i < header->blockCount; i++) {
+            auto current = block(i);
+            if(current->generation & 1) {
+                current->series = 0;
+                __atomic_store_n(&current->generation, current->generation + 1, __ATOMIC_RELEASE);
+            }
+        }
+    }
+}
+
+TimeSeries::~TimeSeries() {
+    munmap(mapping, mappingSize);
+    close(fd);
+}
+
+int64_t TimeSeries::now() {
+    timespec now {};
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+TimeSeries::BlockHeader* TimeSeries::block(uint32_t index) const {
+    return reinterpret_cast<BlockHeader*>(static_cast<char*>(mapping) + HEADER_SIZE + (size_t)index * BLOCK_SIZE);
+}
+
+uint8_t* TimeSeries::bits(uint32_t index) const {
+    return reinterpret_cast<uint8_t*>(block(index)) + sizeof(BlockHeader);
+}
+
+uint32_t TimeSeries::findSeries(const std::string& series) const {
+    auto count = __atomic_load_n(&header->seriesCount, __ATOMIC_ACQUIRE);
+    for(uint32_t i = 0; i < count; i++) {
+        if(strncmp(header->series[i].name, series.c_str(), sizeof(Series::name)) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t TimeSeries::takeBlock(uint32_t series, int64_t timestamp, double value) {
+    auto index = header->nextBlock;
+    header->nextBlock = (index + 1) % header->blockCount;
+    auto taken = block(index);
+    // oldest block may still be open for another series, it starts a new one with its next sample
+    if(taken->series != 0 && header->series[taken->series - 1].openBlock == index + 1) {
+        header->series[taken->series - 1].openBlock = 0;
+    }
+    auto generation = taken->generation + 1;
+    __atomic_store_n(&taken->generation, generation, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(bits(index), 0, BLOCK_SIZE - sizeof(BlockHeader));
+    taken->series = series;
+    taken->bitLength = 0;
+    taken->leading = NO_WINDOW;
+    taken->trailing = 0;
+    taken->firstTimestamp = timestamp;
+    taken->lastTimestamp = timestamp;
+    taken->lastDelta = 0;
+    taken->firstValue = toBits(value);
+    taken->lastValue = toBits(value);
+    taken->count = 1;
+    __atomic_store_n(&taken->generation, generation + 1, __ATOMIC_RELEASE);
+    header->series[series - 1].openBlock = index + 1;
+    return index;
+}
+
+void TimeSeries::append(const std::string& series, int64_t timestamp, double value) {
+    if(!writable) {
+        throw std::runtime_error(path + " is opened only for reading");
+    }
+    std::lock_guard<std::mutex> lock(appendMutex);
+    auto known = seriesIndexes.find(series);
+    uint32_t id;
+    if(known != seriesIndexes.end()) {
+        id = known->second;
+    } else {
+        id = findSeries(series);
+        if(id == 0) {
+            if(series.size() >= sizeof(Series::name)) {
+                throw std::runtime_error("Series name " + series + " is too long");
+            }
+            if(header->seriesCount == sizeof(header->series) / sizeof(Series)) {
+                throw std::runtime_error(path + " has no room for series " + series);
+            }
+            auto& entry = header->series[header->seriesCount];
+            memset(&entry, 0, sizeof(entry));
+            memcpy(entry.name, series.data(), series.size());
+            __atomic_store_n(&header->seriesCount, header->seriesCount + 1, __ATOMIC_RELEASE);
+            id = header->seriesCount;
+        }
+        seriesIndexes[series] = id;
+    }
+
+    auto open = header->series[id - 1].openBlock;
+    if(open == 0) {
+        takeBlock(id, timestamp, value);
+        return;
+    }
+    auto current = block(open - 1);
+    if(current->bitLength + MAX_SAMPLE_BITS > (BLOCK_SIZE - sizeof(BlockHeader)) * 8) {
+        takeBlock(id, timestamp, value);
+        return;
+    }
+    // clock stepping back would break time order of queries
+    timestamp = std::max(timestamp, current->lastTimestamp);
+    auto data = bits(open - 1);
+    auto position = current->bitLength;
+
+    int64_t delta = timestamp - current->lastTimestamp;
+    int64_t deltaOfDelta = delta - current->lastDelta;
+    if(deltaOfDelta == 0) {
+        putBits(data, position, 0, 1);
+    } else if(deltaOfDelta >= -63 && deltaOfDelta <= 64) {
+        putBits(data, position, 0b10, 2);
+        putBits(data, position, deltaOfDelta + 63, 7);
+    } else if(deltaOfDelta >= -255 && deltaOfDelta <= 256) {
+        putBits(data, position, 0b110, 3);
+        putBits(data, position, deltaOfDelta + 255, 9);
+    } else if(deltaOfDelta >= -2047 && deltaOfDelta <= 2048) {
+        putBits(data, position, 0b1110, 4);
+        putBits(data, position, deltaOfDelta + 2047, 12);
+    } else {
+        putBits(data, position, 0b1111, 4);
+        putBits(data, position, deltaOfDelta, 64);
+    }
+
+    auto valueBits = toBits(value);
+    auto difference = valueBits ^ current->lastValue;
+    if(difference == 0) {
+        putBits(data, position, 0, 1);
+    } else {
+        putBits(data, position, 1, 1);
+        int leading = std::min(__builtin_clzll(difference), 31);
+        int trailing = __builtin_ctzll(difference);
+        if(current->leading != NO_WINDOW && leading >= current->leading && trailing >= current->trailing) {
+            // meaningful bits fit into window of previous value
+            putBits(data, position, 0, 1);
+            putBits(data, position, difference >> current->trailing, 64 - current->leading - current->trailing);
+        } else {
+            int length = 64 - leading - trailing;
+            putBits(data, position, 1, 1);
+            putBits(data, position, leading, 5);
+            putBits(data, position, length - 1, 6);
+            putBits(data, position, difference >> trailing, length);
+            current->leading = leading;
+            current->trailing = trailing;
+        }
+    }
+
+    current->bitLength = position;
+    current->lastDelta = delta;
+    current->lastValue = valueBits;
+    __atomic_store_n(&current->lastTimestamp, timestamp, __ATOMIC_RELAXED);
+    __atomic_store_n(&current->count, current->count + 1, __ATOMIC_RELEASE);
+}
+
+void TimeSeries::scan(const std::string& series, int64_t from, int64_t to,
+                      const std::function<void(int64_t timestamp, double value)>& visit) const {
+    auto id = findSeries(series);
+    if(id == 0) {
+        return;
+    }
+    std::vector<std::pair<int64_t, uint32_t>> blocks;
+    for(uint32_t i = 0; i < header->blockCount; i++) {
+        auto current = block(i);
+        if(__atomic_load_n(&current->series, __ATOMIC_RELAXED) != id) {
+            continue;
+        }
+        auto first = __atomic_load_n(&current->firstTimestamp, __ATOMIC_RELAXED);
+        if(first <= to) {
+            blocks.emplace_back(first, i);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    std::vector<std::pair<int64_t, double>> samples;
+    for(auto& [first, index] : blocks) {
+        auto current = block(index);
+        auto generation = __atomic_load_n(&current->generation, __ATOMIC_ACQUIRE);
+        if(generation & 1) {
+            continue;
+        }
+        auto count = __atomic_load_n(&current->count, __ATOMIC_ACQUIRE);
+        if(current->series != id || __atomic_load_n(&current->lastTimestamp, __ATOMIC_RELAXED) < from) {
+            continue;
+        }
+        samples.clear();
+        BitReader reader(bits(index), (BLOCK_SIZE - sizeof(BlockHeader)) * 8);
+        int64_t timestamp = current->firstTimestamp;
+        int64_t delta = 0;
+        uint64_t valueBits = current->firstValue;
+        int leading = 0, trailing = 0;
+        bool isComplete = true;
+        for(uint32_t i = 0; i < count && timestamp <= to; i++) {
+            if(i > 0) {
+                uint64_t bit = 0, field = 0;
+                int64_t deltaOfDelta = 0;
+                isComplete = reader.read(1, bit);
+                if(isComplete && bit) {
+                    // prefix of up to four ones selects width of delta of delta
+                    int ones = 1;
+                    while(isComplete && ones < 4 && (isComplete = reader.read(1, bit)) && bit) {
+                        ones++;
+                    }
+                    const int widths[] = {0, 7, 9, 12, 64};
+                    const int64_t offsets[] = {0, 63, 255, 2047, 0};
+                    isComplete = isComplete && reader.read(widths[ones], field);
+                    deltaOfDelta = (int64_t)field - offsets[ones];
+                }
+                delta += deltaOfDelta;
+                timestamp += delta;
+                isComplete = isComplete && reader.read(1, bit);
+                if(isComplete && bit) {
+                    isComplete = reader.read(1, bit);
+                    if(isComplete && bit) {
+                        uint64_t length = 0;
+                        isComplete = reader.read(5, field) && reader.read(6, length);
+                        leading = field;
+                        trailing = 64 - leading - (int)(length + 1);
+                    }
+                    isComplete = isComplete && trailing >= 0 && reader.read(64 - leading - trailing, field);
+                    valueBits ^= field << trailing;
+                }
+                if(!isComplete || timestamp > to) {
+                    break;
+                }
+            }
+            if(timestamp >= from) {
+                samples.emplace_back(timestamp, fromBits(valueBits));
+            }
+        }
+        // block taken for newer samples while it was decoded
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(!isComplete || __atomic_load_n(&current->generation, __ATOMIC_RELAXED) != generation) {
+            continue;
+        }
+        for(auto& [sampleTimestamp, value] : samples) {
+            visit(sampleTimestamp, value);
+        }
+    }
+}
+
+TimeSeries::Aggregate TimeSeries::aggregate(const std::string& series, int64_t from, int64_t to) const {
+    Aggregate aggregate;
+    scan(series, from, to, [&aggregate](int64_t, double value) {
+        aggregate.count++;
+        aggregate.min = std::min(aggregate.min, value);
+        aggregate.max = std::max(aggregate.max, value);
+        aggregate.sum += value;
+    });
+    return aggregate;
+}
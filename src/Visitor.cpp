@@ -144,6 +144,42 @@ void ExpressionVisitor::visit(WhileExpression* whileExpression) {
 
 }
 
+void ExpressionVisitor::visit(EveryExpression* everyExpression) {
+    std::cout << "In every block\n";
+    std::cout << "Interval:\n";
+    everyExpression->left->accept(this);
+    std::cout << "Block";
+    if(everyExpression->right) {
+        everyExpression->right->accept(this);
+    } else {
+        std::cout << " is empty.\n";
+    }
+}
+
+void ExpressionVisitor::visit(ForExpression* forExpression) {
+    std::cout << "In for loop\n";
+    std::cout << "Range:\n";
+    forExpression->left->accept(this);
+    std::cout << "Block";
+    if(forExpression->right) {
+        forExpression->right->accept(this);
+    } else {
+        std::cout << " is empty.\n";
+    }
+}
+
+void ExpressionVisitor::visit(ParallelForExpression* parallelForExpression) {
+    std::cout << "In parallel for loop\n";
+    std::cout << "Range and reductions:\n";
+    parallelForExpression->left->accept(this);
+    std::cout << "Block";
+    if(parallelForExpression->right) {
+        parallelForExpression->right->accept(this);
+    } else {
+        std::cout << " is empty.\n";
+    }
+}
+
 void ExpressionVisitor::visit(FunctionCallExpression *functionCallExpression) {
 
 }
@@ -190,3 +226,12 @@ void ExpressionVisitor::visit(SystemHandlerDeclExpression *systemHandlerDeclExpr
     /* unused */
 }
 
+void ExpressionVisitor::visit(SpawnExpression *spawnExpression) {
+    std::cout << "Spawning task\n";
+    spawnExpression->call->accept(this);
+}
+
+void ExpressionVisitor::visit(AwaitExpression *awaitExpression) {
+    std::cout << "Awaiting task\n";
+    awaitExpression->handle->accept(this);
+}
\ No newline at end of file
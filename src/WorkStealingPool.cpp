@@ -0,0 +1,196 @@
+//
+// Created by robert on 19.10.2026.
+//
+
+#include "../include/WorkStealingPool.h"
+#include <chrono>
+#include <unistd.h>
+
+namespace {
+    thread_local WorkStealingPool* currentPool {nullptr};
+    thread_local size_t currentWorker {0};
+}
+
+WorkStealingPool::WorkStealingPool(size_t workerCount) {
+    if(workerCount == 0) {
+        workerCount = 1;
+    }
+    for(size_t i = 0; i < workerCount; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for(size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sparesFinished.wait(lock, [this] { return spares == 0; });
+}
+
+WorkStealingPool& WorkStealingPool::instance() {
+    // threads are not copied by fork(), so a child process must not reuse the parent pool
+    static WorkStealingPool* pool {nullptr};
+    static pid_t owner {0};
+    static std::mutex instanceMutex;
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    if(!pool || owner != getpid()) {
+        pool = new WorkStealingPool(std::thread::hardware_concurrency());
+        owner = getpid();
+    }
+    return *pool;
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t index;
+    if(currentPool == this) {
+        index = currentWorker;
+    } else {
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    pendingTasks.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        startSpareIfStuck();
+    }
+    sleepCondition.notify_one();
+}
+
+void WorkStealingPool::beginBlocking() {
+    if(currentPool != this) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    blocked++;
+    startSpareIfStuck();
+}
+
+void WorkStealingPool::endBlocking() {
+    if(currentPool != this) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    blocked--;
+}
+
+void WorkStealingPool::startSpareIfStuck() {
+    if(stopping || blocked < workers.size() + spares || pendingTasks.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    spares++;
+    // destructor waits for spares to finish instead of joining them
+    std::thread([this] { spareLoop(); }).detach();
+}
+
+void WorkStealingPool::spareLoop() {
+    currentPool = this;
+    currentWorker = 0;
+    Task task;
+    while(popLocal(0, task) || steal(0, task)) {
+        task();
+        task = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    spares--;
+    sparesFinished.notify_all();
+}
+
+bool WorkStealingPool::popLocal(size_t index, Task& task) {
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    auto& tasks = queues[index]->tasks;
+    if(tasks.empty()) {
+        return false;
+    }
+    task = std::move(tasks.back());
+    tasks.pop_back();
+    pendingTasks.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, Task& task) {
+    for(size_t offset = 1; offset <= queues.size(); offset++) {
+        auto& victim = *queues[(thief + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pendingTasks.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::runPendingTask() {
+    if(pendingTasks.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    Task task;
+    size_t start = currentPool == this ? currentWorker : nextQueue.load(std::memory_order_relaxed);
+    if((currentPool == this && popLocal(start, task)) || steal(start % queues.size(), task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    while(true) {
+        Task task;
+        if(popLocal(index, task) || steal(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [&] {
+            return stopping || pendingTasks.load(std::memory_order_acquire) > 0;
+        });
+        if(stopping) {
+            return;
+        }
+    }
+}
+
+void TaskGroup::run(WorkStealingPool::Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+    }
+    pool.submit([this, task = std::move(task)] {
+        task();
+        // waiter sees zero only under mutex, so group is not destroyed before this lock is released
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0) {
+            finished.notify_all();
+        }
+    });
+}
+
+bool TaskGroup::isFinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending == 0;
+}
+
+void TaskGroup::wait() {
+    while(!isFinished()) {
+        if(pool.runPendingTask()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait_for(lock, std::chrono::milliseconds(1), [&] { return pending == 0; });
+    }
+}
@@ -2,6 +2,9 @@
 #include "../include/Launcher.h"
 
 int main(int argc, char* argv[]) {
+    if(Launcher::isHandlerMode(argc, argv)) {
+        return Launcher::runHandler(argc, argv);
+    }
     std::cout << "Scanner launched!" << std::endl;
 
     Launcher launcher;